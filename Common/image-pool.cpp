@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <mutex>
+#include "image-pool.h"
+
+/*
+ * Cada bloque lleva delante una cabecera de POOL_ALIGN bytes con su tamaño, de modo que
+ * pool_free no necesita que le digan cuánto ocupa y el puntero devuelto sigue alineado.
+ * Los bloques libres se guardan en una tabla pequeña; una petición se sirve con el bloque
+ * libre más pequeño que le baste, siempre que no sea más del doble de lo pedido.
+ */
+#define POOL_SLOTS 32
+
+typedef struct{
+    unsigned char * block;  // Inicio de la reserva (cabecera incluida)
+    size_t size;            // Bytes útiles del bloque
+} POOL_SLOT;
+
+static std::mutex pool_mutex;       // El hilo de escritura asíncrona también libera imágenes
+static POOL_SLOT pool_free_slots[POOL_SLOTS];
+static int pool_free_count = 0;
+static size_t pool_cached = 0;      // Bytes guardados en la tabla
+static POOL_STATS stats = {0, 0, 0, 0};
+
+static size_t read_pool_limit()
+{
+    const char *limit_str = getenv("C_POOL_MB");
+    return (size_t)((limit_str != NULL) ? atoi(limit_str) : 1024) << 20;
+}
+
+static size_t pool_limit()
+{
+    static const size_t limit = read_pool_limit();
+    return limit;
+}
+
+static size_t round_align(size_t n)
+{
+    return (n + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+}
+
+size_t pool_plane_stride(size_t n)
+{
+    size_t stride = round_align(n);
+    if (stride % 4096 == 0)
+        stride += POOL_ALIGN;
+    return stride;
+}
+
+// Reserva nueva de size bytes útiles (ya redondeados) más la cabecera
+static void * pool_alloc_new(size_t size)
+{
+    unsigned char * block = NULL;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        stats.bytes_allocated += size;
+        stats.allocs++;
+    }
+
+    if (posix_memalign((void **)&block, POOL_ALIGN, size + POOL_ALIGN) != 0) {
+        printf("Out of memory allocating %zu bytes\n", size);
+        exit(1);
+    }
+    *(size_t *)block = size;
+    return block + POOL_ALIGN;
+}
+
+void * pool_alloc(size_t bytes)
+{
+    size_t size = round_align(bytes > 0 ? bytes : 1);
+    unsigned char * block = NULL;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        int best = -1;
+        for (int i = 0; i < pool_free_count; i++) {
+            size_t s = pool_free_slots[i].size;
+            if (s >= size && s / 2 <= size && (best < 0 || s < pool_free_slots[best].size))
+                best = i;
+        }
+        if (best >= 0) {
+            block = pool_free_slots[best].block;
+            pool_cached -= pool_free_slots[best].size;
+            pool_free_slots[best] = pool_free_slots[--pool_free_count];
+            stats.bytes_reused += size;
+            stats.reuses++;
+            return block + POOL_ALIGN;
+        }
+    }
+    return pool_alloc_new(size);
+}
+
+void * pool_alloc_fresh(size_t bytes)
+{
+    return pool_alloc_new(round_align(bytes > 0 ? bytes : 1));
+}
+
+void pool_free(void * p)
+{
+    if (p == NULL)
+        return;
+
+    unsigned char * block = (unsigned char *)p - POOL_ALIGN;
+    size_t size = *(size_t *)block;
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (pool_free_count < POOL_SLOTS && pool_cached + size <= pool_limit()) {
+            pool_free_slots[pool_free_count].block = block;
+            pool_free_slots[pool_free_count].size = size;
+            pool_free_count++;
+            pool_cached += size;
+            return;
+        }
+    }
+    free(block);
+}
+
+POOL_STATS pool_stats()
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return stats;
+}
+
+void pool_report(FILE * out)
+{
+    POOL_STATS s = pool_stats();
+    fprintf(out, "Buffer pool: allocated %.1f MB in %ld blocks, reused %.1f MB in %ld requests\n",
+                 s.bytes_allocated / 1048576.0, s.allocs, s.bytes_reused / 1048576.0, s.reuses);
+}
+
+void pool_trim()
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    for (int i = 0; i < pool_free_count; i++)
+        free(pool_free_slots[i].block);
+    pool_free_count = 0;
+    pool_cached = 0;
+}
@@ -0,0 +1,41 @@
+#ifndef IMAGE_POOL_H
+#define IMAGE_POOL_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Reserva de buffers de imagen compartida por todas las versiones. Cada bloque está
+// alineado a POOL_ALIGN bytes y al liberarlo se guarda para la siguiente petición de un
+// tamaño parecido, así que las imágenes sucesivas (y las etapas gris, HSL y YUV de una
+// misma imagen) reutilizan memoria ya tocada en lugar de pagar de nuevo sus fallos de página.
+// C_POOL_MB limita los megabytes guardados (1024 por defecto); con 0 no se reutiliza nada.
+#define POOL_ALIGN 64
+
+// Bloque de al menos bytes bytes alineado a POOL_ALIGN. Se libera con pool_free
+void * pool_alloc(size_t bytes);
+void pool_free(void * p);
+
+// Como pool_alloc pero sin reutilizar ningún bloque guardado, para que sea el primer
+// contacto (first touch) de quien lo escriba el que decida en qué nodo NUMA quedan sus páginas
+void * pool_alloc_fresh(size_t bytes);
+
+// Distancia entre planos de n bytes dentro de un mismo bloque: múltiplo de POOL_ALIGN y
+// nunca de 4 KiB, para que los planos de una imagen no caigan en los mismos conjuntos de caché
+size_t pool_plane_stride(size_t n);
+
+// Estadísticas acumuladas desde el inicio de la ejecución
+typedef struct{
+    size_t bytes_allocated;  // Bytes pedidos al sistema
+    size_t bytes_reused;     // Bytes servidos desde bloques guardados
+    long allocs;             // Peticiones que reservaron memoria nueva
+    long reuses;             // Peticiones servidas desde la reserva
+} POOL_STATS;
+
+POOL_STATS pool_stats();
+// Escribe en out la línea "Buffer pool: ..." con las estadísticas
+void pool_report(FILE * out);
+
+// Devuelve al sistema todos los bloques guardados
+void pool_trim();
+
+#endif
@@ -0,0 +1,2253 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "pixel-kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+// GCC 12 avisa de un '__Y' sin inicializar dentro de sus propios intrínsecos AVX-512 (los
+// _mm512_undefined_*); es un falso positivo de la cabecera, no de estos núcleos
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#define PIXEL_KERNELS_X86 1
+
+// Una FMA redondearía una sola vez donde la versión escalar redondea dos, así que en los
+// núcleos de coma flotante no se permite al compilador fusionar multiplicaciones y sumas
+#define FP_TARGET(isa) __attribute__((target(isa), optimize("fp-contract=off")))
+#endif
+
+/*
+ * Nivel de ISA de los núcleos. Se detecta una sola vez con cpuid y todas las funciones
+ * select_* eligen su variante según él. C_ISA lo fuerza para comparar variantes en la
+ * misma máquina; si la CPU no soporta el nivel pedido se usa el mejor disponible.
+ */
+static const char * const ISA_NAMES[] = {"scalar", "sse4.2", "avx2", "avx512"};
+
+static int detect_isa_level()
+{
+#ifdef PIXEL_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return ISA_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return ISA_AVX2;
+    if (__builtin_cpu_supports("sse4.2"))
+        return ISA_SSE42;
+#endif
+    return ISA_SCALAR;
+}
+
+static int read_isa_level()
+{
+    int best = detect_isa_level();
+    const char *isa_str = getenv("C_ISA");
+    if (isa_str == NULL)
+        return best;
+
+    for (int level = ISA_SCALAR; level <= ISA_AVX512; level++) {
+        if (strcmp(isa_str, ISA_NAMES[level]) != 0)
+            continue;
+        if (level > best) {
+            printf("C_ISA=%s is not supported by this CPU, using %s\n", isa_str, ISA_NAMES[best]);
+            return best;
+        }
+        return level;
+    }
+    printf("Unknown C_ISA=%s, using %s\n", isa_str, ISA_NAMES[best]);
+    return best;
+}
+
+int isa_level()
+{
+    static const int level = read_isa_level();
+    return level;
+}
+
+const char * isa_name()
+{
+    return ISA_NAMES[isa_level()];
+}
+
+/*
+ * Tamaño de L2. glibc lo da con sysconf; si no lo conoce se busca en sysfs la caché de
+ * nivel 2 de la CPU 0 que no sea de instrucciones, y si tampoco se usa 1 MiB.
+ */
+#define L2_DEFAULT_BYTES ((size_t)1 << 20)
+
+static size_t detect_l2_cache_size()
+{
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (size > 0)
+        return (size_t)size;
+#endif
+    for (int index = 0; index < 8; index++) {
+        char path[96], type[32];
+        int level = 0;
+        size_t kb = 0;
+        FILE *f;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", index);
+        if ((f = fopen(path, "r")) == NULL)
+            break;
+        if (fscanf(f, "%d", &level) != 1)
+            level = 0;
+        fclose(f);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", index);
+        if ((f = fopen(path, "r")) == NULL)
+            continue;
+        if (fscanf(f, "%31s", type) != 1)
+            type[0] = '\0';
+        fclose(f);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+        if (level != 2 || strcmp(type, "Instruction") == 0 || (f = fopen(path, "r")) == NULL)
+            continue;
+        if (fscanf(f, "%zuK", &kb) != 1)
+            kb = 0;
+        fclose(f);
+        if (kb > 0)
+            return kb << 10;
+    }
+    return L2_DEFAULT_BYTES;
+}
+
+size_t l2_cache_size()
+{
+    static const size_t size = detect_l2_cache_size();
+    return size;
+}
+
+size_t tile_bytes()
+{
+    const char *tile_str = getenv("C_TILE_KB");
+    if (tile_str != NULL && atoi(tile_str) > 0)
+        return (size_t)atoi(tile_str) << 10;
+    return l2_cache_size() / 2;
+}
+
+int tile_rows(int w, size_t bytes_per_pixel)
+{
+    size_t rows = tile_bytes() / ((size_t)(w > 0 ? w : 1) * bytes_per_pixel);
+    if (rows < 1)
+        rows = 1;
+    return (rows > (size_t)INT32_MAX) ? INT32_MAX : (int)rows;
+}
+
+#ifdef PIXEL_KERNELS_X86
+// VBMI no forma parte del nivel AVX-512 (no está en Skylake-SP): se comprueba aparte
+static int has_avx512vbmi()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512vbmi");
+}
+#endif
+
+/*
+ * Versiones escalares de referencia. Se usan en CPUs sin SSSE3 y para
+ * terminar los últimos píxeles que no completan un bloque vectorial.
+ */
+static void deinterleave_rgb_scalar(const unsigned char * rgb, unsigned char * r, unsigned char * g,
+                                    unsigned char * b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        r[i] = rgb[3*i + 0];
+        g[i] = rgb[3*i + 1];
+        b[i] = rgb[3*i + 2];
+    }
+}
+
+static void interleave_rgb_scalar(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                  unsigned char * rgb, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        rgb[3*i + 0] = r[i];
+        rgb[3*i + 1] = g[i];
+        rgb[3*i + 2] = b[i];
+    }
+}
+
+#ifdef PIXEL_KERNELS_X86
+
+/*
+ * Máscaras de pshufb para 16 píxeles (48 bytes = 3 registros de 16 bytes).
+ * DEINTERLEAVE_MASK[c][k]: bytes del registro k que pertenecen al canal c.
+ * INTERLEAVE_MASK[k][c]: posiciones del registro de salida k que toma el canal c.
+ * Un -1 pone el byte a cero para poder combinar los tres resultados con OR.
+ */
+alignas(16) static const signed char DEINTERLEAVE_MASK[3][3][16] = {
+    {{ 0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  1,  4,  7, 10, 13}},
+    {{ 1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14}},
+    {{ 2,  5,  8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1,  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15}},
+};
+
+alignas(16) static const signed char INTERLEAVE_MASK[3][3][16] = {
+    {{ 0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1,  5},
+     {-1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1},
+     {-1, -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1}},
+    {{-1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10, -1},
+     { 5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10},
+     {-1,  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1}},
+    {{-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1},
+     {-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1},
+     {10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15}},
+};
+
+__attribute__((target("ssse3")))
+static void deinterleave_rgb_ssse3(const unsigned char * rgb, unsigned char * r, unsigned char * g,
+                                   unsigned char * b, size_t n)
+{
+    unsigned char * planes[3] = {r, g, b};
+    __m128i mask[3][3];
+    for (int c = 0; c < 3; c++)
+        for (int k = 0; k < 3; k++)
+            mask[c][k] = _mm_load_si128((const __m128i *)DEINTERLEAVE_MASK[c][k]);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const unsigned char * p = rgb + 3*i;
+        __m128i a0 = _mm_loadu_si128((const __m128i *)(p));
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(p + 16));
+        __m128i a2 = _mm_loadu_si128((const __m128i *)(p + 32));
+        for (int c = 0; c < 3; c++) {
+            __m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a0, mask[c][0]),
+                                                  _mm_shuffle_epi8(a1, mask[c][1])),
+                                     _mm_shuffle_epi8(a2, mask[c][2]));
+            _mm_storeu_si128((__m128i *)(planes[c] + i), v);
+        }
+    }
+    deinterleave_rgb_scalar(rgb + 3*i, r + i, g + i, b + i, n - i);
+}
+
+__attribute__((target("ssse3")))
+static void interleave_rgb_ssse3(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                 unsigned char * rgb, size_t n)
+{
+    __m128i mask[3][3];
+    for (int k = 0; k < 3; k++)
+        for (int c = 0; c < 3; c++)
+            mask[k][c] = _mm_load_si128((const __m128i *)INTERLEAVE_MASK[k][c]);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i vr = _mm_loadu_si128((const __m128i *)(r + i));
+        __m128i vg = _mm_loadu_si128((const __m128i *)(g + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+        unsigned char * p = rgb + 3*i;
+        for (int k = 0; k < 3; k++) {
+            __m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(vr, mask[k][0]),
+                                                  _mm_shuffle_epi8(vg, mask[k][1])),
+                                     _mm_shuffle_epi8(vb, mask[k][2]));
+            _mm_storeu_si128((__m128i *)(p + 16*k), v);
+        }
+    }
+    interleave_rgb_scalar(r + i, g + i, b + i, rgb + 3*i, n - i);
+}
+
+/*
+ * AVX2: vpshufb trabaja por carriles de 128 bits, así que cada registro de 256 bits
+ * lleva dos bloques de 16 píxeles (carril bajo = píxeles i..i+15, carril alto =
+ * i+16..i+31) y se aplican las mismas máscaras que en SSSE3.
+ */
+__attribute__((target("avx2")))
+static inline __m256i load_two_blocks(const unsigned char * lo, const unsigned char * hi)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)lo)),
+                                   _mm_loadu_si128((const __m128i *)hi), 1);
+}
+
+__attribute__((target("avx2")))
+static void deinterleave_rgb_avx2(const unsigned char * rgb, unsigned char * r, unsigned char * g,
+                                  unsigned char * b, size_t n)
+{
+    unsigned char * planes[3] = {r, g, b};
+    __m256i mask[3][3];
+    for (int c = 0; c < 3; c++)
+        for (int k = 0; k < 3; k++)
+            mask[c][k] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)DEINTERLEAVE_MASK[c][k]));
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        const unsigned char * p = rgb + 3*i;
+        __m256i a0 = load_two_blocks(p,      p + 48);
+        __m256i a1 = load_two_blocks(p + 16, p + 64);
+        __m256i a2 = load_two_blocks(p + 32, p + 80);
+        for (int c = 0; c < 3; c++) {
+            __m256i v = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a0, mask[c][0]),
+                                                         _mm256_shuffle_epi8(a1, mask[c][1])),
+                                        _mm256_shuffle_epi8(a2, mask[c][2]));
+            _mm256_storeu_si256((__m256i *)(planes[c] + i), v);
+        }
+    }
+    deinterleave_rgb_ssse3(rgb + 3*i, r + i, g + i, b + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void interleave_rgb_avx2(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                unsigned char * rgb, size_t n)
+{
+    __m256i mask[3][3];
+    for (int k = 0; k < 3; k++)
+        for (int c = 0; c < 3; c++)
+            mask[k][c] = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)INTERLEAVE_MASK[k][c]));
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i vr = _mm256_loadu_si256((const __m256i *)(r + i));
+        __m256i vg = _mm256_loadu_si256((const __m256i *)(g + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        unsigned char * p = rgb + 3*i;
+        for (int k = 0; k < 3; k++) {
+            __m256i v = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(vr, mask[k][0]),
+                                                        _mm256_shuffle_epi8(vg, mask[k][1])),
+                                        _mm256_shuffle_epi8(vb, mask[k][2]));
+            _mm_storeu_si128((__m128i *)(p + 16*k), _mm256_castsi256_si128(v));
+            _mm_storeu_si128((__m128i *)(p + 48 + 16*k), _mm256_extracti128_si256(v, 1));
+        }
+    }
+    interleave_rgb_ssse3(r + i, g + i, b + i, rgb + 3*i, n - i);
+}
+
+/*
+ * AVX-512BW: el mismo esquema con cuatro bloques de 16 píxeles por registro
+ * (64 píxeles por iteración); el carril j lleva los píxeles i+16j..i+16j+15.
+ */
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i load_four_blocks(const unsigned char * p, int stride)
+{
+    __m512i v = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i *)p));
+    v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i *)(p + stride)), 1);
+    v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i *)(p + 2*stride)), 2);
+    return _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i *)(p + 3*stride)), 3);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void deinterleave_rgb_avx512(const unsigned char * rgb, unsigned char * r, unsigned char * g,
+                                    unsigned char * b, size_t n)
+{
+    unsigned char * planes[3] = {r, g, b};
+    __m512i mask[3][3];
+    for (int c = 0; c < 3; c++)
+        for (int k = 0; k < 3; k++)
+            mask[c][k] = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i *)DEINTERLEAVE_MASK[c][k]));
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        const unsigned char * p = rgb + 3*i;
+        __m512i a0 = load_four_blocks(p,      48);
+        __m512i a1 = load_four_blocks(p + 16, 48);
+        __m512i a2 = load_four_blocks(p + 32, 48);
+        for (int c = 0; c < 3; c++) {
+            __m512i v = _mm512_or_si512(_mm512_or_si512(_mm512_shuffle_epi8(a0, mask[c][0]),
+                                                         _mm512_shuffle_epi8(a1, mask[c][1])),
+                                        _mm512_shuffle_epi8(a2, mask[c][2]));
+            _mm512_storeu_si512((void *)(planes[c] + i), v);
+        }
+    }
+    deinterleave_rgb_avx2(rgb + 3*i, r + i, g + i, b + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void interleave_rgb_avx512(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                  unsigned char * rgb, size_t n)
+{
+    __m512i mask[3][3];
+    for (int k = 0; k < 3; k++)
+        for (int c = 0; c < 3; c++)
+            mask[k][c] = _mm512_broadcast_i32x4(_mm_load_si128((const __m128i *)INTERLEAVE_MASK[k][c]));
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i vr = _mm512_loadu_si512((const void *)(r + i));
+        __m512i vg = _mm512_loadu_si512((const void *)(g + i));
+        __m512i vb = _mm512_loadu_si512((const void *)(b + i));
+        unsigned char * p = rgb + 3*i;
+        for (int k = 0; k < 3; k++) {
+            __m512i v = _mm512_or_si512(_mm512_or_si512(_mm512_shuffle_epi8(vr, mask[k][0]),
+                                                        _mm512_shuffle_epi8(vg, mask[k][1])),
+                                        _mm512_shuffle_epi8(vb, mask[k][2]));
+            _mm_storeu_si128((__m128i *)(p + 16*k),       _mm512_castsi512_si128(v));
+            _mm_storeu_si128((__m128i *)(p + 48 + 16*k),  _mm512_extracti32x4_epi32(v, 1));
+            _mm_storeu_si128((__m128i *)(p + 96 + 16*k),  _mm512_extracti32x4_epi32(v, 2));
+            _mm_storeu_si128((__m128i *)(p + 144 + 16*k), _mm512_extracti32x4_epi32(v, 3));
+        }
+    }
+    interleave_rgb_avx2(r + i, g + i, b + i, rgb + 3*i, n - i);
+}
+
+#endif
+
+typedef void (*deinterleave_fn)(const unsigned char *, unsigned char *, unsigned char *, unsigned char *, size_t);
+typedef void (*interleave_fn)(const unsigned char *, const unsigned char *, const unsigned char *, unsigned char *, size_t);
+
+static deinterleave_fn select_deinterleave()
+{
+    switch (isa_level()) {
+#ifdef PIXEL_KERNELS_X86
+    case ISA_AVX512: return deinterleave_rgb_avx512;
+    case ISA_AVX2:   return deinterleave_rgb_avx2;
+    case ISA_SSE42:  return deinterleave_rgb_ssse3;
+#endif
+    default:         return deinterleave_rgb_scalar;
+    }
+}
+
+static interleave_fn select_interleave()
+{
+    switch (isa_level()) {
+#ifdef PIXEL_KERNELS_X86
+    case ISA_AVX512: return interleave_rgb_avx512;
+    case ISA_AVX2:   return interleave_rgb_avx2;
+    case ISA_SSE42:  return interleave_rgb_ssse3;
+#endif
+    default:         return interleave_rgb_scalar;
+    }
+}
+
+void deinterleave_rgb(const unsigned char * rgb, unsigned char * r, unsigned char * g,
+                      unsigned char * b, size_t n)
+{
+    // La variante se elige una sola vez (inicialización estática segura entre hilos)
+    static const deinterleave_fn fn = select_deinterleave();
+    fn(rgb, r, g, b, n);
+}
+
+void interleave_rgb(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                    unsigned char * rgb, size_t n)
+{
+    static const interleave_fn fn = select_interleave();
+    fn(r, g, b, rgb, n);
+}
+
+/*
+ * Aplicación de una LUT de 256 bytes. La tabla se parte en 16 trozos de 16 entradas:
+ * pshufb busca en un trozo con los 4 bits bajos del píxel y los 4 bits altos eligen
+ * qué trozo se queda. Con AVX-512 VBMI, vpermi2b busca en 128 entradas a la vez y
+ * basta con dos búsquedas y una mezcla según el bit alto.
+ */
+static void apply_lut_u8_scalar(const unsigned char * lut, const unsigned char * in, unsigned char * out, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] = lut[in[i]];
+}
+
+#ifdef PIXEL_KERNELS_X86
+
+__attribute__((target("ssse3")))
+static void apply_lut_u8_ssse3(const unsigned char * lut, const unsigned char * in, unsigned char * out, size_t n)
+{
+    __m128i table[16];
+    for (int k = 0; k < 16; k++)
+        table[k] = _mm_loadu_si128((const __m128i *)(lut + 16*k));
+    const __m128i low_mask = _mm_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i lo = _mm_and_si128(v, low_mask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low_mask);
+        __m128i res = _mm_setzero_si128();
+        for (int k = 0; k < 16; k++) {
+            __m128i sel = _mm_cmpeq_epi8(hi, _mm_set1_epi8((char)k));
+            res = _mm_or_si128(res, _mm_and_si128(sel, _mm_shuffle_epi8(table[k], lo)));
+        }
+        _mm_storeu_si128((__m128i *)(out + i), res);
+    }
+    apply_lut_u8_scalar(lut, in + i, out + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void apply_lut_u8_avx2(const unsigned char * lut, const unsigned char * in, unsigned char * out, size_t n)
+{
+    // vpshufb busca dentro de cada carril de 128 bits: el trozo se repite en ambos
+    __m256i table[16];
+    for (int k = 0; k < 16; k++)
+        table[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(lut + 16*k)));
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+        __m256i lo = _mm256_and_si256(v, low_mask);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        __m256i res = _mm256_setzero_si256();
+        for (int k = 0; k < 16; k++) {
+            __m256i sel = _mm256_cmpeq_epi8(hi, _mm256_set1_epi8((char)k));
+            res = _mm256_or_si256(res, _mm256_and_si256(sel, _mm256_shuffle_epi8(table[k], lo)));
+        }
+        _mm256_storeu_si256((__m256i *)(out + i), res);
+    }
+    apply_lut_u8_scalar(lut, in + i, out + i, n - i);
+}
+
+// AVX-512BW sin VBMI: los 16 trozos de AVX2 con la selección hecha por máscaras
+__attribute__((target("avx512f,avx512bw")))
+static void apply_lut_u8_avx512bw(const unsigned char * lut, const unsigned char * in, unsigned char * out, size_t n)
+{
+    __m512i table[16];
+    for (int k = 0; k < 16; k++)
+        table[k] = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i *)(lut + 16*k)));
+    const __m512i low_mask = _mm512_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void *)(in + i));
+        __m512i lo = _mm512_and_si512(v, low_mask);
+        __m512i hi = _mm512_and_si512(_mm512_srli_epi16(v, 4), low_mask);
+        __m512i res = _mm512_setzero_si512();
+        for (int k = 0; k < 16; k++)
+            res = _mm512_mask_shuffle_epi8(res, _mm512_cmpeq_epi8_mask(hi, _mm512_set1_epi8((char)k)), table[k], lo);
+        _mm512_storeu_si512((void *)(out + i), res);
+    }
+    apply_lut_u8_avx2(lut, in + i, out + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+static void apply_lut_u8_vbmi(const unsigned char * lut, const unsigned char * in, unsigned char * out, size_t n)
+{
+    __m512i t0 = _mm512_loadu_si512((const void *)(lut));
+    __m512i t1 = _mm512_loadu_si512((const void *)(lut + 64));
+    __m512i t2 = _mm512_loadu_si512((const void *)(lut + 128));
+    __m512i t3 = _mm512_loadu_si512((const void *)(lut + 192));
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i v = _mm512_loadu_si512((const void *)(in + i));
+        // Los 7 bits bajos indexan 128 entradas; el bit alto elige la mitad de la tabla
+        __m512i lo_half = _mm512_permutex2var_epi8(t0, v, t1);
+        __m512i hi_half = _mm512_permutex2var_epi8(t2, v, t3);
+        __m512i res = _mm512_mask_blend_epi8(_mm512_movepi8_mask(v), lo_half, hi_half);
+        _mm512_storeu_si512((void *)(out + i), res);
+    }
+    apply_lut_u8_scalar(lut, in + i, out + i, n - i);
+}
+
+#endif
+
+typedef void (*apply_lut_fn)(const unsigned char *, const unsigned char *, unsigned char *, size_t);
+
+static apply_lut_fn select_apply_lut()
+{
+    switch (isa_level()) {
+#ifdef PIXEL_KERNELS_X86
+    case ISA_AVX512: return has_avx512vbmi() ? apply_lut_u8_vbmi : apply_lut_u8_avx512bw;
+    case ISA_AVX2:   return apply_lut_u8_avx2;
+    case ISA_SSE42:  return apply_lut_u8_ssse3;
+#endif
+    default:         return apply_lut_u8_scalar;
+    }
+}
+
+void apply_lut_u8(const unsigned char * lut, const unsigned char * in, unsigned char * out, size_t n)
+{
+    static const apply_lut_fn fn = select_apply_lut();
+    fn(lut, in, out, n);
+}
+
+/*
+ * Conversiones RGB <-> YUV en punto fijo Q14: cada coeficiente se multiplica por
+ * 2^14 y se redondea, los productos se acumulan en 32 bits y el resultado se
+ * desplaza 14 bits a la derecha. Las versiones vectoriales usan pmaddwd sobre pares
+ * de canales de 16 bits y empaquetan con saturación, que hace de clip a [0, 255].
+ * La versión escalar reproduce exactamente la misma aritmética.
+ */
+#define YUV_Q 14
+#define YUV_ONE (1 << YUV_Q)
+
+// rgb2yuv: 0.299, 0.587, 0.114 / -0.169, -0.331, 0.499 / 0.499, -0.418, -0.0813
+#define YUV_YR 4899
+#define YUV_YG 9617
+#define YUV_YB 1868
+#define YUV_UR (-2769)
+#define YUV_UG (-5423)
+#define YUV_UB 8176
+#define YUV_VR 8176
+#define YUV_VG (-6849)
+#define YUV_VB (-1332)
+
+// yuv2rgb: 1.402 / -0.344, -0.714 / 1.772
+#define YUV_RV 22970
+#define YUV_GU (-5636)
+#define YUV_GV (-11698)
+#define YUV_BU 29032
+
+static inline unsigned char clip_u8(int x)
+{
+    return (unsigned char)((x < 0) ? 0 : (x > 255) ? 255 : x);
+}
+
+static void rgb2yuv_fixed_scalar(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                 unsigned char * y, unsigned char * u, unsigned char * v, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        int R = r[i], G = g[i], B = b[i];
+        y[i] = clip_u8((YUV_YR*R + YUV_YG*G + YUV_YB*B) >> YUV_Q);
+        u[i] = clip_u8((YUV_UR*R + YUV_UG*G + YUV_UB*B + 128*YUV_ONE) >> YUV_Q);
+        v[i] = clip_u8((YUV_VR*R + YUV_VG*G + YUV_VB*B + 128*YUV_ONE) >> YUV_Q);
+    }
+}
+
+static void yuv2rgb_fixed_scalar(const unsigned char * y, const unsigned char * u, const unsigned char * v,
+                                 unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        int Y = y[i] * YUV_ONE, U = u[i] - 128, V = v[i] - 128;
+        r[i] = clip_u8((Y + YUV_RV*V) >> YUV_Q);
+        g[i] = clip_u8((Y + YUV_GU*U + YUV_GV*V) >> YUV_Q);
+        b[i] = clip_u8((Y + YUV_BU*U) >> YUV_Q);
+    }
+}
+
+// Par de coeficientes de 16 bits para pmaddwd: a en la posición par, b en la impar
+#define COEF_PAIR(a, b) ((int)(((unsigned)(b) << 16) | ((unsigned)(a) & 0xffff)))
+
+#ifdef PIXEL_KERNELS_X86
+
+/*
+ * SSE2 (16 píxeles por iteración). Para cada mitad de 8 píxeles se forman los pares
+ * (R, G) y (B, 128) en 16 bits; dos pmaddwd dan la suma completa de cada canal.
+ */
+__attribute__((target("sse2")))
+static inline __m128i yuv_channel_sse2(__m128i rg_lo, __m128i rg_hi, __m128i bk_lo, __m128i bk_hi,
+                                       __m128i c_rg, __m128i c_bk)
+{
+    __m128i lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(rg_lo, c_rg), _mm_madd_epi16(bk_lo, c_bk)), YUV_Q);
+    __m128i hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(rg_hi, c_rg), _mm_madd_epi16(bk_hi, c_bk)), YUV_Q);
+    return _mm_packs_epi32(lo, hi);
+}
+
+__attribute__((target("sse2")))
+static void rgb2yuv_fixed_sse2(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                               unsigned char * y, unsigned char * u, unsigned char * v, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k128 = _mm_set1_epi16(128);
+    const __m128i y_rg = _mm_set1_epi32(COEF_PAIR(YUV_YR, YUV_YG)), y_bk = _mm_set1_epi32(COEF_PAIR(YUV_YB, 0));
+    const __m128i u_rg = _mm_set1_epi32(COEF_PAIR(YUV_UR, YUV_UG)), u_bk = _mm_set1_epi32(COEF_PAIR(YUV_UB, YUV_ONE));
+    const __m128i v_rg = _mm_set1_epi32(COEF_PAIR(YUV_VR, YUV_VG)), v_bk = _mm_set1_epi32(COEF_PAIR(YUV_VB, YUV_ONE));
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i vr = _mm_loadu_si128((const __m128i *)(r + i));
+        __m128i vg = _mm_loadu_si128((const __m128i *)(g + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+        __m128i out[3][2];
+        for (int h = 0; h < 2; h++) {
+            __m128i r16 = h ? _mm_unpackhi_epi8(vr, zero) : _mm_unpacklo_epi8(vr, zero);
+            __m128i g16 = h ? _mm_unpackhi_epi8(vg, zero) : _mm_unpacklo_epi8(vg, zero);
+            __m128i b16 = h ? _mm_unpackhi_epi8(vb, zero) : _mm_unpacklo_epi8(vb, zero);
+            __m128i rg_lo = _mm_unpacklo_epi16(r16, g16), rg_hi = _mm_unpackhi_epi16(r16, g16);
+            __m128i bk_lo = _mm_unpacklo_epi16(b16, k128), bk_hi = _mm_unpackhi_epi16(b16, k128);
+            out[0][h] = yuv_channel_sse2(rg_lo, rg_hi, bk_lo, bk_hi, y_rg, y_bk);
+            out[1][h] = yuv_channel_sse2(rg_lo, rg_hi, bk_lo, bk_hi, u_rg, u_bk);
+            out[2][h] = yuv_channel_sse2(rg_lo, rg_hi, bk_lo, bk_hi, v_rg, v_bk);
+        }
+        _mm_storeu_si128((__m128i *)(y + i), _mm_packus_epi16(out[0][0], out[0][1]));
+        _mm_storeu_si128((__m128i *)(u + i), _mm_packus_epi16(out[1][0], out[1][1]));
+        _mm_storeu_si128((__m128i *)(v + i), _mm_packus_epi16(out[2][0], out[2][1]));
+    }
+    rgb2yuv_fixed_scalar(r + i, g + i, b + i, y + i, u + i, v + i, n - i);
+}
+
+/*
+ * yuv2rgb: pares (Y, U-128) y (V-128, 0). Y entra con coeficiente 2^14 = 16384,
+ * que cabe en un entero de 16 bits con signo.
+ */
+__attribute__((target("sse2")))
+static void yuv2rgb_fixed_sse2(const unsigned char * y, const unsigned char * u, const unsigned char * v,
+                               unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k128 = _mm_set1_epi16(128);
+    const __m128i r_yu = _mm_set1_epi32(COEF_PAIR(YUV_ONE, 0)),      r_v0 = _mm_set1_epi32(COEF_PAIR(YUV_RV, 0));
+    const __m128i g_yu = _mm_set1_epi32(COEF_PAIR(YUV_ONE, YUV_GU)), g_v0 = _mm_set1_epi32(COEF_PAIR(YUV_GV, 0));
+    const __m128i b_yu = _mm_set1_epi32(COEF_PAIR(YUV_ONE, YUV_BU)), b_v0 = _mm_set1_epi32(COEF_PAIR(0, 0));
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i vy = _mm_loadu_si128((const __m128i *)(y + i));
+        __m128i vu = _mm_loadu_si128((const __m128i *)(u + i));
+        __m128i vv = _mm_loadu_si128((const __m128i *)(v + i));
+        __m128i out[3][2];
+        for (int h = 0; h < 2; h++) {
+            __m128i y16 = h ? _mm_unpackhi_epi8(vy, zero) : _mm_unpacklo_epi8(vy, zero);
+            __m128i u16 = _mm_sub_epi16(h ? _mm_unpackhi_epi8(vu, zero) : _mm_unpacklo_epi8(vu, zero), k128);
+            __m128i v16 = _mm_sub_epi16(h ? _mm_unpackhi_epi8(vv, zero) : _mm_unpacklo_epi8(vv, zero), k128);
+            __m128i yu_lo = _mm_unpacklo_epi16(y16, u16), yu_hi = _mm_unpackhi_epi16(y16, u16);
+            __m128i v0_lo = _mm_unpacklo_epi16(v16, zero), v0_hi = _mm_unpackhi_epi16(v16, zero);
+            out[0][h] = yuv_channel_sse2(yu_lo, yu_hi, v0_lo, v0_hi, r_yu, r_v0);
+            out[1][h] = yuv_channel_sse2(yu_lo, yu_hi, v0_lo, v0_hi, g_yu, g_v0);
+            out[2][h] = yuv_channel_sse2(yu_lo, yu_hi, v0_lo, v0_hi, b_yu, b_v0);
+        }
+        _mm_storeu_si128((__m128i *)(r + i), _mm_packus_epi16(out[0][0], out[0][1]));
+        _mm_storeu_si128((__m128i *)(g + i), _mm_packus_epi16(out[1][0], out[1][1]));
+        _mm_storeu_si128((__m128i *)(b + i), _mm_packus_epi16(out[2][0], out[2][1]));
+    }
+    yuv2rgb_fixed_scalar(y + i, u + i, v + i, r + i, g + i, b + i, n - i);
+}
+
+/*
+ * AVX2 (32 píxeles por iteración). Los unpack y pack de AVX2 trabajan por carriles
+ * de 128 bits, así que el orden se conserva: el unpack deja en cada carril los
+ * píxeles de ese carril y el pack final los vuelve a juntar en el mismo orden.
+ */
+__attribute__((target("avx2")))
+static inline __m256i yuv_channel_avx2(__m256i rg_lo, __m256i rg_hi, __m256i bk_lo, __m256i bk_hi,
+                                       __m256i c_rg, __m256i c_bk)
+{
+    __m256i lo = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(rg_lo, c_rg), _mm256_madd_epi16(bk_lo, c_bk)), YUV_Q);
+    __m256i hi = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(rg_hi, c_rg), _mm256_madd_epi16(bk_hi, c_bk)), YUV_Q);
+    return _mm256_packs_epi32(lo, hi);
+}
+
+__attribute__((target("avx2")))
+static void rgb2yuv_fixed_avx2(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                               unsigned char * y, unsigned char * u, unsigned char * v, size_t n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i k128 = _mm256_set1_epi16(128);
+    const __m256i y_rg = _mm256_set1_epi32(COEF_PAIR(YUV_YR, YUV_YG)), y_bk = _mm256_set1_epi32(COEF_PAIR(YUV_YB, 0));
+    const __m256i u_rg = _mm256_set1_epi32(COEF_PAIR(YUV_UR, YUV_UG)), u_bk = _mm256_set1_epi32(COEF_PAIR(YUV_UB, YUV_ONE));
+    const __m256i v_rg = _mm256_set1_epi32(COEF_PAIR(YUV_VR, YUV_VG)), v_bk = _mm256_set1_epi32(COEF_PAIR(YUV_VB, YUV_ONE));
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i vr = _mm256_loadu_si256((const __m256i *)(r + i));
+        __m256i vg = _mm256_loadu_si256((const __m256i *)(g + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i out[3][2];
+        for (int h = 0; h < 2; h++) {
+            __m256i r16 = h ? _mm256_unpackhi_epi8(vr, zero) : _mm256_unpacklo_epi8(vr, zero);
+            __m256i g16 = h ? _mm256_unpackhi_epi8(vg, zero) : _mm256_unpacklo_epi8(vg, zero);
+            __m256i b16 = h ? _mm256_unpackhi_epi8(vb, zero) : _mm256_unpacklo_epi8(vb, zero);
+            __m256i rg_lo = _mm256_unpacklo_epi16(r16, g16), rg_hi = _mm256_unpackhi_epi16(r16, g16);
+            __m256i bk_lo = _mm256_unpacklo_epi16(b16, k128), bk_hi = _mm256_unpackhi_epi16(b16, k128);
+            out[0][h] = yuv_channel_avx2(rg_lo, rg_hi, bk_lo, bk_hi, y_rg, y_bk);
+            out[1][h] = yuv_channel_avx2(rg_lo, rg_hi, bk_lo, bk_hi, u_rg, u_bk);
+            out[2][h] = yuv_channel_avx2(rg_lo, rg_hi, bk_lo, bk_hi, v_rg, v_bk);
+        }
+        _mm256_storeu_si256((__m256i *)(y + i), _mm256_packus_epi16(out[0][0], out[0][1]));
+        _mm256_storeu_si256((__m256i *)(u + i), _mm256_packus_epi16(out[1][0], out[1][1]));
+        _mm256_storeu_si256((__m256i *)(v + i), _mm256_packus_epi16(out[2][0], out[2][1]));
+    }
+    rgb2yuv_fixed_scalar(r + i, g + i, b + i, y + i, u + i, v + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void yuv2rgb_fixed_avx2(const unsigned char * y, const unsigned char * u, const unsigned char * v,
+                               unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i k128 = _mm256_set1_epi16(128);
+    const __m256i r_yu = _mm256_set1_epi32(COEF_PAIR(YUV_ONE, 0)),      r_v0 = _mm256_set1_epi32(COEF_PAIR(YUV_RV, 0));
+    const __m256i g_yu = _mm256_set1_epi32(COEF_PAIR(YUV_ONE, YUV_GU)), g_v0 = _mm256_set1_epi32(COEF_PAIR(YUV_GV, 0));
+    const __m256i b_yu = _mm256_set1_epi32(COEF_PAIR(YUV_ONE, YUV_BU)), b_v0 = _mm256_set1_epi32(COEF_PAIR(0, 0));
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i vy = _mm256_loadu_si256((const __m256i *)(y + i));
+        __m256i vu = _mm256_loadu_si256((const __m256i *)(u + i));
+        __m256i vv = _mm256_loadu_si256((const __m256i *)(v + i));
+        __m256i out[3][2];
+        for (int h = 0; h < 2; h++) {
+            __m256i y16 = h ? _mm256_unpackhi_epi8(vy, zero) : _mm256_unpacklo_epi8(vy, zero);
+            __m256i u16 = _mm256_sub_epi16(h ? _mm256_unpackhi_epi8(vu, zero) : _mm256_unpacklo_epi8(vu, zero), k128);
+            __m256i v16 = _mm256_sub_epi16(h ? _mm256_unpackhi_epi8(vv, zero) : _mm256_unpacklo_epi8(vv, zero), k128);
+            __m256i yu_lo = _mm256_unpacklo_epi16(y16, u16), yu_hi = _mm256_unpackhi_epi16(y16, u16);
+            __m256i v0_lo = _mm256_unpacklo_epi16(v16, zero), v0_hi = _mm256_unpackhi_epi16(v16, zero);
+            out[0][h] = yuv_channel_avx2(yu_lo, yu_hi, v0_lo, v0_hi, r_yu, r_v0);
+            out[1][h] = yuv_channel_avx2(yu_lo, yu_hi, v0_lo, v0_hi, g_yu, g_v0);
+            out[2][h] = yuv_channel_avx2(yu_lo, yu_hi, v0_lo, v0_hi, b_yu, b_v0);
+        }
+        _mm256_storeu_si256((__m256i *)(r + i), _mm256_packus_epi16(out[0][0], out[0][1]));
+        _mm256_storeu_si256((__m256i *)(g + i), _mm256_packus_epi16(out[1][0], out[1][1]));
+        _mm256_storeu_si256((__m256i *)(b + i), _mm256_packus_epi16(out[2][0], out[2][1]));
+    }
+    yuv2rgb_fixed_scalar(y + i, u + i, v + i, r + i, g + i, b + i, n - i);
+}
+
+/*
+ * AVX-512BW (64 píxeles por iteración): el código de AVX2 con registros de 512 bits;
+ * unpack y pack siguen trabajando por carriles de 128 bits y conservan el orden.
+ */
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i yuv_channel_avx512(__m512i rg_lo, __m512i rg_hi, __m512i bk_lo, __m512i bk_hi,
+                                       __m512i c_rg, __m512i c_bk)
+{
+    __m512i lo = _mm512_srai_epi32(_mm512_add_epi32(_mm512_madd_epi16(rg_lo, c_rg), _mm512_madd_epi16(bk_lo, c_bk)), YUV_Q);
+    __m512i hi = _mm512_srai_epi32(_mm512_add_epi32(_mm512_madd_epi16(rg_hi, c_rg), _mm512_madd_epi16(bk_hi, c_bk)), YUV_Q);
+    return _mm512_packs_epi32(lo, hi);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void rgb2yuv_fixed_avx512(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                               unsigned char * y, unsigned char * u, unsigned char * v, size_t n)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i k128 = _mm512_set1_epi16(128);
+    const __m512i y_rg = _mm512_set1_epi32(COEF_PAIR(YUV_YR, YUV_YG)), y_bk = _mm512_set1_epi32(COEF_PAIR(YUV_YB, 0));
+    const __m512i u_rg = _mm512_set1_epi32(COEF_PAIR(YUV_UR, YUV_UG)), u_bk = _mm512_set1_epi32(COEF_PAIR(YUV_UB, YUV_ONE));
+    const __m512i v_rg = _mm512_set1_epi32(COEF_PAIR(YUV_VR, YUV_VG)), v_bk = _mm512_set1_epi32(COEF_PAIR(YUV_VB, YUV_ONE));
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i vr = _mm512_loadu_si512((const void *)(r + i));
+        __m512i vg = _mm512_loadu_si512((const void *)(g + i));
+        __m512i vb = _mm512_loadu_si512((const void *)(b + i));
+        __m512i out[3][2];
+        for (int h = 0; h < 2; h++) {
+            __m512i r16 = h ? _mm512_unpackhi_epi8(vr, zero) : _mm512_unpacklo_epi8(vr, zero);
+            __m512i g16 = h ? _mm512_unpackhi_epi8(vg, zero) : _mm512_unpacklo_epi8(vg, zero);
+            __m512i b16 = h ? _mm512_unpackhi_epi8(vb, zero) : _mm512_unpacklo_epi8(vb, zero);
+            __m512i rg_lo = _mm512_unpacklo_epi16(r16, g16), rg_hi = _mm512_unpackhi_epi16(r16, g16);
+            __m512i bk_lo = _mm512_unpacklo_epi16(b16, k128), bk_hi = _mm512_unpackhi_epi16(b16, k128);
+            out[0][h] = yuv_channel_avx512(rg_lo, rg_hi, bk_lo, bk_hi, y_rg, y_bk);
+            out[1][h] = yuv_channel_avx512(rg_lo, rg_hi, bk_lo, bk_hi, u_rg, u_bk);
+            out[2][h] = yuv_channel_avx512(rg_lo, rg_hi, bk_lo, bk_hi, v_rg, v_bk);
+        }
+        _mm512_storeu_si512((void *)(y + i), _mm512_packus_epi16(out[0][0], out[0][1]));
+        _mm512_storeu_si512((void *)(u + i), _mm512_packus_epi16(out[1][0], out[1][1]));
+        _mm512_storeu_si512((void *)(v + i), _mm512_packus_epi16(out[2][0], out[2][1]));
+    }
+    rgb2yuv_fixed_avx2(r + i, g + i, b + i, y + i, u + i, v + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void yuv2rgb_fixed_avx512(const unsigned char * y, const unsigned char * u, const unsigned char * v,
+                               unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i k128 = _mm512_set1_epi16(128);
+    const __m512i r_yu = _mm512_set1_epi32(COEF_PAIR(YUV_ONE, 0)),      r_v0 = _mm512_set1_epi32(COEF_PAIR(YUV_RV, 0));
+    const __m512i g_yu = _mm512_set1_epi32(COEF_PAIR(YUV_ONE, YUV_GU)), g_v0 = _mm512_set1_epi32(COEF_PAIR(YUV_GV, 0));
+    const __m512i b_yu = _mm512_set1_epi32(COEF_PAIR(YUV_ONE, YUV_BU)), b_v0 = _mm512_set1_epi32(COEF_PAIR(0, 0));
+
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i vy = _mm512_loadu_si512((const void *)(y + i));
+        __m512i vu = _mm512_loadu_si512((const void *)(u + i));
+        __m512i vv = _mm512_loadu_si512((const void *)(v + i));
+        __m512i out[3][2];
+        for (int h = 0; h < 2; h++) {
+            __m512i y16 = h ? _mm512_unpackhi_epi8(vy, zero) : _mm512_unpacklo_epi8(vy, zero);
+            __m512i u16 = _mm512_sub_epi16(h ? _mm512_unpackhi_epi8(vu, zero) : _mm512_unpacklo_epi8(vu, zero), k128);
+            __m512i v16 = _mm512_sub_epi16(h ? _mm512_unpackhi_epi8(vv, zero) : _mm512_unpacklo_epi8(vv, zero), k128);
+            __m512i yu_lo = _mm512_unpacklo_epi16(y16, u16), yu_hi = _mm512_unpackhi_epi16(y16, u16);
+            __m512i v0_lo = _mm512_unpacklo_epi16(v16, zero), v0_hi = _mm512_unpackhi_epi16(v16, zero);
+            out[0][h] = yuv_channel_avx512(yu_lo, yu_hi, v0_lo, v0_hi, r_yu, r_v0);
+            out[1][h] = yuv_channel_avx512(yu_lo, yu_hi, v0_lo, v0_hi, g_yu, g_v0);
+            out[2][h] = yuv_channel_avx512(yu_lo, yu_hi, v0_lo, v0_hi, b_yu, b_v0);
+        }
+        _mm512_storeu_si512((void *)(r + i), _mm512_packus_epi16(out[0][0], out[0][1]));
+        _mm512_storeu_si512((void *)(g + i), _mm512_packus_epi16(out[1][0], out[1][1]));
+        _mm512_storeu_si512((void *)(b + i), _mm512_packus_epi16(out[2][0], out[2][1]));
+    }
+    yuv2rgb_fixed_avx2(y + i, u + i, v + i, r + i, g + i, b + i, n - i);
+}
+
+#endif
+
+typedef void (*convert3_fn)(const unsigned char *, const unsigned char *, const unsigned char *,
+                            unsigned char *, unsigned char *, unsigned char *, size_t);
+
+static convert3_fn select_rgb2yuv_fixed()
+{
+    switch (isa_level()) {
+#ifdef PIXEL_KERNELS_X86
+    case ISA_AVX512: return rgb2yuv_fixed_avx512;
+    case ISA_AVX2:   return rgb2yuv_fixed_avx2;
+    case ISA_SSE42:  return rgb2yuv_fixed_sse2;
+#endif
+    default:         return rgb2yuv_fixed_scalar;
+    }
+}
+
+static convert3_fn select_yuv2rgb_fixed()
+{
+    switch (isa_level()) {
+#ifdef PIXEL_KERNELS_X86
+    case ISA_AVX512: return yuv2rgb_fixed_avx512;
+    case ISA_AVX2:   return yuv2rgb_fixed_avx2;
+    case ISA_SSE42:  return yuv2rgb_fixed_sse2;
+#endif
+    default:         return yuv2rgb_fixed_scalar;
+    }
+}
+
+void rgb2yuv_fixed(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                   unsigned char * y, unsigned char * u, unsigned char * v, size_t n)
+{
+    static const convert3_fn fn = select_rgb2yuv_fixed();
+    fn(r, g, b, y, u, v, n);
+}
+
+void yuv2rgb_fixed(const unsigned char * y, const unsigned char * u, const unsigned char * v,
+                   unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    static const convert3_fn fn = select_yuv2rgb_fixed();
+    fn(y, u, v, r, g, b, n);
+}
+
+/*
+ * Conversiones RGB <-> YUV en double, las de la versión original. Las variantes
+ * vectoriales repiten las mismas operaciones en el mismo orden (restar c*x es sumar
+ * (-c)*x, que da exactamente el mismo double), truncan con cvttpd y saturan a
+ * [0, 255] con pack, que es lo mismo que el cast o clip_rgb para estos rangos.
+ */
+static void rgb2yuv_double_scalar(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                  unsigned char * y, unsigned char * u, unsigned char * v, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        y[i] = (unsigned char)( 0.299*r[i] + 0.587*g[i] +  0.114*b[i]);
+        u[i] = (unsigned char)(-0.169*r[i] - 0.331*g[i] +  0.499*b[i] + 128);
+        v[i] = (unsigned char)( 0.499*r[i] - 0.418*g[i] - 0.0813*b[i] + 128);
+    }
+}
+
+static void yuv2rgb_double_scalar(const unsigned char * y, const unsigned char * u, const unsigned char * v,
+                                  unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        int Y = y[i], U = u[i] - 128, V = v[i] - 128;
+        r[i] = clip_u8((int)( Y + 1.402*V));
+        g[i] = clip_u8((int)( Y - 0.344*U - 0.714*V));
+        b[i] = clip_u8((int)( Y + 1.772*U));
+    }
+}
+
+static void rgb2y_double_scalar(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                unsigned char * y, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        y[i] = (unsigned char)( 0.299*r[i] + 0.587*g[i] +  0.114*b[i]);
+}
+
+#ifdef PIXEL_KERNELS_X86
+
+/*
+ * SSE4.2 (4 píxeles por iteración, en dos mitades de 2 doubles).
+ */
+FP_TARGET("sse4.2")
+static inline void load4_pd_sse42(const unsigned char * p, __m128d * lo, __m128d * hi)
+{
+    int word;
+    memcpy(&word, p, sizeof(word));
+    __m128i x = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(word));
+    *lo = _mm_cvtepi32_pd(x);
+    *hi = _mm_cvtepi32_pd(_mm_srli_si128(x, 8));
+}
+
+FP_TARGET("sse4.2")
+static inline void store4_pd_u8_sse42(unsigned char * p, __m128d lo, __m128d hi)
+{
+    __m128i x = _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+    x = _mm_packus_epi32(x, x);
+    int word = _mm_cvtsi128_si32(_mm_packus_epi16(x, x));
+    memcpy(p, &word, sizeof(word));
+}
+
+// (c0*x0 + c1*x1) + c2*x2
+FP_TARGET("sse4.2")
+static inline __m128d dot3_sse42(__m128d x0, __m128d x1, __m128d x2, double c0, double c1, double c2)
+{
+    return _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_set1_pd(c0), x0), _mm_mul_pd(_mm_set1_pd(c1), x1)),
+                      _mm_mul_pd(_mm_set1_pd(c2), x2));
+}
+
+FP_TARGET("sse4.2")
+static void rgb2yuv_double_sse42(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                 unsigned char * y, unsigned char * u, unsigned char * v, size_t n)
+{
+    const __m128d k128 = _mm_set1_pd(128.0);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128d R[2], G[2], B[2], Y[2], U[2], V[2];
+        load4_pd_sse42(r + i, &R[0], &R[1]);
+        load4_pd_sse42(g + i, &G[0], &G[1]);
+        load4_pd_sse42(b + i, &B[0], &B[1]);
+        for (int h = 0; h < 2; h++) {
+            Y[h] = dot3_sse42(R[h], G[h], B[h], 0.299, 0.587, 0.114);
+            U[h] = _mm_add_pd(dot3_sse42(R[h], G[h], B[h], -0.169, -0.331, 0.499), k128);
+            V[h] = _mm_add_pd(dot3_sse42(R[h], G[h], B[h], 0.499, -0.418, -0.0813), k128);
+        }
+        store4_pd_u8_sse42(y + i, Y[0], Y[1]);
+        store4_pd_u8_sse42(u + i, U[0], U[1]);
+        store4_pd_u8_sse42(v + i, V[0], V[1]);
+    }
+    rgb2yuv_double_scalar(r + i, g + i, b + i, y + i, u + i, v + i, n - i);
+}
+
+FP_TARGET("sse4.2")
+static void yuv2rgb_double_sse42(const unsigned char * y, const unsigned char * u, const unsigned char * v,
+                                 unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    const __m128d k128 = _mm_set1_pd(128.0);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128d Y[2], U[2], V[2], R[2], G[2], B[2];
+        load4_pd_sse42(y + i, &Y[0], &Y[1]);
+        load4_pd_sse42(u + i, &U[0], &U[1]);
+        load4_pd_sse42(v + i, &V[0], &V[1]);
+        for (int h = 0; h < 2; h++) {
+            U[h] = _mm_sub_pd(U[h], k128);
+            V[h] = _mm_sub_pd(V[h], k128);
+            R[h] = _mm_add_pd(Y[h], _mm_mul_pd(_mm_set1_pd(1.402), V[h]));
+            G[h] = _mm_add_pd(_mm_add_pd(Y[h], _mm_mul_pd(_mm_set1_pd(-0.344), U[h])),
+                              _mm_mul_pd(_mm_set1_pd(-0.714), V[h]));
+            B[h] = _mm_add_pd(Y[h], _mm_mul_pd(_mm_set1_pd(1.772), U[h]));
+        }
+        store4_pd_u8_sse42(r + i, R[0], R[1]);
+        store4_pd_u8_sse42(g + i, G[0], G[1]);
+        store4_pd_u8_sse42(b + i, B[0], B[1]);
+    }
+    yuv2rgb_double_scalar(y + i, u + i, v + i, r + i, g + i, b + i, n - i);
+}
+
+FP_TARGET("sse4.2")
+static void rgb2y_double_sse42(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                               unsigned char * y, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128d R[2], G[2], B[2];
+        load4_pd_sse42(r + i, &R[0], &R[1]);
+        load4_pd_sse42(g + i, &G[0], &G[1]);
+        load4_pd_sse42(b + i, &B[0], &B[1]);
+        store4_pd_u8_sse42(y + i, dot3_sse42(R[0], G[0], B[0], 0.299, 0.587, 0.114),
+                                  dot3_sse42(R[1], G[1], B[1], 0.299, 0.587, 0.114));
+    }
+    rgb2y_double_scalar(r + i, g + i, b + i, y + i, n - i);
+}
+
+/*
+ * AVX2 (8 píxeles por iteración, en dos mitades de 4 doubles).
+ */
+FP_TARGET("avx2")
+static inline void load8_pd_avx2(const unsigned char * p, __m256d * lo, __m256d * hi)
+{
+    __m128i x = _mm_loadl_epi64((const __m128i *)p);
+    *lo = _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(x));
+    *hi = _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(_mm_srli_si128(x, 4)));
+}
+
+FP_TARGET("avx2")
+static inline void store8_pd_u8_avx2(unsigned char * p, __m256d lo, __m256d hi)
+{
+    __m128i x = _mm_packus_epi32(_mm256_cvttpd_epi32(lo), _mm256_cvttpd_epi32(hi));
+    _mm_storel_epi64((__m128i *)p, _mm_packus_epi16(x, x));
+}
+
+FP_TARGET("avx2")
+static inline __m256d dot3_avx2(__m256d x0, __m256d x1, __m256d x2, double c0, double c1, double c2)
+{
+    return _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(c0), x0), _mm256_mul_pd(_mm256_set1_pd(c1), x1)),
+                         _mm256_mul_pd(_mm256_set1_pd(c2), x2));
+}
+
+FP_TARGET("avx2")
+static void rgb2yuv_double_avx2(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                unsigned char * y, unsigned char * u, unsigned char * v, size_t n)
+{
+    const __m256d k128 = _mm256_set1_pd(128.0);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d R[2], G[2], B[2], Y[2], U[2], V[2];
+        load8_pd_avx2(r + i, &R[0], &R[1]);
+        load8_pd_avx2(g + i, &G[0], &G[1]);
+        load8_pd_avx2(b + i, &B[0], &B[1]);
+        for (int h = 0; h < 2; h++) {
+            Y[h] = dot3_avx2(R[h], G[h], B[h], 0.299, 0.587, 0.114);
+            U[h] = _mm256_add_pd(dot3_avx2(R[h], G[h], B[h], -0.169, -0.331, 0.499), k128);
+            V[h] = _mm256_add_pd(dot3_avx2(R[h], G[h], B[h], 0.499, -0.418, -0.0813), k128);
+        }
+        store8_pd_u8_avx2(y + i, Y[0], Y[1]);
+        store8_pd_u8_avx2(u + i, U[0], U[1]);
+        store8_pd_u8_avx2(v + i, V[0], V[1]);
+    }
+    rgb2yuv_double_scalar(r + i, g + i, b + i, y + i, u + i, v + i, n - i);
+}
+
+FP_TARGET("avx2")
+static void yuv2rgb_double_avx2(const unsigned char * y, const unsigned char * u, const unsigned char * v,
+                                unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    const __m256d k128 = _mm256_set1_pd(128.0);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d Y[2], U[2], V[2], R[2], G[2], B[2];
+        load8_pd_avx2(y + i, &Y[0], &Y[1]);
+        load8_pd_avx2(u + i, &U[0], &U[1]);
+        load8_pd_avx2(v + i, &V[0], &V[1]);
+        for (int h = 0; h < 2; h++) {
+            U[h] = _mm256_sub_pd(U[h], k128);
+            V[h] = _mm256_sub_pd(V[h], k128);
+            R[h] = _mm256_add_pd(Y[h], _mm256_mul_pd(_mm256_set1_pd(1.402), V[h]));
+            G[h] = _mm256_add_pd(_mm256_add_pd(Y[h], _mm256_mul_pd(_mm256_set1_pd(-0.344), U[h])),
+                                 _mm256_mul_pd(_mm256_set1_pd(-0.714), V[h]));
+            B[h] = _mm256_add_pd(Y[h], _mm256_mul_pd(_mm256_set1_pd(1.772), U[h]));
+        }
+        store8_pd_u8_avx2(r + i, R[0], R[1]);
+        store8_pd_u8_avx2(g + i, G[0], G[1]);
+        store8_pd_u8_avx2(b + i, B[0], B[1]);
+    }
+    yuv2rgb_double_scalar(y + i, u + i, v + i, r + i, g + i, b + i, n - i);
+}
+
+FP_TARGET("avx2")
+static void rgb2y_double_avx2(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                              unsigned char * y, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d R[2], G[2], B[2];
+        load8_pd_avx2(r + i, &R[0], &R[1]);
+        load8_pd_avx2(g + i, &G[0], &G[1]);
+        load8_pd_avx2(b + i, &B[0], &B[1]);
+        store8_pd_u8_avx2(y + i, dot3_avx2(R[0], G[0], B[0], 0.299, 0.587, 0.114),
+                                 dot3_avx2(R[1], G[1], B[1], 0.299, 0.587, 0.114));
+    }
+    rgb2y_double_scalar(r + i, g + i, b + i, y + i, n - i);
+}
+
+/*
+ * AVX-512 (16 píxeles por iteración, en dos mitades de 8 doubles). La saturación se
+ * hace con max(x, 0) y vpmovusdb.
+ */
+FP_TARGET("avx512f")
+static inline void load16_pd_avx512(const unsigned char * p, __m512d * lo, __m512d * hi)
+{
+    *lo = _mm512_cvtepi32_pd(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p)));
+    *hi = _mm512_cvtepi32_pd(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(p + 8))));
+}
+
+FP_TARGET("avx512f")
+static inline void store16_pd_u8_avx512(unsigned char * p, __m512d lo, __m512d hi)
+{
+    __m512i x = _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvttpd_epi32(lo)), _mm512_cvttpd_epi32(hi), 1);
+    _mm_storeu_si128((__m128i *)p, _mm512_cvtusepi32_epi8(_mm512_max_epi32(x, _mm512_setzero_si512())));
+}
+
+FP_TARGET("avx512f")
+static inline __m512d dot3_avx512(__m512d x0, __m512d x1, __m512d x2, double c0, double c1, double c2)
+{
+    return _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(_mm512_set1_pd(c0), x0), _mm512_mul_pd(_mm512_set1_pd(c1), x1)),
+                         _mm512_mul_pd(_mm512_set1_pd(c2), x2));
+}
+
+FP_TARGET("avx512f")
+static void rgb2yuv_double_avx512(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                  unsigned char * y, unsigned char * u, unsigned char * v, size_t n)
+{
+    const __m512d k128 = _mm512_set1_pd(128.0);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512d R[2], G[2], B[2], Y[2], U[2], V[2];
+        load16_pd_avx512(r + i, &R[0], &R[1]);
+        load16_pd_avx512(g + i, &G[0], &G[1]);
+        load16_pd_avx512(b + i, &B[0], &B[1]);
+        for (int h = 0; h < 2; h++) {
+            Y[h] = dot3_avx512(R[h], G[h], B[h], 0.299, 0.587, 0.114);
+            U[h] = _mm512_add_pd(dot3_avx512(R[h], G[h], B[h], -0.169, -0.331, 0.499), k128);
+            V[h] = _mm512_add_pd(dot3_avx512(R[h], G[h], B[h], 0.499, -0.418, -0.0813), k128);
+        }
+        store16_pd_u8_avx512(y + i, Y[0], Y[1]);
+        store16_pd_u8_avx512(u + i, U[0], U[1]);
+        store16_pd_u8_avx512(v + i, V[0], V[1]);
+    }
+    rgb2yuv_double_avx2(r + i, g + i, b + i, y + i, u + i, v + i, n - i);
+}
+
+FP_TARGET("avx512f")
+static void yuv2rgb_double_avx512(const unsigned char * y, const unsigned char * u, const unsigned char * v,
+                                  unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    const __m512d k128 = _mm512_set1_pd(128.0);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512d Y[2], U[2], V[2], R[2], G[2], B[2];
+        load16_pd_avx512(y + i, &Y[0], &Y[1]);
+        load16_pd_avx512(u + i, &U[0], &U[1]);
+        load16_pd_avx512(v + i, &V[0], &V[1]);
+        for (int h = 0; h < 2; h++) {
+            U[h] = _mm512_sub_pd(U[h], k128);
+            V[h] = _mm512_sub_pd(V[h], k128);
+            R[h] = _mm512_add_pd(Y[h], _mm512_mul_pd(_mm512_set1_pd(1.402), V[h]));
+            G[h] = _mm512_add_pd(_mm512_add_pd(Y[h], _mm512_mul_pd(_mm512_set1_pd(-0.344), U[h])),
+                                 _mm512_mul_pd(_mm512_set1_pd(-0.714), V[h]));
+            B[h] = _mm512_add_pd(Y[h], _mm512_mul_pd(_mm512_set1_pd(1.772), U[h]));
+        }
+        store16_pd_u8_avx512(r + i, R[0], R[1]);
+        store16_pd_u8_avx512(g + i, G[0], G[1]);
+        store16_pd_u8_avx512(b + i, B[0], B[1]);
+    }
+    yuv2rgb_double_avx2(y + i, u + i, v + i, r + i, g + i, b + i, n - i);
+}
+
+FP_TARGET("avx512f")
+static void rgb2y_double_avx512(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                unsigned char * y, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512d R[2], G[2], B[2];
+        load16_pd_avx512(r + i, &R[0], &R[1]);
+        load16_pd_avx512(g + i, &G[0], &G[1]);
+        load16_pd_avx512(b + i, &B[0], &B[1]);
+        store16_pd_u8_avx512(y + i, dot3_avx512(R[0], G[0], B[0], 0.299, 0.587, 0.114),
+                                    dot3_avx512(R[1], G[1], B[1], 0.299, 0.587, 0.114));
+    }
+    rgb2y_double_avx2(r + i, g + i, b + i, y + i, n - i);
+}
+
+#endif
+
+typedef void (*luma_fn)(const unsigned char *, const unsigned char *, const unsigned char *, unsigned char *, size_t);
+
+static convert3_fn select_rgb2yuv_double()
+{
+    switch (isa_level()) {
+#ifdef PIXEL_KERNELS_X86
+    case ISA_AVX512: return rgb2yuv_double_avx512;
+    case ISA_AVX2:   return rgb2yuv_double_avx2;
+    case ISA_SSE42:  return rgb2yuv_double_sse42;
+#endif
+    default:         return rgb2yuv_double_scalar;
+    }
+}
+
+static convert3_fn select_yuv2rgb_double()
+{
+    switch (isa_level()) {
+#ifdef PIXEL_KERNELS_X86
+    case ISA_AVX512: return yuv2rgb_double_avx512;
+    case ISA_AVX2:   return yuv2rgb_double_avx2;
+    case ISA_SSE42:  return yuv2rgb_double_sse42;
+#endif
+    default:         return yuv2rgb_double_scalar;
+    }
+}
+
+static luma_fn select_rgb2y_double()
+{
+    switch (isa_level()) {
+#ifdef PIXEL_KERNELS_X86
+    case ISA_AVX512: return rgb2y_double_avx512;
+    case ISA_AVX2:   return rgb2y_double_avx2;
+    case ISA_SSE42:  return rgb2y_double_sse42;
+#endif
+    default:         return rgb2y_double_scalar;
+    }
+}
+
+void rgb2yuv_planes(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                    unsigned char * y, unsigned char * u, unsigned char * v, size_t n)
+{
+    static const convert3_fn fn = select_rgb2yuv_double();
+    fn(r, g, b, y, u, v, n);
+}
+
+void yuv2rgb_planes(const unsigned char * y, const unsigned char * u, const unsigned char * v,
+                    unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    static const convert3_fn fn = select_yuv2rgb_double();
+    fn(y, u, v, r, g, b, n);
+}
+
+/*
+ * Motor YUV fusionado. Con C_ISA=scalar y en double cada píxel hace la conversión
+ * original de ida, la LUT y la de vuelta sin salir de registros; en el resto de casos
+ * se trabaja por bloques de PIXEL_BLOCK píxeles con los núcleos vectoriales y planos
+ * Y, U, V de un bloque.
+ */
+void rgb2yuv_luma(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                  unsigned char * y, size_t n, int fixed)
+{
+    if (fixed) {
+        for (size_t i = 0; i < n; i++)
+            y[i] = clip_u8((YUV_YR*r[i] + YUV_YG*g[i] + YUV_YB*b[i]) >> YUV_Q);
+        return;
+    }
+    static const luma_fn fn = select_rgb2y_double();
+    fn(r, g, b, y, n);
+}
+
+static void yuv_equalize_double(const unsigned char * lut, const unsigned char * r, const unsigned char * g,
+                                const unsigned char * b, unsigned char * out_r, unsigned char * out_g,
+                                unsigned char * out_b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        int R = r[i], G = g[i], B = b[i];
+        unsigned char y  = (unsigned char)( 0.299*R + 0.587*G +  0.114*B);
+        unsigned char cb = (unsigned char)(-0.169*R - 0.331*G +  0.499*B + 128);
+        unsigned char cr = (unsigned char)( 0.499*R - 0.418*G - 0.0813*B + 128);
+
+        int Y = lut[y], U = cb - 128, V = cr - 128;
+        out_r[i] = clip_u8((int)( Y + 1.402*V));
+        out_g[i] = clip_u8((int)( Y - 0.344*U - 0.714*V));
+        out_b[i] = clip_u8((int)( Y + 1.772*U));
+    }
+}
+
+static void yuv_equalize_double_tiled(const unsigned char * lut, const unsigned char * r, const unsigned char * g,
+                                      const unsigned char * b, unsigned char * out_r, unsigned char * out_g,
+                                      unsigned char * out_b, size_t n)
+{
+    alignas(64) unsigned char y[PIXEL_BLOCK];
+    alignas(64) unsigned char u[PIXEL_BLOCK];
+    alignas(64) unsigned char v[PIXEL_BLOCK];
+
+    for (size_t i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        rgb2yuv_planes(r + i, g + i, b + i, y, u, v, len);
+        apply_lut_u8(lut, y, y, len);
+        yuv2rgb_planes(y, u, v, out_r + i, out_g + i, out_b + i, len);
+    }
+}
+
+static void yuv_equalize_fixed(const unsigned char * lut, const unsigned char * r, const unsigned char * g,
+                               const unsigned char * b, unsigned char * out_r, unsigned char * out_g,
+                               unsigned char * out_b, size_t n)
+{
+    alignas(64) unsigned char y[PIXEL_BLOCK];
+    alignas(64) unsigned char u[PIXEL_BLOCK];
+    alignas(64) unsigned char v[PIXEL_BLOCK];
+
+    for (size_t i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        rgb2yuv_fixed(r + i, g + i, b + i, y, u, v, len);
+        apply_lut_u8(lut, y, y, len);
+        yuv2rgb_fixed(y, u, v, out_r + i, out_g + i, out_b + i, len);
+    }
+}
+
+void yuv_equalize_planes(const unsigned char * lut, const unsigned char * r, const unsigned char * g,
+                         const unsigned char * b, unsigned char * out_r, unsigned char * out_g,
+                         unsigned char * out_b, size_t n, int fixed)
+{
+    if (fixed)
+        yuv_equalize_fixed(lut, r, g, b, out_r, out_g, out_b, n);
+    else if (isa_level() == ISA_SCALAR)
+        yuv_equalize_double(lut, r, g, b, out_r, out_g, out_b, n);
+    else
+        yuv_equalize_double_tiled(lut, r, g, b, out_r, out_g, out_b, n);
+}
+
+static int read_yuv_mode()
+{
+    const char *verify_str = getenv("C_YUV_VERIFY");
+    if (verify_str != NULL && atoi(verify_str))
+        return YUV_VERIFY;
+    const char *fixed_str = getenv("C_YUV_FIXED");
+    if (fixed_str != NULL && atoi(fixed_str))
+        return YUV_FIXED;
+    return YUV_DOUBLE;
+}
+
+int yuv_mode()
+{
+    // Se lee una sola vez: todas las conversiones de la ejecución usan el mismo modo
+    static const int mode = read_yuv_mode();
+    return mode;
+}
+
+/*
+ * Conversiones RGB <-> HSL sobre planos. Las versiones vectoriales calculan todas
+ * las ramas de la versión escalar y eligen el resultado de cada píxel con máscaras,
+ * repitiendo exactamente las mismas operaciones en float (y en double el tono de
+ * los píxeles cuyo máximo es G o B, como hace la versión original con 1.0/3.0 y
+ * 2.0/3.0), así que el resultado es idéntico bit a bit al escalar.
+ */
+
+static void rgb2hsl_scalar(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                           float * h, float * s, unsigned char * l, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        float H, S, L;
+        float var_r = ( (float)r[i]/255 );
+        float var_g = ( (float)g[i]/255 );
+        float var_b = ( (float)b[i]/255 );
+        float var_min = (var_r < var_g) ? var_r : var_g;
+        var_min = (var_min < var_b) ? var_min : var_b;
+        float var_max = (var_r > var_g) ? var_r : var_g;
+        var_max = (var_max > var_b) ? var_max : var_b;
+        float del_max = var_max - var_min;
+
+        L = ( var_max + var_min ) / 2;
+        if ( del_max == 0 ) {
+            H = 0;
+            S = 0;
+        }
+        else {
+            if ( L < 0.5 )
+                S = del_max/(var_max+var_min);
+            else
+                S = del_max/(2-var_max-var_min );
+
+            float del_r = (((var_max-var_r)/6)+(del_max/2))/del_max;
+            float del_g = (((var_max-var_g)/6)+(del_max/2))/del_max;
+            float del_b = (((var_max-var_b)/6)+(del_max/2))/del_max;
+            if( var_r == var_max )
+                H = del_b - del_g;
+            else if( var_g == var_max )
+                H = (1.0/3.0) + del_r - del_b;
+            else
+                H = (2.0/3.0) + del_g - del_r;
+        }
+
+        if ( H < 0 )
+            H += 1;
+        if ( H > 1 )
+            H -= 1;
+
+        h[i] = H;
+        s[i] = S;
+        l[i] = (unsigned char)(L*255);
+    }
+}
+
+static float hue_to_rgb_scalar(float v1, float v2, float vH)
+{
+    if ( vH < 0 ) vH += 1;
+    if ( vH > 1 ) vH -= 1;
+    if ( ( 6 * vH ) < 1 ) return ( v1 + ( v2 - v1 ) * 6 * vH );
+    if ( ( 2 * vH ) < 1 ) return ( v2 );
+    if ( ( 3 * vH ) < 2 ) return ( v1 + ( v2 - v1 ) * ( ( 2.0f/3.0f ) - vH ) * 6 );
+    return ( v1 );
+}
+
+static void hsl2rgb_scalar(const float * h, const float * s, const unsigned char * l,
+                           unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        float H = h[i];
+        float S = s[i];
+        float L = l[i]/255.0f;
+        float var_1, var_2;
+
+        if ( S == 0 ) {
+            r[i] = L * 255;
+            g[i] = L * 255;
+            b[i] = L * 255;
+        }
+        else {
+            if ( L < 0.5 )
+                var_2 = L * ( 1 + S );
+            else
+                var_2 = ( L + S ) - ( S * L );
+
+            var_1 = 2 * L - var_2;
+            r[i] = 255 * hue_to_rgb_scalar( var_1, var_2, H + (1.0f/3.0f) );
+            g[i] = 255 * hue_to_rgb_scalar( var_1, var_2, H );
+            b[i] = 255 * hue_to_rgb_scalar( var_1, var_2, H - (1.0f/3.0f) );
+        }
+    }
+}
+
+// Solo la L de rgb2hsl: como dividir por 255 es monótono, el máximo y el mínimo de los
+// bytes dan los mismos var_max y var_min que el cálculo completo
+static void rgb2hsl_lightness_scalar(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                     unsigned char * l, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        int max = (r[i] > g[i]) ? r[i] : g[i];
+        int min = (r[i] < g[i]) ? r[i] : g[i];
+        max = (max > b[i]) ? max : b[i];
+        min = (min < b[i]) ? min : b[i];
+        float L = ( (float)max/255 + (float)min/255 ) / 2;
+        l[i] = (unsigned char)(L*255);
+    }
+}
+
+#ifdef PIXEL_KERNELS_X86
+
+/*
+ * SSE4.2 (4 píxeles por iteración). Es el núcleo AVX2 con la mitad de ancho; el tono
+ * en double se calcula en dos mitades de 2 píxeles.
+ */
+FP_TARGET("sse4.2")
+static inline __m128 load_u8_ps_sse42(const unsigned char * p)
+{
+    int word;
+    memcpy(&word, p, sizeof(word));
+    return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(word)));
+}
+
+FP_TARGET("sse4.2")
+static inline void store_ps_u8_sse42(unsigned char * p, __m128 x)
+{
+    const __m128i low_bytes = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    int word = _mm_cvtsi128_si32(_mm_shuffle_epi8(_mm_cvttps_epi32(x), low_bytes));
+    memcpy(p, &word, sizeof(word));
+}
+
+FP_TARGET("sse4.2")
+static inline __m128 hue_gb_half_sse42(__m128i mask, __m128 p, __m128 q)
+{
+    __m128d k = _mm_blendv_pd(_mm_set1_pd(2.0/3.0), _mm_set1_pd(1.0/3.0), _mm_castsi128_pd(mask));
+    return _mm_cvtpd_ps(_mm_sub_pd(_mm_add_pd(k, _mm_cvtps_pd(p)), _mm_cvtps_pd(q)));
+}
+
+FP_TARGET("sse4.2")
+static inline __m128 hue_gb_sse42(__m128 is_g, __m128 del_r, __m128 del_g, __m128 del_b)
+{
+    __m128i mask = _mm_castps_si128(is_g);
+    __m128 p = _mm_blendv_ps(del_g, del_r, is_g);
+    __m128 q = _mm_blendv_ps(del_r, del_b, is_g);
+    __m128 lo = hue_gb_half_sse42(_mm_cvtepi32_epi64(mask), p, q);
+    __m128 hi = hue_gb_half_sse42(_mm_cvtepi32_epi64(_mm_srli_si128(mask, 8)), _mm_movehl_ps(p, p), _mm_movehl_ps(q, q));
+    return _mm_movelh_ps(lo, hi);
+}
+
+FP_TARGET("sse4.2")
+static void rgb2hsl_sse42(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                          float * h, float * s, unsigned char * l, size_t n)
+{
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+    const __m128 half = _mm_set1_ps(0.5f), six = _mm_set1_ps(6.0f), k255 = _mm_set1_ps(255.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 var_r = _mm_div_ps(load_u8_ps_sse42(r + i), k255);
+        __m128 var_g = _mm_div_ps(load_u8_ps_sse42(g + i), k255);
+        __m128 var_b = _mm_div_ps(load_u8_ps_sse42(b + i), k255);
+        __m128 var_min = _mm_min_ps(_mm_min_ps(var_r, var_g), var_b);
+        __m128 var_max = _mm_max_ps(_mm_max_ps(var_r, var_g), var_b);
+        __m128 del_max = _mm_sub_ps(var_max, var_min);
+        __m128 sum = _mm_add_ps(var_max, var_min);
+        __m128 L = _mm_mul_ps(sum, half);
+        __m128 gray = _mm_cmpeq_ps(del_max, zero);
+
+        __m128 low = _mm_cmplt_ps(L, half);
+        __m128 S = _mm_div_ps(del_max, _mm_blendv_ps(_mm_sub_ps(_mm_sub_ps(two, var_max), var_min), sum, low));
+
+        __m128 del_half = _mm_mul_ps(del_max, half);
+        __m128 del_r = _mm_div_ps(_mm_add_ps(_mm_div_ps(_mm_sub_ps(var_max, var_r), six), del_half), del_max);
+        __m128 del_g = _mm_div_ps(_mm_add_ps(_mm_div_ps(_mm_sub_ps(var_max, var_g), six), del_half), del_max);
+        __m128 del_b = _mm_div_ps(_mm_add_ps(_mm_div_ps(_mm_sub_ps(var_max, var_b), six), del_half), del_max);
+
+        __m128 H = hue_gb_sse42(_mm_cmpeq_ps(var_g, var_max), del_r, del_g, del_b);
+        H = _mm_blendv_ps(H, _mm_sub_ps(del_b, del_g), _mm_cmpeq_ps(var_r, var_max));
+        H = _mm_andnot_ps(gray, H);
+        S = _mm_andnot_ps(gray, S);
+
+        H = _mm_blendv_ps(H, _mm_add_ps(H, one), _mm_cmplt_ps(H, zero));
+        H = _mm_blendv_ps(H, _mm_sub_ps(H, one), _mm_cmpgt_ps(H, one));
+
+        _mm_storeu_ps(h + i, H);
+        _mm_storeu_ps(s + i, S);
+        store_ps_u8_sse42(l + i, _mm_mul_ps(L, k255));
+    }
+    rgb2hsl_scalar(r + i, g + i, b + i, h + i, s + i, l + i, n - i);
+}
+
+FP_TARGET("sse4.2")
+static void rgb2hsl_lightness_sse42(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                    unsigned char * l, size_t n)
+{
+    const __m128 half = _mm_set1_ps(0.5f), k255 = _mm_set1_ps(255.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int wr, wg, wb;
+        memcpy(&wr, r + i, sizeof(wr));
+        memcpy(&wg, g + i, sizeof(wg));
+        memcpy(&wb, b + i, sizeof(wb));
+        __m128i vr = _mm_cvtsi32_si128(wr), vg = _mm_cvtsi32_si128(wg), vb = _mm_cvtsi32_si128(wb);
+        __m128i max = _mm_max_epu8(_mm_max_epu8(vr, vg), vb);
+        __m128i min = _mm_min_epu8(_mm_min_epu8(vr, vg), vb);
+        __m128 var_max = _mm_div_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(max)), k255);
+        __m128 var_min = _mm_div_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(min)), k255);
+        __m128 L = _mm_mul_ps(_mm_add_ps(var_max, var_min), half);
+        store_ps_u8_sse42(l + i, _mm_mul_ps(L, k255));
+    }
+    rgb2hsl_lightness_scalar(r + i, g + i, b + i, l + i, n - i);
+}
+
+FP_TARGET("sse4.2")
+static inline __m128 hue_to_rgb_sse42(__m128 v1, __m128 v2, __m128 vH)
+{
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+    const __m128 three = _mm_set1_ps(3.0f), six = _mm_set1_ps(6.0f);
+    const __m128 two_thirds = _mm_set1_ps(2.0f/3.0f);
+
+    vH = _mm_blendv_ps(vH, _mm_add_ps(vH, one), _mm_cmplt_ps(vH, zero));
+    vH = _mm_blendv_ps(vH, _mm_sub_ps(vH, one), _mm_cmpgt_ps(vH, one));
+    __m128 d = _mm_sub_ps(v2, v1);
+    __m128 rising = _mm_add_ps(v1, _mm_mul_ps(_mm_mul_ps(d, six), vH));
+    __m128 falling = _mm_add_ps(v1, _mm_mul_ps(_mm_mul_ps(d, _mm_sub_ps(two_thirds, vH)), six));
+
+    __m128 res = _mm_blendv_ps(v1, falling, _mm_cmplt_ps(_mm_mul_ps(three, vH), two));
+    res = _mm_blendv_ps(res, v2, _mm_cmplt_ps(_mm_mul_ps(two, vH), one));
+    return _mm_blendv_ps(res, rising, _mm_cmplt_ps(_mm_mul_ps(six, vH), one));
+}
+
+FP_TARGET("sse4.2")
+static void hsl2rgb_sse42(const float * h, const float * s, const unsigned char * l,
+                          unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+    const __m128 half = _mm_set1_ps(0.5f), k255 = _mm_set1_ps(255.0f);
+    const __m128 third = _mm_set1_ps(1.0f/3.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 H = _mm_loadu_ps(h + i);
+        __m128 S = _mm_loadu_ps(s + i);
+        __m128 L = _mm_div_ps(load_u8_ps_sse42(l + i), k255);
+        __m128 gray = _mm_cmpeq_ps(S, zero);
+
+        __m128 var_2 = _mm_blendv_ps(_mm_sub_ps(_mm_add_ps(L, S), _mm_mul_ps(S, L)),
+                                     _mm_mul_ps(L, _mm_add_ps(one, S)),
+                                     _mm_cmplt_ps(L, half));
+        __m128 var_1 = _mm_sub_ps(_mm_mul_ps(two, L), var_2);
+        __m128 L255 = _mm_mul_ps(L, k255);
+
+        __m128 R = _mm_mul_ps(k255, hue_to_rgb_sse42(var_1, var_2, _mm_add_ps(H, third)));
+        __m128 G = _mm_mul_ps(k255, hue_to_rgb_sse42(var_1, var_2, H));
+        __m128 B = _mm_mul_ps(k255, hue_to_rgb_sse42(var_1, var_2, _mm_sub_ps(H, third)));
+        store_ps_u8_sse42(r + i, _mm_blendv_ps(R, L255, gray));
+        store_ps_u8_sse42(g + i, _mm_blendv_ps(G, L255, gray));
+        store_ps_u8_sse42(b + i, _mm_blendv_ps(B, L255, gray));
+    }
+    hsl2rgb_scalar(h + i, s + i, l + i, r + i, g + i, b + i, n - i);
+}
+
+/*
+ * AVX2 (8 píxeles por iteración). Para el tono en double se elige primero por píxel
+ * (1/3, del_r, del_b) o (2/3, del_g, del_r) y luego se hace una sola suma en double
+ * por cada mitad de 4 píxeles.
+ */
+FP_TARGET("avx2")
+static inline __m256 load_u8_ps_avx2(const unsigned char * p)
+{
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p)));
+}
+
+// Trunca a entero y guarda el byte bajo de cada píxel, como la conversión a unsigned char
+FP_TARGET("avx2")
+static inline void store_ps_u8_avx2(unsigned char * p, __m256 x)
+{
+    const __m256i low_bytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                               0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m256i bytes = _mm256_shuffle_epi8(_mm256_cvttps_epi32(x), low_bytes);
+    __m128i packed = _mm_unpacklo_epi32(_mm256_castsi256_si128(bytes), _mm256_extracti128_si256(bytes, 1));
+    _mm_storel_epi64((__m128i *)p, packed);
+}
+
+// Tono de 4 píxeles con el máximo en G (is_g) o en B, calculado en double
+FP_TARGET("avx2")
+static inline __m128 hue_gb_avx2(__m128 is_g, __m128 del_r, __m128 del_g, __m128 del_b)
+{
+    __m256d mask = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_castps_si128(is_g)));
+    __m256d k = _mm256_blendv_pd(_mm256_set1_pd(2.0/3.0), _mm256_set1_pd(1.0/3.0), mask);
+    __m256d p = _mm256_cvtps_pd(_mm_blendv_ps(del_g, del_r, is_g));
+    __m256d q = _mm256_cvtps_pd(_mm_blendv_ps(del_r, del_b, is_g));
+    return _mm256_cvtpd_ps(_mm256_sub_pd(_mm256_add_pd(k, p), q));
+}
+
+FP_TARGET("avx2")
+static void rgb2hsl_avx2(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                         float * h, float * s, unsigned char * l, size_t n)
+{
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+    const __m256 half = _mm256_set1_ps(0.5f), six = _mm256_set1_ps(6.0f), k255 = _mm256_set1_ps(255.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 var_r = _mm256_div_ps(load_u8_ps_avx2(r + i), k255);
+        __m256 var_g = _mm256_div_ps(load_u8_ps_avx2(g + i), k255);
+        __m256 var_b = _mm256_div_ps(load_u8_ps_avx2(b + i), k255);
+        __m256 var_min = _mm256_min_ps(_mm256_min_ps(var_r, var_g), var_b);
+        __m256 var_max = _mm256_max_ps(_mm256_max_ps(var_r, var_g), var_b);
+        __m256 del_max = _mm256_sub_ps(var_max, var_min);
+        __m256 sum = _mm256_add_ps(var_max, var_min);
+        __m256 L = _mm256_mul_ps(sum, half);
+        __m256 gray = _mm256_cmp_ps(del_max, zero, _CMP_EQ_OQ);
+
+        __m256 low = _mm256_cmp_ps(L, half, _CMP_LT_OQ);
+        __m256 S = _mm256_div_ps(del_max, _mm256_blendv_ps(_mm256_sub_ps(_mm256_sub_ps(two, var_max), var_min), sum, low));
+
+        __m256 del_half = _mm256_mul_ps(del_max, half);
+        __m256 del_r = _mm256_div_ps(_mm256_add_ps(_mm256_div_ps(_mm256_sub_ps(var_max, var_r), six), del_half), del_max);
+        __m256 del_g = _mm256_div_ps(_mm256_add_ps(_mm256_div_ps(_mm256_sub_ps(var_max, var_g), six), del_half), del_max);
+        __m256 del_b = _mm256_div_ps(_mm256_add_ps(_mm256_div_ps(_mm256_sub_ps(var_max, var_b), six), del_half), del_max);
+
+        __m256 is_g = _mm256_cmp_ps(var_g, var_max, _CMP_EQ_OQ);
+        __m128 H_lo = hue_gb_avx2(_mm256_castps256_ps128(is_g), _mm256_castps256_ps128(del_r),
+                                  _mm256_castps256_ps128(del_g), _mm256_castps256_ps128(del_b));
+        __m128 H_hi = hue_gb_avx2(_mm256_extractf128_ps(is_g, 1), _mm256_extractf128_ps(del_r, 1),
+                                  _mm256_extractf128_ps(del_g, 1), _mm256_extractf128_ps(del_b, 1));
+        __m256 H = _mm256_set_m128(H_hi, H_lo);
+        H = _mm256_blendv_ps(H, _mm256_sub_ps(del_b, del_g), _mm256_cmp_ps(var_r, var_max, _CMP_EQ_OQ));
+        H = _mm256_andnot_ps(gray, H);
+        S = _mm256_andnot_ps(gray, S);
+
+        H = _mm256_blendv_ps(H, _mm256_add_ps(H, one), _mm256_cmp_ps(H, zero, _CMP_LT_OQ));
+        H = _mm256_blendv_ps(H, _mm256_sub_ps(H, one), _mm256_cmp_ps(H, one, _CMP_GT_OQ));
+
+        _mm256_storeu_ps(h + i, H);
+        _mm256_storeu_ps(s + i, S);
+        store_ps_u8_avx2(l + i, _mm256_mul_ps(L, k255));
+    }
+    rgb2hsl_scalar(r + i, g + i, b + i, h + i, s + i, l + i, n - i);
+}
+
+FP_TARGET("avx2")
+static void rgb2hsl_lightness_avx2(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                   unsigned char * l, size_t n)
+{
+    const __m256 half = _mm256_set1_ps(0.5f), k255 = _mm256_set1_ps(255.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i vr = _mm_loadl_epi64((const __m128i *)(r + i));
+        __m128i vg = _mm_loadl_epi64((const __m128i *)(g + i));
+        __m128i vb = _mm_loadl_epi64((const __m128i *)(b + i));
+        __m128i max = _mm_max_epu8(_mm_max_epu8(vr, vg), vb);
+        __m128i min = _mm_min_epu8(_mm_min_epu8(vr, vg), vb);
+        __m256 var_max = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(max)), k255);
+        __m256 var_min = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(min)), k255);
+        __m256 L = _mm256_mul_ps(_mm256_add_ps(var_max, var_min), half);
+        store_ps_u8_avx2(l + i, _mm256_mul_ps(L, k255));
+    }
+    rgb2hsl_lightness_scalar(r + i, g + i, b + i, l + i, n - i);
+}
+
+// Hue_2_RGB con las cuatro ramas evaluadas y elegidas de menor a mayor prioridad
+FP_TARGET("avx2")
+static inline __m256 hue_to_rgb_avx2(__m256 v1, __m256 v2, __m256 vH)
+{
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+    const __m256 three = _mm256_set1_ps(3.0f), six = _mm256_set1_ps(6.0f);
+    const __m256 two_thirds = _mm256_set1_ps(2.0f/3.0f);
+
+    vH = _mm256_blendv_ps(vH, _mm256_add_ps(vH, one), _mm256_cmp_ps(vH, zero, _CMP_LT_OQ));
+    vH = _mm256_blendv_ps(vH, _mm256_sub_ps(vH, one), _mm256_cmp_ps(vH, one, _CMP_GT_OQ));
+    __m256 d = _mm256_sub_ps(v2, v1);
+    __m256 rising = _mm256_add_ps(v1, _mm256_mul_ps(_mm256_mul_ps(d, six), vH));
+    __m256 falling = _mm256_add_ps(v1, _mm256_mul_ps(_mm256_mul_ps(d, _mm256_sub_ps(two_thirds, vH)), six));
+
+    __m256 res = _mm256_blendv_ps(v1, falling, _mm256_cmp_ps(_mm256_mul_ps(three, vH), two, _CMP_LT_OQ));
+    res = _mm256_blendv_ps(res, v2, _mm256_cmp_ps(_mm256_mul_ps(two, vH), one, _CMP_LT_OQ));
+    return _mm256_blendv_ps(res, rising, _mm256_cmp_ps(_mm256_mul_ps(six, vH), one, _CMP_LT_OQ));
+}
+
+FP_TARGET("avx2")
+static void hsl2rgb_avx2(const float * h, const float * s, const unsigned char * l,
+                         unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+    const __m256 half = _mm256_set1_ps(0.5f), k255 = _mm256_set1_ps(255.0f);
+    const __m256 third = _mm256_set1_ps(1.0f/3.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 H = _mm256_loadu_ps(h + i);
+        __m256 S = _mm256_loadu_ps(s + i);
+        __m256 L = _mm256_div_ps(load_u8_ps_avx2(l + i), k255);
+        __m256 gray = _mm256_cmp_ps(S, zero, _CMP_EQ_OQ);
+
+        __m256 var_2 = _mm256_blendv_ps(_mm256_sub_ps(_mm256_add_ps(L, S), _mm256_mul_ps(S, L)),
+                                        _mm256_mul_ps(L, _mm256_add_ps(one, S)),
+                                        _mm256_cmp_ps(L, half, _CMP_LT_OQ));
+        __m256 var_1 = _mm256_sub_ps(_mm256_mul_ps(two, L), var_2);
+        __m256 L255 = _mm256_mul_ps(L, k255);
+
+        __m256 R = _mm256_mul_ps(k255, hue_to_rgb_avx2(var_1, var_2, _mm256_add_ps(H, third)));
+        __m256 G = _mm256_mul_ps(k255, hue_to_rgb_avx2(var_1, var_2, H));
+        __m256 B = _mm256_mul_ps(k255, hue_to_rgb_avx2(var_1, var_2, _mm256_sub_ps(H, third)));
+        store_ps_u8_avx2(r + i, _mm256_blendv_ps(R, L255, gray));
+        store_ps_u8_avx2(g + i, _mm256_blendv_ps(G, L255, gray));
+        store_ps_u8_avx2(b + i, _mm256_blendv_ps(B, L255, gray));
+    }
+    hsl2rgb_scalar(h + i, s + i, l + i, r + i, g + i, b + i, n - i);
+}
+
+/*
+ * AVX-512 (16 píxeles por iteración). Mismo esquema con registros de máscara; el
+ * tono en double se calcula en dos mitades de 8 píxeles.
+ */
+FP_TARGET("avx512f")
+static inline __m512 load_u8_ps_avx512(const unsigned char * p)
+{
+    return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)p)));
+}
+
+FP_TARGET("avx512f")
+static inline void store_ps_u8_avx512(unsigned char * p, __m512 x)
+{
+    _mm_storeu_si128((__m128i *)p, _mm512_cvtepi32_epi8(_mm512_cvttps_epi32(x)));
+}
+
+FP_TARGET("avx512f")
+static inline __m256 hue_gb_avx512(__mmask8 is_g, __m256 del_r, __m256 del_g, __m256 del_b)
+{
+    __m512d k = _mm512_mask_blend_pd(is_g, _mm512_set1_pd(2.0/3.0), _mm512_set1_pd(1.0/3.0));
+    __m512d dr = _mm512_cvtps_pd(del_r), dg = _mm512_cvtps_pd(del_g), db = _mm512_cvtps_pd(del_b);
+    __m512d p = _mm512_mask_blend_pd(is_g, dg, dr);
+    __m512d q = _mm512_mask_blend_pd(is_g, dr, db);
+    return _mm512_cvtpd_ps(_mm512_sub_pd(_mm512_add_pd(k, p), q));
+}
+
+FP_TARGET("avx512f")
+static inline __m512 halves_to_ps_avx512(__m256 lo, __m256 hi)
+{
+    return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo)), _mm256_castps_pd(hi), 1));
+}
+
+FP_TARGET("avx512f")
+static void rgb2hsl_avx512(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                           float * h, float * s, unsigned char * l, size_t n)
+{
+    const __m512 zero = _mm512_setzero_ps(), one = _mm512_set1_ps(1.0f), two = _mm512_set1_ps(2.0f);
+    const __m512 half = _mm512_set1_ps(0.5f), six = _mm512_set1_ps(6.0f), k255 = _mm512_set1_ps(255.0f);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 var_r = _mm512_div_ps(load_u8_ps_avx512(r + i), k255);
+        __m512 var_g = _mm512_div_ps(load_u8_ps_avx512(g + i), k255);
+        __m512 var_b = _mm512_div_ps(load_u8_ps_avx512(b + i), k255);
+        __m512 var_min = _mm512_min_ps(_mm512_min_ps(var_r, var_g), var_b);
+        __m512 var_max = _mm512_max_ps(_mm512_max_ps(var_r, var_g), var_b);
+        __m512 del_max = _mm512_sub_ps(var_max, var_min);
+        __m512 sum = _mm512_add_ps(var_max, var_min);
+        __m512 L = _mm512_mul_ps(sum, half);
+        __mmask16 chroma = _mm512_cmp_ps_mask(del_max, zero, _CMP_NEQ_UQ);
+
+        __mmask16 low = _mm512_cmp_ps_mask(L, half, _CMP_LT_OQ);
+        __m512 S = _mm512_div_ps(del_max, _mm512_mask_blend_ps(low, _mm512_sub_ps(_mm512_sub_ps(two, var_max), var_min), sum));
+
+        __m512 del_half = _mm512_mul_ps(del_max, half);
+        __m512 del_r = _mm512_div_ps(_mm512_add_ps(_mm512_div_ps(_mm512_sub_ps(var_max, var_r), six), del_half), del_max);
+        __m512 del_g = _mm512_div_ps(_mm512_add_ps(_mm512_div_ps(_mm512_sub_ps(var_max, var_g), six), del_half), del_max);
+        __m512 del_b = _mm512_div_ps(_mm512_add_ps(_mm512_div_ps(_mm512_sub_ps(var_max, var_b), six), del_half), del_max);
+
+        __mmask16 is_g = _mm512_cmp_ps_mask(var_g, var_max, _CMP_EQ_OQ);
+        __m256 H_lo = hue_gb_avx512((__mmask8)is_g, _mm512_castps512_ps256(del_r),
+                                    _mm512_castps512_ps256(del_g), _mm512_castps512_ps256(del_b));
+        __m256 H_hi = hue_gb_avx512((__mmask8)(is_g >> 8),
+                                    _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(del_r), 1)),
+                                    _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(del_g), 1)),
+                                    _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(del_b), 1)));
+        __m512 H = halves_to_ps_avx512(H_lo, H_hi);
+        H = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(var_r, var_max, _CMP_EQ_OQ), H, _mm512_sub_ps(del_b, del_g));
+        H = _mm512_maskz_mov_ps(chroma, H);
+        S = _mm512_maskz_mov_ps(chroma, S);
+
+        H = _mm512_mask_add_ps(H, _mm512_cmp_ps_mask(H, zero, _CMP_LT_OQ), H, one);
+        H = _mm512_mask_sub_ps(H, _mm512_cmp_ps_mask(H, one, _CMP_GT_OQ), H, one);
+
+        _mm512_storeu_ps(h + i, H);
+        _mm512_storeu_ps(s + i, S);
+        store_ps_u8_avx512(l + i, _mm512_mul_ps(L, k255));
+    }
+    rgb2hsl_scalar(r + i, g + i, b + i, h + i, s + i, l + i, n - i);
+}
+
+FP_TARGET("avx512f")
+static void rgb2hsl_lightness_avx512(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                                     unsigned char * l, size_t n)
+{
+    const __m512 half = _mm512_set1_ps(0.5f), k255 = _mm512_set1_ps(255.0f);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i vr = _mm_loadu_si128((const __m128i *)(r + i));
+        __m128i vg = _mm_loadu_si128((const __m128i *)(g + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+        __m128i max = _mm_max_epu8(_mm_max_epu8(vr, vg), vb);
+        __m128i min = _mm_min_epu8(_mm_min_epu8(vr, vg), vb);
+        __m512 var_max = _mm512_div_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(max)), k255);
+        __m512 var_min = _mm512_div_ps(_mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(min)), k255);
+        __m512 L = _mm512_mul_ps(_mm512_add_ps(var_max, var_min), half);
+        store_ps_u8_avx512(l + i, _mm512_mul_ps(L, k255));
+    }
+    rgb2hsl_lightness_scalar(r + i, g + i, b + i, l + i, n - i);
+}
+
+FP_TARGET("avx512f")
+static inline __m512 hue_to_rgb_avx512(__m512 v1, __m512 v2, __m512 vH)
+{
+    const __m512 zero = _mm512_setzero_ps(), one = _mm512_set1_ps(1.0f), two = _mm512_set1_ps(2.0f);
+    const __m512 three = _mm512_set1_ps(3.0f), six = _mm512_set1_ps(6.0f);
+    const __m512 two_thirds = _mm512_set1_ps(2.0f/3.0f);
+
+    vH = _mm512_mask_add_ps(vH, _mm512_cmp_ps_mask(vH, zero, _CMP_LT_OQ), vH, one);
+    vH = _mm512_mask_sub_ps(vH, _mm512_cmp_ps_mask(vH, one, _CMP_GT_OQ), vH, one);
+    __m512 d = _mm512_sub_ps(v2, v1);
+    __m512 rising = _mm512_add_ps(v1, _mm512_mul_ps(_mm512_mul_ps(d, six), vH));
+    __m512 falling = _mm512_add_ps(v1, _mm512_mul_ps(_mm512_mul_ps(d, _mm512_sub_ps(two_thirds, vH)), six));
+
+    __m512 res = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(_mm512_mul_ps(three, vH), two, _CMP_LT_OQ), v1, falling);
+    res = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(_mm512_mul_ps(two, vH), one, _CMP_LT_OQ), res, v2);
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(_mm512_mul_ps(six, vH), one, _CMP_LT_OQ), res, rising);
+}
+
+FP_TARGET("avx512f")
+static void hsl2rgb_avx512(const float * h, const float * s, const unsigned char * l,
+                           unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    const __m512 zero = _mm512_setzero_ps(), one = _mm512_set1_ps(1.0f), two = _mm512_set1_ps(2.0f);
+    const __m512 half = _mm512_set1_ps(0.5f), k255 = _mm512_set1_ps(255.0f);
+    const __m512 third = _mm512_set1_ps(1.0f/3.0f);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 H = _mm512_loadu_ps(h + i);
+        __m512 S = _mm512_loadu_ps(s + i);
+        __m512 L = _mm512_div_ps(load_u8_ps_avx512(l + i), k255);
+        __mmask16 gray = _mm512_cmp_ps_mask(S, zero, _CMP_EQ_OQ);
+
+        __m512 var_2 = _mm512_mask_blend_ps(_mm512_cmp_ps_mask(L, half, _CMP_LT_OQ),
+                                            _mm512_sub_ps(_mm512_add_ps(L, S), _mm512_mul_ps(S, L)),
+                                            _mm512_mul_ps(L, _mm512_add_ps(one, S)));
+        __m512 var_1 = _mm512_sub_ps(_mm512_mul_ps(two, L), var_2);
+        __m512 L255 = _mm512_mul_ps(L, k255);
+
+        __m512 R = _mm512_mul_ps(k255, hue_to_rgb_avx512(var_1, var_2, _mm512_add_ps(H, third)));
+        __m512 G = _mm512_mul_ps(k255, hue_to_rgb_avx512(var_1, var_2, H));
+        __m512 B = _mm512_mul_ps(k255, hue_to_rgb_avx512(var_1, var_2, _mm512_sub_ps(H, third)));
+        store_ps_u8_avx512(r + i, _mm512_mask_blend_ps(gray, R, L255));
+        store_ps_u8_avx512(g + i, _mm512_mask_blend_ps(gray, G, L255));
+        store_ps_u8_avx512(b + i, _mm512_mask_blend_ps(gray, B, L255));
+    }
+    hsl2rgb_scalar(h + i, s + i, l + i, r + i, g + i, b + i, n - i);
+}
+
+#endif
+
+typedef void (*rgb2hsl_fn)(const unsigned char *, const unsigned char *, const unsigned char *,
+                           float *, float *, unsigned char *, size_t);
+typedef void (*hsl2rgb_fn)(const float *, const float *, const unsigned char *,
+                           unsigned char *, unsigned char *, unsigned char *, size_t);
+
+static rgb2hsl_fn select_rgb2hsl()
+{
+    switch (isa_level()) {
+#ifdef PIXEL_KERNELS_X86
+    case ISA_AVX512: return rgb2hsl_avx512;
+    case ISA_AVX2:   return rgb2hsl_avx2;
+    case ISA_SSE42:  return rgb2hsl_sse42;
+#endif
+    default:         return rgb2hsl_scalar;
+    }
+}
+
+typedef void (*lightness_fn)(const unsigned char *, const unsigned char *, const unsigned char *,
+                             unsigned char *, size_t);
+
+static lightness_fn select_rgb2hsl_lightness()
+{
+    switch (isa_level()) {
+#ifdef PIXEL_KERNELS_X86
+    case ISA_AVX512: return rgb2hsl_lightness_avx512;
+    case ISA_AVX2:   return rgb2hsl_lightness_avx2;
+    case ISA_SSE42:  return rgb2hsl_lightness_sse42;
+#endif
+    default:         return rgb2hsl_lightness_scalar;
+    }
+}
+
+static hsl2rgb_fn select_hsl2rgb()
+{
+    switch (isa_level()) {
+#ifdef PIXEL_KERNELS_X86
+    case ISA_AVX512: return hsl2rgb_avx512;
+    case ISA_AVX2:   return hsl2rgb_avx2;
+    case ISA_SSE42:  return hsl2rgb_sse42;
+#endif
+    default:         return hsl2rgb_scalar;
+    }
+}
+
+void rgb2hsl_planes(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                    float * h, float * s, unsigned char * l, size_t n)
+{
+    static const rgb2hsl_fn fn = select_rgb2hsl();
+    fn(r, g, b, h, s, l, n);
+}
+
+void hsl2rgb_planes(const float * h, const float * s, const unsigned char * l,
+                    unsigned char * r, unsigned char * g, unsigned char * b, size_t n)
+{
+    static const hsl2rgb_fn fn = select_hsl2rgb();
+    fn(h, s, l, r, g, b, n);
+}
+
+void rgb2hsl_lightness(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                       unsigned char * l, size_t n)
+{
+    static const lightness_fn fn = select_rgb2hsl_lightness();
+    fn(r, g, b, l, n);
+}
+
+void hsl_equalize_planes(const unsigned char * lut, const unsigned char * r, const unsigned char * g,
+                         const unsigned char * b, unsigned char * out_r, unsigned char * out_g,
+                         unsigned char * out_b, size_t n)
+{
+    // Planos H, S y L de un solo bloque: caben en L1/L2 y se reutilizan en cada bloque
+    alignas(64) float h[PIXEL_BLOCK];
+    alignas(64) float s[PIXEL_BLOCK];
+    alignas(64) unsigned char l[PIXEL_BLOCK];
+
+    for (size_t i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        rgb2hsl_planes(r + i, g + i, b + i, h, s, l, len);
+        apply_lut_u8(lut, l, l, len);
+        hsl2rgb_planes(h, s, l, out_r + i, out_g + i, out_b + i, len);
+    }
+}
+
+/*
+ * Vistas RGB. Los motores de color procesan bloques de PIXEL_BLOCK píxeles: si la vista
+ * ya son planos se usan sin copia, y si está intercalada se separan los canales del
+ * bloque en un tile de pila (y se intercala la salida) sin salir de L1/L2.
+ */
+RGB_VIEW planar_view(unsigned char * r, unsigned char * g, unsigned char * b)
+{
+    RGB_VIEW v = {r, g, b, 1};
+    return v;
+}
+
+RGB_VIEW packed_view(unsigned char * rgb)
+{
+    RGB_VIEW v = {rgb, rgb + 1, rgb + 2, 3};
+    return v;
+}
+
+RGB_VIEW view_offset(RGB_VIEW v, size_t first)
+{
+    v.r += (size_t)first * v.stride;
+    v.g += (size_t)first * v.stride;
+    v.b += (size_t)first * v.stride;
+    return v;
+}
+
+// Planos de len píxeles de la vista a partir de first (tile: 3 * PIXEL_BLOCK bytes)
+static void view_load(RGB_VIEW v, size_t first, size_t len, unsigned char * tile, unsigned char ** p)
+{
+    if (v.stride == 1) {
+        p[0] = v.r + first;
+        p[1] = v.g + first;
+        p[2] = v.b + first;
+        return;
+    }
+    p[0] = tile;
+    p[1] = tile + PIXEL_BLOCK;
+    p[2] = tile + 2*PIXEL_BLOCK;
+    deinterleave_rgb(v.r + 3*(size_t)first, p[0], p[1], p[2], len);
+}
+
+// Planos donde escribir la salida del bloque: los de la vista o los del tile
+static void view_target(RGB_VIEW v, size_t first, unsigned char * tile, unsigned char ** p)
+{
+    if (v.stride == 1) {
+        p[0] = v.r + first;
+        p[1] = v.g + first;
+        p[2] = v.b + first;
+        return;
+    }
+    p[0] = tile;
+    p[1] = tile + PIXEL_BLOCK;
+    p[2] = tile + 2*PIXEL_BLOCK;
+}
+
+// Lleva a la vista la salida escrita en los planos de view_target
+static void view_store(RGB_VIEW v, size_t first, size_t len, unsigned char ** p)
+{
+    if (v.stride == 3)
+        interleave_rgb(p[0], p[1], p[2], v.r + 3*(size_t)first, len);
+}
+
+void rgb2hsl_lightness_view(RGB_VIEW in, unsigned char * l, size_t n)
+{
+    alignas(64) unsigned char tile[3*PIXEL_BLOCK];
+    unsigned char * p[3];
+
+    for (size_t i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        view_load(in, i, len, tile, p);
+        rgb2hsl_lightness(p[0], p[1], p[2], l + i, len);
+    }
+}
+
+void rgb2yuv_luma_view(RGB_VIEW in, unsigned char * y, size_t n, int fixed)
+{
+    alignas(64) unsigned char tile[3*PIXEL_BLOCK];
+    unsigned char * p[3];
+
+    for (size_t i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        view_load(in, i, len, tile, p);
+        rgb2yuv_luma(p[0], p[1], p[2], y + i, len, fixed);
+    }
+}
+
+void hsl_equalize_view(const unsigned char * lut, RGB_VIEW in, RGB_VIEW out, size_t n)
+{
+    alignas(64) unsigned char in_tile[3*PIXEL_BLOCK];
+    alignas(64) unsigned char out_tile[3*PIXEL_BLOCK];
+    unsigned char * src[3], * dst[3];
+
+    for (size_t i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        view_load(in, i, len, in_tile, src);
+        view_target(out, i, out_tile, dst);
+        hsl_equalize_planes(lut, src[0], src[1], src[2], dst[0], dst[1], dst[2], len);
+        view_store(out, i, len, dst);
+    }
+}
+
+void yuv_equalize_view(const unsigned char * lut, RGB_VIEW in, RGB_VIEW out, size_t n, int fixed)
+{
+    alignas(64) unsigned char in_tile[3*PIXEL_BLOCK];
+    alignas(64) unsigned char out_tile[3*PIXEL_BLOCK];
+    unsigned char * src[3], * dst[3];
+
+    for (size_t i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        view_load(in, i, len, in_tile, src);
+        view_target(out, i, out_tile, dst);
+        yuv_equalize_planes(lut, src[0], src[1], src[2], dst[0], dst[1], dst[2], len, fixed);
+        view_store(out, i, len, dst);
+    }
+}
+
+long count_view_diffs(RGB_VIEW a, RGB_VIEW b, size_t n)
+{
+    long diffs = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t ia = i * a.stride, ib = i * b.stride;
+        diffs += (a.r[ia] != b.r[ib] || a.g[ia] != b.g[ib] || a.b[ia] != b.b[ib]);
+    }
+    return diffs;
+}
+
+/*
+ * Histograma por bancos. Cada carga de 8 bytes reparte sus píxeles entre los
+ * HIST_BANKS bancos, así dos píxeles seguidos nunca incrementan el mismo contador
+ * y los incrementos de una región plana pueden solaparse en el pipeline.
+ */
+
+// Por debajo de este tamaño no compensa poner a cero y mezclar los bancos
+#define HIST_BANKED_MIN 4096
+
+// Píxeles que se cuentan en los bancos de 32 bits antes de pasarlos a hist: ni un
+// contador de banco ni su suma llegan a desbordarse aunque todos los píxeles sean iguales
+#define HIST_BANKED_SPAN ((size_t)1 << 30)
+
+static void histogram_banked_span(int64_t * hist, const unsigned char * img, size_t n)
+{
+    size_t i = 0;
+
+    uint32_t banks[HIST_BANKS][256];
+    memset(banks, 0, sizeof(banks));
+
+    for (; i + 16 <= n; i += 16) {
+        uint64_t lo, hi;
+        memcpy(&lo, img + i, 8);
+        memcpy(&hi, img + i + 8, 8);
+        for (int k = 0; k < 8; k++) {
+            banks[k % HIST_BANKS][(lo >> (8*k)) & 0xff]++;
+            banks[(k + 8) % HIST_BANKS][(hi >> (8*k)) & 0xff]++;
+        }
+    }
+    for (; i < n; i++)
+        banks[0][img[i]]++;
+
+    for (int b = 0; b < 256; b++) {
+        uint32_t sum = 0;
+        for (int k = 0; k < HIST_BANKS; k++)
+            sum += banks[k][b];
+        hist[b] += sum;
+    }
+}
+
+void histogram_banked(int64_t * hist, const unsigned char * img, size_t n)
+{
+    if (n < HIST_BANKED_MIN) {
+        for (size_t i = 0; i < n; i++)
+            hist[img[i]]++;
+        return;
+    }
+
+    for (size_t i = 0; i < n; i += HIST_BANKED_SPAN)
+        histogram_banked_span(hist, img + i, (n - i < HIST_BANKED_SPAN) ? n - i : HIST_BANKED_SPAN);
+}
+
+// Bucle original de referencia para el microbenchmark
+__attribute__((noinline)) static void histogram_scalar(int64_t * hist, const unsigned char * img, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        hist[img[i]]++;
+}
+
+// Contador de ciclos (TSC en x86, nanosegundos en otras arquitecturas)
+static unsigned long long bench_ticks()
+{
+#ifdef PIXEL_KERNELS_X86
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+// Mejor de varias repeticiones, en ciclos por píxel
+static double bench_one(void (*fn)(int64_t *, const unsigned char *, size_t), const unsigned char * img, size_t n)
+{
+    int64_t hist[256];
+    unsigned long long best = ~0ull;
+    for (int rep = 0; rep < 10; rep++) {
+        memset(hist, 0, sizeof(hist));
+        unsigned long long t0 = bench_ticks();
+        fn(hist, img, n);
+        unsigned long long t1 = bench_ticks();
+        if (t1 - t0 < best)
+            best = t1 - t0;
+    }
+    return (double)best / n;
+}
+
+void histogram_bench(size_t n)
+{
+    // Los resultados se dan por píxel: sin píxeles no hay nada que medir
+    if (n == 0) {
+        printf("Histogram microbenchmark: the image must have at least one pixel\n");
+        return;
+    }
+
+    unsigned char * img = (unsigned char *)malloc(n);
+
+    printf("Histogram microbenchmark (%zu pixels, %d banks)\n", n, HIST_BANKS);
+    printf("Image,Scalar(cycles/pixel),Banked(cycles/pixel)\n");
+
+    memset(img, 128, n);
+    printf("uniform,%.3f,%.3f\n", bench_one(histogram_scalar, img, n), bench_one(histogram_banked, img, n));
+
+    srand(1);
+    for (size_t i = 0; i < n; i++)
+        img[i] = (unsigned char)(rand() & 0xff);
+    printf("random,%.3f,%.3f\n", bench_one(histogram_scalar, img, n), bench_one(histogram_banked, img, n));
+
+    free(img);
+}
@@ -0,0 +1,130 @@
+#ifndef PIXEL_KERNELS_H
+#define PIXEL_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Núcleos de píxel compartidos por todas las versiones (Sequential, OpenMP, MPI y MPI+OpenMP).
+// Cada núcleo tiene una implementación escalar de referencia y variantes vectoriales
+// que se eligen en tiempo de ejecución según la CPU. Los números de píxeles son size_t
+// y los contadores de histograma de 64 bits, para imágenes de más de 2^31 píxeles.
+
+// Número de píxeles que procesa cada iteración de los bucles paralelos que llaman a los núcleos
+#define PIXEL_BLOCK 4096
+
+// Niveles de ISA de los núcleos vectoriales. Se usa el mejor que soporte la CPU salvo que
+// C_ISA=<scalar|sse4.2|avx2|avx512> fuerce otro (por ejemplo para comparar tiempos)
+#define ISA_SCALAR 0
+#define ISA_SSE42  1
+#define ISA_AVX2   2
+#define ISA_AVX512 3
+int isa_level();
+const char * isa_name();
+
+// Tamaño en bytes de la caché L2 de la CPU, detectado en tiempo de ejecución
+size_t l2_cache_size();
+// Bytes que puede ocupar una tesela: la mitad de L2, para dejar sitio a las tablas y a los
+// bloques de trabajo de los núcleos, salvo que C_TILE_KB fije otro tamaño
+size_t tile_bytes();
+// Filas de w píxeles por tesela si cada píxel ocupa bytes_per_pixel bytes (al menos una)
+int tile_rows(int w, size_t bytes_per_pixel);
+
+// Separa n píxeles RGB intercalados (r0 g0 b0 r1 g1 b1 ...) en tres planos
+void deinterleave_rgb(const unsigned char * rgb, unsigned char * r, unsigned char * g,
+                      unsigned char * b, size_t n);
+
+// Operación inversa: intercala tres planos en n píxeles RGB
+void interleave_rgb(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                    unsigned char * rgb, size_t n);
+
+// Aplica una tabla de 256 bytes a n píxeles: out[i] = lut[in[i]] (lut debe tener las 256 entradas)
+void apply_lut_u8(const unsigned char * lut, const unsigned char * in, unsigned char * out, size_t n);
+
+// Conversiones RGB <-> YUV en double sobre planos de n píxeles, con el mismo resultado
+// que las fórmulas originales
+void rgb2yuv_planes(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                    unsigned char * y, unsigned char * u, unsigned char * v, size_t n);
+void yuv2rgb_planes(const unsigned char * y, const unsigned char * u, const unsigned char * v,
+                    unsigned char * r, unsigned char * g, unsigned char * b, size_t n);
+
+// Conversiones RGB <-> YUV en punto fijo (coeficientes Q14), sobre planos de n píxeles.
+// Pueden diferir en una unidad de la versión en double en algunos píxeles.
+void rgb2yuv_fixed(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                   unsigned char * y, unsigned char * u, unsigned char * v, size_t n);
+void yuv2rgb_fixed(const unsigned char * y, const unsigned char * u, const unsigned char * v,
+                   unsigned char * r, unsigned char * g, unsigned char * b, size_t n);
+
+// Modo de las conversiones YUV según el entorno: C_YUV_FIXED=1 usa punto fijo y
+// C_YUV_VERIFY=1 además lo compara con double e informa de los píxeles que cambian
+#define YUV_DOUBLE 0
+#define YUV_FIXED  1
+#define YUV_VERIFY 2
+int yuv_mode();
+
+// Solo el plano Y de la conversión RGB -> YUV: con fixed == 0 en double, como la
+// conversión original, y si no en punto fijo Q14
+void rgb2yuv_luma(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                  unsigned char * y, size_t n, int fixed);
+
+// Ecualización YUV fusionada: out = yuv2rgb(lut[Y], U, V) recalculando Y, U y V de cada
+// píxel desde RGB, sin planos intermedios del tamaño de la imagen
+void yuv_equalize_planes(const unsigned char * lut, const unsigned char * r, const unsigned char * g,
+                         const unsigned char * b, unsigned char * out_r, unsigned char * out_g,
+                         unsigned char * out_b, size_t n, int fixed);
+
+// Conversiones RGB <-> HSL sobre planos de n píxeles (H y S en [0, 1], L en [0, 255]).
+// Sin ramas por píxel en las versiones vectoriales y con el mismo resultado bit a bit
+// que el bucle escalar original en float.
+void rgb2hsl_planes(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                    float * h, float * s, unsigned char * l, size_t n);
+void hsl2rgb_planes(const float * h, const float * s, const unsigned char * l,
+                    unsigned char * r, unsigned char * g, unsigned char * b, size_t n);
+
+// Solo el plano L de rgb2hsl_planes, calculado con el máximo y el mínimo de cada píxel
+void rgb2hsl_lightness(const unsigned char * r, const unsigned char * g, const unsigned char * b,
+                       unsigned char * l, size_t n);
+
+// Ecualización HSL fusionada: por cada bloque de PIXEL_BLOCK píxeles recalcula H, S y L,
+// aplica lut a L y vuelve a RGB, sin planos intermedios del tamaño de la imagen
+void hsl_equalize_planes(const unsigned char * lut, const unsigned char * r, const unsigned char * g,
+                         const unsigned char * b, unsigned char * out_r, unsigned char * out_g,
+                         unsigned char * out_b, size_t n);
+
+// Vista de píxeles RGB con la que los motores de color aceptan las dos disposiciones:
+// con stride 1, r, g y b son tres planos; con stride 3 los píxeles están intercalados
+// (r0 g0 b0 r1 g1 b1 ...) y g = r + 1, b = r + 2. Las versiones _view trabajan por
+// bloques de PIXEL_BLOCK píxeles y solo separan o intercalan canales dentro de cada
+// bloque, así que la imagen completa nunca se transpone.
+typedef struct{
+    unsigned char * r;
+    unsigned char * g;
+    unsigned char * b;
+    int stride;
+} RGB_VIEW;
+
+RGB_VIEW planar_view(unsigned char * r, unsigned char * g, unsigned char * b);
+RGB_VIEW packed_view(unsigned char * rgb);
+// La misma vista empezando first píxeles más adelante
+RGB_VIEW view_offset(RGB_VIEW v, size_t first);
+
+void rgb2hsl_lightness_view(RGB_VIEW in, unsigned char * l, size_t n);
+void rgb2yuv_luma_view(RGB_VIEW in, unsigned char * y, size_t n, int fixed);
+void hsl_equalize_view(const unsigned char * lut, RGB_VIEW in, RGB_VIEW out, size_t n);
+void yuv_equalize_view(const unsigned char * lut, RGB_VIEW in, RGB_VIEW out, size_t n, int fixed);
+
+// Número de píxeles en los que las vistas a y b no coinciden
+long count_view_diffs(RGB_VIEW a, RGB_VIEW b, size_t n);
+
+// Bancos de contadores intercalados del núcleo de histograma
+#define HIST_BANKS 8
+
+// Suma a hist (256 contadores) el histograma de n píxeles. Los incrementos se reparten
+// entre HIST_BANKS bancos para que píxeles iguales consecutivos no actualicen el mismo
+// contador uno tras otro (dependencia store-load); al final se mezclan los bancos.
+void histogram_banked(int64_t * hist, const unsigned char * img, size_t n);
+
+// Microbenchmark: ciclos por píxel del bucle escalar y de histogram_banked sobre una
+// imagen uniforme (un solo valor) y otra aleatoria de n píxeles (n > 0)
+void histogram_bench(size_t n);
+
+#endif
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "pnm-header.h"
+
+static void invalid_header()
+{
+    printf("Invalid PNM header!\n");
+    exit(1);
+}
+
+// Siguiente entero de la cabecera, saltando espacios y comentarios
+static int read_header_int(FILE * f)
+{
+    int c = fgetc(f);
+    int value = 0;
+
+    while (c != EOF && (isspace(c) || c == '#')) {
+        if (c == '#') {
+            while (c != EOF && c != '\n')
+                c = fgetc(f);
+        } else {
+            c = fgetc(f);
+        }
+    }
+    if (c == EOF || !isdigit(c))
+        invalid_header();
+    while (c != EOF && isdigit(c)) {
+        value = value * 10 + (c - '0');
+        c = fgetc(f);
+    }
+    // c es el separador que sigue al número: tras el valor máximo es el único carácter en
+    // blanco antes de los píxeles, así que no se devuelve al fichero. Un comentario pegado
+    // al número termina con su salto de línea, que hace de separador
+    if (c == '#') {
+        while (c != EOF && c != '\n')
+            c = fgetc(f);
+    }
+    if (c == EOF || !isspace(c))
+        invalid_header();
+    return value;
+}
+
+PNM_HEADER read_pnm_header(FILE * f)
+{
+    PNM_HEADER hdr;
+    int p = fgetc(f);
+    int kind = fgetc(f);
+
+    if (p != 'P' || (kind != '5' && kind != '6'))
+        invalid_header();
+    hdr.channels = (kind == '6') ? 3 : 1;
+    hdr.w = read_header_int(f);
+    hdr.h = read_header_int(f);
+    hdr.max_value = read_header_int(f);
+    hdr.offset = ftell(f);
+    return hdr;
+}
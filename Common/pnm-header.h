@@ -0,0 +1,22 @@
+#ifndef PNM_HEADER_H
+#define PNM_HEADER_H
+
+#include <stdio.h>
+
+// Cabecera de un PGM (P5) o PPM (P6) binario. La leen todos los lectores de todas las
+// versiones (stdio, mmap, streaming y MPI-IO), de modo que un mismo fichero se interpreta
+// igual con cualquier modo de lectura
+typedef struct{
+    int w;
+    int h;
+    int channels;          // 1 para P5, 3 para P6
+    int max_value;
+    long offset;           // Posición del primer píxel dentro del fichero
+} PNM_HEADER;
+
+// Lee la cabecera desde el principio de f saltando espacios y comentarios ('#' hasta el
+// final de la línea) y consume el único carácter en blanco que la separa de los píxeles,
+// así que f queda en el primer píxel. Termina el programa si la cabecera no es válida
+PNM_HEADER read_pnm_header(FILE * f);
+
+#endif
@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "work-stealing.h"
+
+/*
+ * Cola Chase-Lev (Chase y Lev, 2005, con los órdenes de memoria de Lê et al., 2013). El
+ * dueño mete y saca por abajo (bottom) sin cerrojos y los ladrones sacan por arriba (top)
+ * con un compare-and-swap. Cada tarea es un rango de bloques [begin, end) codificado en
+ * 64 bits (32 por extremo), así que el buffer es un array de atómicos. Un hilo solo mete
+ * un rango cuando su cola está vacía, de modo que nunca hay más de unos pocos y basta una
+ * capacidad fija.
+ */
+#define WS_DEQUE_CAPACITY 64
+#define WS_EMPTY 0          // Ningún rango pendiente es [0, 0)
+
+typedef uint64_t WS_RANGE;
+
+static WS_RANGE make_range(uint64_t begin, uint64_t end)
+{
+    return (begin << 32) | end;
+}
+
+struct WsDeque {
+    std::atomic<int64_t> top{0};
+    std::atomic<int64_t> bottom{0};
+    std::atomic<WS_RANGE> buffer[WS_DEQUE_CAPACITY];
+
+    int empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+    // Solo el dueño
+    int push(WS_RANGE r) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= WS_DEQUE_CAPACITY)
+            return 0;
+        buffer[b % WS_DEQUE_CAPACITY].store(r, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return 1;
+    }
+
+    // Solo el dueño: el último rango metido
+    WS_RANGE pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return WS_EMPTY;
+        }
+        WS_RANGE r = buffer[b % WS_DEQUE_CAPACITY].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Último elemento: se compite con los ladrones por él
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                r = WS_EMPTY;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return r;
+    }
+
+    // Cualquier otro hilo: el rango más antiguo
+    WS_RANGE steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return WS_EMPTY;
+        WS_RANGE r = buffer[t % WS_DEQUE_CAPACITY].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return WS_EMPTY;
+        return r;
+    }
+};
+
+// Cada hilo en su propia línea de caché: las colas las leen todos los ladrones
+struct alignas(64) WsWorker {
+    WsDeque deque;
+    uint32_t seed;          // Elección de víctima (xorshift)
+    long steals;
+    long splits;
+};
+
+// Trabajo en curso: lo publica el hilo que llama bajo pool_mutex y no cambia hasta que
+// todos los hilos que entraron en él han salido
+struct WsJob {
+    const std::function<void(size_t, size_t)> * body;
+    size_t n;
+    size_t block;
+    std::atomic<size_t> blocks_left{0};
+};
+
+static std::mutex pool_mutex;
+static std::condition_variable pool_wake;   // Hay un trabajo nuevo o hay que terminar
+static std::condition_variable pool_idle;   // Ya no queda ningún hilo dentro del trabajo
+static std::mutex submit_mutex;             // Un solo trabajo a la vez
+static std::vector<std::thread> pool_threads;
+static WsWorker * workers = NULL;
+static int pool_size = 1;
+static long generation = 0;                 // Se incrementa con cada trabajo
+static int job_open = 0;                    // Aún se puede entrar en el trabajo actual
+static int job_active = 0;                  // Hilos del pool dentro del trabajo actual
+static int pool_stop = 0;
+static WsJob job;
+static long jobs_run = 0;
+
+static thread_local int worker_id = 0;
+
+int ws_threads()
+{
+    return pool_size;
+}
+
+int ws_worker_id()
+{
+    return worker_id;
+}
+
+// Ejecuta el rango [begin, end) bloque a bloque. Mientras quede más de un bloque y la cola
+// propia esté vacía, la mitad final se deja en la cola para que otro hilo pueda robarla
+static void run_range(WsWorker & self, uint64_t begin, uint64_t end)
+{
+    uint64_t done = 0;
+    while (begin < end) {
+        if (pool_size > 1 && end - begin > 1 && self.deque.empty()) {
+            uint64_t mid = begin + (end - begin) / 2;
+            if (self.deque.push(make_range(mid, end))) {
+                end = mid;
+                self.splits++;
+            }
+        }
+        size_t first = (size_t)begin * job.block;
+        size_t len = (job.n - first < job.block) ? job.n - first : job.block;
+        (*job.body)(first, len);
+        begin++;
+        done++;
+    }
+    job.blocks_left.fetch_sub(done, std::memory_order_acq_rel);
+}
+
+static WS_RANGE steal_any(WsWorker & self)
+{
+    if (pool_size == 1)
+        return WS_EMPTY;
+    self.seed ^= self.seed << 13;
+    self.seed ^= self.seed >> 17;
+    self.seed ^= self.seed << 5;
+    int first = (int)(self.seed % (uint32_t)pool_size);
+    for (int k = 0; k < pool_size; k++) {
+        int victim = (first + k) % pool_size;
+        if (&workers[victim] == &self)
+            continue;
+        WS_RANGE r = workers[victim].deque.steal();
+        if (r != WS_EMPTY) {
+            self.steals++;
+            return r;
+        }
+    }
+    return WS_EMPTY;
+}
+
+// Saca rangos de la cola propia o los roba hasta que no queda ningún bloque sin terminar
+static void work(WsWorker & self)
+{
+    for (;;) {
+        WS_RANGE r = self.deque.pop();
+        if (r == WS_EMPTY)
+            r = steal_any(self);
+        if (r != WS_EMPTY) {
+            run_range(self, r >> 32, r & 0xffffffffu);
+        } else if (job.blocks_left.load(std::memory_order_acquire) == 0) {
+            return;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+static void worker_loop(int id)
+{
+    long seen = 0;
+    worker_id = id;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            pool_wake.wait(lock, [&] { return pool_stop || generation != seen; });
+            if (pool_stop)
+                return;
+            seen = generation;
+            // Un hilo que despierta tarde no entra en un trabajo ya cerrado
+            if (!job_open)
+                continue;
+            job_active++;
+        }
+        work(workers[id]);
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            if (--job_active == 0)
+                pool_idle.notify_all();
+        }
+    }
+}
+
+// Al salir del programa se despierta a los hilos para que terminen
+struct WsShutdown {
+    ~WsShutdown() {
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            pool_stop = 1;
+        }
+        pool_wake.notify_all();
+        for (size_t i = 0; i < pool_threads.size(); i++)
+            pool_threads[i].join();
+    }
+};
+static WsShutdown shutdown_pool;
+
+void ws_start(int threads)
+{
+    std::lock_guard<std::mutex> lock(submit_mutex);
+    if (workers != NULL)
+        return;
+    pool_size = (threads > 0) ? threads : 1;
+    workers = new WsWorker[pool_size];
+    for (int i = 0; i < pool_size; i++) {
+        workers[i].seed = 2463534242u + 977 * (uint32_t)i;
+        workers[i].steals = 0;
+        workers[i].splits = 0;
+    }
+    // El hilo 0 es el que llama a ws_parallel_for
+    for (int i = 1; i < pool_size; i++)
+        pool_threads.push_back(std::thread(worker_loop, i));
+}
+
+void ws_parallel_for(size_t n, size_t block, const std::function<void(size_t first, size_t len)> & body)
+{
+    if (n == 0)
+        return;
+    size_t blocks = (n + block - 1) / block;
+
+    // Pool sin arrancar, ocupado o rango que no cabe en 32 bits: en el hilo que llama
+    std::unique_lock<std::mutex> submit(submit_mutex, std::try_to_lock);
+    if (!submit.owns_lock() || workers == NULL || blocks > 0xffffffffu) {
+        for (size_t i = 0; i < n; i += block)
+            body(i, (n - i < block) ? n - i : block);
+        return;
+    }
+
+    int caller_id = worker_id;
+    worker_id = 0;
+    job.body = &body;
+    job.n = n;
+    job.block = block;
+    job.blocks_left.store(blocks, std::memory_order_relaxed);
+    workers[0].deque.push(make_range(0, blocks));
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        generation++;
+        job_open = 1;
+        jobs_run++;
+    }
+    pool_wake.notify_all();
+
+    work(workers[0]);
+
+    // Se cierra el trabajo y se espera a que salgan los hilos que entraron: body y job
+    // deben seguir siendo válidos mientras alguno los use
+    {
+        std::unique_lock<std::mutex> lock(pool_mutex);
+        job_open = 0;
+        pool_idle.wait(lock, [] { return job_active == 0; });
+    }
+    worker_id = caller_id;
+}
+
+void ws_report()
+{
+    long steals = 0, splits = 0;
+    std::lock_guard<std::mutex> lock(submit_mutex);
+    if (workers == NULL)
+        return;
+    for (int i = 0; i < pool_size; i++) {
+        steals += workers[i].steals;
+        splits += workers[i].splits;
+    }
+    printf("Work stealing: %d threads, %ld jobs, %ld ranges stolen, %ld splits\n",
+           pool_size, jobs_run, steals, splits);
+}
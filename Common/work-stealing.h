@@ -0,0 +1,31 @@
+#ifndef WORK_STEALING_H
+#define WORK_STEALING_H
+
+#include <stddef.h>
+#include <functional>
+
+// Pool persistente de hilos con robo de trabajo, alternativa a los bucles schedule(runtime)
+// de OpenMP (versión OpenMP, C_BACKEND=steal). Cada hilo tiene una cola Chase-Lev sin
+// cerrojos de rangos de bloques. Un hilo que ejecuta un rango solo parte la mitad restante
+// y la deja en su cola cuando esta está vacía (partición binaria perezosa): si otros hilos
+// la roban vuelve a partir, y si nadie roba sigue bloque a bloque sin coste. Así el tamaño
+// de los trozos se adapta a la carga sin fijar un tamaño de bloque.
+
+// Arranca el pool con threads hilos (el que llama a ws_parallel_for cuenta como uno).
+// Las llamadas siguientes no hacen nada
+void ws_start(int threads);
+int ws_threads();
+
+// Índice en [0, ws_threads()) del hilo que ejecuta el cuerpo, para acumular en copias
+// privadas (por ejemplo histogramas)
+int ws_worker_id();
+
+// Llama a body(first, len) para cada bloque de block elementos de [0, n), repartidos entre
+// los hilos del pool, y vuelve cuando han terminado todos. Si el pool ya está ocupado (una
+// llamada anidada o desde otro hilo) los bloques se ejecutan en el hilo que llama
+void ws_parallel_for(size_t n, size_t block, const std::function<void(size_t first, size_t len)> & body);
+
+// Imprime los trabajos, rangos robados y particiones acumulados
+void ws_report();
+
+#endif
@@ -2,529 +2,896 @@
 #include <string.h>
 #include <stdlib.h>
 #include "hist-equ.h"
+#include "pixel-kernels.h"
 #include <mpi.h>
+#include <omp.h>
 
-PGM_IMG contrast_enhancement_g(PGM_IMG img_in)
+void band_counts(int h, int *rowcounts, int *displs)
 {
-    PGM_IMG result;
-    int hist_local[256];
-    int global_hist[256];
+    // Cada proceso recibe h / size filas y el último además el resto
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    for (int i = 0; i < size; i++) {
+        rowcounts[i] = h / size;
+        if (i == size - 1) {
+            rowcounts[i] += h % size;
+        }
+        displs[i] = i * (h / size);
+    }
+}
 
-    result.w = img_in.w;
-    result.h = img_in.h;
+MPI_Datatype row_type(int row_bytes)
+{
+    MPI_Datatype row;
+    MPI_Type_contiguous(row_bytes, MPI_UNSIGNED_CHAR, &row);
+    MPI_Type_commit(&row);
+    return row;
+}
 
-    // Inicializamos MPI
+int band_rows(int h)
+{
     int size, rank;
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    // Extraemos las dimensiones que necesitamos
-    int local_width = img_in.w;
-    int local_height = img_in.h / size;
-    int remainder = img_in.h % size; // Resto de divisiones desiguales
-    int local_size = local_width * local_height;
-
     // Ajustamos el tamaño para el último proceso
     if (rank == size - 1) {
-        local_height += remainder;
-        local_size = local_width * local_height;
+        return h / size + h % size;
     }
+    return h / size;
+}
 
-    // Asignamos la memoria para las partes locales de la imagen
-    unsigned char *img_local = (unsigned char *)malloc(local_size * sizeof(unsigned char));
+PGM_IMG scatter_pgm(PGM_IMG img_in)
+{
+    PGM_IMG band;
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Extraemos las dimensiones que necesitamos
+    band.w = img_in.w;
+    band.h = band_rows(img_in.h);
+    band.img = (unsigned char *)pool_alloc((size_t)band.w * band.h * sizeof(unsigned char));
 
     // Dividimos la imagen entre procesos
-    // Utilizamos MPI_Scatterv debido a que no tenemos tamaños iguales
-    int *sendcounts = (int *)malloc(size * sizeof(int));
+    // Utilizamos MPI_Scatterv debido a que no tenemos tamaños iguales; se cuentan filas
+    int *rowcounts = (int *)malloc(size * sizeof(int));
     int *displs = (int *)malloc(size * sizeof(int));
-    #pragma omp parallel for schedule(runtime)
-    for (int i = 0; i < size; i++) {
-        sendcounts[i] = (img_in.h / size) * img_in.w;
-        if (i == size - 1) {
-            sendcounts[i] += remainder * img_in.w;
-        }
-        displs[i] = i * (img_in.h / size) * img_in.w;
-    }
+    band_counts(img_in.h, rowcounts, displs);
+    MPI_Datatype row = row_type(img_in.w);
 
-    MPI_Scatterv(img_in.img, sendcounts, displs, MPI_UNSIGNED_CHAR, img_local, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Scatterv(img_in.img, rowcounts, displs, row, band.img, band.h, row, 0, MPI_COMM_WORLD);
 
-    // Calculamos el histograma local
-    histogram(hist_local, img_local, local_size, 256);
+    MPI_Type_free(&row);
+    free(rowcounts);
+    free(displs);
 
-    // Combinamos los histogramas de todos los procesos en un histograma global
-    MPI_Allreduce(hist_local, global_hist, 256, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return band;
+}
 
-    // Aplicamos la ecualización del histograma localmente
-    unsigned char *img_local_out = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    histogram_equalization(img_local_out, img_local, global_hist, local_size, 256, img_in.w * img_in.h);
+PPM_IMG scatter_ppm(PPM_IMG img_in)
+{
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Asignamos la memoria para las partes locales de la imagen, teniendo en cuenta los tres canales RGB
+    PPM_IMG band = alloc_ppm(img_in.w, band_rows(img_in.h));
+
+    // Dividimos la imagen entre procesos
+    // Utilizamos MPI_Scatterv debido a que no tenemos tamaños iguales; se cuentan filas
+    int *rowcounts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    band_counts(img_in.h, rowcounts, displs);
+    MPI_Datatype row = row_type(img_in.w);
+
+    MPI_Scatterv(img_in.img_r, rowcounts, displs, row, band.img_r, band.h, row, 0, MPI_COMM_WORLD);
+    MPI_Scatterv(img_in.img_g, rowcounts, displs, row, band.img_g, band.h, row, 0, MPI_COMM_WORLD);
+    MPI_Scatterv(img_in.img_b, rowcounts, displs, row, band.img_b, band.h, row, 0, MPI_COMM_WORLD);
+
+    MPI_Type_free(&row);
+    free(rowcounts);
+    free(displs);
+
+    return band;
+}
+
+// Recolecta las bandas sobre img, que solo tiene que existir en el proceso 0
+void gather_pgm_into(PGM_IMG band, PGM_IMG img)
+{
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int *rowcounts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    band_counts(img.h, rowcounts, displs);
+    MPI_Datatype row = row_type(img.w);
+
+    // Recolectamos los datos procesados de todos los procesos
+    MPI_Gatherv(band.img, band.h, row, img.img, rowcounts, displs, row, 0, MPI_COMM_WORLD);
+
+    MPI_Type_free(&row);
+    free(rowcounts);
+    free(displs);
+}
+
+PGM_IMG gather_pgm(PGM_IMG band, int w, int h)
+{
+    PGM_IMG result;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    result.w = w;
+    result.h = h;
+    result.img = NULL;
 
     // Solo el proceso 0 tiene la imagen final
     if (rank == 0) {
-        result.img = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
+        result.img = (unsigned char *)pool_alloc((size_t)result.w * result.h * sizeof(unsigned char));
     }
 
-    // Recolectamos los datos procesados de todos los procesos
-    MPI_Gatherv(img_local_out, local_size, MPI_UNSIGNED_CHAR, result.img, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    gather_pgm_into(band, result);
+    return result;
+}
 
-    // Liberamos memoria
-    free(img_local);
-    free(img_local_out);
-    free(sendcounts);
+void gather_ppm_into(PPM_IMG band, PPM_IMG img)
+{
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int *rowcounts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    band_counts(img.h, rowcounts, displs);
+    MPI_Datatype row = row_type(img.w);
+
+    // Utilizamos Gatherv por los distintos tamaños de cada banda
+    MPI_Gatherv(band.img_r, band.h, row, img.img_r, rowcounts, displs, row, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(band.img_g, band.h, row, img.img_g, rowcounts, displs, row, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(band.img_b, band.h, row, img.img_b, rowcounts, displs, row, 0, MPI_COMM_WORLD);
+
+    MPI_Type_free(&row);
+    free(rowcounts);
     free(displs);
+}
 
+PPM_IMG gather_ppm(PPM_IMG band, int w, int h)
+{
+    PPM_IMG result;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    result.w = w;
+    result.h = h;
+    result.img_r = result.img_g = result.img_b = NULL;
+
+    // Combinamos las imágenes procesadas en el proceso 0
+    if (rank == 0) {
+        result = alloc_ppm(w, h);
+    }
+
+    gather_ppm_into(band, result);
     return result;
 }
 
-PPM_IMG contrast_enhancement_c_yuv(PPM_IMG img_in) {
-    // Estructuras para manejar imágenes
-    YUV_IMG local_yuv_med;  // Imagen en espacio de color YUV (local)
-    PPM_IMG local_result;   // Resultado del procesamiento local
-    PPM_IMG result;         // Resultado final que será reunido por el proceso maestro
-    PPM_IMG local_img_in;   // Imagen local procesada en cada proceso
+// Reparto de una imagen intercalada: cada fila son 3 * w bytes contiguos, así que basta
+// un único MPI_Scatterv/MPI_Gatherv con filas de 3 * w bytes
+PPM_PACKED_IMG scatter_ppm_packed(PPM_PACKED_IMG img_in)
+{
+    PPM_PACKED_IMG band;
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    // Variables para histogramas y cálculos
-    unsigned char *y_equ;   // Canal de luminancia ajustado (igualado)
-    int localHist[256];     // Histograma local
-    int globalHist[256];    // Histograma global (combinado)
+    band.w = img_in.w;
+    band.h = band_rows(img_in.h);
+    band.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * band.h * sizeof(unsigned char));
 
-    // Información sobre los procesos MPI
-    int size, rank;
-    MPI_Comm_size(MPI_COMM_WORLD, &size); // Número total de procesos
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank); // Rango del proceso actual
+    int *rowcounts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    band_counts(img_in.h, rowcounts, displs);
+    MPI_Datatype row = row_type(3 * img_in.w);
 
-    // Dividir la imagen en segmentos para los procesos
-    int local_width = img_in.w;            // Ancho de la imagen (igual para todos los procesos)
-    int local_height = img_in.h / size;    // Altura dividida entre procesos
-    int remainder = img_in.h % size;       // Resto de la división
-    int local_size = local_width * local_height; // Tamaño del segmento local
+    MPI_Scatterv(img_in.img, rowcounts, displs, row, band.img, band.h, row, 0, MPI_COMM_WORLD);
 
-    // Ajustar la altura para el último proceso (manejo del resto)
-    if (rank == size - 1) {
-        local_height += remainder;        // Añadir el resto a la altura local
-        local_size = local_width * local_height;
+    MPI_Type_free(&row);
+    free(rowcounts);
+    free(displs);
+
+    return band;
+}
+
+void gather_ppm_packed_into(PPM_PACKED_IMG band, PPM_PACKED_IMG img)
+{
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int *rowcounts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    band_counts(img.h, rowcounts, displs);
+    MPI_Datatype row = row_type(3 * img.w);
+
+    MPI_Gatherv(band.img, band.h, row, img.img, rowcounts, displs, row, 0, MPI_COMM_WORLD);
+
+    MPI_Type_free(&row);
+    free(rowcounts);
+    free(displs);
+}
+
+PPM_PACKED_IMG gather_ppm_packed(PPM_PACKED_IMG band, int w, int h)
+{
+    PPM_PACKED_IMG result;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    result.w = w;
+    result.h = h;
+    result.img = NULL;
+
+    if (rank == 0) {
+        result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
     }
 
-    // Asignar memoria para las partes locales de la imagen
-    local_img_in.img_r = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    local_img_in.img_g = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    local_img_in.img_b = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    local_img_in.w = local_width;
-    local_img_in.h = local_height;
+    gather_ppm_packed_into(band, result);
+    return result;
+}
 
-    // Preparar las estructuras para Scatterv (distribuir partes de la imagen)
-    int *sendcounts = (int *)malloc(size * sizeof(int)); // Tamaños de los datos enviados
-    int *displs = (int *)malloc(size * sizeof(int));     // Desplazamientos en el buffer de entrada
-    #pragma omp parallel for schedule(runtime)
-    for (int i = 0; i < size; i++) {
-        sendcounts[i] = (img_in.h / size) * img_in.w;    // Tamaño estándar para cada proceso
-        if (i == size - 1) {
-            sendcounts[i] += remainder * img_in.w;      // Ajustar para el último proceso
-        }
-        displs[i] = i * (img_in.h / size) * img_in.w;   // Desplazamiento para cada proceso
+// Tamaño total de la imagen a partir del histograma global (suma de todas las bandas)
+static size_t hist_total(int64_t * hist, int nbr_bin)
+{
+    size_t total = 0;
+    for (int i = 0; i < nbr_bin; i++) {
+        total += hist[i];
     }
+    return total;
+}
+
+PGM_IMG contrast_enhancement_g_band(PGM_IMG band)
+{
+    PGM_IMG result;
+    int64_t hist_local[256];
+    int64_t global_hist[256];
+    size_t local_size = (size_t)band.w * band.h;
 
-    // Distribuir los canales R, G y B de la imagen de entrada
-    MPI_Scatterv(img_in.img_r, sendcounts, displs, MPI_UNSIGNED_CHAR, local_img_in.img_r, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Scatterv(img_in.img_g, sendcounts, displs, MPI_UNSIGNED_CHAR, local_img_in.img_g, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Scatterv(img_in.img_b, sendcounts, displs, MPI_UNSIGNED_CHAR, local_img_in.img_b, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    result.w = band.w;
+    result.h = band.h;
 
-    // Convertir la imagen local de RGB a YUV
-    local_yuv_med = rgb2yuv(local_img_in);
+    // Calculamos el histograma local
+    histogram(hist_local, band.img, local_size, 256);
+
+    // Combinamos los histogramas de todos los procesos en un histograma global
+    MPI_Allreduce(hist_local, global_hist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    // Aplicamos la ecualización del histograma localmente
+    result.img = (unsigned char *)pool_alloc(local_size * sizeof(unsigned char));
+    histogram_equalization(result.img, band.img, global_hist, local_size, 256, hist_total(global_hist, 256));
 
-    // Asignar memoria para la luminancia ajustada
-    y_equ = (unsigned char *)malloc(local_yuv_med.h * local_yuv_med.w * sizeof(unsigned char));
+    return result;
+}
 
-    // Calcular el histograma local para el canal de luminancia (Y)
-    histogram(localHist, local_yuv_med.img_y, local_yuv_med.h * local_yuv_med.w, 256);
+PGM_IMG contrast_enhancement_g(PGM_IMG img_in)
+{
+    PGM_IMG band = scatter_pgm(img_in);
+    PGM_IMG band_out = contrast_enhancement_g_band(band);
+    PGM_IMG result = gather_pgm(band_out, img_in.w, img_in.h);
 
-    // Reducir (sumar) los histogramas locales en un histograma global
-    MPI_Allreduce(localHist, globalHist, 256, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    // Liberamos memoria
+    free_pgm(band);
+    free_pgm(band_out);
 
-    // Realizar la igualación del histograma en el canal de luminancia
-    histogram_equalization(y_equ, local_yuv_med.img_y, globalHist, local_yuv_med.h * local_yuv_med.w, 256, img_in.h * img_in.w);
+    return result;
+}
 
-    // Reemplazar el canal de luminancia en la imagen YUV con la versión igualada
-    free(local_yuv_med.img_y);
-    local_yuv_med.img_y = y_equ;
+PPM_IMG contrast_enhancement_c_yuv_band(PPM_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
 
-    // Convertir la imagen YUV de nuevo a RGB
-    local_result = yuv2rgb(local_yuv_med);
+    // Histograma de Y de la banda leyendo solo RGB, sin planos YUV
+    histogram_yuv_y(localHist, band);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
 
-    // Liberar los canales U, V e Y de la imagen YUV local
-    free(local_yuv_med.img_u);
-    free(local_yuv_med.img_v);
-    free(local_yuv_med.img_y);
+    // Ecualizamos Y y volvemos a RGB recalculando U y V en cada píxel
+    return yuv_equalize_rgb(band, lut);
+}
 
-    // Asignar memoria para la imagen final en el proceso maestro (rank 0)
-    if (rank == 0) {
-        result.w = img_in.w;
-        result.h = img_in.h;
-        result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-        result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-        result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    }
+PPM_IMG contrast_enhancement_c_yuv(PPM_IMG img_in)
+{
+    PPM_IMG band = scatter_ppm(img_in);
+    PPM_IMG band_out = contrast_enhancement_c_yuv_band(band);
+    PPM_IMG result = gather_ppm(band_out, img_in.w, img_in.h);
 
-    // Recolectar las partes procesadas de cada proceso en la imagen final
-    MPI_Gatherv(local_result.img_r, local_size, MPI_UNSIGNED_CHAR, result.img_r, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Gatherv(local_result.img_g, local_size, MPI_UNSIGNED_CHAR, result.img_g, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Gatherv(local_result.img_b, local_size, MPI_UNSIGNED_CHAR, result.img_b, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-
-    // Liberar memoria utilizada en cada proceso
-    free(local_result.img_r);
-    free(local_result.img_g);
-    free(local_result.img_b);
-    free(local_img_in.img_r);
-    free(local_img_in.img_g);
-    free(local_img_in.img_b);
-    free(sendcounts);
-    free(displs);
+    // Terminamos de liberar la memoria
+    free_ppm(band);
+    free_ppm(band_out);
 
-    // Devolver el resultado final (solo el proceso maestro tendrá los datos completos)
     return result;
 }
 
-PPM_IMG contrast_enhancement_c_hsl(PPM_IMG img_in) {
-    // Estructuras para manejar imágenes
-    HSL_IMG local_hsl_med; // Imagen en espacio de color HSL (local)
-    PPM_IMG local_result;  // Resultado del procesamiento local
-    PPM_IMG result;        // Resultado final que será reunido por el proceso maestro
-    PPM_IMG local_img_in;  // Imagen local procesada en cada proceso
+PPM_IMG contrast_enhancement_c_hsl_band(PPM_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
 
-    // Variables para histogramas y otros cálculos
-    unsigned char *l_equ;   // Canal de luminancia ajustado (igualado)
-    int localHist[256];     // Histograma local
-    int globalHist[256];    // Histograma global
+    // Histograma de L de la banda calculado directamente desde RGB, sin planos HSL
+    histogram_hsl_l(localHist, band);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
 
-    int size, rank;
-    MPI_Comm_size(MPI_COMM_WORLD, &size); // Número total de procesos
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank); // Rango del proceso actual
+    // Recalculamos H y S por bloques mientras se ecualiza L y se vuelve a RGB
+    return hsl_equalize_rgb(band, lut);
+}
 
-    // Dimensiones de la imagen local
-    int local_width = img_in.w;
-    int local_height = img_in.h / size; // Dividir la altura entre los procesos
-    int remainder = img_in.h % size;    // Resto de la división para el último proceso
-    int local_size = local_width * local_height;
+PPM_IMG contrast_enhancement_c_hsl(PPM_IMG img_in)
+{
+    PPM_IMG band = scatter_ppm(img_in);
+    PPM_IMG band_out = contrast_enhancement_c_hsl_band(band);
+    PPM_IMG result = gather_ppm(band_out, img_in.w, img_in.h);
 
-    // Ajustar la altura local para el último proceso (manejo del resto)
-    if (rank == size - 1) {
-        local_height += remainder;
-        local_size = local_width * local_height;
-    }
+    // Terminamos de liberar la memoria
+    free_ppm(band);
+    free_ppm(band_out);
 
-    // Asignar memoria para las partes locales de la imagen
-    local_img_in.img_r = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    local_img_in.img_g = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    local_img_in.img_b = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    local_img_in.w = local_width;
-    local_img_in.h = local_height;
+    return result;
+}
 
-    // Preparar las estructuras para Scatterv (distribuir partes de la imagen entre procesos)
-    int *sendcounts = (int *)malloc(size * sizeof(int)); // Tamaño de los datos enviados a cada proceso
-    int *displs = (int *)malloc(size * sizeof(int));     // Desplazamientos en el buffer de origen
-    #pragma omp parallel for schedule(runtime)
-    for (int i = 0; i < size; i++) {
-        sendcounts[i] = (img_in.h / size) * img_in.w; // Tamaño estándar
-        if (i == size - 1) {
-            sendcounts[i] += remainder * img_in.w; // Agregar el resto al último proceso
-        }
-        displs[i] = i * (img_in.h / size) * img_in.w; // Desplazamiento de cada segmento
-    }
+// Las versiones intercaladas usan los mismos motores sobre una vista con stride 3
+PPM_PACKED_IMG contrast_enhancement_c_yuv_packed_band(PPM_PACKED_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+    PPM_PACKED_IMG result;
+
+    histogram_yuv_y_pixels(localHist, packed_view(band.img), (size_t)band.w * band.h);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+
+    result.w = band.w;
+    result.h = band.h;
+    result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+    yuv_equalize_pixels(lut, packed_view(band.img), packed_view(result.img), (size_t)band.w * band.h);
+    return result;
+}
 
-    // Distribuir los canales R, G y B de la imagen de entrada entre los procesos
-    MPI_Scatterv(img_in.img_r, sendcounts, displs, MPI_UNSIGNED_CHAR, local_img_in.img_r, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Scatterv(img_in.img_g, sendcounts, displs, MPI_UNSIGNED_CHAR, local_img_in.img_g, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Scatterv(img_in.img_b, sendcounts, displs, MPI_UNSIGNED_CHAR, local_img_in.img_b, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+PPM_PACKED_IMG contrast_enhancement_c_yuv_packed(PPM_PACKED_IMG img_in)
+{
+    PPM_PACKED_IMG band = scatter_ppm_packed(img_in);
+    PPM_PACKED_IMG band_out = contrast_enhancement_c_yuv_packed_band(band);
+    PPM_PACKED_IMG result = gather_ppm_packed(band_out, img_in.w, img_in.h);
 
-    // Convertir la imagen local de RGB a HSL
-    local_hsl_med = rgb2hsl(local_img_in);
+    free_ppm_packed(band);
+    free_ppm_packed(band_out);
 
-    // Asignar memoria para la luminancia ajustada
-    l_equ = (unsigned char *)malloc(local_hsl_med.height * local_hsl_med.width * sizeof(unsigned char));
+    return result;
+}
 
-    // Calcular el histograma local de la luminancia
-    histogram(localHist, local_hsl_med.l, local_hsl_med.height * local_hsl_med.width, 256);
+PPM_PACKED_IMG contrast_enhancement_c_hsl_packed_band(PPM_PACKED_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+    PPM_PACKED_IMG result;
+
+    histogram_hsl_l_pixels(localHist, packed_view(band.img), (size_t)band.w * band.h);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+
+    result.w = band.w;
+    result.h = band.h;
+    result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+    hsl_equalize_pixels(lut, packed_view(band.img), packed_view(result.img), (size_t)band.w * band.h);
+    return result;
+}
 
-    // Reducir (sumar) los histogramas locales en un histograma global
-    MPI_Allreduce(localHist, globalHist, 256, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+PPM_PACKED_IMG contrast_enhancement_c_hsl_packed(PPM_PACKED_IMG img_in)
+{
+    PPM_PACKED_IMG band = scatter_ppm_packed(img_in);
+    PPM_PACKED_IMG band_out = contrast_enhancement_c_hsl_packed_band(band);
+    PPM_PACKED_IMG result = gather_ppm_packed(band_out, img_in.w, img_in.h);
 
-    // Realizar la igualación del histograma en el canal de luminancia
-    histogram_equalization(l_equ, local_hsl_med.l, globalHist, local_hsl_med.height * local_hsl_med.width, 256, img_in.h * img_in.w);
+    free_ppm_packed(band);
+    free_ppm_packed(band_out);
 
-    // Reemplazar el canal de luminancia en la imagen HSL con la versión igualada
-    free(local_hsl_med.l);
-    local_hsl_med.l = l_equ;
+    return result;
+}
+
+// Variantes en el sitio: la banda (o la imagen del proceso 0) se sobrescribe con el
+// resultado y no se reserva ninguna imagen de salida
+void contrast_enhancement_g_band_inplace(PGM_IMG band)
+{
+    int64_t hist_local[256];
+    int64_t global_hist[256];
+    size_t local_size = (size_t)band.w * band.h;
+
+    histogram(hist_local, band.img, local_size, 256);
+    MPI_Allreduce(hist_local, global_hist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_equalization_inplace(band.img, global_hist, local_size, 256, hist_total(global_hist, 256));
+}
+
+void contrast_enhancement_c_yuv_band_inplace(PPM_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+    RGB_VIEW view = planar_view(band.img_r, band.img_g, band.img_b);
+
+    histogram_yuv_y_pixels(localHist, view, (size_t)band.w * band.h);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+    yuv_equalize_pixels(lut, view, view, (size_t)band.w * band.h);
+}
+
+void contrast_enhancement_c_hsl_band_inplace(PPM_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+    RGB_VIEW view = planar_view(band.img_r, band.img_g, band.img_b);
+
+    histogram_hsl_l_pixels(localHist, view, (size_t)band.w * band.h);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+    hsl_equalize_pixels(lut, view, view, (size_t)band.w * band.h);
+}
 
-    // Convertir la imagen HSL de nuevo a RGB
-    local_result = hsl2rgb(local_hsl_med);
+void contrast_enhancement_c_yuv_packed_band_inplace(PPM_PACKED_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+
+    histogram_yuv_y_pixels(localHist, packed_view(band.img), (size_t)band.w * band.h);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+    yuv_equalize_pixels(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+}
 
-    // Liberar los canales de HSL ya no necesarios
-    free(local_hsl_med.h);
-    free(local_hsl_med.s);
-    free(local_hsl_med.l);
+void contrast_enhancement_c_hsl_packed_band_inplace(PPM_PACKED_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+
+    histogram_hsl_l_pixels(localHist, packed_view(band.img), (size_t)band.w * band.h);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+    hsl_equalize_pixels(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+}
 
-    // Asignar memoria para la imagen final en el proceso maestro (rank 0)
+// La imagen completa se reparte, cada banda se ecualiza en el sitio y el resultado se
+// recolecta sobre la propia imagen de entrada del proceso 0
+void contrast_enhancement_g_inplace(PGM_IMG img)
+{
+    PGM_IMG band = scatter_pgm(img);
+    contrast_enhancement_g_band_inplace(band);
+    gather_pgm_into(band, img);
+    free_pgm(band);
+}
+
+void contrast_enhancement_c_yuv_inplace(PPM_IMG img)
+{
+    PPM_IMG band = scatter_ppm(img);
+    contrast_enhancement_c_yuv_band_inplace(band);
+    gather_ppm_into(band, img);
+    free_ppm(band);
+}
+
+void contrast_enhancement_c_hsl_inplace(PPM_IMG img)
+{
+    PPM_IMG band = scatter_ppm(img);
+    contrast_enhancement_c_hsl_band_inplace(band);
+    gather_ppm_into(band, img);
+    free_ppm(band);
+}
+
+void contrast_enhancement_c_yuv_packed_inplace(PPM_PACKED_IMG img)
+{
+    PPM_PACKED_IMG band = scatter_ppm_packed(img);
+    contrast_enhancement_c_yuv_packed_band_inplace(band);
+    gather_ppm_packed_into(band, img);
+    free_ppm_packed(band);
+}
+
+void contrast_enhancement_c_hsl_packed_inplace(PPM_PACKED_IMG img)
+{
+    PPM_PACKED_IMG band = scatter_ppm_packed(img);
+    contrast_enhancement_c_hsl_packed_band_inplace(band);
+    gather_ppm_packed_into(band, img);
+    free_ppm_packed(band);
+}
+
+// Bytes por píxel que ocupan a la vez los buffers de una banda en cada modo de streaming
+// (cada banda se ecualiza en el sitio, así que no hay buffer de salida)
+#define STREAM_BYTES_G   1   // banda de entrada, sobrescrita con el resultado
+#define STREAM_BYTES_YUV 3   // RGB intercalado de la banda (Y, U y V no se guardan)
+#define STREAM_BYTES_HSL 3   // RGB intercalado de la banda (H, S y L van por bloques)
+
+// Número de filas por banda para no superar mem_budget bytes en cada proceso (al menos una fila)
+static int stream_band_rows(int w, int local_rows, int bytes_per_pixel, size_t mem_budget)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    size_t rows = mem_budget / ((size_t)w * bytes_per_pixel);
+    if (rows > (size_t)local_rows)
+        rows = local_rows;
+    if (rows < 1)
+        rows = 1;
     if (rank == 0) {
-        result.w = img_in.w;
-        result.h = img_in.h;
-        result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-        result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-        result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
+        printf("Streaming %d rows per band\n", (int)rows);
     }
+    return (int)rows;
+}
 
-    // Recolectar las partes procesadas de cada proceso en la imagen final
-    MPI_Gatherv(local_result.img_r, local_size, MPI_UNSIGNED_CHAR, result.img_r, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Gatherv(local_result.img_g, local_size, MPI_UNSIGNED_CHAR, result.img_g, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Gatherv(local_result.img_b, local_size, MPI_UNSIGNED_CHAR, result.img_b, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-
-    // Liberar memoria local utilizada en cada proceso
-    free(local_result.img_r);
-    free(local_result.img_g);
-    free(local_result.img_b);
-    free(local_img_in.img_r);
-    free(local_img_in.img_g);
-    free(local_img_in.img_b);
-    free(sendcounts);
-    free(displs);
+// Primera fila de este proceso, con el mismo reparto que band_counts (band_rows da cuántas)
+static int stream_first_row(int h)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    return rank * (h / size);
+}
 
-    // Devolver el resultado final al proceso maestro
-    return result;
+// Suma el histograma de img_size píxeles al acumulado en hist
+static void histogram_add(int64_t * hist, unsigned char * img_in, size_t img_size)
+{
+    int64_t hist_band[256];
+    histogram(hist_band, img_in, img_size, 256);
+    for (int i = 0; i < 256; i++)
+        hist[i] += hist_band[i];
 }
 
-//Convert RGB to HSL, assume R,G,B in [0, 255]
-//Output H, S in [0.0, 1.0] and L in [0, 255]
-HSL_IMG rgb2hsl(PPM_IMG img_in)
-{
-    int i;
-    float H, S, L;
-    HSL_IMG img_out;// = (HSL_IMG *)malloc(sizeof(HSL_IMG));
-    img_out.width  = img_in.w;
-    img_out.height = img_in.h;
-    img_out.h = (float *)malloc(img_in.w * img_in.h * sizeof(float));
-    img_out.s = (float *)malloc(img_in.w * img_in.h * sizeof(float));
-    img_out.l = (unsigned char *)malloc(img_in.w * img_in.h * sizeof(unsigned char));
-    
-    // Inicia la paralelización del bucle for utilizando OpenMP. 
-    // 1. `private(H, S, L)`: Cada hilo tendrá sus propias copias de las variables H, S y L, evitando conflictos entre hilos.
-    // 2. `schedule(runtime)`: El esquema de distribución de las iteraciones se puede configurar en tiempo de ejecución 
-    //    mediante la variable de entorno OMP_SCHEDULE (por ejemplo, static, dynamic, etc.).
-    #pragma omp parallel for private(H, S, L) schedule(runtime)
-    for(i = 0; i < img_in.w*img_in.h; i ++){
-        
-        float var_r = ( (float)img_in.img_r[i]/255 );//Convertimos RGB a [0,1]
-        float var_g = ( (float)img_in.img_g[i]/255 );
-        float var_b = ( (float)img_in.img_b[i]/255 );
-        float var_min = (var_r < var_g) ? var_r : var_g;
-        var_min = (var_min < var_b) ? var_min : var_b;   //mínimo de RGB
-        float var_max = (var_r > var_g) ? var_r : var_g;
-        var_max = (var_max > var_b) ? var_max : var_b;   //máximo de RGB
-        float del_max = var_max - var_min;               //Valor Delta de RGB
-        
-        L = ( var_max + var_min ) / 2;
-        if ( del_max == 0 )
-        // Si no hay diferencia entre el máximo y mínimo, significa que el color es un gris puro.
-        {
-            H = 0;         
-            S = 0;    
-        }
-        else   
-        // Si hay diferencia, calculamos Saturación (S) y Tono (H).                                 
-        {
-            if ( L < 0.5 )
-                S = del_max/(var_max+var_min);
-            else
-                S = del_max/(2-var_max-var_min );
-
-            // Calculamos las diferencias relativas de cada componente RGB.
-            float del_r = (((var_max-var_r)/6)+(del_max/2))/del_max;
-            float del_g = (((var_max-var_g)/6)+(del_max/2))/del_max;
-            float del_b = (((var_max-var_b)/6)+(del_max/2))/del_max;
-            if( var_r == var_max ){
-                H = del_b - del_g;
-            }
-            else{       
-                if( var_g == var_max ){
-                    H = (1.0/3.0) + del_r - del_b;
-                }
-                else{
-                        H = (2.0/3.0) + del_g - del_r;
-                }   
-            }
-            
-        }
+void contrast_enhancement_g_stream(const char * in_path, const char * out_path, size_t mem_budget)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PGM_IMG band;
+    int64_t hist[256] = {0};
+    int64_t global_hist[256];
+    unsigned char lut[256];
+    int first = stream_first_row(in.h);
+    int last = first + band_rows(in.h);
+    int rows = stream_band_rows(in.w, last - first, STREAM_BYTES_G, mem_budget);
+    int row;
+
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc((size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de las filas locales, combinado después entre procesos
+    for (row = first; row < last; row += rows) {
+        band.h = (last - row < rows) ? last - row : rows;
+        read_pgm_rows(in, row, band);
+        histogram_add(hist, band.img, (size_t)band.w * band.h);
+    }
+    MPI_Allreduce(hist, global_hist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, global_hist, hist_total(global_hist, 256), 256);
+
+    // Segundo recorrido: ecualizar cada banda local y escribirla en su sitio
+    out = create_pnm_stream(out_path, in.w, in.h, 1);
+    for (row = first; row < last; row += rows) {
+        band.h = (last - row < rows) ? last - row : rows;
+        read_pgm_rows(in, row, band);
+        apply_lut(band.img, band.img, lut, (size_t)band.w * band.h);
+        write_pgm_rows(out, row, band);
+    }
 
-        // Ajustamos el rango de H para que esté en [0,1].
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    pool_free(band.img);
+}
 
-        if ( H < 0 )
-            H += 1;
-        if ( H > 1 )
-            H -= 1;
+// Modo C_YUV_VERIFY: píxeles de la banda de este proceso que cambian respecto a double
+static void report_fixed_diffs(const char * name, long diffs, size_t n)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    printf("Rank %d: %s fixed-point: %ld of %zu pixels differ from double precision\n", rank, name, diffs, n);
+}
 
-        // Asignamos los valores calculados a la estructura de salida.
+void contrast_enhancement_c_yuv_stream(const char * in_path, const char * out_path, size_t mem_budget)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PPM_PACKED_IMG band;
+    int64_t hist[256] = {0};
+    int64_t band_hist[256];
+    int64_t global_hist[256];
+    unsigned char lut[256];
+    int first = stream_first_row(in.h);
+    int last = first + band_rows(in.h);
+    int rows = stream_band_rows(in.w, last - first, STREAM_BYTES_YUV, mem_budget);
+    int row;
+    long diffs = 0;
+
+    // Las bandas se procesan intercaladas, tal como están en el fichero, y en el sitio
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la luminancia Y, calculada directamente desde RGB
+    for (row = first; row < last; row += rows) {
+        band.h = (last - row < rows) ? last - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        histogram_yuv_y_pixels(band_hist, packed_view(band.img), (size_t)band.w * band.h);
+        for (int i = 0; i < 256; i++)
+            hist[i] += band_hist[i];
+    }
+    MPI_Allreduce(hist, global_hist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, global_hist, hist_total(global_hist, 256), 256);
+
+    // Segundo recorrido: ecualizar Y y volver a RGB banda a banda en un solo paso por píxel
+    out = create_pnm_stream(out_path, in.w, in.h, 3);
+    for (row = first; row < last; row += rows) {
+        band.h = (last - row < rows) ? last - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        diffs += yuv_equalize_count(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+        write_ppm_packed_rows(out, row, band);
+    }
 
-        img_out.h[i] = H;
-        img_out.s[i] = S;
-        img_out.l[i] = (unsigned char)(L*255);
+    // En C_YUV_VERIFY se informa una vez por imagen, sumando todas las bandas
+    if (yuv_mode() == YUV_VERIFY)
+        report_fixed_diffs("yuv equalization", diffs, (size_t)in.w * (last - first));
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    free_ppm_packed(band);
+}
+
+void contrast_enhancement_c_hsl_stream(const char * in_path, const char * out_path, size_t mem_budget)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PPM_PACKED_IMG band;
+    int64_t hist[256] = {0};
+    int64_t band_hist[256];
+    int64_t global_hist[256];
+    unsigned char lut[256];
+    int first = stream_first_row(in.h);
+    int last = first + band_rows(in.h);
+    int rows = stream_band_rows(in.w, last - first, STREAM_BYTES_HSL, mem_budget);
+    int row;
+
+    // Las bandas se procesan intercaladas, tal como están en el fichero, y en el sitio
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la luminosidad L, calculada directamente desde RGB
+    for (row = first; row < last; row += rows) {
+        band.h = (last - row < rows) ? last - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        histogram_hsl_l_pixels(band_hist, packed_view(band.img), (size_t)band.w * band.h);
+        for (int i = 0; i < 256; i++)
+            hist[i] += band_hist[i];
     }
-    
-    return img_out;
+    MPI_Allreduce(hist, global_hist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, global_hist, hist_total(global_hist, 256), 256);
+
+    // Segundo recorrido: recalcular HSL, ecualizar L y volver a RGB banda a banda
+    out = create_pnm_stream(out_path, in.w, in.h, 3);
+    for (row = first; row < last; row += rows) {
+        band.h = (last - row < rows) ? last - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        hsl_equalize_pixels(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+        write_ppm_packed_rows(out, row, band);
+    }
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    free_ppm_packed(band);
 }
 
-float Hue_2_RGB( float v1, float v2, float vH )             //Function Hue_2_RGB
+
+// Motor HSL fusionado: el histograma de L se calcula desde RGB con solo el máximo y el
+// mínimo, y hsl_equalize_rgb recalcula H y S por bloques al volver a RGB, así que nunca
+// se reservan los planos H, S y L de toda la imagen
+void histogram_hsl_l_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n)
 {
-    if ( vH < 0 ) vH += 1;
-    if ( vH > 1 ) vH -= 1;
-    if ( ( 6 * vH ) < 1 ) return ( v1 + ( v2 - v1 ) * 6 * vH );
-    if ( ( 2 * vH ) < 1 ) return ( v2 );
-    if ( ( 3 * vH ) < 2 ) return ( v1 + ( v2 - v1 ) * ( ( 2.0f/3.0f ) - vH ) * 6 );
-    return ( v1 );
+    size_t i;
+
+    memset(hist_out, 0, 256 * sizeof(int64_t));
+
+    // Cada hilo acumula en su copia privada del histograma y OpenMP las suma al final
+    #pragma omp parallel for reduction(+:hist_out[:256]) schedule(runtime)
+    for (i = 0; i < n; i += PIXEL_BLOCK) {
+        unsigned char l[PIXEL_BLOCK];
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        rgb2hsl_lightness_view(view_offset(img_in, i), l, len);
+        histogram_banked(hist_out, l, len);
+    }
 }
 
-//Convert HSL to RGB, assume H, S in [0.0, 1.0] and L in [0, 255]
-//Output R,G,B in [0, 255]
-PPM_IMG hsl2rgb(HSL_IMG img_in)
+void histogram_hsl_l(int64_t * hist_out, PPM_IMG img_in)
 {
-    int i;
-    PPM_IMG result;
-    
-    result.w = img_in.width;
-    result.h = img_in.height;
-    result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    
-
-    // Este pragma paraleliza el bucle for con OpenMP. Cada iteración es independiente,
-    // por lo que se puede ejecutar en paralelo para mejorar el rendimiento.
-    // `schedule(runtime)` permite ajustar dinámicamente cómo se distribuyen las iteraciones.
+    histogram_hsl_l_pixels(hist_out, planar_view(img_in.img_r, img_in.img_g, img_in.img_b), (size_t)img_in.w * img_in.h);
+}
+
+void hsl_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    size_t i;
+
     #pragma omp parallel for schedule(runtime)
-    for(i = 0; i < img_in.width*img_in.height; i ++){
-        float H = img_in.h[i];
-        float S = img_in.s[i];
-        float L = img_in.l[i]/255.0f;
-        float var_1, var_2;
-        
-        unsigned char r,g,b;
-        
-        if ( S == 0 )
-        // Si la saturación es 0, el color es un gris puro.
-        // En este caso, todos los canales RGB tienen el mismo valor que L.
-        {
-            r = L * 255;
-            g = L * 255;
-            b = L * 255;
-        }
-        else
-        {
-            
-            if ( L < 0.5 )
-                var_2 = L * ( 1 + S );
-            else
-                var_2 = ( L + S ) - ( S * L );
-
-            // Convertimos el tono (H) y las variables intermedias a valores RGB usando Hue_2_RGB.
-            // `Hue_2_RGB` es una función auxiliar que calcula los valores RGB
-            // a partir de las variables `var_1`, `var_2` y el tono modificado.
-            var_1 = 2 * L - var_2;
-            r = 255 * Hue_2_RGB( var_1, var_2, H + (1.0f/3.0f) );
-            g = 255 * Hue_2_RGB( var_1, var_2, H );
-            b = 255 * Hue_2_RGB( var_1, var_2, H - (1.0f/3.0f) );
+    for (i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        hsl_equalize_view(lut, view_offset(img_in, i), view_offset(img_out, i), len);
+    }
+}
+
+PPM_IMG hsl_equalize_rgb(PPM_IMG img_in, unsigned char * lut)
+{
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+
+    hsl_equalize_pixels(lut, planar_view(img_in.img_r, img_in.img_g, img_in.img_b),
+                        planar_view(result.img_r, result.img_g, result.img_b), (size_t)img_in.w * img_in.h);
+    return result;
+}
+
+// Motor YUV fusionado: el histograma de Y se calcula en un recorrido de solo lectura sobre
+// RGB y yuv_equalize_rgb produce la salida a partir de (LUT[Y], U, V) recalculando U y V
+// en cada píxel, así que nunca se guardan los planos YUV de la imagen
+void histogram_yuv_y_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n)
+{
+    size_t i;
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+
+    memset(hist_out, 0, 256 * sizeof(int64_t));
+
+    // Cada hilo acumula en su copia privada del histograma y OpenMP las suma al final
+    #pragma omp parallel for reduction(+:hist_out[:256]) schedule(runtime)
+    for (i = 0; i < n; i += PIXEL_BLOCK) {
+        unsigned char y[PIXEL_BLOCK];
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        rgb2yuv_luma_view(view_offset(img_in, i), y, len, fixed);
+        histogram_banked(hist_out, y, len);
+    }
+}
+
+void histogram_yuv_y(int64_t * hist_out, PPM_IMG img_in)
+{
+    histogram_yuv_y_pixels(hist_out, planar_view(img_in.img_r, img_in.img_g, img_in.img_b), (size_t)img_in.w * img_in.h);
+}
+
+long yuv_equalize_count(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    size_t i;
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+    unsigned char * ref = NULL;
+    long diffs = 0;
+
+    // En C_YUV_VERIFY se compara la salida con la del motor en double usando la misma LUT.
+    // La referencia se calcula antes porque img_out puede ser la propia img_in (en el sitio)
+    if (yuv_mode() == YUV_VERIFY) {
+        ref = (unsigned char *)pool_alloc(3 * n * sizeof(unsigned char));
+        #pragma omp parallel for schedule(runtime)
+        for (i = 0; i < n; i += PIXEL_BLOCK) {
+            size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+            yuv_equalize_view(lut, view_offset(img_in, i), packed_view(ref + 3*(size_t)i), len, 0);
         }
-        result.img_r[i] = r;
-        result.img_g[i] = g;
-        result.img_b[i] = b;
     }
 
+    #pragma omp parallel for schedule(runtime)
+    for (i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        yuv_equalize_view(lut, view_offset(img_in, i), view_offset(img_out, i), len, fixed);
+    }
+
+    if (ref != NULL) {
+        diffs = count_view_diffs(img_out, packed_view(ref), n);
+        pool_free(ref);
+    }
+    return diffs;
+}
+
+void yuv_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    long diffs = yuv_equalize_count(lut, img_in, img_out, n);
+
+    if (yuv_mode() == YUV_VERIFY)
+        report_fixed_diffs("yuv equalization", diffs, n);
+}
+
+PPM_IMG yuv_equalize_rgb(PPM_IMG img_in, unsigned char * lut)
+{
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+
+    yuv_equalize_pixels(lut, planar_view(img_in.img_r, img_in.img_g, img_in.img_b),
+                        planar_view(result.img_r, result.img_g, result.img_b), (size_t)img_in.w * img_in.h);
     return result;
 }
 
-//Convert RGB to YUV, all components in [0, 255]
-YUV_IMG rgb2yuv(PPM_IMG img_in)
-{
-    YUV_IMG img_out;
-    int i;//, j;
-    unsigned char r, g, b;
-    unsigned char y, cb, cr;
-    
-    img_out.w = img_in.w;
-    img_out.h = img_in.h;
-    img_out.img_y = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_u = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_v = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-
-
-    // Paralelizamos el bucle con OpenMP:
-    // - `private(r, g, b, y, cb, cr)`: Cada hilo tiene su propia copia de estas variables temporales,
-    //   evitando conflictos durante las operaciones.
-    // - `schedule(runtime)`: Permite configurar el esquema de planificación en tiempo de ejecución
-    //   (por ejemplo, estático o dinámico) mediante la variable OMP_SCHEDULE.
-    #pragma omp parallel for private(r, g, b, y, cb, cr) schedule(runtime)
-    for(i = 0; i < img_out.w*img_out.h; i ++){
-        // Leemos los valores RGB del píxel actual.
-        r = img_in.img_r[i];
-        g = img_in.img_g[i];
-        b = img_in.img_b[i];
-        
-        // Convertimos de RGB a YUV utilizando las fórmulas estándar.
-        // Y: Luminancia (representa el brillo del píxel)
-        y  = (unsigned char)( 0.299*r + 0.587*g +  0.114*b);
-        // U (Cb): Componente de crominancia azul
-        cb = (unsigned char)(-0.169*r - 0.331*g +  0.499*b + 128);
-        // V (Cr): Componente de crominancia roja.
-        cr = (unsigned char)( 0.499*r - 0.418*g - 0.0813*b + 128);
-        
-        img_out.img_y[i] = y;
-        img_out.img_u[i] = cb;
-        img_out.img_v[i] = cr;
+// Bytes por píxel de una tesela durante la ecualización: la entrada RGB y las dos salidas
+#define TILE_BYTES_PER_PIXEL 9
+
+// Histogramas de L (hist_l) y de Y (hist_y) de n píxeles, bloque a bloque: cada bloque
+// de entrada se carga una vez para los dos canales
+static void tile_histograms(int64_t * hist_l, int64_t * hist_y, RGB_VIEW img, size_t n, int fixed)
+{
+    for (size_t i = 0; i < n; i += PIXEL_BLOCK) {
+        unsigned char c[PIXEL_BLOCK];
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        rgb2hsl_lightness_view(view_offset(img, i), c, len);
+        histogram_banked(hist_l, c, len);
+        rgb2yuv_luma_view(view_offset(img, i), c, len, fixed);
+        histogram_banked(hist_y, c, len);
+    }
+}
+
+// Ejecutor por teselas sobre la banda local: la banda se divide en teselas de filas que ocupan la mitad de L2
+// (tile_rows) y cada hilo toma teselas enteras. El primer recorrido calcula a la vez los
+// histogramas de L e Y; tras el histograma global, el segundo ecualiza cada tesela en HSL y
+// a continuación en YUV, mientras su entrada sigue en caché. Así la imagen de entrada se
+// lee de memoria dos veces en lugar de cuatro. yuv_out puede ser img_in (en el sitio):
+// HSL lee cada tesela antes de que YUV la sobrescriba
+static void tiled_pixels(RGB_VIEW img_in, RGB_VIEW hsl_out, RGB_VIEW yuv_out, int w, int h, TILED_TIMES * times)
+{
+    int rows = tile_rows(w, TILE_BYTES_PER_PIXEL);
+    int tiles = (h + rows - 1) / rows;
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+    int verify = (yuv_mode() == YUV_VERIFY);
+    int64_t hist[512];              // L en las 256 primeras entradas e Y en las siguientes
+    unsigned char lut_l[256], lut_y[256];
+    double hsl_busy = 0, yuv_busy = 0;
+    long diffs = 0;
+    int t;
+
+    double tstart = omp_get_wtime();
+    memset(hist, 0, sizeof(hist));
+    #pragma omp parallel for reduction(+:hist[:512]) schedule(runtime)
+    for (t = 0; t < tiles; t++) {
+        size_t first = (size_t)t * rows * w;
+        size_t len = (size_t)w * ((h - t * rows < rows) ? h - t * rows : rows);
+        tile_histograms(hist, hist + 256, view_offset(img_in, first), len, fixed);
     }
-    
-    return img_out;
-}
-
-unsigned char clip_rgb(int x)
-{
-    if(x > 255)
-        return 255;
-    if(x < 0)
-        return 0;
-
-    return (unsigned char)x;
-}
-
-//Convert YUV to RGB, all components in [0, 255]
-PPM_IMG yuv2rgb(YUV_IMG img_in)
-{
-    PPM_IMG img_out;
-    int i;
-    int  rt,gt,bt;
-    int y, cb, cr;
-    
-    
-    img_out.w = img_in.w;
-    img_out.h = img_in.h;
-    img_out.img_r = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_g = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_b = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-
-    // Paralelizamos el bucle con OpenMP:
-    // - `private(y, cb, cr, rt, gt, bt)`: Cada hilo tiene su propia copia de estas variables temporales.
-    // - `schedule(runtime)`: Permite configurar el esquema de planificación en tiempo de ejecución.
-    #pragma omp parallel for private(y, cb, cr, rt, gt, bt) schedule(runtime)
-    for(i = 0; i < img_out.w*img_out.h; i ++){
-        // Leemos los valores Y, U (Cb) y V (Cr) del píxel actual.
-        y  = (int)img_in.img_y[i];
-        cb = (int)img_in.img_u[i] - 128;
-        cr = (int)img_in.img_v[i] - 128;
-        
-        // Convertimos de YUV a RGB utilizando las fórmulas estándar.
-        rt  = (int)( y + 1.402*cr);
-        gt  = (int)( y - 0.344*cb - 0.714*cr);
-        bt  = (int)( y + 1.772*cb);
-
-        // Limitamos los valores RGB al rango válido [0, 255] usando `clip_rgb`.
-        img_out.img_r[i] = clip_rgb(rt);
-        img_out.img_g[i] = clip_rgb(gt);
-        img_out.img_b[i] = clip_rgb(bt);
+    // Histograma global de L e Y de todas las bandas en una sola reducción
+    int64_t global_hist[512];
+    MPI_Allreduce(hist, global_hist, 512, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut_l, global_hist, hist_total(global_hist, 256), 256);
+    histogram_lut(lut_y, global_hist + 256, hist_total(global_hist + 256, 256), 256);
+    double tmid = omp_get_wtime();
+
+    #pragma omp parallel for reduction(+:hsl_busy, yuv_busy, diffs) schedule(runtime)
+    for (t = 0; t < tiles; t++) {
+        size_t first = (size_t)t * rows * w;
+        size_t len = (size_t)w * ((h - t * rows < rows) ? h - t * rows : rows);
+        unsigned char * ref = NULL;
+        double t0 = omp_get_wtime();
+        hsl_equalize_view(lut_l, view_offset(img_in, first), view_offset(hsl_out, first), len);
+        double t1 = omp_get_wtime();
+        if (verify) {
+            // Referencia en double antes de que la salida pueda sobrescribir la entrada
+            ref = (unsigned char *)pool_alloc(3 * len * sizeof(unsigned char));
+            yuv_equalize_view(lut_y, view_offset(img_in, first), packed_view(ref), len, 0);
+        }
+        yuv_equalize_view(lut_y, view_offset(img_in, first), view_offset(yuv_out, first), len, fixed);
+        if (verify) {
+            diffs += count_view_diffs(view_offset(yuv_out, first), packed_view(ref), len);
+            pool_free(ref);
+        }
+        hsl_busy += t1 - t0;
+        yuv_busy += omp_get_wtime() - t1;
     }
-    
-    return img_out;
+    double tend = omp_get_wtime();
+
+    if (verify)
+        report_fixed_diffs("yuv equalization", diffs, (size_t)w * h);
+
+    // El segundo recorrido hace HSL y YUV juntos: su tiempo se reparte según lo que cada
+    // motor ocupó a los hilos
+    double share = (hsl_busy + yuv_busy > 0) ? hsl_busy / (hsl_busy + yuv_busy) : 0.5;
+    times->tile_rows = rows;
+    times->histogram = tmid - tstart;
+    times->hsl = (tend - tmid) * share;
+    times->yuv = (tend - tmid) - times->hsl;
+}
+
+void contrast_enhancement_c_tiled_band(PPM_IMG band, PPM_IMG hsl_out, PPM_IMG yuv_out, TILED_TIMES * times)
+{
+    tiled_pixels(planar_view(band.img_r, band.img_g, band.img_b),
+                 planar_view(hsl_out.img_r, hsl_out.img_g, hsl_out.img_b),
+                 planar_view(yuv_out.img_r, yuv_out.img_g, yuv_out.img_b), band.w, band.h, times);
+}
+
+void contrast_enhancement_c_tiled_packed_band(PPM_PACKED_IMG band, PPM_PACKED_IMG hsl_out,
+                                              PPM_PACKED_IMG yuv_out, TILED_TIMES * times)
+{
+    tiled_pixels(packed_view(band.img), packed_view(hsl_out.img), packed_view(yuv_out.img),
+                 band.w, band.h, times);
 }
@@ -1,12 +1,28 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "hist-equ.h"
+#include "pixel-kernels.h"
+#include "pnm-header.h"
 #include <omp.h>
 #include <mpi.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <string>
 
 void run_cpu_color_test(PPM_IMG img_in);
 void run_cpu_gray_test(PGM_IMG img_in);
+void run_cpu_color_test_band(PPM_IMG band);
+void run_cpu_color_test_packed_band(PPM_PACKED_IMG band);
+void run_cpu_gray_test_band(PGM_IMG band);
+void run_cpu_color_test_stream();
+void run_cpu_gray_test_stream();
 
 void set_schedule_openmp();
 
@@ -19,55 +35,204 @@ struct Times {
     double WriteTimeGray;
     double WriteTimeHsl;
     double WriteTimeYuv;
+    double WriteOverlapped; // E/S de color solapada con el cálculo (modo write-behind)
+    double WriteExposed;    // E/S de color que el proceso 0 tuvo que esperar
     double TotalTime;
 };
 
 Times times;
 
+// Modo de entrada/salida, configurado mediante variables de entorno
+struct IoMode {
+    int CollectiveWrite; // C_MPI_IO_WRITE=1: cada proceso escribe su banda con MPI-IO
+    int CollectiveRead;  // C_MPI_IO_READ=1: cada proceso lee solo su banda con MPI-IO
+    int Stream;          // C_STREAM=1: cada proceso recorre sus filas del disco por bandas
+    size_t StreamBudget; // C_STREAM_MEM_MB: memoria máxima por proceso para cada banda (bytes)
+    int Packed;          // C_PACKED=1: la imagen en color se procesa con los canales intercalados
+    int InPlace;         // C_INPLACE=1: gris y YUV sobrescriben su entrada en lugar de reservar salida
+    int AsyncWrite;      // C_ASYNC_WRITE=1: el proceso 0 escribe en un hilo de E/S en segundo plano
+    int Tiled;           // C_TILED=1: HSL y YUV seguidos sobre cada tesela de la banda del tamaño de L2
+};
+
+IoMode io_mode;
+
+void set_io_mode();
+
+void async_writer_start(size_t capacity);
+double async_writer_submit(PPM_IMG img, const char * path, int keep);
+double async_writer_submit_packed(PPM_PACKED_IMG img, const char * path, int keep);
+double async_writer_finish();
+double async_writer_overlapped();
+double async_writer_exposed();
+
+// La escritura en segundo plano solo se usa cuando el proceso 0 escribe la imagen recolectada;
+// la escritura colectiva con MPI-IO requiere a todos los procesos y sigue siendo síncrona
+static int async_output() {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    return rank == 0 && io_mode.AsyncWrite && !io_mode.CollectiveWrite;
+}
+
+static void color_output_begin() {
+    if (async_output()) {
+        const char *queue_str = getenv("C_ASYNC_WRITE_QUEUE");
+        async_writer_start((queue_str != NULL) ? atoi(queue_str) : 2);
+    }
+}
+
+// Escribe una imagen de color del proceso 0, directamente o a través del hilo de E/S, y la
+// libera salvo con keep (la imagen es de otro, p. ej. la entrada ecualizada en el sitio)
+static void write_color_output(PPM_IMG img, const char * path, int keep) {
+    if (async_output()) {
+        async_writer_submit(img, path, keep);
+    } else {
+        write_ppm(img, path);
+        if (!keep)
+            free_ppm(img);
+    }
+}
+
+static void write_color_output_packed(PPM_PACKED_IMG img, const char * path, int keep) {
+    if (async_output()) {
+        async_writer_submit_packed(img, path, keep);
+    } else {
+        write_ppm_packed(img, path);
+        if (!keep)
+            free_ppm_packed(img);
+    }
+}
+
+static void color_output_end() {
+    if (async_output()) {
+        async_writer_finish();
+    }
+}
+
+static void color_output_stats() {
+    if (async_output()) {
+        times.WriteOverlapped = async_writer_overlapped();
+        times.WriteExposed = async_writer_exposed();
+    } else {
+        times.WriteOverlapped = 0;
+        times.WriteExposed = times.WriteTimeHsl + times.WriteTimeYuv;
+    }
+}
+
 int main(int argc, char *argv[]) {
     PGM_IMG img_ibuf_g; // Estructura para almacenar una imagen en escala de grises
     PPM_IMG img_ibuf_c; // Estructura para almacenar una imagen en color
+    PPM_PACKED_IMG img_packed_c; // Imagen en color intercalada (C_PACKED=1)
+    MAPPED_IMG map_g;   // Proyección de in.pgm cuando se lee con mmap
+    MAPPED_IMG map_c;   // Proyección de in.ppm con C_PACKED y C_MMAP_READ
+
+    // C_MMAP_READ=1: leer las imágenes de entrada mediante mmap
+    const char *mmap_str = getenv("C_MMAP_READ");
+    int use_mmap = (mmap_str != NULL) ? atoi(mmap_str) : 0;
 
     // Inicializar MPI
     MPI_Init(&argc, &argv);
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank); // Obtener el rango del proceso actual
     MPI_Comm_size(MPI_COMM_WORLD, &size); // Obtener el número total de procesos
+    set_io_mode(); // Configurar el modo de E/S según las variables de entorno
     set_schedule_openmp(); // Configurar el programador de OpenMP según las variables de entorno
 
     // Medir el tiempo total de ejecución
     times.TotalTime = MPI_Wtime();
 
-    // Leer la imagen en escala de grises y medir el tiempo necesario
-    times.ReadTimeGray = MPI_Wtime();
-    img_ibuf_g = read_pgm("in.pgm"); // Leer archivo PGM
-    times.ReadTimeGray = MPI_Wtime() - times.ReadTimeGray;
+    if (io_mode.Stream) {
+        // La lectura y la escritura se hacen banda a banda dentro del procesamiento
+        run_cpu_gray_test_stream();
+        run_cpu_color_test_stream();
+    } else if (io_mode.CollectiveRead) {
+        // Con lectura colectiva cada proceso lee solo su banda y no hay MPI_Scatterv
+        times.ReadTimeGray = MPI_Wtime();
+        img_ibuf_g = read_pgm_mpi("in.pgm");
+        times.ReadTimeGray = MPI_Wtime() - times.ReadTimeGray;
+        run_cpu_gray_test_band(img_ibuf_g);
+        free_pgm(img_ibuf_g);
 
-    // Procesar la imagen en escala de grises
-    run_cpu_gray_test(img_ibuf_g);
-    free_pgm(img_ibuf_g); // Liberar memoria de la imagen en escala de grises
+        times.ReadTimeColor = MPI_Wtime();
+        if (io_mode.Packed) {
+            img_packed_c = read_ppm_packed_mpi("in.ppm");
+            times.ReadTimeColor = MPI_Wtime() - times.ReadTimeColor;
+            run_cpu_color_test_packed_band(img_packed_c);
+            free_ppm_packed(img_packed_c);
+        } else {
+            img_ibuf_c = read_ppm_mpi("in.ppm");
+            times.ReadTimeColor = MPI_Wtime() - times.ReadTimeColor;
+            run_cpu_color_test_band(img_ibuf_c);
+            free_ppm(img_ibuf_c);
+        }
+    } else {
+        // Leer la imagen en escala de grises y medir el tiempo necesario
+        times.ReadTimeGray = MPI_Wtime();
+        if (use_mmap) {
+            map_g = map_pnm("in.pgm");
+            img_ibuf_g = pgm_view(map_g); // Sin copia
+        } else {
+            img_ibuf_g = read_pgm("in.pgm"); // Leer archivo PGM
+        }
+        times.ReadTimeGray = MPI_Wtime() - times.ReadTimeGray;
+
+        // Procesar la imagen en escala de grises
+        run_cpu_gray_test(img_ibuf_g);
+        if (use_mmap) {
+            unmap_pnm(map_g);
+        } else {
+            free_pgm(img_ibuf_g); // Liberar memoria de la imagen en escala de grises
+        }
 
-    // Leer la imagen a color y medir el tiempo necesario
-    times.ReadTimeColor = MPI_Wtime();
-    img_ibuf_c = read_ppm("in.ppm"); // Leer archivo PPM
-    times.ReadTimeColor = MPI_Wtime() - times.ReadTimeColor;
+        // Leer la imagen a color y medir el tiempo necesario
+        if (io_mode.Packed) {
+            // La imagen intercalada se reparte por filas y cada proceso trabaja sobre su banda
+            times.ReadTimeColor = MPI_Wtime();
+            if (use_mmap) {
+                map_c = map_pnm("in.ppm");
+                img_packed_c = ppm_packed_view(map_c); // Sin copia
+            } else {
+                img_packed_c = read_ppm_packed("in.ppm");
+            }
+            PPM_PACKED_IMG band = scatter_ppm_packed(img_packed_c);
+            times.ReadTimeColor = MPI_Wtime() - times.ReadTimeColor;
 
-    // Procesar la imagen a color
-    run_cpu_color_test(img_ibuf_c);
-    free_ppm(img_ibuf_c); // Liberar memoria de la imagen a color
+            if (use_mmap) {
+                unmap_pnm(map_c);
+            } else {
+                free_ppm_packed(img_packed_c);
+            }
+            run_cpu_color_test_packed_band(band);
+            free_ppm_packed(band);
+        } else {
+            times.ReadTimeColor = MPI_Wtime();
+            img_ibuf_c = use_mmap ? read_ppm_mmap("in.ppm") : read_ppm("in.ppm"); // Leer archivo PPM
+            times.ReadTimeColor = MPI_Wtime() - times.ReadTimeColor;
+
+            // Procesar la imagen a color
+            run_cpu_color_test(img_ibuf_c);
+            free_ppm(img_ibuf_c); // Liberar memoria de la imagen a color
+        }
+    }
 
     // Calcular el tiempo total de ejecución
     times.TotalTime = MPI_Wtime() - times.TotalTime;
 
     // Imprimir estadísticas en el proceso maestro
     if (rank == 0) {
-        printf("Processes,Num Threads,ReadGray(s),ReadColor(s),Gray(s),Hsl(s),Yuv(s),WriteGray(s),WriteHsl(s),WriteYuv(s),Total(s)\n");
-        printf("%d,%d,%f,%f,%f,%f,%f,%f,%f,%f,%f\n", size, omp_get_max_threads(), 
+        // La salida estándar del proceso 0 es el CSV que recoge obtainData.sh: los
+        // informes van a la salida de error
+        fprintf(stderr, "Kernel ISA: %s\n", isa_name());
+        pool_report(stderr); // Reserva de buffers del proceso 0
+        printf("Processes,Num Threads,ReadGray(s),ReadColor(s),Gray(s),Hsl(s),Yuv(s),WriteGray(s),WriteHsl(s),WriteYuv(s),WriteOverlapped(s),WriteExposed(s),Total(s)\n");
+        printf("%d,%d,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f\n", size, omp_get_max_threads(), 
                times.ReadTimeGray, times.ReadTimeColor, times.GrayTime, 
                times.HslTime, times.YuvTime, times.WriteTimeGray, 
-               times.WriteTimeHsl, times.WriteTimeYuv, times.TotalTime);
+               times.WriteTimeHsl, times.WriteTimeYuv, 
+               times.WriteOverlapped, times.WriteExposed, times.TotalTime);
     }
 
+    pool_trim();
+
     // Finalizar MPI
     MPI_Finalize();
     return 0;
@@ -78,6 +243,15 @@ void run_cpu_color_test(PPM_IMG img_in) {
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank); // Obtener el rango del proceso actual
     
+    if (io_mode.CollectiveWrite || io_mode.Tiled) {
+        PPM_IMG band = scatter_ppm(img_in);
+        run_cpu_color_test_band(band);
+        free_ppm(band);
+        return;
+    }
+
+    color_output_begin();
+
     // Procesar la imagen en espacio de color HSL y medir el tiempo necesario
     times.HslTime = MPI_Wtime();
     img_obuf_hsl = contrast_enhancement_c_hsl(img_in); // Mejora de contraste en HSL
@@ -86,23 +260,29 @@ void run_cpu_color_test(PPM_IMG img_in) {
     // Escribir la imagen HSL procesada en el disco si es el proceso maestro
     if (rank == 0) {
         times.WriteTimeHsl = MPI_Wtime();
-        write_ppm(img_obuf_hsl, "out_hsl.ppm"); // Guardar imagen en archivo PPM
+        write_color_output(img_obuf_hsl, "out_hsl.ppm", 0); // Guardar imagen en archivo PPM (y liberar memoria)
         times.WriteTimeHsl = MPI_Wtime() - times.WriteTimeHsl;
-        free_ppm(img_obuf_hsl); // Liberar memoria
     }
 
     // Procesar la imagen en espacio de color YUV y medir el tiempo necesario
     times.YuvTime = MPI_Wtime();
-    img_obuf_yuv = contrast_enhancement_c_yuv(img_in); // Mejora de contraste en YUV
+    if (io_mode.InPlace) {
+        contrast_enhancement_c_yuv_inplace(img_in); // El resultado queda en img_in del proceso 0
+        img_obuf_yuv = img_in;
+    } else {
+        img_obuf_yuv = contrast_enhancement_c_yuv(img_in); // Mejora de contraste en YUV
+    }
     times.YuvTime = MPI_Wtime() - times.YuvTime;
 
     // Escribir la imagen YUV procesada en el disco si es el proceso maestro
     if (rank == 0) {
         times.WriteTimeYuv = MPI_Wtime();
-        write_ppm(img_obuf_yuv, "out_yuv.ppm"); // Guardar imagen en archivo PPM
+        // En el sitio el resultado es img_in, que la libera quien la leyó
+        write_color_output(img_obuf_yuv, "out_yuv.ppm", io_mode.InPlace);
+        color_output_end(); // Esperar a las escrituras pendientes
         times.WriteTimeYuv = MPI_Wtime() - times.WriteTimeYuv;
-        free_ppm(img_obuf_yuv); // Liberar memoria
     }
+    color_output_stats();
 }
 
 void get_custom_schedule(const char *schedule_str, const char* chunk_str, omp_sched_t *out_schedule_type, int *out_chunk_size) {
@@ -146,9 +326,21 @@ void set_schedule_openmp() {
 void run_cpu_gray_test(PGM_IMG img_in) {
     PGM_IMG img_obuf; // Imagen de salida para escala de grises
     
+    if (io_mode.CollectiveWrite) {
+        PGM_IMG band = scatter_pgm(img_in);
+        run_cpu_gray_test_band(band);
+        free_pgm(band);
+        return;
+    }
+
     // Procesar la imagen en escala de grises y medir el tiempo necesario
     times.GrayTime = MPI_Wtime();
-    img_obuf = contrast_enhancement_g(img_in); // Mejora de contraste
+    if (io_mode.InPlace) {
+        contrast_enhancement_g_inplace(img_in); // El resultado queda en img_in del proceso 0
+        img_obuf = img_in;
+    } else {
+        img_obuf = contrast_enhancement_g(img_in); // Mejora de contraste
+    }
     times.GrayTime = MPI_Wtime() - times.GrayTime;
 
     int rank;
@@ -159,54 +351,277 @@ void run_cpu_gray_test(PGM_IMG img_in) {
         times.WriteTimeGray = MPI_Wtime();
         write_pgm(img_obuf, "out.pgm"); // Guardar imagen en archivo PGM
         times.WriteTimeGray = MPI_Wtime() - times.WriteTimeGray;
-        free_pgm(img_obuf); // Liberar memoria
+        if (!io_mode.InPlace)
+            free_pgm(img_obuf); // Liberar memoria
     }
 }
 
 
 
+void set_io_mode() {
+    // Si la variable de entorno no está definida se mantiene la escritura desde el proceso 0
+    const char *write_str = getenv("C_MPI_IO_WRITE");
+    io_mode.CollectiveWrite = (write_str != NULL) ? atoi(write_str) : 0;
+
+    // Si no está definida, todos los procesos leen la imagen completa
+    const char *read_str = getenv("C_MPI_IO_READ");
+    io_mode.CollectiveRead = (read_str != NULL) ? atoi(read_str) : 0;
+
+    // En modo streaming la imagen nunca se carga completa en memoria
+    const char *stream_str = getenv("C_STREAM");
+    io_mode.Stream = (stream_str != NULL) ? atoi(stream_str) : 0;
+    const char *budget_str = getenv("C_STREAM_MEM_MB");
+    io_mode.StreamBudget = (size_t)((budget_str != NULL) ? atoi(budget_str) : 256) << 20;
+
+    // Sin separar canales al leer ni intercalarlos al escribir
+    const char *packed_str = getenv("C_PACKED");
+    io_mode.Packed = (packed_str != NULL) ? atoi(packed_str) : 0;
+
+    // La ecualización YUV es la última en leer la imagen en color, así que puede escribir
+    // sobre ella; la HSL necesita la entrada intacta y siempre reserva su salida
+    const char *inplace_str = getenv("C_INPLACE");
+    io_mode.InPlace = (inplace_str != NULL) ? atoi(inplace_str) : 0;
+
+    const char *async_str = getenv("C_ASYNC_WRITE");
+    io_mode.AsyncWrite = (async_str != NULL) ? atoi(async_str) : 0;
+
+    // El ejecutor por teselas trabaja sobre la banda de cada proceso
+    const char *tiled_str = getenv("C_TILED");
+    io_mode.Tiled = (tiled_str != NULL) ? atoi(tiled_str) : 0;
+}
+
+// Modo por teselas: las dos salidas de la banda se calculan juntas antes de escribir la
+// HSL. Los histogramas se cuentan en HSL y el segundo recorrido se reparte entre HSL y YUV
+// según lo que ocupó cada motor
+static void tiled_times(TILED_TIMES tiled) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    times.HslTime = tiled.histogram + tiled.hsl;
+    times.YuvTime = tiled.yuv;
+    if (rank == 0)
+        printf("Tiles: %d rows (%zu KB per tile, L2 %zu KB), histograms %f (s)\n",
+               tiled.tile_rows, tile_bytes() >> 10, l2_cache_size() >> 10, tiled.histogram);
+}
+
+// Procesamiento en color de la banda local de cada proceso.
+// La salida se escribe con MPI-IO o se recolecta en el proceso 0 según io_mode.
+void run_cpu_color_test_band(PPM_IMG band) {
+    PPM_IMG band_out, img_obuf;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // La altura completa es la suma de las bandas
+    int h;
+    MPI_Allreduce(&band.h, &h, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    color_output_begin();
+
+    PPM_IMG yuv_out;
+    if (io_mode.Tiled) {
+        TILED_TIMES tiled;
+        band_out = alloc_ppm(band.w, band.h);
+        yuv_out = io_mode.InPlace ? band : alloc_ppm(band.w, band.h);
+        contrast_enhancement_c_tiled_band(band, band_out, yuv_out, &tiled);
+        tiled_times(tiled);
+    } else {
+        times.HslTime = MPI_Wtime();
+        band_out = contrast_enhancement_c_hsl_band(band);
+        times.HslTime = MPI_Wtime() - times.HslTime;
+    }
+
+    times.WriteTimeHsl = MPI_Wtime();
+    if (io_mode.CollectiveWrite) {
+        write_ppm_mpi(band_out, "out_hsl.ppm");
+    } else {
+        img_obuf = gather_ppm(band_out, band.w, h);
+        if (rank == 0) {
+            write_color_output(img_obuf, "out_hsl.ppm", 0);
+        }
+    }
+    times.WriteTimeHsl = MPI_Wtime() - times.WriteTimeHsl;
+    free_ppm(band_out);
+
+    if (io_mode.Tiled) {
+        band_out = yuv_out;
+    } else {
+        times.YuvTime = MPI_Wtime();
+        if (io_mode.InPlace) {
+            contrast_enhancement_c_yuv_band_inplace(band);
+            band_out = band;
+        } else {
+            band_out = contrast_enhancement_c_yuv_band(band);
+        }
+        times.YuvTime = MPI_Wtime() - times.YuvTime;
+    }
+
+    times.WriteTimeYuv = MPI_Wtime();
+    if (io_mode.CollectiveWrite) {
+        write_ppm_mpi(band_out, "out_yuv.ppm");
+    } else {
+        img_obuf = gather_ppm(band_out, band.w, h);
+        if (rank == 0) {
+            write_color_output(img_obuf, "out_yuv.ppm", 0);
+            color_output_end();
+        }
+    }
+    times.WriteTimeYuv = MPI_Wtime() - times.WriteTimeYuv;
+    if (!io_mode.InPlace)
+        free_ppm(band_out);
+    color_output_stats();
+}
+
+// Igual que run_cpu_color_test_band con la banda intercalada: ni la lectura, ni el
+// reparto, ni la escritura separan o intercalan canales
+void run_cpu_color_test_packed_band(PPM_PACKED_IMG band) {
+    PPM_PACKED_IMG band_out, img_obuf;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // La altura completa es la suma de las bandas
+    int h;
+    MPI_Allreduce(&band.h, &h, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    color_output_begin();
+
+    PPM_PACKED_IMG yuv_out;
+    if (io_mode.Tiled) {
+        TILED_TIMES tiled;
+        band_out = band;
+        band_out.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * band.h * sizeof(unsigned char));
+        yuv_out = band;
+        if (!io_mode.InPlace)
+            yuv_out.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * band.h * sizeof(unsigned char));
+        contrast_enhancement_c_tiled_packed_band(band, band_out, yuv_out, &tiled);
+        tiled_times(tiled);
+    } else {
+        times.HslTime = MPI_Wtime();
+        band_out = contrast_enhancement_c_hsl_packed_band(band);
+        times.HslTime = MPI_Wtime() - times.HslTime;
+    }
+
+    times.WriteTimeHsl = MPI_Wtime();
+    if (io_mode.CollectiveWrite) {
+        write_ppm_packed_mpi(band_out, "out_hsl.ppm");
+    } else {
+        img_obuf = gather_ppm_packed(band_out, band.w, h);
+        if (rank == 0) {
+            write_color_output_packed(img_obuf, "out_hsl.ppm", 0);
+        }
+    }
+    times.WriteTimeHsl = MPI_Wtime() - times.WriteTimeHsl;
+    free_ppm_packed(band_out);
+
+    if (io_mode.Tiled) {
+        band_out = yuv_out;
+    } else {
+        times.YuvTime = MPI_Wtime();
+        if (io_mode.InPlace) {
+            contrast_enhancement_c_yuv_packed_band_inplace(band);
+            band_out = band;
+        } else {
+            band_out = contrast_enhancement_c_yuv_packed_band(band);
+        }
+        times.YuvTime = MPI_Wtime() - times.YuvTime;
+    }
+
+    times.WriteTimeYuv = MPI_Wtime();
+    if (io_mode.CollectiveWrite) {
+        write_ppm_packed_mpi(band_out, "out_yuv.ppm");
+    } else {
+        img_obuf = gather_ppm_packed(band_out, band.w, h);
+        if (rank == 0) {
+            write_color_output_packed(img_obuf, "out_yuv.ppm", 0);
+            color_output_end();
+        }
+    }
+    times.WriteTimeYuv = MPI_Wtime() - times.WriteTimeYuv;
+    if (!io_mode.InPlace)
+        free_ppm_packed(band_out);
+    color_output_stats();
+}
+
+// Procesamiento en escala de grises de la banda local de cada proceso
+void run_cpu_gray_test_band(PGM_IMG band) {
+    PGM_IMG band_out, img_obuf;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int h;
+    MPI_Allreduce(&band.h, &h, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    times.GrayTime = MPI_Wtime();
+    if (io_mode.InPlace) {
+        contrast_enhancement_g_band_inplace(band);
+        band_out = band;
+    } else {
+        band_out = contrast_enhancement_g_band(band);
+    }
+    times.GrayTime = MPI_Wtime() - times.GrayTime;
+
+    times.WriteTimeGray = MPI_Wtime();
+    if (io_mode.CollectiveWrite) {
+        write_pgm_mpi(band_out, "out.pgm");
+    } else {
+        img_obuf = gather_pgm(band_out, band.w, h);
+        if (rank == 0) {
+            write_pgm(img_obuf, "out.pgm");
+            free_pgm(img_obuf);
+        }
+    }
+    times.WriteTimeGray = MPI_Wtime() - times.WriteTimeGray;
+    if (!io_mode.InPlace)
+        free_pgm(band_out);
+}
+
+// Modo streaming: cada proceso lee, procesa y escribe sus filas banda a banda,
+// por lo que la E/S queda incluida en el tiempo de procesamiento
+void run_cpu_color_test_stream() {
+    times.HslTime = MPI_Wtime();
+    contrast_enhancement_c_hsl_stream("in.ppm", "out_hsl.ppm", io_mode.StreamBudget);
+    times.HslTime = MPI_Wtime() - times.HslTime;
+
+    times.YuvTime = MPI_Wtime();
+    contrast_enhancement_c_yuv_stream("in.ppm", "out_yuv.ppm", io_mode.StreamBudget);
+    times.YuvTime = MPI_Wtime() - times.YuvTime;
+}
+
+void run_cpu_gray_test_stream() {
+    times.GrayTime = MPI_Wtime();
+    contrast_enhancement_g_stream("in.pgm", "out.pgm", io_mode.StreamBudget);
+    times.GrayTime = MPI_Wtime() - times.GrayTime;
+}
+
 PPM_IMG read_ppm(const char * path){
     // Aplicamos paralelización mediante omp en la lectura en imágenes de color
     FILE * in_file;
-    char sbuf[256];
     
     char *ibuf;
     PPM_IMG result;
-    int v_max, i;
+    size_t i;
     in_file = fopen(path, "r");
     if (in_file == NULL){
         printf("Input file not found!\n");
         exit(1);
     }
-    /*Skip the magic number*/
-    fscanf(in_file, "%s", sbuf);
-
-
-    //result = malloc(sizeof(PPM_IMG));
-    fscanf(in_file, "%d",&result.w);
-    fscanf(in_file, "%d",&result.h);
-    fscanf(in_file, "%d\n",&v_max);
+    PNM_HEADER hdr = read_pnm_header(in_file);
     
 
-    result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    ibuf         = (char *)malloc(3 * result.w * result.h * sizeof(char));
+    result = alloc_ppm(hdr.w, hdr.h);
+    ibuf         = (char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(char));
 
     // Leemos todos los datos de la imagen desde el archivo.
     // Los datos están organizados como una secuencia de valores RGB intercalados.
-    fread(ibuf,sizeof(unsigned char), 3 * result.w*result.h, in_file);
+    fread(ibuf,sizeof(unsigned char), 3 * (size_t)result.w * result.h, in_file);
 
     // Paralelizamos la separación de los canales R, G y B utilizando OpenMP.
     #pragma omp parallel for schedule(runtime)
-    for(i = 0; i < result.w*result.h; i ++){
-        result.img_r[i] = ibuf[3*i + 0]; //Extraemos el componente rojo
-        result.img_g[i] = ibuf[3*i + 1]; //Extraemos el componente verde
-        result.img_b[i] = ibuf[3*i + 2]; //Extraemos el componente azul
+    for(i = 0; i < (size_t)result.w * result.h; i += PIXEL_BLOCK){
+        size_t len = ((size_t)result.w * result.h - i < PIXEL_BLOCK) ? (size_t)result.w * result.h - i : PIXEL_BLOCK;
+        deinterleave_rgb((const unsigned char *)ibuf + 3*i, result.img_r + i, result.img_g + i, result.img_b + i, len);
     }
     
     fclose(in_file);
-    free(ibuf);
+    pool_free(ibuf);
     
     return result;
 }
@@ -214,54 +629,99 @@ PPM_IMG read_ppm(const char * path){
 void write_ppm(PPM_IMG img, const char * path){
     // Se paraleliza la organización de los datos de los canales R, G y B en un solo buffer intercalado.
     FILE * out_file;
-    int i;
+    size_t i;
     
-    char * obuf = (char *)malloc(3 * img.w * img.h * sizeof(char));
+    char * obuf = (char *)pool_alloc(3 * (size_t)img.w * img.h * sizeof(char));
 
     // Paralelizamos la construcción del buffer intercalado utilizando OpenMP.
     #pragma omp parallel for schedule(runtime)
-    for(i = 0; i < img.w*img.h; i ++){
-        obuf[3*i + 0] = img.img_r[i]; // Canal rojo
-        obuf[3*i + 1] = img.img_g[i]; // Canal verde
-        obuf[3*i + 2] = img.img_b[i]; // Canal azul
+    for(i = 0; i < (size_t)img.w * img.h; i += PIXEL_BLOCK){
+        size_t len = ((size_t)img.w * img.h - i < PIXEL_BLOCK) ? (size_t)img.w * img.h - i : PIXEL_BLOCK;
+        interleave_rgb(img.img_r + i, img.img_g + i, img.img_b + i, (unsigned char *)obuf + 3*i, len);
     }
     out_file = fopen(path, "wb");
     fprintf(out_file, "P6\n");
     fprintf(out_file, "%d %d\n255\n",img.w, img.h);
-    fwrite(obuf,sizeof(unsigned char), 3*img.w*img.h, out_file);
+    fwrite(obuf,sizeof(unsigned char), 3*(size_t)img.w * img.h, out_file);
     fclose(out_file);
-    free(obuf);
+    pool_free(obuf);
 }
 
 void free_ppm(PPM_IMG img)
 {
-    free(img.img_r);
-    free(img.img_g);
-    free(img.img_b);
+    pool_free(img.img_r);
+}
+
+// Los tres planos de una imagen salen de un único bloque de la reserva de buffers,
+// cada uno alineado a POOL_ALIGN; el bloque empieza en el primer plano
+PPM_IMG alloc_ppm(int w, int h)
+{
+    PPM_IMG img;
+    size_t stride = pool_plane_stride((size_t)w * h);
+    unsigned char * block = (unsigned char *)pool_alloc(3 * stride);
+
+    img.w = w;
+    img.h = h;
+    img.img_r = block;
+    img.img_g = block + stride;
+    img.img_b = block + 2 * stride;
+    return img;
+}
+
+// Lectura y escritura sin separar canales: los píxeles se copian tal como están en el fichero
+PPM_PACKED_IMG read_ppm_packed(const char * path){
+    FILE * in_file;
+    PPM_PACKED_IMG result;
+
+    in_file = fopen(path, "r");
+    if (in_file == NULL){
+        printf("Input file not found!\n");
+        exit(1);
+    }
+    PNM_HEADER hdr = read_pnm_header(in_file);
+    result.w = hdr.w;
+    result.h = hdr.h;
+
+    result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+    fread(result.img, sizeof(unsigned char), 3 * (size_t)result.w * result.h, in_file);
+
+    fclose(in_file);
+    return result;
+}
+
+void write_ppm_packed(PPM_PACKED_IMG img, const char * path){
+    FILE * out_file = fopen(path, "wb");
+
+    fprintf(out_file, "P6\n");
+    fprintf(out_file, "%d %d\n255\n",img.w, img.h);
+    fwrite(img.img, sizeof(unsigned char), 3*(size_t)img.w * img.h, out_file);
+    fclose(out_file);
+}
+
+void free_ppm_packed(PPM_PACKED_IMG img)
+{
+    pool_free(img.img);
 }
 
 PGM_IMG read_pgm(const char * path){
     FILE * in_file;
-    char sbuf[256];
     
     
     PGM_IMG result;
-    int v_max;//, i;
     in_file = fopen(path, "r");
     if (in_file == NULL){
         printf("Input file not found!\n");
         exit(1);
     }
     
-    fscanf(in_file, "%s", sbuf); /*Skip the magic number*/
-    fscanf(in_file, "%d",&result.w);
-    fscanf(in_file, "%d",&result.h);
-    fscanf(in_file, "%d\n",&v_max);
+    PNM_HEADER hdr = read_pnm_header(in_file);
+    result.w = hdr.w;
+    result.h = hdr.h;
     
-    result.img = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
+    result.img = (unsigned char *)pool_alloc((size_t)result.w * result.h * sizeof(unsigned char));
 
         
-    fread(result.img,sizeof(unsigned char), result.w*result.h, in_file);    
+    fread(result.img,sizeof(unsigned char), (size_t)result.w * result.h, in_file);    
     fclose(in_file);
     
     return result;
@@ -272,11 +732,457 @@ void write_pgm(PGM_IMG img, const char * path){
     out_file = fopen(path, "wb");
     fprintf(out_file, "P5\n");
     fprintf(out_file, "%d %d\n255\n",img.w, img.h);
-    fwrite(img.img,sizeof(unsigned char), img.w*img.h, out_file);
+    fwrite(img.img,sizeof(unsigned char), (size_t)img.w * img.h, out_file);
     fclose(out_file);
 }
 
 void free_pgm(PGM_IMG img)
 {
-    free(img.img);
+    pool_free(img.img);
+}
+
+// Fila inicial de la banda local: suma de las filas de los procesos anteriores
+static int band_first_row(int rows){
+    int rank, first_row = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Exscan(&rows, &first_row, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        first_row = 0; // MPI_Exscan no define el resultado en el proceso 0
+    }
+    return first_row;
+}
+
+// El proceso 0 interpreta la cabecera y difunde ancho, alto, valor máximo,
+// desplazamiento de los datos y número de canales
+static void read_header_mpi(const char * path, int * header){
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0) {
+        FILE * in_file;
+        in_file = fopen(path, "r");
+        if (in_file == NULL){
+            printf("Input file not found!\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        PNM_HEADER hdr = read_pnm_header(in_file);
+        header[0] = hdr.w;
+        header[1] = hdr.h;
+        header[2] = hdr.max_value;
+        header[3] = (int)hdr.offset;
+        header[4] = hdr.channels;
+        fclose(in_file);
+    }
+    MPI_Bcast(header, 5, MPI_INT, 0, MPI_COMM_WORLD);
+}
+
+// Lee únicamente la banda de filas de este proceso
+static unsigned char * read_band_mpi(const char * path, int channels, int * w, int * rows){
+    int header[5];
+    read_header_mpi(path, header);
+
+    *w = header[0];
+    *rows = band_rows(header[1]);
+    int first_row = band_first_row(*rows);
+
+    MPI_File in_file;
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &in_file) != MPI_SUCCESS){
+        printf("Input file not found!\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    unsigned char * buf = (unsigned char *)pool_alloc((size_t)channels * (*w) * (*rows) * sizeof(unsigned char));
+    MPI_Offset offset = (MPI_Offset)header[3] + (MPI_Offset)channels * (*w) * first_row;
+    MPI_Datatype row = row_type(channels * (*w)); // La cuenta va en filas: no desborda un int
+    MPI_File_read_at_all(in_file, offset, buf, *rows, row, MPI_STATUS_IGNORE);
+    MPI_Type_free(&row);
+    MPI_File_close(&in_file);
+
+    return buf;
+}
+
+PPM_IMG read_ppm_mpi(const char * path){
+    int w, h;
+    size_t i;
+    unsigned char * ibuf = read_band_mpi(path, 3, &w, &h);
+    PPM_IMG band = alloc_ppm(w, h);
+
+    // Cada proceso separa los canales únicamente de sus filas
+    #pragma omp parallel for schedule(runtime)
+    for(i = 0; i < (size_t)band.w * band.h; i += PIXEL_BLOCK){
+        size_t len = ((size_t)band.w * band.h - i < PIXEL_BLOCK) ? (size_t)band.w * band.h - i : PIXEL_BLOCK;
+        deinterleave_rgb(ibuf + 3*i, band.img_r + i, band.img_g + i, band.img_b + i, len);
+    }
+    pool_free(ibuf);
+
+    return band;
+}
+
+PPM_PACKED_IMG read_ppm_packed_mpi(const char * path){
+    PPM_PACKED_IMG band;
+    band.img = read_band_mpi(path, 3, &band.w, &band.h);
+    return band;
+}
+
+PGM_IMG read_pgm_mpi(const char * path){
+    PGM_IMG band;
+    band.img = read_band_mpi(path, 1, &band.w, &band.h);
+    return band;
+}
+
+// Escribe la banda local en su posición dentro del fichero final.
+// El proceso 0 escribe la cabecera y todos escriben sus píxeles con MPI_File_write_at_all.
+static void write_band_mpi(const char * path, const char * magic, int w, int rows, int channels, unsigned char * buf){
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Fila inicial de la banda y alto total
+    int first_row = band_first_row(rows), total_rows;
+    MPI_Allreduce(&rows, &total_rows, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    // Todos los procesos calculan la cabecera para conocer su longitud
+    char header[64];
+    int header_len = sprintf(header, "%s\n%d %d\n255\n", magic, w, total_rows);
+
+    MPI_File out_file;
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &out_file) != MPI_SUCCESS){
+        printf("Output file could not be opened!\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    // Truncamos el fichero por si ya existía uno más grande
+    MPI_File_set_size(out_file, (MPI_Offset)header_len + (MPI_Offset)channels * w * total_rows);
+
+    if (rank == 0) {
+        MPI_File_write_at(out_file, 0, header, header_len, MPI_CHAR, MPI_STATUS_IGNORE);
+    }
+
+    MPI_Offset offset = (MPI_Offset)header_len + (MPI_Offset)channels * w * first_row;
+    MPI_Datatype row = row_type(channels * w); // La cuenta va en filas: no desborda un int
+    MPI_File_write_at_all(out_file, offset, buf, rows, row, MPI_STATUS_IGNORE);
+    MPI_Type_free(&row);
+    MPI_File_close(&out_file);
+}
+
+void write_ppm_mpi(PPM_IMG band, const char * path){
+    size_t i;
+    unsigned char * obuf = (unsigned char *)pool_alloc(3 * (size_t)band.w * band.h * sizeof(unsigned char));
+
+    // Cada proceso intercala únicamente sus propias filas
+    #pragma omp parallel for schedule(runtime)
+    for(i = 0; i < (size_t)band.w * band.h; i += PIXEL_BLOCK){
+        size_t len = ((size_t)band.w * band.h - i < PIXEL_BLOCK) ? (size_t)band.w * band.h - i : PIXEL_BLOCK;
+        interleave_rgb(band.img_r + i, band.img_g + i, band.img_b + i, obuf + 3*i, len);
+    }
+    write_band_mpi(path, "P6", band.w, band.h, 3, obuf);
+    pool_free(obuf);
+}
+
+void write_ppm_packed_mpi(PPM_PACKED_IMG band, const char * path){
+    write_band_mpi(path, "P6", band.w, band.h, 3, band.img);
+}
+
+void write_pgm_mpi(PGM_IMG band, const char * path){
+    write_band_mpi(path, "P5", band.w, band.h, 1, band.img);
+}
+
+MAPPED_IMG map_pnm(const char * path){
+    MAPPED_IMG result;
+    struct stat st;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0){
+        printf("Input file not found!\n");
+        exit(1);
+    }
+    result.map_size = st.st_size;
+
+    // El fichero se recorre una sola vez de principio a fin
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    // Escribible y privada (copia en escritura): el modo C_INPLACE ecualiza sobre la
+    // propia proyección sin modificar el fichero
+    result.map = mmap(NULL, result.map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // La proyección sigue siendo válida tras cerrar el descriptor
+    if (result.map == MAP_FAILED){
+        printf("Input file could not be mapped!\n");
+        exit(1);
+    }
+    madvise(result.map, result.map_size, MADV_SEQUENTIAL);
+    madvise(result.map, result.map_size, MADV_WILLNEED);
+
+    // La cabecera se interpreta sobre la propia proyección con el mismo lector que la
+    // lectura con stdio, así que ambos modos aceptan exactamente los mismos ficheros
+    FILE * header_file = fmemopen(result.map, result.map_size, "rb");
+    PNM_HEADER hdr = read_pnm_header(header_file);
+    fclose(header_file);
+    result.w = hdr.w;
+    result.h = hdr.h;
+    result.channels = hdr.channels;
+
+    const unsigned char * p = (const unsigned char *)result.map + hdr.offset;
+    const unsigned char * end = (const unsigned char *)result.map + result.map_size;
+
+    result.data = (unsigned char *)p;
+    if (p > end || (size_t)(end - p) < (size_t)result.channels * (size_t)result.w * result.h){
+        printf("Input file is truncated!\n");
+        exit(1);
+    }
+
+    return result;
+}
+
+void unmap_pnm(MAPPED_IMG img){
+    munmap(img.map, img.map_size);
+}
+
+PGM_IMG pgm_view(MAPPED_IMG img){
+    // Vista sin copia: los píxeles se leen directamente de la proyección.
+    // No se debe llamar a free_pgm sobre ella, sino a unmap_pnm.
+    PGM_IMG result;
+    result.w = img.w;
+    result.h = img.h;
+    result.img = img.data;
+    return result;
+}
+
+PPM_PACKED_IMG ppm_packed_view(MAPPED_IMG img){
+    // Vista sin copia de una imagen en color: se libera con unmap_pnm, no con free_ppm_packed
+    PPM_PACKED_IMG result;
+    result.w = img.w;
+    result.h = img.h;
+    result.img = img.data;
+    return result;
+}
+
+PPM_IMG read_ppm_mmap(const char * path){
+    // Separamos los canales leyendo directamente de la proyección, sin buffer intermedio
+    MAPPED_IMG mapped = map_pnm(path);
+    PPM_IMG result = alloc_ppm(mapped.w, mapped.h);
+    size_t i;
+
+    const unsigned char * ibuf = mapped.data;
+    #pragma omp parallel for schedule(runtime)
+    for(i = 0; i < (size_t)result.w * result.h; i += PIXEL_BLOCK){
+        size_t len = ((size_t)result.w * result.h - i < PIXEL_BLOCK) ? (size_t)result.w * result.h - i : PIXEL_BLOCK;
+        deinterleave_rgb(ibuf + 3*i, result.img_r + i, result.img_g + i, result.img_b + i, len);
+    }
+
+    unmap_pnm(mapped);
+
+    return result;
+}
+
+// Escritura en segundo plano (write-behind): un hilo de E/S vacía una cola acotada
+// de imágenes terminadas mientras el hilo principal calcula la siguiente.
+struct WriteJob {
+    PPM_IMG img;
+    PPM_PACKED_IMG packed_img; // Imagen intercalada cuando packed != 0
+    int packed;
+    int keep;                  // La imagen sigue siendo del llamador: no se libera al escribirla
+    std::string path;
+};
+
+struct AsyncWriter {
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<WriteJob> queue;
+    size_t capacity;     // Número máximo de imágenes pendientes de escribir
+    bool closing;
+    double busy_time;    // Tiempo total que el hilo de E/S pasa escribiendo
+    double exposed_time; // Tiempo que el hilo principal espera por la E/S
+};
+
+AsyncWriter writer;
+
+static void async_writer_loop() {
+    // El entrelazado de write_ppm se hace con un solo hilo para no quitar
+    // núcleos a la etapa de cálculo que se está solapando
+    omp_set_num_threads(1);
+
+    for (;;) {
+        WriteJob job;
+        {
+            std::unique_lock<std::mutex> lock(writer.mutex);
+            writer.not_empty.wait(lock, [] { return !writer.queue.empty() || writer.closing; });
+            if (writer.queue.empty()) {
+                return; // Cola vacía y cerrada: no queda nada por escribir
+            }
+            job = writer.queue.front();
+            writer.queue.pop_front();
+        }
+        writer.not_full.notify_one();
+
+        double tstart = omp_get_wtime();
+        // El hilo de E/S es el propietario de la imagen
+        if (job.packed) {
+            write_ppm_packed(job.packed_img, job.path.c_str());
+            if (!job.keep)
+                free_ppm_packed(job.packed_img);
+        } else {
+            write_ppm(job.img, job.path.c_str());
+            if (!job.keep)
+                free_ppm(job.img);
+        }
+        double elapsed = omp_get_wtime() - tstart;
+
+        std::lock_guard<std::mutex> lock(writer.mutex);
+        writer.busy_time += elapsed;
+    }
+}
+
+void async_writer_start(size_t capacity) {
+    writer.capacity = (capacity > 0) ? capacity : 1;
+    writer.closing = false;
+    writer.busy_time = 0;
+    writer.exposed_time = 0;
+    writer.worker = std::thread(async_writer_loop);
+}
+
+// Encola la imagen para escribirla; solo bloquea si la cola está llena.
+// La imagen pasa a ser propiedad del hilo de E/S, que la libera tras escribirla salvo con keep,
+// en cuyo caso el llamador no debe tocarla ni liberarla hasta async_writer_finish.
+static double async_writer_push(const WriteJob & job) {
+    double tstart = omp_get_wtime();
+    {
+        std::unique_lock<std::mutex> lock(writer.mutex);
+        writer.not_full.wait(lock, [] { return writer.queue.size() < writer.capacity; });
+        writer.queue.push_back(job);
+    }
+    writer.not_empty.notify_one();
+    double waited = omp_get_wtime() - tstart;
+    writer.exposed_time += waited;
+    return waited;
+}
+
+double async_writer_submit(PPM_IMG img, const char * path, int keep) {
+    WriteJob job;
+    job.img = img;
+    job.packed = 0;
+    job.keep = keep;
+    job.path = path;
+    return async_writer_push(job);
+}
+
+double async_writer_submit_packed(PPM_PACKED_IMG img, const char * path, int keep) {
+    WriteJob job;
+    job.packed_img = img;
+    job.packed = 1;
+    job.keep = keep;
+    job.path = path;
+    return async_writer_push(job);
+}
+
+// Espera a que terminen las escrituras pendientes y detiene el hilo de E/S
+double async_writer_finish() {
+    double tstart = omp_get_wtime();
+    {
+        std::lock_guard<std::mutex> lock(writer.mutex);
+        writer.closing = true;
+    }
+    writer.not_empty.notify_one();
+    writer.worker.join();
+    double waited = omp_get_wtime() - tstart;
+    writer.exposed_time += waited;
+    return waited;
+}
+
+// Tiempo de E/S oculto tras el cálculo: lo que el hilo de E/S escribió sin que el principal esperase
+double async_writer_overlapped() {
+    double overlapped = writer.busy_time - writer.exposed_time;
+    return (overlapped > 0) ? overlapped : 0;
+}
+
+double async_writer_exposed() {
+    return writer.exposed_time;
+}
+
+// Con streaming cada proceso recorre sus propias filas banda a banda y el número de
+// bandas puede variar entre procesos, por eso las lecturas y escrituras son independientes
+PNM_STREAM open_pnm_stream(const char * path){
+    PNM_STREAM s;
+    int rank, header[5];
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    read_header_mpi(path, header);
+    s.w = header[0];
+    s.h = header[1];
+    s.offset = header[3];
+    s.channels = header[4];
+    if (rank == 0) {
+        printf("Image size: %d x %d\n", s.w, s.h);
+    }
+
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &s.file) != MPI_SUCCESS){
+        printf("Input file not found!\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    return s;
+}
+
+PNM_STREAM create_pnm_stream(const char * path, int w, int h, int channels){
+    PNM_STREAM s;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Todos los procesos calculan la cabecera para conocer su longitud
+    char header[64];
+    int header_len = sprintf(header, "%s\n%d %d\n255\n", (channels == 3) ? "P6" : "P5", w, h);
+
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &s.file) != MPI_SUCCESS){
+        printf("Output file could not be opened!\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    // Truncamos el fichero por si ya existía uno más grande
+    MPI_File_set_size(s.file, (MPI_Offset)header_len + (MPI_Offset)channels * w * h);
+
+    if (rank == 0) {
+        MPI_File_write_at(s.file, 0, header, header_len, MPI_CHAR, MPI_STATUS_IGNORE);
+    }
+    s.w = w;
+    s.h = h;
+    s.channels = channels;
+    s.offset = header_len;
+
+    return s;
+}
+
+void close_pnm_stream(PNM_STREAM s){
+    MPI_File_close(&s.file);
+}
+
+// Lectura y escritura independientes de rows filas de row_bytes bytes. Se cuentan filas
+// con un tipo MPI de fila, así que la banda puede superar 2^31 bytes
+static void read_rows_at(MPI_File file, MPI_Offset offset, unsigned char * buf, int row_bytes, int rows){
+    MPI_Datatype row = row_type(row_bytes);
+    MPI_File_read_at(file, offset, buf, rows, row, MPI_STATUS_IGNORE);
+    MPI_Type_free(&row);
+}
+
+static void write_rows_at(MPI_File file, MPI_Offset offset, unsigned char * buf, int row_bytes, int rows){
+    MPI_Datatype row = row_type(row_bytes);
+    MPI_File_write_at(file, offset, buf, rows, row, MPI_STATUS_IGNORE);
+    MPI_Type_free(&row);
+}
+
+void read_pgm_rows(PNM_STREAM s, int first_row, PGM_IMG band){
+    MPI_Offset offset = (MPI_Offset)s.offset + (MPI_Offset)s.w * first_row;
+    read_rows_at(s.file, offset, band.img, band.w, band.h);
+}
+
+void write_pgm_rows(PNM_STREAM s, int first_row, PGM_IMG band){
+    MPI_Offset offset = (MPI_Offset)s.offset + (MPI_Offset)s.w * first_row;
+    write_rows_at(s.file, offset, band.img, band.w, band.h);
+}
+
+void read_ppm_packed_rows(PNM_STREAM s, int first_row, PPM_PACKED_IMG band){
+    MPI_Offset offset = (MPI_Offset)s.offset + (MPI_Offset)3 * s.w * first_row;
+    read_rows_at(s.file, offset, band.img, 3 * band.w, band.h);
+}
+
+void write_ppm_packed_rows(PNM_STREAM s, int first_row, PPM_PACKED_IMG band){
+    MPI_Offset offset = (MPI_Offset)s.offset + (MPI_Offset)3 * s.w * first_row;
+    write_rows_at(s.file, offset, band.img, 3 * band.w, band.h);
 }
@@ -2,31 +2,140 @@
 #include <string.h>
 #include <stdlib.h>
 #include "hist-equ.h"
+#include "pixel-kernels.h"
+#include <omp.h>
+
+
+// Estrategias para calcular el histograma en paralelo
+enum HistMethod { HIST_SERIAL, HIST_REDUCTION, HIST_PRIVATE, HIST_ATOMIC };
+
+// Por debajo de este número de píxeles no compensa abrir una región paralela
+#define HIST_MIN_PARALLEL 65536
+// Con más hilos que este valor la mezcla por bins de las copias privadas escala mejor
+// que la reducción de arrays del runtime, que combina las copias hilo a hilo
+#define HIST_MAX_REDUCTION_THREADS 8
+// Píxeles que cada hilo pasa de una vez al núcleo por bancos (histogram_banked)
+#define HIST_BLOCK 16384
+
+// Elige la estrategia según el número de hilos y el tamaño de la imagen.
+// C_OMP_HIST=serial|reduction|private|atomic fuerza una estrategia concreta.
+static HistMethod histogram_method(size_t img_size, int nbr_bin){
+    const char *method_str = getenv("C_OMP_HIST");
+    if (method_str != NULL) {
+        if (strcmp(method_str, "serial") == 0) return HIST_SERIAL;
+        if (strcmp(method_str, "reduction") == 0) return HIST_REDUCTION;
+        if (strcmp(method_str, "private") == 0) return HIST_PRIVATE;
+        if (strcmp(method_str, "atomic") == 0) return HIST_ATOMIC;
+    }
+
+    int threads = omp_get_max_threads();
+    if (threads == 1 || img_size < HIST_MIN_PARALLEL) {
+        return HIST_SERIAL;
+    }
+    // Si cada hilo tiene pocos píxeles por bin, mezclar las copias cuesta más que las atómicas
+    if (img_size / threads < (size_t)4 * nbr_bin) {
+        return HIST_ATOMIC;
+    }
+    if (threads <= HIST_MAX_REDUCTION_THREADS) {
+        return HIST_REDUCTION;
+    }
+    return HIST_PRIVATE;
+}
 
+// Cada hilo acumula en su propia copia del histograma y el runtime las suma al final
+static void histogram_reduction(int64_t * hist_out, unsigned char * img_in, size_t img_size, int nbr_bin){
+    size_t i;
+    #pragma omp parallel for schedule(runtime) reduction(+:hist_out[:nbr_bin])
+    for ( i = 0; i < img_size; i += HIST_BLOCK){
+        size_t len = (img_size - i < HIST_BLOCK) ? img_size - i : HIST_BLOCK;
+        histogram_banked(hist_out, img_in + i, len);
+    }
+}
+
+// Copias privadas separadas al menos una línea de caché (64 bytes) para evitar falso
+// compartido; la mezcla se reparte por bins, de modo que cada hilo suma una parte del array
+static void histogram_private(int64_t * hist_out, unsigned char * img_in, size_t img_size, int nbr_bin){
+    int threads = omp_get_max_threads();
+    int stride = (nbr_bin + 7) & ~7;
+    size_t bytes = (size_t)threads * stride * sizeof(int64_t);
+    int64_t * hist_priv = (int64_t *)aligned_alloc(64, bytes);
+    if (hist_priv == NULL) {
+        printf("Out of memory allocating %zu bytes\n", bytes);
+        exit(1);
+    }
+
+    #pragma omp parallel num_threads(threads)
+    {
+        // El equipo puede tener menos hilos de los pedidos (OMP_DYNAMIC, OMP_THREAD_LIMIT):
+        // solo existen, y se suman, las copias de los hilos que lo forman
+        int team = omp_get_num_threads();
+        int i;
+        size_t p;
+        int64_t * hist_local = hist_priv + (size_t)omp_get_thread_num() * stride;
+        for ( i = 0; i < nbr_bin; i ++){
+            hist_local[i] = 0;
+        }
+
+        #pragma omp for schedule(runtime)
+        for ( p = 0; p < img_size; p += HIST_BLOCK){
+            size_t len = (img_size - p < HIST_BLOCK) ? img_size - p : HIST_BLOCK;
+            histogram_banked(hist_local, img_in + p, len);
+        }
+
+        #pragma omp for schedule(static)
+        for ( i = 0; i < nbr_bin; i ++){
+            int t;
+            int64_t sum = 0;
+            for ( t = 0; t < team; t ++){
+                sum += hist_priv[(size_t)t * stride + i];
+            }
+            hist_out[i] = sum;
+        }
+    }
+
+    free(hist_priv);
+}
+
+// Un único histograma compartido actualizado con operaciones atómicas
+static void histogram_atomic(int64_t * hist_out, unsigned char * img_in, size_t img_size){
+    size_t i;
+    #pragma omp parallel for schedule(runtime)
+    for ( i = 0; i < img_size; i ++){
+        #pragma omp atomic update
+        hist_out[img_in[i]] ++;
+    }
+}
 
-void histogram(int * hist_out, unsigned char * img_in, int img_size, int nbr_bin){
+void histogram(int64_t * hist_out, unsigned char * img_in, size_t img_size, int nbr_bin){
     int i;
     for ( i = 0; i < nbr_bin; i ++){
         hist_out[i] = 0;
     }
 
-    for ( i = 0; i < img_size; i ++){
-        hist_out[img_in[i]] ++;
+    switch (histogram_method(img_size, nbr_bin)) {
+        case HIST_REDUCTION:
+            histogram_reduction(hist_out, img_in, img_size, nbr_bin);
+            break;
+        case HIST_PRIVATE:
+            histogram_private(hist_out, img_in, img_size, nbr_bin);
+            break;
+        case HIST_ATOMIC:
+            histogram_atomic(hist_out, img_in, img_size);
+            break;
+        default:
+            histogram_banked(hist_out, img_in, img_size);
+            break;
     }
 }
 
-void histogram_equalization(unsigned char * img_out, unsigned char * img_in, 
-                            int * hist_in, int img_size, int nbr_bin, int full_img_size) {
-    // `img_out`: Puntero a la imagen de salida (ecualizada)
-    // `img_in`: Puntero a la imagen de entrada
-    // `hist_in`: Histograma de la imagen de entrada
-    // `img_size`: Tamaño de la imagen local (procesada por este proceso)
-    // `nbr_bin`: Número de niveles en el histograma (generalmente 256 para imágenes en escala de grises)
+void histogram_lut(unsigned char * lut, int64_t * hist_in, size_t full_img_size, int nbr_bin) {
+    // `lut`: Tabla de búsqueda de salida (nbr_bin bytes, ya recortados a [0, 255])
     // `full_img_size`: Tamaño total de la imagen (toda la imagen, incluyendo la parte procesada por otros procesos)
 
-    int *lut = (int *)malloc(sizeof(int) * nbr_bin); // Crear la tabla de búsqueda (LUT) para mapear intensidades
-    int i, cdf, min, d; // Variables auxiliares
+    int i, v;              // Variables auxiliares
+    int64_t cdf, min, d;   // En 64 bits: una imagen puede tener más de 2^31 píxeles
     /* 
+     * `v`: Valor de la LUT antes de recortarlo a [0, 255].
      * `cdf`: Acumulador para la función de distribución acumulativa (CDF).
      * `min`: Mínima frecuencia no nula en el histograma.
      * `d`: Diferencia entre el tamaño total de la imagen y el mínimo (usado para normalización).
@@ -50,28 +159,46 @@ void histogram_equalization(unsigned char * img_out, unsigned char * img_in,
         cdf += hist_in[i]; // Incrementar el CDF con la frecuencia actual del histograma
 
         // Mapear el CDF al rango de intensidad de salida [0, 255]
-        lut[i] = (int)(((float)cdf - min) * 255 / d + 0.5); // Normalización al rango [0, 255]
+        v = (int)(((float)cdf - min) * 255 / d + 0.5); // Normalización al rango [0, 255]
 
-        // Asegurarse de que los valores de la LUT no sean negativos
-        if (lut[i] < 0) {
-            lut[i] = 0;
+        // Recortar al rango de un byte: la LUT se guarda ya como uint8
+        if (v < 0) {
+            v = 0;
         }
+        if (v > 255) {
+            v = 255;
+        }
+        lut[i] = (unsigned char)v;
     }
+}
+
+void apply_lut(unsigned char * img_out, unsigned char * img_in, unsigned char * lut, size_t img_size) {
+    size_t i;
 
     /* Generar la imagen de salida usando la LUT */
-    #pragma omp parallel for schedule(runtime) // Usar OpenMP para paralelizar el bucle
-    for (i = 0; i < img_size; i++) {
-        // Asignar el valor de la LUT a cada píxel de la imagen de salida
-        if (lut[img_in[i]] > 255) {
-            img_out[i] = 255; // Limitar valores a 255 si exceden el rango
-        } else {
-            img_out[i] = (unsigned char)lut[img_in[i]]; // Asignar el valor mapeado
-        }
+    #pragma omp parallel for schedule(runtime) // Cada hilo aplica el núcleo vectorial a bloques de píxeles
+    for (i = 0; i < img_size; i += PIXEL_BLOCK) {
+        size_t len = (img_size - i < PIXEL_BLOCK) ? img_size - i : PIXEL_BLOCK;
+        apply_lut_u8(lut, img_in + i, img_out + i, len);
     }
-
-    // Liberar la memoria reservada para la LUT
-    free(lut);
 }
 
+void histogram_equalization(unsigned char * img_out, unsigned char * img_in, 
+                            int64_t * hist_in, size_t img_size, int nbr_bin, size_t full_img_size) {
+    // `img_out`: Puntero a la imagen de salida (ecualizada)
+    // `img_in`: Puntero a la imagen de entrada
+    // `hist_in`: Histograma de la imagen de entrada
+    // `img_size`: Tamaño de la imagen local (procesada por este proceso)
+    // `nbr_bin`: Número de niveles en el histograma (generalmente 256 para imágenes en escala de grises)
+    // `full_img_size`: Tamaño total de la imagen (toda la imagen, incluyendo la parte procesada por otros procesos)
 
+    unsigned char lut[256]; // nbr_bin es siempre 256: la tabla va en la pila, sin reservas por llamada
+    histogram_lut(lut, hist_in, full_img_size, nbr_bin);
+    apply_lut(img_out, img_in, lut, img_size);
+}
 
+// Ecualización en el sitio: img se sobrescribe con el resultado
+void histogram_equalization_inplace(unsigned char * img, int64_t * hist_in, size_t img_size,
+                                    int nbr_bin, size_t full_img_size){
+    histogram_equalization(img, img, hist_in, img_size, nbr_bin, full_img_size);
+}
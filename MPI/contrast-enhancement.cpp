@@ -2,466 +2,775 @@
 #include <string.h>
 #include <stdlib.h>
 #include "hist-equ.h"
+#include "pixel-kernels.h"
 #include <mpi.h>
 
-PGM_IMG contrast_enhancement_g(PGM_IMG img_in)
+void band_counts(int h, int *rowcounts, int *displs)
 {
-    PGM_IMG result;
-    int hist_local[256];
-    int global_hist[256];
+    // Cada proceso recibe h / size filas y el último además el resto
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    for (int i = 0; i < size; i++) {
+        rowcounts[i] = h / size;
+        if (i == size - 1) {
+            rowcounts[i] += h % size;
+        }
+        displs[i] = i * (h / size);
+    }
+}
 
-    result.w = img_in.w;
-    result.h = img_in.h;
+MPI_Datatype row_type(int row_bytes)
+{
+    MPI_Datatype row;
+    MPI_Type_contiguous(row_bytes, MPI_UNSIGNED_CHAR, &row);
+    MPI_Type_commit(&row);
+    return row;
+}
 
-    // Inicializamos MPI
+int band_rows(int h)
+{
     int size, rank;
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    // Extraemos las dimensiones que necesitamos
-    int local_width = img_in.w;
-    int local_height = img_in.h / size;
-    int remainder = img_in.h % size; // Resto de divisiones desiguales
-    int local_size = local_width * local_height;
-
     // Ajustamos el tamaño para el último proceso
     if (rank == size - 1) {
-        local_height += remainder;
-        local_size = local_width * local_height;
+        return h / size + h % size;
     }
+    return h / size;
+}
+
+PGM_IMG scatter_pgm(PGM_IMG img_in)
+{
+    PGM_IMG band;
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    // Asignamos la memoria para las partes locales de la imagen
-    unsigned char *img_local = (unsigned char *)malloc(local_size * sizeof(unsigned char));
+    // Extraemos las dimensiones que necesitamos
+    band.w = img_in.w;
+    band.h = band_rows(img_in.h);
+    band.img = (unsigned char *)pool_alloc((size_t)band.w * band.h * sizeof(unsigned char));
 
     // Dividimos la imagen entre procesos
-    // Utilizamos MPI_Scatterv debido a que no tenemos tamaños iguales
-    int *sendcounts = (int *)malloc(size * sizeof(int));
+    // Utilizamos MPI_Scatterv debido a que no tenemos tamaños iguales; se cuentan filas
+    int *rowcounts = (int *)malloc(size * sizeof(int));
     int *displs = (int *)malloc(size * sizeof(int));
-    for (int i = 0; i < size; i++) {
-        sendcounts[i] = (img_in.h / size) * img_in.w;
-        if (i == size - 1) {
-            sendcounts[i] += remainder * img_in.w;
-        }
-        displs[i] = i * (img_in.h / size) * img_in.w;
-    }
+    band_counts(img_in.h, rowcounts, displs);
+    MPI_Datatype row = row_type(img_in.w);
 
-    MPI_Scatterv(img_in.img, sendcounts, displs, MPI_UNSIGNED_CHAR, img_local, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    MPI_Scatterv(img_in.img, rowcounts, displs, row, band.img, band.h, row, 0, MPI_COMM_WORLD);
 
-    // Calculamos el histograma local
-    histogram(hist_local, img_local, local_size, 256);
+    MPI_Type_free(&row);
+    free(rowcounts);
+    free(displs);
 
-    // Combinamos los histogramas de todos los procesos en un histograma global
-    MPI_Allreduce(hist_local, global_hist, 256, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return band;
+}
 
-    // Aplicamos la ecualización del histograma localmente
-    unsigned char *img_local_out = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    histogram_equalization(img_local_out, img_local, global_hist, local_size, 256, img_in.w * img_in.h);
+PPM_IMG scatter_ppm(PPM_IMG img_in)
+{
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Asignamos la memoria para las partes locales de la imagen, teniendo en cuenta los tres canales RGB
+    PPM_IMG band = alloc_ppm(img_in.w, band_rows(img_in.h));
+
+    // Dividimos la imagen entre procesos
+    // Utilizamos MPI_Scatterv debido a que no tenemos tamaños iguales; se cuentan filas
+    int *rowcounts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    band_counts(img_in.h, rowcounts, displs);
+    MPI_Datatype row = row_type(img_in.w);
+
+    MPI_Scatterv(img_in.img_r, rowcounts, displs, row, band.img_r, band.h, row, 0, MPI_COMM_WORLD);
+    MPI_Scatterv(img_in.img_g, rowcounts, displs, row, band.img_g, band.h, row, 0, MPI_COMM_WORLD);
+    MPI_Scatterv(img_in.img_b, rowcounts, displs, row, band.img_b, band.h, row, 0, MPI_COMM_WORLD);
+
+    MPI_Type_free(&row);
+    free(rowcounts);
+    free(displs);
+
+    return band;
+}
+
+// Recolecta las bandas sobre img, que solo tiene que existir en el proceso 0
+void gather_pgm_into(PGM_IMG band, PGM_IMG img)
+{
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int *rowcounts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    band_counts(img.h, rowcounts, displs);
+    MPI_Datatype row = row_type(img.w);
+
+    // Recolectamos los datos procesados de todos los procesos
+    MPI_Gatherv(band.img, band.h, row, img.img, rowcounts, displs, row, 0, MPI_COMM_WORLD);
+
+    MPI_Type_free(&row);
+    free(rowcounts);
+    free(displs);
+}
+
+PGM_IMG gather_pgm(PGM_IMG band, int w, int h)
+{
+    PGM_IMG result;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    result.w = w;
+    result.h = h;
+    result.img = NULL;
 
     // Solo el proceso 0 tiene la imagen final
     if (rank == 0) {
-        result.img = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
+        result.img = (unsigned char *)pool_alloc((size_t)result.w * result.h * sizeof(unsigned char));
     }
 
-    // Recolectamos los datos procesados de todos los procesos
-    MPI_Gatherv(img_local_out, local_size, MPI_UNSIGNED_CHAR, result.img, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    gather_pgm_into(band, result);
+    return result;
+}
 
-    // Liberamos memoria
-    free(img_local);
-    free(img_local_out);
-    free(sendcounts);
+void gather_ppm_into(PPM_IMG band, PPM_IMG img)
+{
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int *rowcounts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    band_counts(img.h, rowcounts, displs);
+    MPI_Datatype row = row_type(img.w);
+
+    // Utilizamos Gatherv por los distintos tamaños de cada banda
+    MPI_Gatherv(band.img_r, band.h, row, img.img_r, rowcounts, displs, row, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(band.img_g, band.h, row, img.img_g, rowcounts, displs, row, 0, MPI_COMM_WORLD);
+    MPI_Gatherv(band.img_b, band.h, row, img.img_b, rowcounts, displs, row, 0, MPI_COMM_WORLD);
+
+    MPI_Type_free(&row);
+    free(rowcounts);
     free(displs);
+}
 
+PPM_IMG gather_ppm(PPM_IMG band, int w, int h)
+{
+    PPM_IMG result;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    result.w = w;
+    result.h = h;
+    result.img_r = result.img_g = result.img_b = NULL;
+
+    // Combinamos las imágenes procesadas en el proceso 0
+    if (rank == 0) {
+        result = alloc_ppm(w, h);
+    }
+
+    gather_ppm_into(band, result);
     return result;
 }
 
-PPM_IMG contrast_enhancement_c_yuv(PPM_IMG img_in)
+// Reparto de una imagen intercalada: cada fila son 3 * w bytes contiguos, así que basta
+// un único MPI_Scatterv/MPI_Gatherv con filas de 3 * w bytes
+PPM_PACKED_IMG scatter_ppm_packed(PPM_PACKED_IMG img_in)
 {
-    YUV_IMG local_yuv_med;
-    PPM_IMG local_result;
-    PPM_IMG result;
-    PPM_IMG local_img_in;
-    
-    unsigned char * y_equ;
-    int localHist[256];
-    int globalHist[256];
+    PPM_PACKED_IMG band;
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
 
-    // Inicializamos MPI
-    int size, rank;
+    band.w = img_in.w;
+    band.h = band_rows(img_in.h);
+    band.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * band.h * sizeof(unsigned char));
+
+    int *rowcounts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    band_counts(img_in.h, rowcounts, displs);
+    MPI_Datatype row = row_type(3 * img_in.w);
+
+    MPI_Scatterv(img_in.img, rowcounts, displs, row, band.img, band.h, row, 0, MPI_COMM_WORLD);
+
+    MPI_Type_free(&row);
+    free(rowcounts);
+    free(displs);
+
+    return band;
+}
+
+void gather_ppm_packed_into(PPM_PACKED_IMG band, PPM_PACKED_IMG img)
+{
+    int size;
     MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int *rowcounts = (int *)malloc(size * sizeof(int));
+    int *displs = (int *)malloc(size * sizeof(int));
+    band_counts(img.h, rowcounts, displs);
+    MPI_Datatype row = row_type(3 * img.w);
+
+    MPI_Gatherv(band.img, band.h, row, img.img, rowcounts, displs, row, 0, MPI_COMM_WORLD);
+
+    MPI_Type_free(&row);
+    free(rowcounts);
+    free(displs);
+}
+
+PPM_PACKED_IMG gather_ppm_packed(PPM_PACKED_IMG band, int w, int h)
+{
+    PPM_PACKED_IMG result;
+    int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    // Extraemos las dimensiones que necesitamos
-    int local_width = img_in.w;
-    int local_height = img_in.h / size;
-    int remainder = img_in.h % size; // Resto de divisiones desiguales
-    int local_size = local_width * local_height;
+    result.w = w;
+    result.h = h;
+    result.img = NULL;
 
-    // Ajustamos el tamaño para el último proceso
-    if (rank == size - 1) {
-        local_height += remainder;
-        local_size = local_width * local_height;
+    if (rank == 0) {
+        result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
     }
 
-    // Asignamos la memoria para las partes locales de la imagen, teniendo en cuenta los tres canales RGB
-    local_img_in.img_r = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    local_img_in.img_g = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    local_img_in.img_b = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    local_img_in.w = local_width;
-    local_img_in.h = local_height;
+    gather_ppm_packed_into(band, result);
+    return result;
+}
 
-    // Dividimos la imagen entre procesos
-    // Utilizamos MPI_Scatterv debido a que no tenemos tamaños iguales
-    int *sendcounts = (int *)malloc(size * sizeof(int));
-    int *displs = (int *)malloc(size * sizeof(int));
-    for (int i = 0; i < size; i++) {
-        sendcounts[i] = (img_in.h / size) * img_in.w;
-        if (i == size - 1) {
-            sendcounts[i] += remainder * img_in.w;
-        }
-        displs[i] = i * (img_in.h / size) * img_in.w;
+// Tamaño total de la imagen a partir del histograma global (suma de todas las bandas)
+static size_t hist_total(int64_t * hist, int nbr_bin)
+{
+    size_t total = 0;
+    for (int i = 0; i < nbr_bin; i++) {
+        total += hist[i];
     }
+    return total;
+}
 
-    MPI_Scatterv(img_in.img_r, sendcounts, displs, MPI_UNSIGNED_CHAR, local_img_in.img_r, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Scatterv(img_in.img_g, sendcounts, displs, MPI_UNSIGNED_CHAR, local_img_in.img_g, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Scatterv(img_in.img_b, sendcounts, displs, MPI_UNSIGNED_CHAR, local_img_in.img_b, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+PGM_IMG contrast_enhancement_g_band(PGM_IMG band)
+{
+    PGM_IMG result;
+    int64_t hist_local[256];
+    int64_t global_hist[256];
+    size_t local_size = (size_t)band.w * band.h;
+
+    result.w = band.w;
+    result.h = band.h;
+
+    // Calculamos el histograma local
+    histogram(hist_local, band.img, local_size, 256);
+
+    // Combinamos los histogramas de todos los procesos en un histograma global
+    MPI_Allreduce(hist_local, global_hist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
 
-    // Convertimos la imagen de RGB a YUV
-    local_yuv_med = rgb2yuv(local_img_in);
-    y_equ = (unsigned char *)malloc(local_yuv_med.h * local_yuv_med.w * sizeof(unsigned char));
+    // Aplicamos la ecualización del histograma localmente
+    result.img = (unsigned char *)pool_alloc(local_size * sizeof(unsigned char));
+    histogram_equalization(result.img, band.img, global_hist, local_size, 256, hist_total(global_hist, 256));
+
+    return result;
+}
+
+PGM_IMG contrast_enhancement_g(PGM_IMG img_in)
+{
+    PGM_IMG band = scatter_pgm(img_in);
+    PGM_IMG band_out = contrast_enhancement_g_band(band);
+    PGM_IMG result = gather_pgm(band_out, img_in.w, img_in.h);
 
-    // Calculamos el histograma y la ecualización en Y
-    histogram(localHist, local_yuv_med.img_y, local_yuv_med.h * local_yuv_med.w, 256);
-    MPI_Allreduce(localHist, globalHist, 256, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
-    histogram_equalization(y_equ, local_yuv_med.img_y, globalHist, local_yuv_med.h * local_yuv_med.w, 256, img_in.h * img_in.w);
-    
     // Liberamos memoria
-    free(local_yuv_med.img_y);
-    local_yuv_med.img_y = y_equ;
+    free_pgm(band);
+    free_pgm(band_out);
+
+    return result;
+}
 
-    // Convertimos de YUV a RGB y liberamos memoria ocupada por YUV
-    local_result = yuv2rgb(local_yuv_med);
-    free(local_yuv_med.img_u);
-    free(local_yuv_med.img_v);
-    free(local_yuv_med.img_y);
+PPM_IMG contrast_enhancement_c_yuv_band(PPM_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
 
-    // Combinamos las imágenes procesadas en el proceso 0
-    if (rank == 0) {
-        result.w = img_in.w;
-        result.h = img_in.h;
-        result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-        result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-        result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    }
+    // Histograma de Y de la banda leyendo solo RGB, sin planos YUV
+    histogram_yuv_y(localHist, band);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+
+    // Ecualizamos Y y volvemos a RGB recalculando U y V en cada píxel
+    return yuv_equalize_rgb(band, lut);
+}
 
-    // Utilizamos Gatherv por los distintos tamaños comentados previamente
-    MPI_Gatherv(local_result.img_r, local_size, MPI_UNSIGNED_CHAR, result.img_r, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Gatherv(local_result.img_g, local_size, MPI_UNSIGNED_CHAR, result.img_g, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Gatherv(local_result.img_b, local_size, MPI_UNSIGNED_CHAR, result.img_b, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+PPM_IMG contrast_enhancement_c_yuv(PPM_IMG img_in)
+{
+    PPM_IMG band = scatter_ppm(img_in);
+    PPM_IMG band_out = contrast_enhancement_c_yuv_band(band);
+    PPM_IMG result = gather_ppm(band_out, img_in.w, img_in.h);
 
     // Terminamos de liberar la memoria
-    free(local_result.img_r);
-    free(local_result.img_g);
-    free(local_result.img_b);
-    free(local_img_in.img_r);
-    free(local_img_in.img_g);
-    free(local_img_in.img_b);
-    free(sendcounts);
-    free(displs);
+    free_ppm(band);
+    free_ppm(band_out);
 
     return result;
 }
 
+PPM_IMG contrast_enhancement_c_hsl_band(PPM_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+
+    // Histograma de L de la banda calculado directamente desde RGB, sin planos HSL
+    histogram_hsl_l(localHist, band);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+
+    // Recalculamos H y S por bloques mientras se ecualiza L y se vuelve a RGB
+    return hsl_equalize_rgb(band, lut);
+}
+
 PPM_IMG contrast_enhancement_c_hsl(PPM_IMG img_in)
 {
-    HSL_IMG local_hsl_med;
-    PPM_IMG local_result;
-    PPM_IMG result;
-    PPM_IMG local_img_in;
-    
-    unsigned char * l_equ;
-    int localHist[256];
-    int globalHist[256];
+    PPM_IMG band = scatter_ppm(img_in);
+    PPM_IMG band_out = contrast_enhancement_c_hsl_band(band);
+    PPM_IMG result = gather_ppm(band_out, img_in.w, img_in.h);
 
-    // Inicializamos MPI
-    int size, rank;
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    // Terminamos de liberar la memoria
+    free_ppm(band);
+    free_ppm(band_out);
 
-    // Extraemos las dimensiones que necesitamos
-    int local_width = img_in.w;
-    int local_height = img_in.h / size;
-    int remainder = img_in.h % size;  // Resto de divisiones desiguales
-    int local_size = local_width * local_height;
+    return result;
+}
 
-    // // Ajustamos el tamaño para el último proceso
-    if (rank == size - 1) {
-        local_height += remainder;
-        local_size = local_width * local_height;
-    }
+// Las versiones intercaladas usan los mismos motores sobre una vista con stride 3
+PPM_PACKED_IMG contrast_enhancement_c_yuv_packed_band(PPM_PACKED_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+    PPM_PACKED_IMG result;
+
+    histogram_yuv_y_pixels(localHist, packed_view(band.img), (size_t)band.w * band.h);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+
+    result.w = band.w;
+    result.h = band.h;
+    result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+    yuv_equalize_pixels(lut, packed_view(band.img), packed_view(result.img), (size_t)band.w * band.h);
+    return result;
+}
 
-    // Asignamos la memoria para las partes locales de la imagen, teniendo en cuenta los tres canales RGB
-    local_img_in.img_r = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    local_img_in.img_g = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    local_img_in.img_b = (unsigned char *)malloc(local_size * sizeof(unsigned char));
-    local_img_in.w = local_width;
-    local_img_in.h = local_height;
+PPM_PACKED_IMG contrast_enhancement_c_yuv_packed(PPM_PACKED_IMG img_in)
+{
+    PPM_PACKED_IMG band = scatter_ppm_packed(img_in);
+    PPM_PACKED_IMG band_out = contrast_enhancement_c_yuv_packed_band(band);
+    PPM_PACKED_IMG result = gather_ppm_packed(band_out, img_in.w, img_in.h);
 
-    // Dividimos la imagen entre procesos
-    // Utilizamos MPI_Scatterv debido a que no tenemos tamaños iguales
-    int *sendcounts = (int *)malloc(size * sizeof(int));
-    int *displs = (int *)malloc(size * sizeof(int));
-    for (int i = 0; i < size; i++) {
-        sendcounts[i] = (img_in.h / size) * img_in.w;
-        if (i == size - 1) {
-            sendcounts[i] += remainder * img_in.w;
-        }
-        displs[i] = i * (img_in.h / size) * img_in.w;
-    }
+    free_ppm_packed(band);
+    free_ppm_packed(band_out);
 
-    MPI_Scatterv(img_in.img_r, sendcounts, displs, MPI_UNSIGNED_CHAR, local_img_in.img_r, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Scatterv(img_in.img_g, sendcounts, displs, MPI_UNSIGNED_CHAR, local_img_in.img_g, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Scatterv(img_in.img_b, sendcounts, displs, MPI_UNSIGNED_CHAR, local_img_in.img_b, local_size, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    return result;
+}
 
-    // Convertimos la imagen de RGB a HSL
-    local_hsl_med = rgb2hsl(local_img_in);
-    l_equ = (unsigned char *)malloc(local_hsl_med.height * local_hsl_med.width * sizeof(unsigned char));
+PPM_PACKED_IMG contrast_enhancement_c_hsl_packed_band(PPM_PACKED_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+    PPM_PACKED_IMG result;
+
+    histogram_hsl_l_pixels(localHist, packed_view(band.img), (size_t)band.w * band.h);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+
+    result.w = band.w;
+    result.h = band.h;
+    result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+    hsl_equalize_pixels(lut, packed_view(band.img), packed_view(result.img), (size_t)band.w * band.h);
+    return result;
+}
 
-    // Calculamos el histograma y la ecualización en Y
-    histogram(localHist, local_hsl_med.l, local_hsl_med.height * local_hsl_med.width, 256);
-    MPI_Allreduce(localHist, globalHist, 256, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
-    histogram_equalization(l_equ, local_hsl_med.l, globalHist, local_hsl_med.height * local_hsl_med.width, 256, img_in.h * img_in.w);
-    
-    // Liberamos memoria
-    free(local_hsl_med.l);
-    local_hsl_med.l = l_equ;
+PPM_PACKED_IMG contrast_enhancement_c_hsl_packed(PPM_PACKED_IMG img_in)
+{
+    PPM_PACKED_IMG band = scatter_ppm_packed(img_in);
+    PPM_PACKED_IMG band_out = contrast_enhancement_c_hsl_packed_band(band);
+    PPM_PACKED_IMG result = gather_ppm_packed(band_out, img_in.w, img_in.h);
 
-    // Convertimos de HSL a RGB y liberamos memoria ocupada por HSL
-    local_result = hsl2rgb(local_hsl_med);
-    free(local_hsl_med.h);
-    free(local_hsl_med.s);
-    free(local_hsl_med.l);
+    free_ppm_packed(band);
+    free_ppm_packed(band_out);
 
-    // Combinamos las imágenes procesadas en el proceso 0
+    return result;
+}
+
+// Variantes en el sitio: la banda (o la imagen del proceso 0) se sobrescribe con el
+// resultado y no se reserva ninguna imagen de salida
+void contrast_enhancement_g_band_inplace(PGM_IMG band)
+{
+    int64_t hist_local[256];
+    int64_t global_hist[256];
+    size_t local_size = (size_t)band.w * band.h;
+
+    histogram(hist_local, band.img, local_size, 256);
+    MPI_Allreduce(hist_local, global_hist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_equalization_inplace(band.img, global_hist, local_size, 256, hist_total(global_hist, 256));
+}
+
+void contrast_enhancement_c_yuv_band_inplace(PPM_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+    RGB_VIEW view = planar_view(band.img_r, band.img_g, band.img_b);
+
+    histogram_yuv_y_pixels(localHist, view, (size_t)band.w * band.h);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+    yuv_equalize_pixels(lut, view, view, (size_t)band.w * band.h);
+}
+
+void contrast_enhancement_c_hsl_band_inplace(PPM_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+    RGB_VIEW view = planar_view(band.img_r, band.img_g, band.img_b);
+
+    histogram_hsl_l_pixels(localHist, view, (size_t)band.w * band.h);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+    hsl_equalize_pixels(lut, view, view, (size_t)band.w * band.h);
+}
+
+void contrast_enhancement_c_yuv_packed_band_inplace(PPM_PACKED_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+
+    histogram_yuv_y_pixels(localHist, packed_view(band.img), (size_t)band.w * band.h);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+    yuv_equalize_pixels(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+}
+
+void contrast_enhancement_c_hsl_packed_band_inplace(PPM_PACKED_IMG band)
+{
+    int64_t localHist[256];
+    int64_t globalHist[256];
+    unsigned char lut[256];
+
+    histogram_hsl_l_pixels(localHist, packed_view(band.img), (size_t)band.w * band.h);
+    MPI_Allreduce(localHist, globalHist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, globalHist, hist_total(globalHist, 256), 256);
+    hsl_equalize_pixels(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+}
+
+// La imagen completa se reparte, cada banda se ecualiza en el sitio y el resultado se
+// recolecta sobre la propia imagen de entrada del proceso 0
+void contrast_enhancement_g_inplace(PGM_IMG img)
+{
+    PGM_IMG band = scatter_pgm(img);
+    contrast_enhancement_g_band_inplace(band);
+    gather_pgm_into(band, img);
+    free_pgm(band);
+}
+
+void contrast_enhancement_c_yuv_inplace(PPM_IMG img)
+{
+    PPM_IMG band = scatter_ppm(img);
+    contrast_enhancement_c_yuv_band_inplace(band);
+    gather_ppm_into(band, img);
+    free_ppm(band);
+}
+
+void contrast_enhancement_c_hsl_inplace(PPM_IMG img)
+{
+    PPM_IMG band = scatter_ppm(img);
+    contrast_enhancement_c_hsl_band_inplace(band);
+    gather_ppm_into(band, img);
+    free_ppm(band);
+}
+
+void contrast_enhancement_c_yuv_packed_inplace(PPM_PACKED_IMG img)
+{
+    PPM_PACKED_IMG band = scatter_ppm_packed(img);
+    contrast_enhancement_c_yuv_packed_band_inplace(band);
+    gather_ppm_packed_into(band, img);
+    free_ppm_packed(band);
+}
+
+void contrast_enhancement_c_hsl_packed_inplace(PPM_PACKED_IMG img)
+{
+    PPM_PACKED_IMG band = scatter_ppm_packed(img);
+    contrast_enhancement_c_hsl_packed_band_inplace(band);
+    gather_ppm_packed_into(band, img);
+    free_ppm_packed(band);
+}
+
+// Bytes por píxel que ocupan a la vez los buffers de una banda en cada modo de streaming
+// (cada banda se ecualiza en el sitio, así que no hay buffer de salida)
+#define STREAM_BYTES_G   1   // banda de entrada, sobrescrita con el resultado
+#define STREAM_BYTES_YUV 3   // RGB intercalado de la banda (Y, U y V no se guardan)
+#define STREAM_BYTES_HSL 3   // RGB intercalado de la banda (H, S y L van por bloques)
+
+// Número de filas por banda para no superar mem_budget bytes en cada proceso (al menos una fila)
+static int stream_band_rows(int w, int local_rows, int bytes_per_pixel, size_t mem_budget)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    size_t rows = mem_budget / ((size_t)w * bytes_per_pixel);
+    if (rows > (size_t)local_rows)
+        rows = local_rows;
+    if (rows < 1)
+        rows = 1;
     if (rank == 0) {
-        result.w = img_in.w;
-        result.h = img_in.h;
-        result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-        result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-        result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
+        printf("Streaming %d rows per band\n", (int)rows);
     }
+    return (int)rows;
+}
 
-    // Utilizamos Gatherv por los distintos tamaños comentados previamente
-    MPI_Gatherv(local_result.img_r, local_size, MPI_UNSIGNED_CHAR, result.img_r, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Gatherv(local_result.img_g, local_size, MPI_UNSIGNED_CHAR, result.img_g, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
-    MPI_Gatherv(local_result.img_b, local_size, MPI_UNSIGNED_CHAR, result.img_b, sendcounts, displs, MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+// Primera fila de este proceso, con el mismo reparto que band_counts (band_rows da cuántas)
+static int stream_first_row(int h)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    return rank * (h / size);
+}
 
-    // Terminamos de liberar la memoria
-    free(local_result.img_r);
-    free(local_result.img_g);
-    free(local_result.img_b);
-    free(local_img_in.img_r);
-    free(local_img_in.img_g);
-    free(local_img_in.img_b);
-    free(sendcounts);
-    free(displs);
+// Suma el histograma de img_size píxeles al acumulado en hist
+static void histogram_add(int64_t * hist, unsigned char * img_in, size_t img_size)
+{
+    int64_t hist_band[256];
+    histogram(hist_band, img_in, img_size, 256);
+    for (int i = 0; i < 256; i++)
+        hist[i] += hist_band[i];
+}
 
-    return result;
+void contrast_enhancement_g_stream(const char * in_path, const char * out_path, size_t mem_budget)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PGM_IMG band;
+    int64_t hist[256] = {0};
+    int64_t global_hist[256];
+    unsigned char lut[256];
+    int first = stream_first_row(in.h);
+    int last = first + band_rows(in.h);
+    int rows = stream_band_rows(in.w, last - first, STREAM_BYTES_G, mem_budget);
+    int row;
+
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc((size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de las filas locales, combinado después entre procesos
+    for (row = first; row < last; row += rows) {
+        band.h = (last - row < rows) ? last - row : rows;
+        read_pgm_rows(in, row, band);
+        histogram_add(hist, band.img, (size_t)band.w * band.h);
+    }
+    MPI_Allreduce(hist, global_hist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, global_hist, hist_total(global_hist, 256), 256);
+
+    // Segundo recorrido: ecualizar cada banda local y escribirla en su sitio
+    out = create_pnm_stream(out_path, in.w, in.h, 1);
+    for (row = first; row < last; row += rows) {
+        band.h = (last - row < rows) ? last - row : rows;
+        read_pgm_rows(in, row, band);
+        apply_lut(band.img, band.img, lut, (size_t)band.w * band.h);
+        write_pgm_rows(out, row, band);
+    }
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    pool_free(band.img);
 }
 
-//Convert RGB to HSL, assume R,G,B in [0, 255]
-//Output H, S in [0.0, 1.0] and L in [0, 255]
-HSL_IMG rgb2hsl(PPM_IMG img_in)
-{
-    int i;
-    float H, S, L;
-    HSL_IMG img_out;// = (HSL_IMG *)malloc(sizeof(HSL_IMG));
-    img_out.width  = img_in.w;
-    img_out.height = img_in.h;
-    img_out.h = (float *)malloc(img_in.w * img_in.h * sizeof(float));
-    img_out.s = (float *)malloc(img_in.w * img_in.h * sizeof(float));
-    img_out.l = (unsigned char *)malloc(img_in.w * img_in.h * sizeof(unsigned char));
-    
-    for(i = 0; i < img_in.w*img_in.h; i ++){
-        
-        float var_r = ( (float)img_in.img_r[i]/255 );//Convert RGB to [0,1]
-        float var_g = ( (float)img_in.img_g[i]/255 );
-        float var_b = ( (float)img_in.img_b[i]/255 );
-        float var_min = (var_r < var_g) ? var_r : var_g;
-        var_min = (var_min < var_b) ? var_min : var_b;   //min. value of RGB
-        float var_max = (var_r > var_g) ? var_r : var_g;
-        var_max = (var_max > var_b) ? var_max : var_b;   //max. value of RGB
-        float del_max = var_max - var_min;               //Delta RGB value
-        
-        L = ( var_max + var_min ) / 2;
-        if ( del_max == 0 )//This is a gray, no chroma...
-        {
-            H = 0;         
-            S = 0;    
-        }
-        else                                    //Chromatic data...
-        {
-            if ( L < 0.5 )
-                S = del_max/(var_max+var_min);
-            else
-                S = del_max/(2-var_max-var_min );
-
-            float del_r = (((var_max-var_r)/6)+(del_max/2))/del_max;
-            float del_g = (((var_max-var_g)/6)+(del_max/2))/del_max;
-            float del_b = (((var_max-var_b)/6)+(del_max/2))/del_max;
-            if( var_r == var_max ){
-                H = del_b - del_g;
-            }
-            else{       
-                if( var_g == var_max ){
-                    H = (1.0/3.0) + del_r - del_b;
-                }
-                else{
-                        H = (2.0/3.0) + del_g - del_r;
-                }   
-            }
-            
-        }
-        
-        if ( H < 0 )
-            H += 1;
-        if ( H > 1 )
-            H -= 1;
-
-        img_out.h[i] = H;
-        img_out.s[i] = S;
-        img_out.l[i] = (unsigned char)(L*255);
+// Modo C_YUV_VERIFY: píxeles de la banda de este proceso que cambian respecto a double
+static void report_fixed_diffs(const char * name, long diffs, size_t n)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    printf("Rank %d: %s fixed-point: %ld of %zu pixels differ from double precision\n", rank, name, diffs, n);
+}
+
+void contrast_enhancement_c_yuv_stream(const char * in_path, const char * out_path, size_t mem_budget)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PPM_PACKED_IMG band;
+    int64_t hist[256] = {0};
+    int64_t band_hist[256];
+    int64_t global_hist[256];
+    unsigned char lut[256];
+    int first = stream_first_row(in.h);
+    int last = first + band_rows(in.h);
+    int rows = stream_band_rows(in.w, last - first, STREAM_BYTES_YUV, mem_budget);
+    int row;
+    long diffs = 0;
+
+    // Las bandas se procesan intercaladas, tal como están en el fichero, y en el sitio
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la luminancia Y, calculada directamente desde RGB
+    for (row = first; row < last; row += rows) {
+        band.h = (last - row < rows) ? last - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        histogram_yuv_y_pixels(band_hist, packed_view(band.img), (size_t)band.w * band.h);
+        for (int i = 0; i < 256; i++)
+            hist[i] += band_hist[i];
+    }
+    MPI_Allreduce(hist, global_hist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, global_hist, hist_total(global_hist, 256), 256);
+
+    // Segundo recorrido: ecualizar Y y volver a RGB banda a banda en un solo paso por píxel
+    out = create_pnm_stream(out_path, in.w, in.h, 3);
+    for (row = first; row < last; row += rows) {
+        band.h = (last - row < rows) ? last - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        diffs += yuv_equalize_count(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+        write_ppm_packed_rows(out, row, band);
     }
-    
-    return img_out;
+
+    // En C_YUV_VERIFY se informa una vez por imagen, sumando todas las bandas
+    if (yuv_mode() == YUV_VERIFY)
+        report_fixed_diffs("yuv equalization", diffs, (size_t)in.w * (last - first));
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    free_ppm_packed(band);
 }
 
-float Hue_2_RGB( float v1, float v2, float vH )             //Function Hue_2_RGB
+void contrast_enhancement_c_hsl_stream(const char * in_path, const char * out_path, size_t mem_budget)
 {
-    if ( vH < 0 ) vH += 1;
-    if ( vH > 1 ) vH -= 1;
-    if ( ( 6 * vH ) < 1 ) return ( v1 + ( v2 - v1 ) * 6 * vH );
-    if ( ( 2 * vH ) < 1 ) return ( v2 );
-    if ( ( 3 * vH ) < 2 ) return ( v1 + ( v2 - v1 ) * ( ( 2.0f/3.0f ) - vH ) * 6 );
-    return ( v1 );
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PPM_PACKED_IMG band;
+    int64_t hist[256] = {0};
+    int64_t band_hist[256];
+    int64_t global_hist[256];
+    unsigned char lut[256];
+    int first = stream_first_row(in.h);
+    int last = first + band_rows(in.h);
+    int rows = stream_band_rows(in.w, last - first, STREAM_BYTES_HSL, mem_budget);
+    int row;
+
+    // Las bandas se procesan intercaladas, tal como están en el fichero, y en el sitio
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la luminosidad L, calculada directamente desde RGB
+    for (row = first; row < last; row += rows) {
+        band.h = (last - row < rows) ? last - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        histogram_hsl_l_pixels(band_hist, packed_view(band.img), (size_t)band.w * band.h);
+        for (int i = 0; i < 256; i++)
+            hist[i] += band_hist[i];
+    }
+    MPI_Allreduce(hist, global_hist, 256, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+    histogram_lut(lut, global_hist, hist_total(global_hist, 256), 256);
+
+    // Segundo recorrido: recalcular HSL, ecualizar L y volver a RGB banda a banda
+    out = create_pnm_stream(out_path, in.w, in.h, 3);
+    for (row = first; row < last; row += rows) {
+        band.h = (last - row < rows) ? last - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        hsl_equalize_pixels(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+        write_ppm_packed_rows(out, row, band);
+    }
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    free_ppm_packed(band);
 }
 
-//Convert HSL to RGB, assume H, S in [0.0, 1.0] and L in [0, 255]
-//Output R,G,B in [0, 255]
-PPM_IMG hsl2rgb(HSL_IMG img_in)
+
+// Motor HSL fusionado: el histograma de L se calcula desde RGB con solo el máximo y el
+// mínimo, y hsl_equalize_rgb recalcula H y S por bloques al volver a RGB, así que nunca
+// se reservan los planos H, S y L de toda la imagen
+void histogram_hsl_l_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n)
 {
-    int i;
-    PPM_IMG result;
-    
-    result.w = img_in.width;
-    result.h = img_in.height;
-    result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    
-    for(i = 0; i < img_in.width*img_in.height; i ++){
-        float H = img_in.h[i];
-        float S = img_in.s[i];
-        float L = img_in.l[i]/255.0f;
-        float var_1, var_2;
-        
-        unsigned char r,g,b;
-        
-        if ( S == 0 )
-        {
-            r = L * 255;
-            g = L * 255;
-            b = L * 255;
-        }
-        else
-        {
-            
-            if ( L < 0.5 )
-                var_2 = L * ( 1 + S );
-            else
-                var_2 = ( L + S ) - ( S * L );
-
-            var_1 = 2 * L - var_2;
-            r = 255 * Hue_2_RGB( var_1, var_2, H + (1.0f/3.0f) );
-            g = 255 * Hue_2_RGB( var_1, var_2, H );
-            b = 255 * Hue_2_RGB( var_1, var_2, H - (1.0f/3.0f) );
-        }
-        result.img_r[i] = r;
-        result.img_g[i] = g;
-        result.img_b[i] = b;
+    unsigned char l[PIXEL_BLOCK];
+    size_t i;
+
+    memset(hist_out, 0, 256 * sizeof(int64_t));
+    for (i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        rgb2hsl_lightness_view(view_offset(img_in, i), l, len);
+        histogram_banked(hist_out, l, len);
     }
+}
+
+void histogram_hsl_l(int64_t * hist_out, PPM_IMG img_in)
+{
+    histogram_hsl_l_pixels(hist_out, planar_view(img_in.img_r, img_in.img_g, img_in.img_b), (size_t)img_in.w * img_in.h);
+}
 
+void hsl_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    hsl_equalize_view(lut, img_in, img_out, n);
+}
+
+PPM_IMG hsl_equalize_rgb(PPM_IMG img_in, unsigned char * lut)
+{
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+
+    hsl_equalize_pixels(lut, planar_view(img_in.img_r, img_in.img_g, img_in.img_b),
+                        planar_view(result.img_r, result.img_g, result.img_b), (size_t)img_in.w * img_in.h);
     return result;
 }
 
-//Convert RGB to YUV, all components in [0, 255]
-YUV_IMG rgb2yuv(PPM_IMG img_in)
-{
-    YUV_IMG img_out;
-    int i;//, j;
-    unsigned char r, g, b;
-    unsigned char y, cb, cr;
-    
-    img_out.w = img_in.w;
-    img_out.h = img_in.h;
-    img_out.img_y = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_u = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_v = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-
-    for(i = 0; i < img_out.w*img_out.h; i ++){
-        r = img_in.img_r[i];
-        g = img_in.img_g[i];
-        b = img_in.img_b[i];
-        
-        y  = (unsigned char)( 0.299*r + 0.587*g +  0.114*b);
-        cb = (unsigned char)(-0.169*r - 0.331*g +  0.499*b + 128);
-        cr = (unsigned char)( 0.499*r - 0.418*g - 0.0813*b + 128);
-        
-        img_out.img_y[i] = y;
-        img_out.img_u[i] = cb;
-        img_out.img_v[i] = cr;
+// Motor YUV fusionado: el histograma de Y se calcula en un recorrido de solo lectura sobre
+// RGB y yuv_equalize_rgb produce la salida a partir de (LUT[Y], U, V) recalculando U y V
+// en cada píxel, así que nunca se guardan los planos YUV de la imagen
+void histogram_yuv_y_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n)
+{
+    unsigned char y[PIXEL_BLOCK];
+    size_t i;
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+
+    memset(hist_out, 0, 256 * sizeof(int64_t));
+    for (i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        rgb2yuv_luma_view(view_offset(img_in, i), y, len, fixed);
+        histogram_banked(hist_out, y, len);
     }
-    
-    return img_out;
-}
-
-unsigned char clip_rgb(int x)
-{
-    if(x > 255)
-        return 255;
-    if(x < 0)
-        return 0;
-
-    return (unsigned char)x;
-}
-
-//Convert YUV to RGB, all components in [0, 255]
-PPM_IMG yuv2rgb(YUV_IMG img_in)
-{
-    PPM_IMG img_out;
-    int i;
-    int  rt,gt,bt;
-    int y, cb, cr;
-    
-    
-    img_out.w = img_in.w;
-    img_out.h = img_in.h;
-    img_out.img_r = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_g = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_b = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-
-    for(i = 0; i < img_out.w*img_out.h; i ++){
-        y  = (int)img_in.img_y[i];
-        cb = (int)img_in.img_u[i] - 128;
-        cr = (int)img_in.img_v[i] - 128;
-        
-        rt  = (int)( y + 1.402*cr);
-        gt  = (int)( y - 0.344*cb - 0.714*cr);
-        bt  = (int)( y + 1.772*cb);
-
-        img_out.img_r[i] = clip_rgb(rt);
-        img_out.img_g[i] = clip_rgb(gt);
-        img_out.img_b[i] = clip_rgb(bt);
+}
+
+void histogram_yuv_y(int64_t * hist_out, PPM_IMG img_in)
+{
+    histogram_yuv_y_pixels(hist_out, planar_view(img_in.img_r, img_in.img_g, img_in.img_b), (size_t)img_in.w * img_in.h);
+}
+
+long yuv_equalize_count(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+    unsigned char * ref = NULL;
+    long diffs = 0;
+
+    // En C_YUV_VERIFY se compara la salida con la del motor en double usando la misma LUT.
+    // La referencia se calcula antes porque img_out puede ser la propia img_in (en el sitio)
+    if (yuv_mode() == YUV_VERIFY) {
+        ref = (unsigned char *)pool_alloc(3 * n * sizeof(unsigned char));
+        yuv_equalize_view(lut, img_in, packed_view(ref), n, 0);
     }
-    
-    return img_out;
+
+    yuv_equalize_view(lut, img_in, img_out, n, fixed);
+
+    if (ref != NULL) {
+        diffs = count_view_diffs(img_out, packed_view(ref), n);
+        pool_free(ref);
+    }
+    return diffs;
+}
+
+void yuv_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    long diffs = yuv_equalize_count(lut, img_in, img_out, n);
+
+    if (yuv_mode() == YUV_VERIFY)
+        report_fixed_diffs("yuv equalization", diffs, n);
+}
+
+PPM_IMG yuv_equalize_rgb(PPM_IMG img_in, unsigned char * lut)
+{
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+
+    yuv_equalize_pixels(lut, planar_view(img_in.img_r, img_in.img_g, img_in.img_b),
+                        planar_view(result.img_r, result.img_g, result.img_b), (size_t)img_in.w * img_in.h);
+    return result;
 }
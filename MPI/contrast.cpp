@@ -1,11 +1,22 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "hist-equ.h"
+#include "pixel-kernels.h"
+#include "pnm-header.h"
 #include <mpi.h>
 
 void run_cpu_color_test(PPM_IMG img_in);
 void run_cpu_gray_test(PGM_IMG img_in);
+void run_cpu_color_test_band(PPM_IMG band);
+void run_cpu_color_test_packed_band(PPM_PACKED_IMG band);
+void run_cpu_gray_test_band(PGM_IMG band);
+void run_cpu_color_test_stream();
+void run_cpu_gray_test_stream();
 
 struct Times {
     double ReadTimeGray;
@@ -21,46 +32,130 @@ struct Times {
 
 Times times;
 
+// Modo de entrada/salida, configurado mediante variables de entorno
+struct IoMode {
+    int CollectiveWrite; // C_MPI_IO_WRITE=1: cada proceso escribe su banda con MPI-IO
+    int CollectiveRead;  // C_MPI_IO_READ=1: cada proceso lee solo su banda con MPI-IO
+    int Stream;          // C_STREAM=1: cada proceso recorre sus filas del disco por bandas
+    size_t StreamBudget; // C_STREAM_MEM_MB: memoria máxima por proceso para cada banda (bytes)
+    int Packed;          // C_PACKED=1: la imagen en color se procesa con los canales intercalados
+    int InPlace;         // C_INPLACE=1: gris y YUV sobrescriben su entrada en lugar de reservar salida
+};
+
+IoMode io_mode;
+
+void set_io_mode();
+
 int main(int argc, char *argv[]) {
     PGM_IMG img_ibuf_g; // Estructura para almacenar una imagen en escala de grises
     PPM_IMG img_ibuf_c; // Estructura para almacenar una imagen en color
+    PPM_PACKED_IMG img_packed_c; // Imagen en color intercalada (C_PACKED=1)
+    MAPPED_IMG map_g;   // Proyección de in.pgm cuando se lee con mmap
+    MAPPED_IMG map_c;   // Proyección de in.ppm con C_PACKED y C_MMAP_READ
+
+    // C_MMAP_READ=1: leer las imágenes de entrada mediante mmap
+    const char *mmap_str = getenv("C_MMAP_READ");
+    int use_mmap = (mmap_str != NULL) ? atoi(mmap_str) : 0;
 
     // Inicializar el entorno de MPI
     MPI_Init(&argc, &argv);
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank); // Obtener el identificador del proceso actual
     MPI_Comm_size(MPI_COMM_WORLD, &size); // Obtener el número total de procesos
+    set_io_mode(); // Configurar el modo de E/S según las variables de entorno
 
     // Iniciar el cronómetro general
     times.TotalTime = MPI_Wtime();
 
-    // Leer la imagen en escala de grises y medir el tiempo que toma
-    times.ReadTimeGray = MPI_Wtime();
-    img_ibuf_g = read_pgm("in.pgm");
-    times.ReadTimeGray = MPI_Wtime() - times.ReadTimeGray;
-
-    // Realizar el procesamiento en escala de grises
-    run_cpu_gray_test(img_ibuf_g);
-    free_pgm(img_ibuf_g); // Liberar memoria utilizada por la imagen en escala de grises
-
-    // Leer la imagen en color y medir el tiempo que toma
-    times.ReadTimeColor = MPI_Wtime();
-    img_ibuf_c = read_ppm("in.ppm");
-    times.ReadTimeColor = MPI_Wtime() - times.ReadTimeColor;
-
-    // Realizar el procesamiento en color
-    run_cpu_color_test(img_ibuf_c);
-    free_ppm(img_ibuf_c); // Liberar memoria utilizada por la imagen en color
+    if (io_mode.Stream) {
+        // La lectura y la escritura se hacen banda a banda dentro del procesamiento
+        run_cpu_gray_test_stream();
+        run_cpu_color_test_stream();
+    } else if (io_mode.CollectiveRead) {
+        // Con lectura colectiva cada proceso lee solo su banda y no hay MPI_Scatterv
+        times.ReadTimeGray = MPI_Wtime();
+        img_ibuf_g = read_pgm_mpi("in.pgm");
+        times.ReadTimeGray = MPI_Wtime() - times.ReadTimeGray;
+        run_cpu_gray_test_band(img_ibuf_g);
+        free_pgm(img_ibuf_g);
+
+        times.ReadTimeColor = MPI_Wtime();
+        if (io_mode.Packed) {
+            img_packed_c = read_ppm_packed_mpi("in.ppm");
+            times.ReadTimeColor = MPI_Wtime() - times.ReadTimeColor;
+            run_cpu_color_test_packed_band(img_packed_c);
+            free_ppm_packed(img_packed_c);
+        } else {
+            img_ibuf_c = read_ppm_mpi("in.ppm");
+            times.ReadTimeColor = MPI_Wtime() - times.ReadTimeColor;
+            run_cpu_color_test_band(img_ibuf_c);
+            free_ppm(img_ibuf_c);
+        }
+    } else {
+        // Leer la imagen en escala de grises y medir el tiempo que toma
+        times.ReadTimeGray = MPI_Wtime();
+        if (use_mmap) {
+            map_g = map_pnm("in.pgm");
+            img_ibuf_g = pgm_view(map_g); // Sin copia
+        } else {
+            img_ibuf_g = read_pgm("in.pgm");
+        }
+        times.ReadTimeGray = MPI_Wtime() - times.ReadTimeGray;
+
+        // Realizar el procesamiento en escala de grises
+        run_cpu_gray_test(img_ibuf_g);
+        if (use_mmap) {
+            unmap_pnm(map_g);
+        } else {
+            free_pgm(img_ibuf_g); // Liberar memoria utilizada por la imagen en escala de grises
+        }
+
+        // Leer la imagen en color y medir el tiempo que toma
+        if (io_mode.Packed) {
+            // La imagen intercalada se reparte por filas y cada proceso trabaja sobre su banda
+            times.ReadTimeColor = MPI_Wtime();
+            if (use_mmap) {
+                map_c = map_pnm("in.ppm");
+                img_packed_c = ppm_packed_view(map_c); // Sin copia
+            } else {
+                img_packed_c = read_ppm_packed("in.ppm");
+            }
+            PPM_PACKED_IMG band = scatter_ppm_packed(img_packed_c);
+            times.ReadTimeColor = MPI_Wtime() - times.ReadTimeColor;
+
+            if (use_mmap) {
+                unmap_pnm(map_c);
+            } else {
+                free_ppm_packed(img_packed_c);
+            }
+            run_cpu_color_test_packed_band(band);
+            free_ppm_packed(band);
+        } else {
+            times.ReadTimeColor = MPI_Wtime();
+            img_ibuf_c = use_mmap ? read_ppm_mmap("in.ppm") : read_ppm("in.ppm");
+            times.ReadTimeColor = MPI_Wtime() - times.ReadTimeColor;
+
+            // Realizar el procesamiento en color
+            run_cpu_color_test(img_ibuf_c);
+            free_ppm(img_ibuf_c); // Liberar memoria utilizada por la imagen en color
+        }
+    }
 
     // Finalizar el cronómetro general
     times.TotalTime = MPI_Wtime() - times.TotalTime;
 
     // El proceso con rank 0 escribe los resultados en la consola
     if (rank == 0) {
+        // La salida estándar del proceso 0 es el CSV que recoge obtainData.sh: los
+        // informes van a la salida de error
+        fprintf(stderr, "Kernel ISA: %s\n", isa_name());
+        pool_report(stderr); // Reserva de buffers del proceso 0
         printf("Processes,ReadGray(s),ReadColor(s),Gray(s),Hsl(s),Yuv(s),WriteGray(s),WriteHsl(s),WriteYuv(s),Total(s)\n");
         printf("%d,%f,%f,%f,%f,%f,%f,%f,%f,%f\n", size, times.ReadTimeGray, times.ReadTimeColor, times.GrayTime, times.HslTime, times.YuvTime, times.WriteTimeGray, times.WriteTimeHsl, times.WriteTimeYuv, times.TotalTime);
     }
 
+    pool_trim();
+
     // Finalizar el entorno de MPI
     MPI_Finalize();
     return 0;
@@ -72,6 +167,13 @@ void run_cpu_color_test(PPM_IMG img_in) {
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank); // Obtener el identificador del proceso actual
 
+    if (io_mode.CollectiveWrite) {
+        PPM_IMG band = scatter_ppm(img_in);
+        run_cpu_color_test_band(band);
+        free_ppm(band);
+        return;
+    }
+
     // Procesar la imagen en el espacio de color HSL y medir el tiempo que toma
     times.HslTime = MPI_Wtime();
     img_obuf_hsl = contrast_enhancement_c_hsl(img_in);
@@ -87,7 +189,12 @@ void run_cpu_color_test(PPM_IMG img_in) {
 
     // Procesar la imagen en el espacio de color YUV y medir el tiempo que toma
     times.YuvTime = MPI_Wtime();
-    img_obuf_yuv = contrast_enhancement_c_yuv(img_in);
+    if (io_mode.InPlace) {
+        contrast_enhancement_c_yuv_inplace(img_in); // El resultado queda en img_in del proceso 0
+        img_obuf_yuv = img_in;
+    } else {
+        img_obuf_yuv = contrast_enhancement_c_yuv(img_in);
+    }
     times.YuvTime = MPI_Wtime() - times.YuvTime;
 
     // Si el proceso actual es el maestro (rank 0), escribir la imagen procesada en YUV a un archivo
@@ -95,7 +202,8 @@ void run_cpu_color_test(PPM_IMG img_in) {
         times.WriteTimeYuv = MPI_Wtime();
         write_ppm(img_obuf_yuv, "out_yuv.ppm");
         times.WriteTimeYuv = MPI_Wtime() - times.WriteTimeYuv;
-        free_ppm(img_obuf_yuv); // Liberar memoria utilizada por la imagen procesada
+        if (!io_mode.InPlace)
+            free_ppm(img_obuf_yuv); // Liberar memoria utilizada por la imagen procesada
     }
 }
 
@@ -103,9 +211,21 @@ void run_cpu_color_test(PPM_IMG img_in) {
 void run_cpu_gray_test(PGM_IMG img_in) {
     PGM_IMG img_obuf; // Buffer para la imagen procesada
 
+    if (io_mode.CollectiveWrite) {
+        PGM_IMG band = scatter_pgm(img_in);
+        run_cpu_gray_test_band(band);
+        free_pgm(band);
+        return;
+    }
+
     // Procesar la imagen en escala de grises y medir el tiempo que toma
     times.GrayTime = MPI_Wtime();
-    img_obuf = contrast_enhancement_g(img_in);
+    if (io_mode.InPlace) {
+        contrast_enhancement_g_inplace(img_in); // El resultado queda en img_in del proceso 0
+        img_obuf = img_in;
+    } else {
+        img_obuf = contrast_enhancement_g(img_in);
+    }
     times.GrayTime = MPI_Wtime() - times.GrayTime;
 
     int rank;
@@ -116,102 +236,309 @@ void run_cpu_gray_test(PGM_IMG img_in) {
         times.WriteTimeGray = MPI_Wtime();
         write_pgm(img_obuf, "out.pgm");
         times.WriteTimeGray = MPI_Wtime() - times.WriteTimeGray;
-        free_pgm(img_obuf); // Liberar memoria utilizada por la imagen procesada
+        if (!io_mode.InPlace)
+            free_pgm(img_obuf); // Liberar memoria utilizada por la imagen procesada
+    }
+}
+
+
+
+void set_io_mode() {
+    // Si la variable de entorno no está definida se mantiene la escritura desde el proceso 0
+    const char *write_str = getenv("C_MPI_IO_WRITE");
+    io_mode.CollectiveWrite = (write_str != NULL) ? atoi(write_str) : 0;
+
+    // Si no está definida, todos los procesos leen la imagen completa
+    const char *read_str = getenv("C_MPI_IO_READ");
+    io_mode.CollectiveRead = (read_str != NULL) ? atoi(read_str) : 0;
+
+    // En modo streaming la imagen nunca se carga completa en memoria
+    const char *stream_str = getenv("C_STREAM");
+    io_mode.Stream = (stream_str != NULL) ? atoi(stream_str) : 0;
+    const char *budget_str = getenv("C_STREAM_MEM_MB");
+    io_mode.StreamBudget = (size_t)((budget_str != NULL) ? atoi(budget_str) : 256) << 20;
+
+    // Sin separar canales al leer ni intercalarlos al escribir
+    const char *packed_str = getenv("C_PACKED");
+    io_mode.Packed = (packed_str != NULL) ? atoi(packed_str) : 0;
+
+    // La ecualización YUV es la última en leer la imagen en color, así que puede escribir
+    // sobre ella; la HSL necesita la entrada intacta y siempre reserva su salida
+    const char *inplace_str = getenv("C_INPLACE");
+    io_mode.InPlace = (inplace_str != NULL) ? atoi(inplace_str) : 0;
+}
+
+// Procesamiento en color de la banda local de cada proceso.
+// La salida se escribe con MPI-IO o se recolecta en el proceso 0 según io_mode.
+void run_cpu_color_test_band(PPM_IMG band) {
+    PPM_IMG band_out, img_obuf;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // La altura completa es la suma de las bandas
+    int h;
+    MPI_Allreduce(&band.h, &h, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    times.HslTime = MPI_Wtime();
+    band_out = contrast_enhancement_c_hsl_band(band);
+    times.HslTime = MPI_Wtime() - times.HslTime;
+
+    times.WriteTimeHsl = MPI_Wtime();
+    if (io_mode.CollectiveWrite) {
+        write_ppm_mpi(band_out, "out_hsl.ppm");
+    } else {
+        img_obuf = gather_ppm(band_out, band.w, h);
+        if (rank == 0) {
+            write_ppm(img_obuf, "out_hsl.ppm");
+            free_ppm(img_obuf);
+        }
+    }
+    times.WriteTimeHsl = MPI_Wtime() - times.WriteTimeHsl;
+    free_ppm(band_out);
+
+    times.YuvTime = MPI_Wtime();
+    if (io_mode.InPlace) {
+        contrast_enhancement_c_yuv_band_inplace(band);
+        band_out = band;
+    } else {
+        band_out = contrast_enhancement_c_yuv_band(band);
+    }
+    times.YuvTime = MPI_Wtime() - times.YuvTime;
+
+    times.WriteTimeYuv = MPI_Wtime();
+    if (io_mode.CollectiveWrite) {
+        write_ppm_mpi(band_out, "out_yuv.ppm");
+    } else {
+        img_obuf = gather_ppm(band_out, band.w, h);
+        if (rank == 0) {
+            write_ppm(img_obuf, "out_yuv.ppm");
+            free_ppm(img_obuf);
+        }
+    }
+    times.WriteTimeYuv = MPI_Wtime() - times.WriteTimeYuv;
+    if (!io_mode.InPlace)
+        free_ppm(band_out);
+}
+
+// Igual que run_cpu_color_test_band con la banda intercalada: ni la lectura, ni el
+// reparto, ni la escritura separan o intercalan canales
+void run_cpu_color_test_packed_band(PPM_PACKED_IMG band) {
+    PPM_PACKED_IMG band_out, img_obuf;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // La altura completa es la suma de las bandas
+    int h;
+    MPI_Allreduce(&band.h, &h, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    times.HslTime = MPI_Wtime();
+    band_out = contrast_enhancement_c_hsl_packed_band(band);
+    times.HslTime = MPI_Wtime() - times.HslTime;
+
+    times.WriteTimeHsl = MPI_Wtime();
+    if (io_mode.CollectiveWrite) {
+        write_ppm_packed_mpi(band_out, "out_hsl.ppm");
+    } else {
+        img_obuf = gather_ppm_packed(band_out, band.w, h);
+        if (rank == 0) {
+            write_ppm_packed(img_obuf, "out_hsl.ppm");
+            free_ppm_packed(img_obuf);
+        }
+    }
+    times.WriteTimeHsl = MPI_Wtime() - times.WriteTimeHsl;
+    free_ppm_packed(band_out);
+
+    times.YuvTime = MPI_Wtime();
+    if (io_mode.InPlace) {
+        contrast_enhancement_c_yuv_packed_band_inplace(band);
+        band_out = band;
+    } else {
+        band_out = contrast_enhancement_c_yuv_packed_band(band);
     }
+    times.YuvTime = MPI_Wtime() - times.YuvTime;
+
+    times.WriteTimeYuv = MPI_Wtime();
+    if (io_mode.CollectiveWrite) {
+        write_ppm_packed_mpi(band_out, "out_yuv.ppm");
+    } else {
+        img_obuf = gather_ppm_packed(band_out, band.w, h);
+        if (rank == 0) {
+            write_ppm_packed(img_obuf, "out_yuv.ppm");
+            free_ppm_packed(img_obuf);
+        }
+    }
+    times.WriteTimeYuv = MPI_Wtime() - times.WriteTimeYuv;
+    if (!io_mode.InPlace)
+        free_ppm_packed(band_out);
+}
+
+// Procesamiento en escala de grises de la banda local de cada proceso
+void run_cpu_gray_test_band(PGM_IMG band) {
+    PGM_IMG band_out, img_obuf;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int h;
+    MPI_Allreduce(&band.h, &h, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    times.GrayTime = MPI_Wtime();
+    if (io_mode.InPlace) {
+        contrast_enhancement_g_band_inplace(band);
+        band_out = band;
+    } else {
+        band_out = contrast_enhancement_g_band(band);
+    }
+    times.GrayTime = MPI_Wtime() - times.GrayTime;
+
+    times.WriteTimeGray = MPI_Wtime();
+    if (io_mode.CollectiveWrite) {
+        write_pgm_mpi(band_out, "out.pgm");
+    } else {
+        img_obuf = gather_pgm(band_out, band.w, h);
+        if (rank == 0) {
+            write_pgm(img_obuf, "out.pgm");
+            free_pgm(img_obuf);
+        }
+    }
+    times.WriteTimeGray = MPI_Wtime() - times.WriteTimeGray;
+    if (!io_mode.InPlace)
+        free_pgm(band_out);
 }
 
+// Modo streaming: cada proceso lee, procesa y escribe sus filas banda a banda,
+// por lo que la E/S queda incluida en el tiempo de procesamiento
+void run_cpu_color_test_stream() {
+    times.HslTime = MPI_Wtime();
+    contrast_enhancement_c_hsl_stream("in.ppm", "out_hsl.ppm", io_mode.StreamBudget);
+    times.HslTime = MPI_Wtime() - times.HslTime;
 
+    times.YuvTime = MPI_Wtime();
+    contrast_enhancement_c_yuv_stream("in.ppm", "out_yuv.ppm", io_mode.StreamBudget);
+    times.YuvTime = MPI_Wtime() - times.YuvTime;
+}
+
+void run_cpu_gray_test_stream() {
+    times.GrayTime = MPI_Wtime();
+    contrast_enhancement_g_stream("in.pgm", "out.pgm", io_mode.StreamBudget);
+    times.GrayTime = MPI_Wtime() - times.GrayTime;
+}
 
 PPM_IMG read_ppm(const char * path){
     FILE * in_file;
-    char sbuf[256];
     
     char *ibuf;
     PPM_IMG result;
-    int v_max, i;
     in_file = fopen(path, "r");
     if (in_file == NULL){
         printf("Input file not found!\n");
         exit(1);
     }
-    /*Skip the magic number*/
-    fscanf(in_file, "%s", sbuf);
-
-
-    //result = malloc(sizeof(PPM_IMG));
-    fscanf(in_file, "%d",&result.w);
-    fscanf(in_file, "%d",&result.h);
-    fscanf(in_file, "%d\n",&v_max);
+    PNM_HEADER hdr = read_pnm_header(in_file);
     
 
-    result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    ibuf         = (char *)malloc(3 * result.w * result.h * sizeof(char));
+    result = alloc_ppm(hdr.w, hdr.h);
+    ibuf         = (char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(char));
 
     
-    fread(ibuf,sizeof(unsigned char), 3 * result.w*result.h, in_file);
+    fread(ibuf,sizeof(unsigned char), 3 * (size_t)result.w * result.h, in_file);
 
-    for(i = 0; i < result.w*result.h; i ++){
-        result.img_r[i] = ibuf[3*i + 0];
-        result.img_g[i] = ibuf[3*i + 1];
-        result.img_b[i] = ibuf[3*i + 2];
-    }
+    deinterleave_rgb((const unsigned char *)ibuf, result.img_r, result.img_g, result.img_b, (size_t)result.w * result.h);
     
     fclose(in_file);
-    free(ibuf);
+    pool_free(ibuf);
     
     return result;
 }
 
 void write_ppm(PPM_IMG img, const char * path){
     FILE * out_file;
-    int i;
     
-    char * obuf = (char *)malloc(3 * img.w * img.h * sizeof(char));
+    char * obuf = (char *)pool_alloc(3 * (size_t)img.w * img.h * sizeof(char));
 
-    for(i = 0; i < img.w*img.h; i ++){
-        obuf[3*i + 0] = img.img_r[i];
-        obuf[3*i + 1] = img.img_g[i];
-        obuf[3*i + 2] = img.img_b[i];
-    }
+    interleave_rgb(img.img_r, img.img_g, img.img_b, (unsigned char *)obuf, (size_t)img.w * img.h);
     out_file = fopen(path, "wb");
     fprintf(out_file, "P6\n");
     fprintf(out_file, "%d %d\n255\n",img.w, img.h);
-    fwrite(obuf,sizeof(unsigned char), 3*img.w*img.h, out_file);
+    fwrite(obuf,sizeof(unsigned char), 3*(size_t)img.w * img.h, out_file);
     fclose(out_file);
-    free(obuf);
+    pool_free(obuf);
 }
 
 void free_ppm(PPM_IMG img)
 {
-    free(img.img_r);
-    free(img.img_g);
-    free(img.img_b);
+    pool_free(img.img_r);
+}
+
+// Los tres planos de una imagen salen de un único bloque de la reserva de buffers,
+// cada uno alineado a POOL_ALIGN; el bloque empieza en el primer plano
+PPM_IMG alloc_ppm(int w, int h)
+{
+    PPM_IMG img;
+    size_t stride = pool_plane_stride((size_t)w * h);
+    unsigned char * block = (unsigned char *)pool_alloc(3 * stride);
+
+    img.w = w;
+    img.h = h;
+    img.img_r = block;
+    img.img_g = block + stride;
+    img.img_b = block + 2 * stride;
+    return img;
+}
+
+// Lectura y escritura sin separar canales: los píxeles se copian tal como están en el fichero
+PPM_PACKED_IMG read_ppm_packed(const char * path){
+    FILE * in_file;
+    PPM_PACKED_IMG result;
+
+    in_file = fopen(path, "r");
+    if (in_file == NULL){
+        printf("Input file not found!\n");
+        exit(1);
+    }
+    PNM_HEADER hdr = read_pnm_header(in_file);
+    result.w = hdr.w;
+    result.h = hdr.h;
+
+    result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+    fread(result.img, sizeof(unsigned char), 3 * (size_t)result.w * result.h, in_file);
+
+    fclose(in_file);
+    return result;
+}
+
+void write_ppm_packed(PPM_PACKED_IMG img, const char * path){
+    FILE * out_file = fopen(path, "wb");
+
+    fprintf(out_file, "P6\n");
+    fprintf(out_file, "%d %d\n255\n",img.w, img.h);
+    fwrite(img.img, sizeof(unsigned char), 3*(size_t)img.w * img.h, out_file);
+    fclose(out_file);
+}
+
+void free_ppm_packed(PPM_PACKED_IMG img)
+{
+    pool_free(img.img);
 }
 
 PGM_IMG read_pgm(const char * path){
     FILE * in_file;
-    char sbuf[256];
     
     
     PGM_IMG result;
-    int v_max;//, i;
     in_file = fopen(path, "r");
     if (in_file == NULL){
         printf("Input file not found!\n");
         exit(1);
     }
     
-    fscanf(in_file, "%s", sbuf); /*Skip the magic number*/
-    fscanf(in_file, "%d",&result.w);
-    fscanf(in_file, "%d",&result.h);
-    fscanf(in_file, "%d\n",&v_max);
+    PNM_HEADER hdr = read_pnm_header(in_file);
+    result.w = hdr.w;
+    result.h = hdr.h;
     
-    result.img = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
+    result.img = (unsigned char *)pool_alloc((size_t)result.w * result.h * sizeof(unsigned char));
 
         
-    fread(result.img,sizeof(unsigned char), result.w*result.h, in_file);    
+    fread(result.img,sizeof(unsigned char), (size_t)result.w * result.h, in_file);    
     fclose(in_file);
     
     return result;
@@ -222,12 +549,316 @@ void write_pgm(PGM_IMG img, const char * path){
     out_file = fopen(path, "wb");
     fprintf(out_file, "P5\n");
     fprintf(out_file, "%d %d\n255\n",img.w, img.h);
-    fwrite(img.img,sizeof(unsigned char), img.w*img.h, out_file);
+    fwrite(img.img,sizeof(unsigned char), (size_t)img.w * img.h, out_file);
     fclose(out_file);
 }
 
 void free_pgm(PGM_IMG img)
 {
-    free(img.img);
+    pool_free(img.img);
 }
 
+// Fila inicial de la banda local: suma de las filas de los procesos anteriores
+static int band_first_row(int rows){
+    int rank, first_row = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Exscan(&rows, &first_row, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        first_row = 0; // MPI_Exscan no define el resultado en el proceso 0
+    }
+    return first_row;
+}
+
+// El proceso 0 interpreta la cabecera y difunde ancho, alto, valor máximo,
+// desplazamiento de los datos y número de canales
+static void read_header_mpi(const char * path, int * header){
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0) {
+        FILE * in_file;
+        in_file = fopen(path, "r");
+        if (in_file == NULL){
+            printf("Input file not found!\n");
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        PNM_HEADER hdr = read_pnm_header(in_file);
+        header[0] = hdr.w;
+        header[1] = hdr.h;
+        header[2] = hdr.max_value;
+        header[3] = (int)hdr.offset;
+        header[4] = hdr.channels;
+        fclose(in_file);
+    }
+    MPI_Bcast(header, 5, MPI_INT, 0, MPI_COMM_WORLD);
+}
+
+// Lee únicamente la banda de filas de este proceso
+static unsigned char * read_band_mpi(const char * path, int channels, int * w, int * rows){
+    int header[5];
+    read_header_mpi(path, header);
+
+    *w = header[0];
+    *rows = band_rows(header[1]);
+    int first_row = band_first_row(*rows);
+
+    MPI_File in_file;
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &in_file) != MPI_SUCCESS){
+        printf("Input file not found!\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    unsigned char * buf = (unsigned char *)pool_alloc((size_t)channels * (*w) * (*rows) * sizeof(unsigned char));
+    MPI_Offset offset = (MPI_Offset)header[3] + (MPI_Offset)channels * (*w) * first_row;
+    MPI_Datatype row = row_type(channels * (*w)); // La cuenta va en filas: no desborda un int
+    MPI_File_read_at_all(in_file, offset, buf, *rows, row, MPI_STATUS_IGNORE);
+    MPI_Type_free(&row);
+    MPI_File_close(&in_file);
+
+    return buf;
+}
+
+PPM_IMG read_ppm_mpi(const char * path){
+    int w, h;
+    unsigned char * ibuf = read_band_mpi(path, 3, &w, &h);
+    PPM_IMG band = alloc_ppm(w, h);
+
+    // Cada proceso separa los canales únicamente de sus filas
+    deinterleave_rgb(ibuf, band.img_r, band.img_g, band.img_b, (size_t)band.w * band.h);
+    pool_free(ibuf);
+
+    return band;
+}
+
+PPM_PACKED_IMG read_ppm_packed_mpi(const char * path){
+    PPM_PACKED_IMG band;
+    band.img = read_band_mpi(path, 3, &band.w, &band.h);
+    return band;
+}
+
+PGM_IMG read_pgm_mpi(const char * path){
+    PGM_IMG band;
+    band.img = read_band_mpi(path, 1, &band.w, &band.h);
+    return band;
+}
+
+// Escribe la banda local en su posición dentro del fichero final.
+// El proceso 0 escribe la cabecera y todos escriben sus píxeles con MPI_File_write_at_all.
+static void write_band_mpi(const char * path, const char * magic, int w, int rows, int channels, unsigned char * buf){
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Fila inicial de la banda y alto total
+    int first_row = band_first_row(rows), total_rows;
+    MPI_Allreduce(&rows, &total_rows, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    // Todos los procesos calculan la cabecera para conocer su longitud
+    char header[64];
+    int header_len = sprintf(header, "%s\n%d %d\n255\n", magic, w, total_rows);
+
+    MPI_File out_file;
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &out_file) != MPI_SUCCESS){
+        printf("Output file could not be opened!\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    // Truncamos el fichero por si ya existía uno más grande
+    MPI_File_set_size(out_file, (MPI_Offset)header_len + (MPI_Offset)channels * w * total_rows);
+
+    if (rank == 0) {
+        MPI_File_write_at(out_file, 0, header, header_len, MPI_CHAR, MPI_STATUS_IGNORE);
+    }
+
+    MPI_Offset offset = (MPI_Offset)header_len + (MPI_Offset)channels * w * first_row;
+    MPI_Datatype row = row_type(channels * w); // La cuenta va en filas: no desborda un int
+    MPI_File_write_at_all(out_file, offset, buf, rows, row, MPI_STATUS_IGNORE);
+    MPI_Type_free(&row);
+    MPI_File_close(&out_file);
+}
+
+void write_ppm_mpi(PPM_IMG band, const char * path){
+    unsigned char * obuf = (unsigned char *)pool_alloc(3 * (size_t)band.w * band.h * sizeof(unsigned char));
+
+    // Cada proceso intercala únicamente sus propias filas
+    interleave_rgb(band.img_r, band.img_g, band.img_b, obuf, (size_t)band.w * band.h);
+    write_band_mpi(path, "P6", band.w, band.h, 3, obuf);
+    pool_free(obuf);
+}
+
+void write_ppm_packed_mpi(PPM_PACKED_IMG band, const char * path){
+    write_band_mpi(path, "P6", band.w, band.h, 3, band.img);
+}
+
+void write_pgm_mpi(PGM_IMG band, const char * path){
+    write_band_mpi(path, "P5", band.w, band.h, 1, band.img);
+}
+
+MAPPED_IMG map_pnm(const char * path){
+    MAPPED_IMG result;
+    struct stat st;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0){
+        printf("Input file not found!\n");
+        exit(1);
+    }
+    result.map_size = st.st_size;
+
+    // El fichero se recorre una sola vez de principio a fin
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    // Escribible y privada (copia en escritura): el modo C_INPLACE ecualiza sobre la
+    // propia proyección sin modificar el fichero
+    result.map = mmap(NULL, result.map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // La proyección sigue siendo válida tras cerrar el descriptor
+    if (result.map == MAP_FAILED){
+        printf("Input file could not be mapped!\n");
+        exit(1);
+    }
+    madvise(result.map, result.map_size, MADV_SEQUENTIAL);
+    madvise(result.map, result.map_size, MADV_WILLNEED);
+
+    // La cabecera se interpreta sobre la propia proyección con el mismo lector que la
+    // lectura con stdio, así que ambos modos aceptan exactamente los mismos ficheros
+    FILE * header_file = fmemopen(result.map, result.map_size, "rb");
+    PNM_HEADER hdr = read_pnm_header(header_file);
+    fclose(header_file);
+    result.w = hdr.w;
+    result.h = hdr.h;
+    result.channels = hdr.channels;
+
+    const unsigned char * p = (const unsigned char *)result.map + hdr.offset;
+    const unsigned char * end = (const unsigned char *)result.map + result.map_size;
+
+    result.data = (unsigned char *)p;
+    if (p > end || (size_t)(end - p) < (size_t)result.channels * (size_t)result.w * result.h){
+        printf("Input file is truncated!\n");
+        exit(1);
+    }
+
+    return result;
+}
+
+void unmap_pnm(MAPPED_IMG img){
+    munmap(img.map, img.map_size);
+}
+
+PGM_IMG pgm_view(MAPPED_IMG img){
+    // Vista sin copia: los píxeles se leen directamente de la proyección.
+    // No se debe llamar a free_pgm sobre ella, sino a unmap_pnm.
+    PGM_IMG result;
+    result.w = img.w;
+    result.h = img.h;
+    result.img = img.data;
+    return result;
+}
+
+PPM_PACKED_IMG ppm_packed_view(MAPPED_IMG img){
+    // Vista sin copia de una imagen en color: se libera con unmap_pnm, no con free_ppm_packed
+    PPM_PACKED_IMG result;
+    result.w = img.w;
+    result.h = img.h;
+    result.img = img.data;
+    return result;
+}
+
+PPM_IMG read_ppm_mmap(const char * path){
+    // Separamos los canales leyendo directamente de la proyección, sin buffer intermedio
+    MAPPED_IMG mapped = map_pnm(path);
+    PPM_IMG result = alloc_ppm(mapped.w, mapped.h);
+
+    const unsigned char * ibuf = mapped.data;
+    deinterleave_rgb(ibuf, result.img_r, result.img_g, result.img_b, (size_t)result.w * result.h);
+
+    unmap_pnm(mapped);
+
+    return result;
+}
+
+// Con streaming cada proceso recorre sus propias filas banda a banda y el número de
+// bandas puede variar entre procesos, por eso las lecturas y escrituras son independientes
+PNM_STREAM open_pnm_stream(const char * path){
+    PNM_STREAM s;
+    int rank, header[5];
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    read_header_mpi(path, header);
+    s.w = header[0];
+    s.h = header[1];
+    s.offset = header[3];
+    s.channels = header[4];
+    if (rank == 0) {
+        printf("Image size: %d x %d\n", s.w, s.h);
+    }
+
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &s.file) != MPI_SUCCESS){
+        printf("Input file not found!\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    return s;
+}
+
+PNM_STREAM create_pnm_stream(const char * path, int w, int h, int channels){
+    PNM_STREAM s;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Todos los procesos calculan la cabecera para conocer su longitud
+    char header[64];
+    int header_len = sprintf(header, "%s\n%d %d\n255\n", (channels == 3) ? "P6" : "P5", w, h);
+
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &s.file) != MPI_SUCCESS){
+        printf("Output file could not be opened!\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    // Truncamos el fichero por si ya existía uno más grande
+    MPI_File_set_size(s.file, (MPI_Offset)header_len + (MPI_Offset)channels * w * h);
+
+    if (rank == 0) {
+        MPI_File_write_at(s.file, 0, header, header_len, MPI_CHAR, MPI_STATUS_IGNORE);
+    }
+    s.w = w;
+    s.h = h;
+    s.channels = channels;
+    s.offset = header_len;
+
+    return s;
+}
+
+void close_pnm_stream(PNM_STREAM s){
+    MPI_File_close(&s.file);
+}
+
+// Lectura y escritura independientes de rows filas de row_bytes bytes. Se cuentan filas
+// con un tipo MPI de fila, así que la banda puede superar 2^31 bytes
+static void read_rows_at(MPI_File file, MPI_Offset offset, unsigned char * buf, int row_bytes, int rows){
+    MPI_Datatype row = row_type(row_bytes);
+    MPI_File_read_at(file, offset, buf, rows, row, MPI_STATUS_IGNORE);
+    MPI_Type_free(&row);
+}
+
+static void write_rows_at(MPI_File file, MPI_Offset offset, unsigned char * buf, int row_bytes, int rows){
+    MPI_Datatype row = row_type(row_bytes);
+    MPI_File_write_at(file, offset, buf, rows, row, MPI_STATUS_IGNORE);
+    MPI_Type_free(&row);
+}
+
+void read_pgm_rows(PNM_STREAM s, int first_row, PGM_IMG band){
+    MPI_Offset offset = (MPI_Offset)s.offset + (MPI_Offset)s.w * first_row;
+    read_rows_at(s.file, offset, band.img, band.w, band.h);
+}
+
+void write_pgm_rows(PNM_STREAM s, int first_row, PGM_IMG band){
+    MPI_Offset offset = (MPI_Offset)s.offset + (MPI_Offset)s.w * first_row;
+    write_rows_at(s.file, offset, band.img, band.w, band.h);
+}
+
+void read_ppm_packed_rows(PNM_STREAM s, int first_row, PPM_PACKED_IMG band){
+    MPI_Offset offset = (MPI_Offset)s.offset + (MPI_Offset)3 * s.w * first_row;
+    read_rows_at(s.file, offset, band.img, 3 * band.w, band.h);
+}
+
+void write_ppm_packed_rows(PNM_STREAM s, int first_row, PPM_PACKED_IMG band){
+    MPI_Offset offset = (MPI_Offset)s.offset + (MPI_Offset)3 * s.w * first_row;
+    write_rows_at(s.file, offset, band.img, 3 * band.w, band.h);
+}
@@ -1,6 +1,12 @@
 #ifndef HIST_EQU_COLOR_H
 #define HIST_EQU_COLOR_H
 
+#include <stddef.h>
+#include <stdio.h>
+#include "pixel-kernels.h"
+#include "image-pool.h"
+#include <mpi.h>
+
 typedef struct{
     int w;
     int h;
@@ -15,43 +21,115 @@ typedef struct{
     unsigned char * img_b;
 } PPM_IMG;
 
+//Imagen en color con los canales intercalados (r0 g0 b0 r1 g1 b1 ...), en el mismo
+//orden que en el fichero: se lee y se escribe sin separar ni intercalar canales
 typedef struct{
     int w;
     int h;
-    unsigned char * img_y;
-    unsigned char * img_u;
-    unsigned char * img_v;
-} YUV_IMG;
-
-
-typedef struct
-{
-    int width;
-    int height;
-    float * h;
-    float * s;
-    unsigned char * l;
-} HSL_IMG;
+    unsigned char * img;
+} PPM_PACKED_IMG;
 
-    
 
 PPM_IMG read_ppm(const char * path);
 void write_ppm(PPM_IMG img, const char * path);
 void free_ppm(PPM_IMG img);
 
+//Reserva de imágenes: los planos salen de un único bloque alineado de la reserva de
+//buffers (image-pool.h), que se reutiliza entre etapas e imágenes; se liberan con free_*
+PPM_IMG alloc_ppm(int w, int h);
+
+PPM_PACKED_IMG read_ppm_packed(const char * path);
+void write_ppm_packed(PPM_PACKED_IMG img, const char * path);
+void free_ppm_packed(PPM_PACKED_IMG img);
+
 PGM_IMG read_pgm(const char * path);
 void write_pgm(PGM_IMG img, const char * path);
 void free_pgm(PGM_IMG img);
 
-HSL_IMG rgb2hsl(PPM_IMG img_in);
-PPM_IMG hsl2rgb(HSL_IMG img_in);
+//Lectura mediante mmap: vista sin copia sobre los píxeles del fichero
+typedef struct{
+    int w;
+    int h;
+    int channels;          // 1 para PGM, 3 para PPM (intercalado)
+    unsigned char * data;  // Primer píxel dentro de la proyección
+    void * map;
+    size_t map_size;
+} MAPPED_IMG;
+
+MAPPED_IMG map_pnm(const char * path);
+void unmap_pnm(MAPPED_IMG img);
+PGM_IMG pgm_view(MAPPED_IMG img);
+PPM_IMG read_ppm_mmap(const char * path);
+PPM_PACKED_IMG ppm_packed_view(MAPPED_IMG img);
+
+//Lectura colectiva con MPI-IO: cada proceso lee solo su banda de filas
+PPM_IMG read_ppm_mpi(const char * path);
+PGM_IMG read_pgm_mpi(const char * path);
+
+//Escritura colectiva con MPI-IO: cada proceso escribe su banda de filas
+void write_ppm_mpi(PPM_IMG band, const char * path);
+void write_pgm_mpi(PGM_IMG band, const char * path);
+PPM_PACKED_IMG read_ppm_packed_mpi(const char * path);
+void write_ppm_packed_mpi(PPM_PACKED_IMG band, const char * path);
 
-YUV_IMG rgb2yuv(PPM_IMG img_in);
-PPM_IMG yuv2rgb(YUV_IMG img_in);    
+//Reparto de la imagen en bandas de filas entre procesos. Las cuentas y desplazamientos
+//van en filas, con un tipo MPI de fila (row_type, se libera con MPI_Type_free), para que
+//ningún int de MPI_Scatterv/MPI_Gatherv desborde con imágenes de más de 2^31 bytes
+void band_counts(int h, int *rowcounts, int *displs);
+MPI_Datatype row_type(int row_bytes);
+int band_rows(int h);
+PGM_IMG scatter_pgm(PGM_IMG img_in);
+PPM_IMG scatter_ppm(PPM_IMG img_in);
+PGM_IMG gather_pgm(PGM_IMG band, int w, int h);
+PPM_IMG gather_ppm(PPM_IMG band, int w, int h);
+PPM_PACKED_IMG scatter_ppm_packed(PPM_PACKED_IMG img_in);
+PPM_PACKED_IMG gather_ppm_packed(PPM_PACKED_IMG band, int w, int h);
+//Recolección sobre una imagen ya reservada en el proceso 0
+void gather_pgm_into(PGM_IMG band, PGM_IMG img);
+void gather_ppm_into(PPM_IMG band, PPM_IMG img);
+void gather_ppm_packed_into(PPM_PACKED_IMG band, PPM_PACKED_IMG img);
 
-void histogram(int * hist_out, unsigned char * img_in, int img_size, int nbr_bin);
+//Lectura y escritura por bandas de filas, para imágenes que no caben en memoria
+typedef struct{
+    MPI_File file;
+    int w;
+    int h;
+    int channels;          // 1 para PGM, 3 para PPM
+    long offset;           // Posición del primer píxel dentro del fichero
+} PNM_STREAM;
+
+PNM_STREAM open_pnm_stream(const char * path);
+PNM_STREAM create_pnm_stream(const char * path, int w, int h, int channels);
+void close_pnm_stream(PNM_STREAM s);
+void read_pgm_rows(PNM_STREAM s, int first_row, PGM_IMG band);
+void write_pgm_rows(PNM_STREAM s, int first_row, PGM_IMG band);
+void read_ppm_packed_rows(PNM_STREAM s, int first_row, PPM_PACKED_IMG band);
+void write_ppm_packed_rows(PNM_STREAM s, int first_row, PPM_PACKED_IMG band);
+
+// Motor HSL fusionado: histograma de L directamente desde RGB y vuelta a RGB con L
+// ecualizada por lut, recalculando H y S por bloques. Las versiones _pixels trabajan
+// sobre n píxeles de una vista planar o intercalada
+void histogram_hsl_l(int64_t * hist_out, PPM_IMG img_in);
+PPM_IMG hsl_equalize_rgb(PPM_IMG img_in, unsigned char * lut);
+void histogram_hsl_l_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n);
+void hsl_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n);
+
+// Motor YUV fusionado: histograma de Y leyendo solo RGB y vuelta a RGB desde
+// (lut[Y], U, V) recalculando U y V en cada píxel
+void histogram_yuv_y(int64_t * hist_out, PPM_IMG img_in);
+PPM_IMG yuv_equalize_rgb(PPM_IMG img_in, unsigned char * lut);
+void histogram_yuv_y_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n);
+void yuv_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n);
+//Como yuv_equalize_pixels, pero en C_YUV_VERIFY devuelve los píxeles distintos sin imprimirlos
+long yuv_equalize_count(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n);
+
+void histogram(int64_t * hist_out, unsigned char * img_in, size_t img_size, int nbr_bin);
 void histogram_equalization(unsigned char * img_out, unsigned char * img_in, 
-                            int * hist_in, int img_size, int nbr_bin, int full_img_size);
+                            int64_t * hist_in, size_t img_size, int nbr_bin, size_t full_img_size);
+void histogram_equalization_inplace(unsigned char * img, int64_t * hist_in, size_t img_size,
+                                    int nbr_bin, size_t full_img_size);
+void histogram_lut(unsigned char * lut, int64_t * hist_in, size_t full_img_size, int nbr_bin);
+void apply_lut(unsigned char * img_out, unsigned char * img_in, unsigned char * lut, size_t img_size);
 
 //Contrast enhancement for gray-scale images
 PGM_IMG contrast_enhancement_g(PGM_IMG img_in);
@@ -61,5 +139,35 @@ PPM_IMG contrast_enhancement_c_rgb(PPM_IMG img_in);
 PPM_IMG contrast_enhancement_c_yuv(PPM_IMG img_in);
 PPM_IMG contrast_enhancement_c_hsl(PPM_IMG img_in);
 
+//Contrast enhancement sobre imágenes intercaladas, sin separar los canales
+PPM_PACKED_IMG contrast_enhancement_c_yuv_packed(PPM_PACKED_IMG img_in);
+PPM_PACKED_IMG contrast_enhancement_c_hsl_packed(PPM_PACKED_IMG img_in);
+
+//Contrast enhancement sobre la banda local de cada proceso (sin scatter ni gather)
+PGM_IMG contrast_enhancement_g_band(PGM_IMG band);
+PPM_IMG contrast_enhancement_c_yuv_band(PPM_IMG band);
+PPM_IMG contrast_enhancement_c_hsl_band(PPM_IMG band);
+PPM_PACKED_IMG contrast_enhancement_c_yuv_packed_band(PPM_PACKED_IMG band);
+PPM_PACKED_IMG contrast_enhancement_c_hsl_packed_band(PPM_PACKED_IMG band);
+
+//Contrast enhancement en el sitio: el resultado sobrescribe la entrada (la imagen del
+//proceso 0 o la banda local) y no se reserva imagen de salida
+void contrast_enhancement_g_inplace(PGM_IMG img);
+void contrast_enhancement_c_yuv_inplace(PPM_IMG img);
+void contrast_enhancement_c_hsl_inplace(PPM_IMG img);
+void contrast_enhancement_c_yuv_packed_inplace(PPM_PACKED_IMG img);
+void contrast_enhancement_c_hsl_packed_inplace(PPM_PACKED_IMG img);
+void contrast_enhancement_g_band_inplace(PGM_IMG band);
+void contrast_enhancement_c_yuv_band_inplace(PPM_IMG band);
+void contrast_enhancement_c_hsl_band_inplace(PPM_IMG band);
+void contrast_enhancement_c_yuv_packed_band_inplace(PPM_PACKED_IMG band);
+void contrast_enhancement_c_hsl_packed_band_inplace(PPM_PACKED_IMG band);
+
+//Ecualización en dos recorridos sobre el fichero, por bandas de filas que caben en
+//mem_budget bytes: el primero calcula el histograma y el segundo aplica la LUT
+void contrast_enhancement_g_stream(const char * in_path, const char * out_path, size_t mem_budget);
+void contrast_enhancement_c_yuv_stream(const char * in_path, const char * out_path, size_t mem_budget);
+void contrast_enhancement_c_hsl_stream(const char * in_path, const char * out_path, size_t mem_budget);
+
 
 #endif
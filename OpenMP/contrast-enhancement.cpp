@@ -1,25 +1,27 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <omp.h>
 #include "hist-equ.h"
+#include "pixel-kernels.h"
 
 PGM_IMG contrast_enhancement_g(PGM_IMG img_in)
 {
     PGM_IMG result; // Imagen de salida
-    int hist[256];  // Histograma para la imagen en escala de grises (256 niveles)
+    int64_t hist[256];  // Histograma para la imagen en escala de grises (256 niveles)
 
     // Inicializar las dimensiones de la imagen de salida
     result.w = img_in.w;
     result.h = img_in.h;
 
     // Reservar memoria para la imagen de salida
-    result.img = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
+    result.img = (unsigned char *)alloc_pixels((size_t)result.w * result.h, sizeof(unsigned char));
 
     // Calcular el histograma de la imagen de entrada
-    histogram(hist, img_in.img, img_in.h * img_in.w, 256);
+    histogram(hist, img_in.img, (size_t)img_in.h * img_in.w, 256);
 
     // Aplicar ecualización del histograma a la imagen de entrada
-    histogram_equalization(result.img, img_in.img, hist, result.w * result.h, 256);
+    histogram_equalization(result.img, img_in.img, hist, (size_t)result.w * result.h, 256);
 
     // Retornar la imagen con contraste mejorado
     return result;
@@ -27,29 +29,21 @@ PGM_IMG contrast_enhancement_g(PGM_IMG img_in)
 
 PPM_IMG contrast_enhancement_c_rgb(PPM_IMG img_in)
 {
-    PPM_IMG result; // Imagen de salida
-    int hist[256];  // Histograma para cada canal de color (R, G, B)
-
-    // Inicializar las dimensiones de la imagen de salida
-    result.w = img_in.w;
-    result.h = img_in.h;
-
-    // Reservar memoria para los canales de color de la imagen de salida
-    result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
+    // Imagen de salida, con las dimensiones de la de entrada y sus canales ya reservados
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+    int64_t hist[256];  // Histograma para cada canal de color (R, G, B)
 
     // Calcular el histograma y aplicar ecualización del histograma para el canal rojo
-    histogram(hist, img_in.img_r, img_in.h * img_in.w, 256);
-    histogram_equalization(result.img_r, img_in.img_r, hist, result.w * result.h, 256);
+    histogram(hist, img_in.img_r, (size_t)img_in.h * img_in.w, 256);
+    histogram_equalization(result.img_r, img_in.img_r, hist, (size_t)result.w * result.h, 256);
 
     // Repetir el proceso para el canal verde
-    histogram(hist, img_in.img_g, img_in.h * img_in.w, 256);
-    histogram_equalization(result.img_g, img_in.img_g, hist, result.w * result.h, 256);
+    histogram(hist, img_in.img_g, (size_t)img_in.h * img_in.w, 256);
+    histogram_equalization(result.img_g, img_in.img_g, hist, (size_t)result.w * result.h, 256);
 
     // Repetir el proceso para el canal azul
-    histogram(hist, img_in.img_b, img_in.h * img_in.w, 256);
-    histogram_equalization(result.img_b, img_in.img_b, hist, result.w * result.h, 256);
+    histogram(hist, img_in.img_b, (size_t)img_in.h * img_in.w, 256);
+    histogram_equalization(result.img_b, img_in.img_b, hist, (size_t)result.w * result.h, 256);
 
     // Retornar la imagen con contraste mejorado para cada canal
     return result;
@@ -58,310 +52,802 @@ PPM_IMG contrast_enhancement_c_rgb(PPM_IMG img_in)
 
 PPM_IMG contrast_enhancement_c_yuv(PPM_IMG img_in)
 {
-    YUV_IMG yuv_med;       // Imagen intermedia en espacio de color YUV
-    PPM_IMG result;        // Imagen de salida
-    unsigned char *y_equ;  // Canal Y (luminancia) ecualizado
-    int hist[256];         // Histograma para el canal Y
+    int64_t hist[256];       // Histograma para el canal Y
+    unsigned char lut[256];  // Tabla de ecualización del canal Y
 
-    // Convertir la imagen de entrada de RGB a YUV
-    yuv_med = rgb2yuv(img_in);
+    // Calcular el histograma del canal Y leyendo solo la imagen RGB
+    histogram_yuv_y(hist, img_in);
 
-    // Reservar memoria para el canal Y ecualizado
-    y_equ = (unsigned char *)malloc(yuv_med.h * yuv_med.w * sizeof(unsigned char));
+    // Tabla de ecualización del histograma
+    histogram_lut(lut, hist, (size_t)img_in.w * img_in.h, 256);
 
-    // Calcular el histograma del canal Y
-    histogram(hist, yuv_med.img_y, yuv_med.h * yuv_med.w, 256);
+    // Ecualizar Y y volver a RGB recalculando U y V, sin planos YUV intermedios
+    return yuv_equalize_rgb(img_in, lut);
+}
 
-    // Aplicar ecualización del histograma al canal Y
-    histogram_equalization(y_equ, yuv_med.img_y, hist, yuv_med.h * yuv_med.w, 256);
+PPM_IMG contrast_enhancement_c_hsl(PPM_IMG img_in)
+{
+    int64_t hist[256];       // Histograma para el canal L
+    unsigned char lut[256];  // Tabla de ecualización del canal L
 
-    // Reemplazar el canal Y original por el ecualizado
-    free(yuv_med.img_y);
-    yuv_med.img_y = y_equ;
+    // Calcular el histograma del canal L directamente desde RGB (solo máximo y mínimo)
+    histogram_hsl_l(hist, img_in);
 
-    // Convertir la imagen intermedia de YUV de regreso a RGB
-    result = yuv2rgb(yuv_med);
+    // Tabla de ecualización del histograma
+    histogram_lut(lut, hist, (size_t)img_in.w * img_in.h, 256);
 
-    // Liberar memoria utilizada por los canales Y, U, y V
-    free(yuv_med.img_y);
-    free(yuv_med.img_u);
-    free(yuv_med.img_v);
+    // Recalcular H y S por bloques, ecualizar L y volver a RGB sin planos HSL intermedios
+    return hsl_equalize_rgb(img_in, lut);
+}
 
-    // Retornar la imagen con contraste mejorado
+
+// Las versiones intercaladas usan los mismos motores sobre una vista con stride 3
+PPM_PACKED_IMG contrast_enhancement_c_yuv_packed(PPM_PACKED_IMG img_in)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+    PPM_PACKED_IMG result;
+
+    histogram_yuv_y_pixels(hist, packed_view(img_in.img), (size_t)img_in.w * img_in.h);
+    histogram_lut(lut, hist, (size_t)img_in.w * img_in.h, 256);
+
+    result.w = img_in.w;
+    result.h = img_in.h;
+    result.img = (unsigned char *)alloc_pixels((size_t)result.w * result.h, 3 * sizeof(unsigned char));
+    yuv_equalize_pixels(lut, packed_view(img_in.img), packed_view(result.img), (size_t)img_in.w * img_in.h);
     return result;
 }
 
-PPM_IMG contrast_enhancement_c_hsl(PPM_IMG img_in)
+PPM_PACKED_IMG contrast_enhancement_c_hsl_packed(PPM_PACKED_IMG img_in)
 {
-    HSL_IMG hsl_med;       // Imagen intermedia en espacio de color HSL
-    PPM_IMG result;        // Imagen de salida
-    unsigned char *l_equ;  // Canal L (luminancia) ecualizado
-    int hist[256];         // Histograma para el canal L
+    int64_t hist[256];
+    unsigned char lut[256];
+    PPM_PACKED_IMG result;
 
-    // Convertir la imagen de entrada de RGB a HSL
-    hsl_med = rgb2hsl(img_in);
+    histogram_hsl_l_pixels(hist, packed_view(img_in.img), (size_t)img_in.w * img_in.h);
+    histogram_lut(lut, hist, (size_t)img_in.w * img_in.h, 256);
 
-    // Reservar memoria para el canal L ecualizado
-    l_equ = (unsigned char *)malloc(hsl_med.height * hsl_med.width * sizeof(unsigned char));
+    result.w = img_in.w;
+    result.h = img_in.h;
+    result.img = (unsigned char *)alloc_pixels((size_t)result.w * result.h, 3 * sizeof(unsigned char));
+    hsl_equalize_pixels(lut, packed_view(img_in.img), packed_view(result.img), (size_t)img_in.w * img_in.h);
+    return result;
+}
 
-    // Calcular el histograma del canal L
-    histogram(hist, hsl_med.l, hsl_med.height * hsl_med.width, 256);
+// Variantes en el sitio: el resultado sobrescribe la imagen de entrada y no se reserva
+// ninguna imagen de salida, para cuando el llamador ya no necesita la entrada
+void contrast_enhancement_g_inplace(PGM_IMG img)
+{
+    int64_t hist[256];
 
-    // Aplicar ecualización del histograma al canal L
-    histogram_equalization(l_equ, hsl_med.l, hist, hsl_med.width * hsl_med.height, 256);
+    histogram(hist, img.img, (size_t)img.h * img.w, 256);
+    histogram_equalization_inplace(img.img, hist, (size_t)img.w * img.h, 256);
+}
+
+void contrast_enhancement_c_yuv_inplace(PPM_IMG img)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+    RGB_VIEW view = planar_view(img.img_r, img.img_g, img.img_b);
 
-    // Reemplazar el canal L original por el ecualizado
-    free(hsl_med.l);
-    hsl_med.l = l_equ;
+    histogram_yuv_y_pixels(hist, view, (size_t)img.w * img.h);
+    histogram_lut(lut, hist, (size_t)img.w * img.h, 256);
+    yuv_equalize_pixels(lut, view, view, (size_t)img.w * img.h);
+}
 
-    // Convertir la imagen intermedia de HSL de regreso a RGB
-    result = hsl2rgb(hsl_med);
+void contrast_enhancement_c_hsl_inplace(PPM_IMG img)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+    RGB_VIEW view = planar_view(img.img_r, img.img_g, img.img_b);
 
-    // Liberar memoria utilizada por los canales H, S, y L
-    free(hsl_med.h);
-    free(hsl_med.s);
-    free(hsl_med.l);
+    histogram_hsl_l_pixels(hist, view, (size_t)img.w * img.h);
+    histogram_lut(lut, hist, (size_t)img.w * img.h, 256);
+    hsl_equalize_pixels(lut, view, view, (size_t)img.w * img.h);
+}
 
-    // Retornar la imagen con contraste mejorado
+void contrast_enhancement_c_yuv_packed_inplace(PPM_PACKED_IMG img)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+
+    histogram_yuv_y_pixels(hist, packed_view(img.img), (size_t)img.w * img.h);
+    histogram_lut(lut, hist, (size_t)img.w * img.h, 256);
+    yuv_equalize_pixels(lut, packed_view(img.img), packed_view(img.img), (size_t)img.w * img.h);
+}
+
+void contrast_enhancement_c_hsl_packed_inplace(PPM_PACKED_IMG img)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+
+    histogram_hsl_l_pixels(hist, packed_view(img.img), (size_t)img.w * img.h);
+    histogram_lut(lut, hist, (size_t)img.w * img.h, 256);
+    hsl_equalize_pixels(lut, packed_view(img.img), packed_view(img.img), (size_t)img.w * img.h);
+}
+
+// Bytes por píxel que ocupan a la vez los buffers de una banda en cada modo de streaming
+// (cada banda se ecualiza en el sitio, así que no hay buffer de salida)
+#define STREAM_BYTES_G   1   // banda de entrada, sobrescrita con el resultado
+#define STREAM_BYTES_YUV 3   // RGB intercalado de la banda (Y, U y V no se guardan)
+#define STREAM_BYTES_HSL 3   // RGB intercalado de la banda (H, S y L van por bloques)
+
+// Número de filas por banda para no superar mem_budget bytes (al menos una fila)
+static int stream_band_rows(int w, int h, int bytes_per_pixel, size_t mem_budget)
+{
+    size_t rows = mem_budget / ((size_t)w * bytes_per_pixel);
+    if (rows < 1)
+        rows = 1;
+    if (rows > (size_t)h)
+        rows = h;
+    printf("Streaming %d rows per band\n", (int)rows);
+    return (int)rows;
+}
+
+// Suma el histograma de img_size píxeles al acumulado en hist
+static void histogram_add(int64_t * hist, unsigned char * img_in, size_t img_size)
+{
+    int64_t hist_band[256];
+    histogram(hist_band, img_in, img_size, 256);
+    for (int i = 0; i < 256; i++)
+        hist[i] += hist_band[i];
+}
+
+void contrast_enhancement_g_stream(const char * in_path, const char * out_path, size_t mem_budget)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PGM_IMG band;
+    int64_t hist[256] = {0};
+    unsigned char lut[256];
+    int rows = stream_band_rows(in.w, in.h, STREAM_BYTES_G, mem_budget);
+    int row;
+
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc((size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la imagen completa
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_pgm_rows(in, row, band);
+        histogram_add(hist, band.img, (size_t)band.w * band.h);
+    }
+    histogram_lut(lut, hist, (size_t)in.w * in.h, 256);
+
+    // Segundo recorrido: ecualizar cada banda y escribirla en su sitio
+    out = create_pnm_stream(out_path, in.w, in.h, 1);
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_pgm_rows(in, row, band);
+        apply_lut(band.img, band.img, lut, (size_t)band.w * band.h);
+        write_pgm_rows(out, row, band);
+    }
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    pool_free(band.img);
+}
+
+// Modo C_YUV_VERIFY: píxeles que cambian respecto a la conversión en double
+static void report_fixed_diffs(const char * name, long diffs, size_t n)
+{
+    printf("%s fixed-point: %ld of %zu pixels differ from double precision\n", name, diffs, n);
+}
+
+void contrast_enhancement_c_yuv_stream(const char * in_path, const char * out_path, size_t mem_budget)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PPM_PACKED_IMG band;
+    int64_t hist[256] = {0};
+    int64_t band_hist[256];
+    unsigned char lut[256];
+    int rows = stream_band_rows(in.w, in.h, STREAM_BYTES_YUV, mem_budget);
+    int row;
+    long diffs = 0;
+
+    // Las bandas se procesan intercaladas, tal como están en el fichero, y en el sitio
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la luminancia Y, calculada directamente desde RGB
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        histogram_yuv_y_pixels(band_hist, packed_view(band.img), (size_t)band.w * band.h);
+        for (int i = 0; i < 256; i++)
+            hist[i] += band_hist[i];
+    }
+    histogram_lut(lut, hist, (size_t)in.w * in.h, 256);
+
+    // Segundo recorrido: ecualizar Y y volver a RGB banda a banda en un solo paso por píxel
+    out = create_pnm_stream(out_path, in.w, in.h, 3);
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        diffs += yuv_equalize_count(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+        write_ppm_packed_rows(out, row, band);
+    }
+
+    // En C_YUV_VERIFY se informa una vez por imagen, sumando todas las bandas
+    if (yuv_mode() == YUV_VERIFY)
+        report_fixed_diffs("yuv equalization", diffs, (size_t)in.w * in.h);
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    free_ppm_packed(band);
+}
+
+void contrast_enhancement_c_hsl_stream(const char * in_path, const char * out_path, size_t mem_budget)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PPM_PACKED_IMG band;
+    int64_t hist[256] = {0};
+    int64_t band_hist[256];
+    unsigned char lut[256];
+    int rows = stream_band_rows(in.w, in.h, STREAM_BYTES_HSL, mem_budget);
+    int row;
+
+    // Las bandas se procesan intercaladas, tal como están en el fichero, y en el sitio
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la luminosidad L, calculada directamente desde RGB
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        histogram_hsl_l_pixels(band_hist, packed_view(band.img), (size_t)band.w * band.h);
+        for (int i = 0; i < 256; i++)
+            hist[i] += band_hist[i];
+    }
+    histogram_lut(lut, hist, (size_t)in.w * in.h, 256);
+
+    // Segundo recorrido: recalcular HSL, ecualizar L y volver a RGB banda a banda
+    out = create_pnm_stream(out_path, in.w, in.h, 3);
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        hsl_equalize_pixels(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+        write_ppm_packed_rows(out, row, band);
+    }
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    free_ppm_packed(band);
+}
+
+
+// Motor HSL fusionado: el histograma de L se calcula desde RGB con solo el máximo y el
+// mínimo, y hsl_equalize_rgb recalcula H y S por bloques al volver a RGB, así que nunca
+// se reservan los planos H, S y L de toda la imagen
+void histogram_hsl_l_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n)
+{
+    memset(hist_out, 0, 256 * sizeof(int64_t));
+
+    // Cada hilo acumula en su copia privada del histograma y se suman al final
+    parallel_histogram_blocks(LOOP_HSL_HIST, hist_out, n, PIXEL_BLOCK, [&](int64_t * hist, size_t i, size_t len) {
+        unsigned char l[PIXEL_BLOCK];
+        rgb2hsl_lightness_view(view_offset(img_in, i), l, len);
+        histogram_banked(hist, l, len);
+    });
+}
+
+void histogram_hsl_l(int64_t * hist_out, PPM_IMG img_in)
+{
+    histogram_hsl_l_pixels(hist_out, planar_view(img_in.img_r, img_in.img_g, img_in.img_b), (size_t)img_in.w * img_in.h);
+}
+
+void hsl_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    parallel_blocks(LOOP_HSL_EQUALIZE, n, PIXEL_BLOCK, [&](size_t i, size_t len) {
+        hsl_equalize_view(lut, view_offset(img_in, i), view_offset(img_out, i), len);
+    });
+}
+
+PPM_IMG hsl_equalize_rgb(PPM_IMG img_in, unsigned char * lut)
+{
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+
+    hsl_equalize_pixels(lut, planar_view(img_in.img_r, img_in.img_g, img_in.img_b),
+                        planar_view(result.img_r, result.img_g, result.img_b), (size_t)img_in.w * img_in.h);
     return result;
 }
 
+// Motor YUV fusionado: el histograma de Y se calcula en un recorrido de solo lectura sobre
+// RGB y yuv_equalize_rgb produce la salida a partir de (LUT[Y], U, V) recalculando U y V
+// en cada píxel, así que nunca se guardan los planos YUV de la imagen
+void histogram_yuv_y_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n)
+{
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+
+    memset(hist_out, 0, 256 * sizeof(int64_t));
+
+    // Cada hilo acumula en su copia privada del histograma y se suman al final
+    parallel_histogram_blocks(LOOP_YUV_HIST, hist_out, n, PIXEL_BLOCK, [&](int64_t * hist, size_t i, size_t len) {
+        unsigned char y[PIXEL_BLOCK];
+        rgb2yuv_luma_view(view_offset(img_in, i), y, len, fixed);
+        histogram_banked(hist, y, len);
+    });
+}
+
+void histogram_yuv_y(int64_t * hist_out, PPM_IMG img_in)
+{
+    histogram_yuv_y_pixels(hist_out, planar_view(img_in.img_r, img_in.img_g, img_in.img_b), (size_t)img_in.w * img_in.h);
+}
+
+void yuv_equalize_blocks(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n, int fixed)
+{
+    parallel_blocks(LOOP_YUV_EQUALIZE, n, PIXEL_BLOCK, [&](size_t i, size_t len) {
+        yuv_equalize_view(lut, view_offset(img_in, i), view_offset(img_out, i), len, fixed);
+    });
+}
+
+long yuv_equalize_count(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    unsigned char * ref = NULL;
+    long diffs = 0;
+
+    // En C_YUV_VERIFY se compara la salida con la del motor en double usando la misma LUT.
+    // La referencia se calcula antes porque img_out puede ser la propia img_in (en el sitio)
+    if (yuv_mode() == YUV_VERIFY) {
+        ref = (unsigned char *)pool_alloc(3 * n * sizeof(unsigned char));
+        yuv_equalize_blocks(lut, img_in, packed_view(ref), n, 0);
+    }
+
+    yuv_equalize_blocks(lut, img_in, img_out, n, yuv_mode() != YUV_DOUBLE);
+
+    if (ref != NULL) {
+        diffs = count_view_diffs(img_out, packed_view(ref), n);
+        pool_free(ref);
+    }
+    return diffs;
+}
+
+void yuv_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    long diffs = yuv_equalize_count(lut, img_in, img_out, n);
 
-//Convert RGB to HSL, assume R,G,B in [0, 255]
-//Output H, S in [0.0, 1.0] and L in [0, 255]
-HSL_IMG rgb2hsl(PPM_IMG img_in)
-{
-    int i;
-    float H, S, L;
-    HSL_IMG img_out;// = (HSL_IMG *)malloc(sizeof(HSL_IMG));
-    img_out.width  = img_in.w;
-    img_out.height = img_in.h;
-    img_out.h = (float *)malloc(img_in.w * img_in.h * sizeof(float));
-    img_out.s = (float *)malloc(img_in.w * img_in.h * sizeof(float));
-    img_out.l = (unsigned char *)malloc(img_in.w * img_in.h * sizeof(unsigned char));
-    
-    // Inicia la paralelización del bucle for utilizando OpenMP. 
-    // 1. `private(H, S, L)`: Cada hilo tendrá sus propias copias de las variables H, S y L, evitando conflictos entre hilos.
-    // 2. `schedule(runtime)`: El esquema de distribución de las iteraciones se puede configurar en tiempo de ejecución 
-    //    mediante la variable de entorno OMP_SCHEDULE (por ejemplo, static, dynamic, etc.).
-    #pragma omp parallel for private(H, S, L) schedule(runtime)
-    for(i = 0; i < img_in.w*img_in.h; i ++){
-        
-        float var_r = ( (float)img_in.img_r[i]/255 );//Convertimos RGB a [0,1]
-        float var_g = ( (float)img_in.img_g[i]/255 );
-        float var_b = ( (float)img_in.img_b[i]/255 );
-        float var_min = (var_r < var_g) ? var_r : var_g;
-        var_min = (var_min < var_b) ? var_min : var_b;   //mínimo de RGB
-        float var_max = (var_r > var_g) ? var_r : var_g;
-        var_max = (var_max > var_b) ? var_max : var_b;   //máximo de RGB
-        float del_max = var_max - var_min;               //Valor Delta de RGB
-        
-        L = ( var_max + var_min ) / 2;
-        if ( del_max == 0 )
-        // Si no hay diferencia entre el máximo y mínimo, significa que el color es un gris puro.
-        {
-            H = 0;         
-            S = 0;    
+    if (yuv_mode() == YUV_VERIFY)
+        report_fixed_diffs("yuv equalization", diffs, n);
+}
+
+PPM_IMG yuv_equalize_rgb(PPM_IMG img_in, unsigned char * lut)
+{
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+
+    yuv_equalize_pixels(lut, planar_view(img_in.img_r, img_in.img_g, img_in.img_b),
+                        planar_view(result.img_r, result.img_g, result.img_b), (size_t)img_in.w * img_in.h);
+    return result;
+}
+
+// Etapas del pipeline de color, en el orden en que las recorre cada hilo
+enum PipelinePhase { PHASE_READ, PHASE_HISTOGRAM, PHASE_BARRIER, PHASE_HSL, PHASE_WRITE_HSL,
+                     PHASE_YUV, PHASE_WRITE_YUV, PIPELINE_PHASES };
+
+// Una sola región paralela para todo el color: cada hilo lee con pread su rango de filas
+// (así también es el primero en tocar esas páginas), calcula los histogramas de L e Y de su
+// rango y espera en la única barrera. Después cada hilo suma los histogramas de todos y
+// calcula su copia de las LUT, lo que evita una segunda barrera, y ecualiza y escribe con
+// pwrite su rango en HSL y luego en YUV. La entrada se guarda intercalada, como en el
+// fichero, y cada salida pasa por un buffer del rango del hilo, así que no se reservan
+// imágenes de salida completas.
+void contrast_enhancement_c_pipeline(const char * in_path, const char * hsl_path,
+                                     const char * yuv_path, PIPELINE_TIMES * times)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out_hsl = create_pnm_stream(hsl_path, in.w, in.h, 3);
+    PNM_STREAM out_yuv = create_pnm_stream(yuv_path, in.w, in.h, 3);
+    size_t n = (size_t)in.w * in.h;
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+    int verify = (yuv_mode() == YUV_VERIFY);
+    int max_threads = omp_get_max_threads();
+    long diffs = 0;
+
+    // Sin primer contacto: cada hilo escribe primero su propio rango al leerlo
+    unsigned char * img = (unsigned char *)pool_alloc(3 * n * sizeof(unsigned char));
+    // Histogramas de L y de Y de cada hilo (2 x 256 contadores por hilo)
+    int64_t * hist_threads = (int64_t *)pool_alloc((size_t)max_threads * 512 * sizeof(int64_t));
+    double * phase_time = (double *)pool_alloc((size_t)max_threads * PIPELINE_PHASES * sizeof(double));
+    // Si el runtime crea menos hilos, los que faltan no cuentan en los máximos
+    memset(phase_time, 0, (size_t)max_threads * PIPELINE_PHASES * sizeof(double));
+
+    #pragma omp parallel num_threads(max_threads)
+    {
+        int t = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        // Rango de filas del hilo, el mismo en todas las etapas
+        size_t first = (size_t)in.w * (size_t)((long)in.h * t / threads);
+        size_t len = (size_t)in.w * (size_t)((long)in.h * (t + 1) / threads) - first;
+        RGB_VIEW view = packed_view(img + 3 * first);
+        int64_t * hist_l = hist_threads + (size_t)t * 512;
+        int64_t * hist_y = hist_l + 256;
+        int64_t hist[256];
+        unsigned char lut_l[256], lut_y[256];
+        double * phase = phase_time + (size_t)t * PIPELINE_PHASES;
+        double tprev = omp_get_wtime(), tnow;
+        size_t i;
+        int b, k;
+
+        read_pnm_pixels(in, first, len, img + 3 * first);
+        tnow = omp_get_wtime(); phase[PHASE_READ] = tnow - tprev; tprev = tnow;
+
+        // Histogramas de L y de Y recorriendo el rango una sola vez
+        memset(hist_l, 0, 512 * sizeof(int64_t));
+        for (i = 0; i < len; i += PIXEL_BLOCK) {
+            unsigned char c[PIXEL_BLOCK];
+            size_t blen = (len - i < PIXEL_BLOCK) ? len - i : PIXEL_BLOCK;
+            rgb2hsl_lightness_view(view_offset(view, i), c, blen);
+            histogram_banked(hist_l, c, blen);
+            rgb2yuv_luma_view(view_offset(view, i), c, blen, fixed);
+            histogram_banked(hist_y, c, blen);
         }
-        else  
-        // Si hay diferencia, calculamos Saturación (S) y Tono (H).                                    //Chromatic data...
-        {
-            if ( L < 0.5 )
-                S = del_max/(var_max+var_min);
-            else
-                S = del_max/(2-var_max-var_min );
-
-            // Calculamos las diferencias relativas de cada componente RGB.
-            float del_r = (((var_max-var_r)/6)+(del_max/2))/del_max;
-            float del_g = (((var_max-var_g)/6)+(del_max/2))/del_max;
-            float del_b = (((var_max-var_b)/6)+(del_max/2))/del_max;
-            if( var_r == var_max ){
-                H = del_b - del_g;
-            }
-            else{       
-                if( var_g == var_max ){
-                    H = (1.0/3.0) + del_r - del_b;
+        tnow = omp_get_wtime(); phase[PHASE_HISTOGRAM] = tnow - tprev; tprev = tnow;
+
+        #pragma omp barrier
+        tnow = omp_get_wtime(); phase[PHASE_BARRIER] = tnow - tprev; tprev = tnow;
+
+        // Cada hilo suma los histogramas de todos en el mismo orden, así que todas las
+        // copias de las LUT son iguales
+        for (b = 0; b < 256; b++) {
+            hist[b] = 0;
+            for (k = 0; k < threads; k++)
+                hist[b] += hist_threads[(size_t)k * 512 + b];
+        }
+        histogram_lut(lut_l, hist, n, 256);
+        for (b = 0; b < 256; b++) {
+            hist[b] = 0;
+            for (k = 0; k < threads; k++)
+                hist[b] += hist_threads[(size_t)k * 512 + 256 + b];
+        }
+        histogram_lut(lut_y, hist, n, 256);
+
+        unsigned char * out = (unsigned char *)pool_alloc(3 * len * sizeof(unsigned char));
+        hsl_equalize_view(lut_l, view, packed_view(out), len);
+        tnow = omp_get_wtime(); phase[PHASE_HSL] = tnow - tprev; tprev = tnow;
+
+        write_pnm_pixels(out_hsl, first, len, out);
+        tnow = omp_get_wtime(); phase[PHASE_WRITE_HSL] = tnow - tprev; tprev = tnow;
+
+        yuv_equalize_view(lut_y, view, packed_view(out), len, fixed);
+        if (verify) {
+            // Referencia en double con la misma LUT sobre el rango del hilo
+            unsigned char * ref = (unsigned char *)pool_alloc(3 * len * sizeof(unsigned char));
+            yuv_equalize_view(lut_y, view, packed_view(ref), len, 0);
+            long d = count_view_diffs(packed_view(out), packed_view(ref), len);
+            #pragma omp atomic update
+            diffs += d;
+            pool_free(ref);
+        }
+        tnow = omp_get_wtime(); phase[PHASE_YUV] = tnow - tprev; tprev = tnow;
+
+        write_pnm_pixels(out_yuv, first, len, out);
+        tnow = omp_get_wtime(); phase[PHASE_WRITE_YUV] = tnow - tprev;
+
+        pool_free(out);
+    }
+
+    double slowest[PIPELINE_PHASES] = {0};
+    for (int k = 0; k < max_threads; k++) {
+        for (int p = 0; p < PIPELINE_PHASES; p++) {
+            if (phase_time[(size_t)k * PIPELINE_PHASES + p] > slowest[p])
+                slowest[p] = phase_time[(size_t)k * PIPELINE_PHASES + p];
+        }
+    }
+    times->read = slowest[PHASE_READ];
+    times->histogram = slowest[PHASE_HISTOGRAM];
+    times->barrier = slowest[PHASE_BARRIER];
+    times->hsl = slowest[PHASE_HSL];
+    times->write_hsl = slowest[PHASE_WRITE_HSL];
+    times->yuv = slowest[PHASE_YUV];
+    times->write_yuv = slowest[PHASE_WRITE_YUV];
+
+    if (verify)
+        report_fixed_diffs("yuv equalization", diffs, n);
+
+    close_pnm_stream(in);
+    close_pnm_stream(out_hsl);
+    close_pnm_stream(out_yuv);
+    pool_free(phase_time);
+    pool_free(hist_threads);
+    pool_free(img);
+}
+
+// Trozos por hilo en cada etapa del grafo de tareas: más de uno para que las tareas de
+// una cadena rellenen los huecos que dejan las partes serie de la otra
+#define TASKS_PER_THREAD 4
+
+// Histograma del canal L (chain == 0) o Y (chain == 1) de n píxeles
+static void chain_histogram(int chain, int64_t * hist, RGB_VIEW img, size_t n, int fixed)
+{
+    memset(hist, 0, 256 * sizeof(int64_t));
+    for (size_t i = 0; i < n; i += PIXEL_BLOCK) {
+        unsigned char c[PIXEL_BLOCK];
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        if (chain == 0)
+            rgb2hsl_lightness_view(view_offset(img, i), c, len);
+        else
+            rgb2yuv_luma_view(view_offset(img, i), c, len, fixed);
+        histogram_banked(hist, c, len);
+    }
+}
+
+// Cada cadena c (0 = HSL, 1 = YUV) es: K tareas de histograma, una de LUT que las espera
+// todas, K de ecualización que esperan a la LUT y una de escritura que las espera todas.
+// Las dependencias se expresan sobre arrays centinela (un elemento por trozo), así que
+// las dos cadenas solo se ordenan entre sí en el modo en el sitio
+void contrast_enhancement_c_tasks(PPM_IMG * planar, PPM_PACKED_IMG * packed, int inplace,
+                                  const char * hsl_path, const char * yuv_path, TASK_GRAPH_TIMES * times)
+{
+    int w = packed ? packed->w : planar->w;
+    int h = packed ? packed->h : planar->h;
+    size_t n = (size_t)w * h;
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+    int verify = (yuv_mode() == YUV_VERIFY);
+    long diffs = 0;
+    RGB_VIEW in, out[2];
+    PPM_IMG out_planar[2];
+    PPM_PACKED_IMG out_packed[2];
+
+    // Trozos múltiplos de PIXEL_BLOCK
+    size_t chunk = n / ((size_t)TASKS_PER_THREAD * omp_get_max_threads());
+    chunk = (chunk / PIXEL_BLOCK + 1) * PIXEL_BLOCK;
+    int K = (int)((n + chunk - 1) / chunk);
+    if (K < 1)
+        K = 1;
+
+    if (packed) {
+        in = packed_view(packed->img);
+        for (int c = 0; c < 2; c++) {
+            out_packed[c] = *packed;
+            if (c == 0 || !inplace)
+                out_packed[c].img = (unsigned char *)alloc_pixels(n, 3 * sizeof(unsigned char));
+            out[c] = packed_view(out_packed[c].img);
+        }
+    } else {
+        in = planar_view(planar->img_r, planar->img_g, planar->img_b);
+        for (int c = 0; c < 2; c++) {
+            out_planar[c] = (c == 0 || !inplace) ? alloc_ppm(w, h) : *planar;
+            out[c] = planar_view(out_planar[c].img_r, out_planar[c].img_g, out_planar[c].img_b);
+        }
+    }
+
+    int64_t * hist_parts = (int64_t *)pool_alloc(2 * (size_t)K * 256 * sizeof(int64_t));
+    unsigned char lut[2][256];
+    // Centinelas de dependencia: histograma y ecualización de cada trozo de cada cadena
+    char * hist_done = (char *)pool_alloc(2 * (size_t)K);
+    char * eq_done = (char *)pool_alloc(2 * (size_t)K);
+    // En el sitio, la ecualización YUV de un trozo espera a la HSL del mismo trozo, que es
+    // la última en leerlo. Si no, apunta a un array que ninguna tarea escribe y no ordena nada
+    char * unused_guard = (char *)pool_alloc((size_t)K);
+    char * yuv_guard = inplace ? eq_done : unused_guard;
+    // Duración de cada tarea: histogramas y ecualizaciones por trozo, LUT y escritura por cadena
+    double * d_hist = (double *)pool_alloc(2 * (size_t)K * sizeof(double));
+    double * d_eq = (double *)pool_alloc(2 * (size_t)K * sizeof(double));
+    double d_lut[2], d_write[2], end_eq[2] = {0, 0};
+    double t0 = omp_get_wtime(), t_end;
+
+    #pragma omp parallel
+    #pragma omp single
+    {
+        for (int c = 0; c < 2; c++) {
+            double * c_d_hist = d_hist + (size_t)c * K;
+            double * c_d_eq = d_eq + (size_t)c * K;
+            int64_t * c_parts = hist_parts + (size_t)c * K * 256;
+
+            for (int k = 0; k < K; k++) {
+                #pragma omp task firstprivate(c, k) depend(out: hist_done[c * K + k])
+                {
+                    double ts = omp_get_wtime();
+                    size_t first = (size_t)k * chunk;
+                    size_t len = (n - first < chunk) ? n - first : chunk;
+                    chain_histogram(c, c_parts + (size_t)k * 256, view_offset(in, first), len, fixed);
+                    c_d_hist[k] = omp_get_wtime() - ts;
                 }
-                else{
-                        H = (2.0/3.0) + del_g - del_r;
-                }   
             }
-            
-        }
-        
-        // Ajustamos el rango de H para que esté en [0,1].
 
-        if ( H < 0 )
-            H += 1;
-        if ( H > 1 )
-            H -= 1;
+            #pragma omp task firstprivate(c) depend(iterator(k = 0:K), in: hist_done[c * K + k]) depend(out: lut[c])
+            {
+                double ts = omp_get_wtime();
+                int64_t hist[256];
+                for (int b = 0; b < 256; b++) {
+                    hist[b] = 0;
+                    for (int k = 0; k < K; k++)
+                        hist[b] += c_parts[(size_t)k * 256 + b];
+                }
+                histogram_lut(lut[c], hist, n, 256);
+                d_lut[c] = omp_get_wtime() - ts;
+            }
 
-        // Asignamos los valores calculados a la estructura de salida.
+            for (int k = 0; k < K; k++) {
+                #pragma omp task firstprivate(c, k) depend(in: lut[c]) \
+                                 depend(in: (c == 1 ? yuv_guard : unused_guard)[k]) depend(out: eq_done[c * K + k])
+                {
+                    double ts = omp_get_wtime();
+                    size_t first = (size_t)k * chunk;
+                    size_t len = (n - first < chunk) ? n - first : chunk;
+                    if (c == 0) {
+                        hsl_equalize_view(lut[0], view_offset(in, first), view_offset(out[0], first), len);
+                    } else if (verify) {
+                        // La referencia en double se calcula antes porque la salida puede ser la entrada
+                        unsigned char * ref = (unsigned char *)pool_alloc(3 * len * sizeof(unsigned char));
+                        yuv_equalize_view(lut[1], view_offset(in, first), packed_view(ref), len, 0);
+                        yuv_equalize_view(lut[1], view_offset(in, first), view_offset(out[1], first), len, fixed);
+                        long d = count_view_diffs(view_offset(out[1], first), packed_view(ref), len);
+                        #pragma omp atomic update
+                        diffs += d;
+                        pool_free(ref);
+                    } else {
+                        yuv_equalize_view(lut[1], view_offset(in, first), view_offset(out[1], first), len, fixed);
+                    }
+                    double te = omp_get_wtime();
+                    c_d_eq[k] = te - ts;
+                    #pragma omp critical
+                    if (te - t0 > end_eq[c])
+                        end_eq[c] = te - t0;
+                }
+            }
 
-        img_out.h[i] = H;
-        img_out.s[i] = S;
-        img_out.l[i] = (unsigned char)(L*255);
+            #pragma omp task firstprivate(c) depend(iterator(k = 0:K), in: eq_done[c * K + k])
+            {
+                double ts = omp_get_wtime();
+                const char * path = (c == 0) ? hsl_path : yuv_path;
+                if (packed)
+                    write_ppm_packed(out_packed[c], path);
+                else
+                    write_ppm(out_planar[c], path);
+                d_write[c] = omp_get_wtime() - ts;
+            }
+        }
     }
-    
-    return img_out;
-}
-
-float Hue_2_RGB( float v1, float v2, float vH )             //Function Hue_2_RGB
-{
-    if ( vH < 0 ) vH += 1;
-    if ( vH > 1 ) vH -= 1;
-    if ( ( 6 * vH ) < 1 ) return ( v1 + ( v2 - v1 ) * 6 * vH );
-    if ( ( 2 * vH ) < 1 ) return ( v2 );
-    if ( ( 3 * vH ) < 2 ) return ( v1 + ( v2 - v1 ) * ( ( 2.0f/3.0f ) - vH ) * 6 );
-    return ( v1 );
-}
-
-//Convert HSL to RGB, assume H, S in [0.0, 1.0] and L in [0, 255]
-//Output R,G,B in [0, 255]
-PPM_IMG hsl2rgb(HSL_IMG img_in)
-{
-    int i;
-    PPM_IMG result;
-    
-    result.w = img_in.width;
-    result.h = img_in.height;
-    result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    
-
-    // Este pragma paraleliza el bucle for con OpenMP. Cada iteración es independiente,
-    // por lo que se puede ejecutar en paralelo para mejorar el rendimiento.
-    // `schedule(runtime)` permite ajustar dinámicamente cómo se distribuyen las iteraciones.
-    #pragma omp parallel for schedule(runtime)
-    for(i = 0; i < img_in.width*img_in.height; i ++){
-        float H = img_in.h[i];
-        float S = img_in.s[i];
-        float L = img_in.l[i]/255.0f;
-        float var_1, var_2;
-        
-        unsigned char r,g,b;
-        
-        if ( S == 0 )
-        {
-            // Si la saturación es 0, el color es un gris puro.
-            // En este caso, todos los canales RGB tienen el mismo valor que L.
-            r = L * 255;
-            g = L * 255;
-            b = L * 255;
+    t_end = omp_get_wtime();
+
+    // Camino crítico: fin más temprano de cada tarea si el grafo tuviera hilos ilimitados
+    double finish_lut[2], finish_write[2];
+    double * finish_eq = (double *)pool_alloc(2 * (size_t)K * sizeof(double));
+    times->work = 0;
+    for (int c = 0; c < 2; c++) {
+        double last = 0;
+        for (int k = 0; k < K; k++) {
+            if (d_hist[(size_t)c * K + k] > last)
+                last = d_hist[(size_t)c * K + k];
+            times->work += d_hist[(size_t)c * K + k] + d_eq[(size_t)c * K + k];
         }
-        else
-        {
-            
-            if ( L < 0.5 )
-                var_2 = L * ( 1 + S );
-            else
-                var_2 = ( L + S ) - ( S * L );
-
-            // Convertimos el tono (H) y las variables intermedias a valores RGB usando Hue_2_RGB.
-            // `Hue_2_RGB` es una función auxiliar que calcula los valores RGB
-            // a partir de las variables `var_1`, `var_2` y el tono modificado.
-            var_1 = 2 * L - var_2;
-            r = 255 * Hue_2_RGB( var_1, var_2, H + (1.0f/3.0f) );
-            g = 255 * Hue_2_RGB( var_1, var_2, H );
-            b = 255 * Hue_2_RGB( var_1, var_2, H - (1.0f/3.0f) );
+        finish_lut[c] = last + d_lut[c];
+        times->work += d_lut[c] + d_write[c];
+    }
+    for (int c = 0; c < 2; c++) {
+        double last = 0;
+        for (int k = 0; k < K; k++) {
+            double ready = finish_lut[c];
+            if (c == 1 && inplace && finish_eq[k] > ready)
+                ready = finish_eq[k];
+            finish_eq[(size_t)c * K + k] = ready + d_eq[(size_t)c * K + k];
+            if (finish_eq[(size_t)c * K + k] > last)
+                last = finish_eq[(size_t)c * K + k];
         }
-        result.img_r[i] = r;
-        result.img_g[i] = g;
-        result.img_b[i] = b;
+        finish_write[c] = last + d_write[c];
+    }
+    times->critical_path = (finish_write[0] > finish_write[1]) ? finish_write[0] : finish_write[1];
+    times->wall = t_end - t0;
+    times->hsl = end_eq[0];
+    times->yuv = end_eq[1];
+    times->write_hsl = d_write[0];
+    times->write_yuv = d_write[1];
+    times->tasks = 2 * (2 * K + 2);
+    if (verify)
+        report_fixed_diffs("yuv equalization", diffs, n);
+
+    pool_free(finish_eq);
+    pool_free(d_eq);
+    pool_free(d_hist);
+    pool_free(unused_guard);
+    pool_free(eq_done);
+    pool_free(hist_done);
+    pool_free(hist_parts);
+    if (packed) {
+        free_ppm_packed(out_packed[0]);
+        if (!inplace)
+            free_ppm_packed(out_packed[1]);
+    } else {
+        free_ppm(out_planar[0]);
+        if (!inplace)
+            free_ppm(out_planar[1]);
     }
+}
 
-    return result;
+// Bytes por píxel de una tesela durante la ecualización: la entrada RGB y las dos salidas
+#define TILE_BYTES_PER_PIXEL 9
+
+// Histogramas de L (hist_l) y de Y (hist_y) de n píxeles, bloque a bloque: cada bloque
+// de entrada se carga una vez para los dos canales
+static void tile_histograms(int64_t * hist_l, int64_t * hist_y, RGB_VIEW img, size_t n, int fixed)
+{
+    for (size_t i = 0; i < n; i += PIXEL_BLOCK) {
+        unsigned char c[PIXEL_BLOCK];
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        rgb2hsl_lightness_view(view_offset(img, i), c, len);
+        histogram_banked(hist_l, c, len);
+        rgb2yuv_luma_view(view_offset(img, i), c, len, fixed);
+        histogram_banked(hist_y, c, len);
+    }
 }
 
-//Convert RGB to YUV, all components in [0, 255]
-YUV_IMG rgb2yuv(PPM_IMG img_in)
-{
-    YUV_IMG img_out;
-    int i;//, j;
-    unsigned char r, g, b;
-    unsigned char y, cb, cr;
-    
-    img_out.w = img_in.w;
-    img_out.h = img_in.h;
-    img_out.img_y = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_u = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_v = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-
-
-    // Paralelizamos el bucle con OpenMP:
-    // - `private(r, g, b, y, cb, cr)`: Cada hilo tiene su propia copia de estas variables temporales,
-    //   evitando conflictos durante las operaciones.
-    // - `schedule(runtime)`: Permite configurar el esquema de planificación en tiempo de ejecución
-    //   (por ejemplo, estático o dinámico) mediante la variable OMP_SCHEDULE.
-    #pragma omp parallel for private(r, g, b, y, cb, cr) schedule(runtime)
-    for(i = 0; i < img_out.w*img_out.h; i ++){
-        // Leemos los valores RGB del píxel actual.
-        r = img_in.img_r[i];
-        g = img_in.img_g[i];
-        b = img_in.img_b[i];
-        
-        // Convertimos de RGB a YUV utilizando las fórmulas estándar.
-        // Y: Luminancia (representa el brillo del píxel)
-        y  = (unsigned char)( 0.299*r + 0.587*g +  0.114*b);
-        // U (Cb): Componente de crominancia azul
-        cb = (unsigned char)(-0.169*r - 0.331*g +  0.499*b + 128);
-        // V (Cr): Componente de crominancia roja.
-        cr = (unsigned char)( 0.499*r - 0.418*g - 0.0813*b + 128);
-        
-        img_out.img_y[i] = y;
-        img_out.img_u[i] = cb;
-        img_out.img_v[i] = cr;
+// Ejecutor por teselas: la imagen se divide en teselas de filas que ocupan la mitad de L2
+// (tile_rows) y cada hilo toma teselas enteras. El primer recorrido calcula a la vez los
+// histogramas de L e Y; tras el histograma global, el segundo ecualiza cada tesela en HSL y
+// a continuación en YUV, mientras su entrada sigue en caché. Así la imagen de entrada se
+// lee de memoria dos veces en lugar de cuatro. yuv_out puede ser img_in (en el sitio):
+// HSL lee cada tesela antes de que YUV la sobrescriba
+static void tiled_pixels(RGB_VIEW img_in, RGB_VIEW hsl_out, RGB_VIEW yuv_out, int w, int h, TILED_TIMES * times)
+{
+    int rows = tile_rows(w, TILE_BYTES_PER_PIXEL);
+    int tiles = (h + rows - 1) / rows;
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+    int verify = (yuv_mode() == YUV_VERIFY);
+    int64_t hist[512];              // L en las 256 primeras entradas e Y en las siguientes
+    unsigned char lut_l[256], lut_y[256];
+    double hsl_busy = 0, yuv_busy = 0;
+    long diffs = 0;
+    int t;
+
+    double tstart = omp_get_wtime();
+    memset(hist, 0, sizeof(hist));
+    #pragma omp parallel for reduction(+:hist[:512]) schedule(runtime)
+    for (t = 0; t < tiles; t++) {
+        size_t first = (size_t)t * rows * w;
+        size_t len = (size_t)w * ((h - t * rows < rows) ? h - t * rows : rows);
+        tile_histograms(hist, hist + 256, view_offset(img_in, first), len, fixed);
     }
-    
-    return img_out;
-}
-
-unsigned char clip_rgb(int x)
-{
-    if(x > 255)
-        return 255;
-    if(x < 0)
-        return 0;
-
-    return (unsigned char)x;
-}
-
-//Convert YUV to RGB, all components in [0, 255]
-PPM_IMG yuv2rgb(YUV_IMG img_in)
-{
-    PPM_IMG img_out;
-    int i;
-    int  rt,gt,bt;
-    int y, cb, cr;
-    
-    
-    img_out.w = img_in.w;
-    img_out.h = img_in.h;
-    img_out.img_r = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_g = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_b = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-
-    // Paralelizamos el bucle con OpenMP:
-    // - `private(y, cb, cr, rt, gt, bt)`: Cada hilo tiene su propia copia de estas variables temporales.
-    // - `schedule(runtime)`: Permite configurar el esquema de planificación en tiempo de ejecución.
-    #pragma omp parallel for private(y, cb, cr, rt, gt, bt) schedule(runtime)
-    for(i = 0; i < img_out.w*img_out.h; i ++){
-        // Leemos los valores Y, U (Cb) y V (Cr) del píxel actual.
-        y  = (int)img_in.img_y[i];
-        cb = (int)img_in.img_u[i] - 128;
-        cr = (int)img_in.img_v[i] - 128;
-        
-        // Convertimos de YUV a RGB utilizando las fórmulas estándar.
-        rt  = (int)( y + 1.402*cr);
-        gt  = (int)( y - 0.344*cb - 0.714*cr);
-        bt  = (int)( y + 1.772*cb);
-
-        // Limitamos los valores RGB al rango válido [0, 255] usando `clip_rgb`.
-        img_out.img_r[i] = clip_rgb(rt);
-        img_out.img_g[i] = clip_rgb(gt);
-        img_out.img_b[i] = clip_rgb(bt);
+    histogram_lut(lut_l, hist, (size_t)w * h, 256);
+    histogram_lut(lut_y, hist + 256, (size_t)w * h, 256);
+    double tmid = omp_get_wtime();
+
+    #pragma omp parallel for reduction(+:hsl_busy, yuv_busy, diffs) schedule(runtime)
+    for (t = 0; t < tiles; t++) {
+        size_t first = (size_t)t * rows * w;
+        size_t len = (size_t)w * ((h - t * rows < rows) ? h - t * rows : rows);
+        unsigned char * ref = NULL;
+        double t0 = omp_get_wtime();
+        hsl_equalize_view(lut_l, view_offset(img_in, first), view_offset(hsl_out, first), len);
+        double t1 = omp_get_wtime();
+        if (verify) {
+            // Referencia en double antes de que la salida pueda sobrescribir la entrada
+            ref = (unsigned char *)pool_alloc(3 * len * sizeof(unsigned char));
+            yuv_equalize_view(lut_y, view_offset(img_in, first), packed_view(ref), len, 0);
+        }
+        yuv_equalize_view(lut_y, view_offset(img_in, first), view_offset(yuv_out, first), len, fixed);
+        if (verify) {
+            diffs += count_view_diffs(view_offset(yuv_out, first), packed_view(ref), len);
+            pool_free(ref);
+        }
+        hsl_busy += t1 - t0;
+        yuv_busy += omp_get_wtime() - t1;
     }
-    
-    return img_out;
+    double tend = omp_get_wtime();
+
+    if (verify)
+        report_fixed_diffs("yuv equalization", diffs, (size_t)w * h);
+
+    // El segundo recorrido hace HSL y YUV juntos: su tiempo se reparte según lo que cada
+    // motor ocupó a los hilos
+    double share = (hsl_busy + yuv_busy > 0) ? hsl_busy / (hsl_busy + yuv_busy) : 0.5;
+    times->tile_rows = rows;
+    times->histogram = tmid - tstart;
+    times->hsl = (tend - tmid) * share;
+    times->yuv = (tend - tmid) - times->hsl;
+}
+
+void contrast_enhancement_c_tiled(PPM_IMG img_in, PPM_IMG hsl_out, PPM_IMG yuv_out, TILED_TIMES * times)
+{
+    tiled_pixels(planar_view(img_in.img_r, img_in.img_g, img_in.img_b),
+                 planar_view(hsl_out.img_r, hsl_out.img_g, hsl_out.img_b),
+                 planar_view(yuv_out.img_r, yuv_out.img_g, yuv_out.img_b), img_in.w, img_in.h, times);
+}
+
+void contrast_enhancement_c_tiled_packed(PPM_PACKED_IMG img_in, PPM_PACKED_IMG hsl_out,
+                                         PPM_PACKED_IMG yuv_out, TILED_TIMES * times)
+{
+    tiled_pixels(packed_view(img_in.img), packed_view(hsl_out.img), packed_view(yuv_out.img),
+                 img_in.w, img_in.h, times);
 }
@@ -1,9 +1,22 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include "hist-equ.h"
+#include "pixel-kernels.h"
+#include "pnm-header.h"
+#include "work-stealing.h"
 #include <mpi.h>
 #include <omp.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <string>
 
 
 typedef struct {
@@ -16,19 +29,81 @@ typedef struct {
     double time_yuv;
     double time_write_hsl;
     double time_write_yuv;
+    double time_write_overlapped; // E/S solapada con el cálculo (modo write-behind)
+    double time_write_exposed;    // E/S que el hilo principal tuvo que esperar
 } timeColor;
 
-timeColor run_cpu_color_test(PPM_IMG img_in);
-timeGray run_cpu_gray_test(PGM_IMG img_in);
+timeColor run_cpu_color_test(PPM_IMG img_in, int inplace, int tasks, int tiled, int async_write);
+timeColor run_cpu_color_test_packed(PPM_PACKED_IMG img_in, int inplace, int tasks, int tiled, int async_write);
+timeGray run_cpu_gray_test(PGM_IMG img_in, int inplace);
+timeColor run_cpu_color_test_stream(size_t mem_budget);
+timeColor run_cpu_color_test_pipeline(double * time_read);
+timeColor run_cpu_color_test_tasks(PPM_IMG * planar, PPM_PACKED_IMG * packed, int inplace);
+timeColor run_cpu_color_test_tiled(PPM_IMG * planar, PPM_PACKED_IMG * packed, int inplace);
+timeGray run_cpu_gray_test_stream(size_t mem_budget);
 
 const char *obtain_schedule_string(omp_sched_t schedule_type);
+static void autotune_loop_schedules(size_t size);
+static int autotune_active();
+static PPM_IMG alloc_ppm_planes(int w, int h, int touch);
+static void read_ppm_numa(FILE * in_file, PPM_IMG img);
+static void numa_report_ppm(const char * name, PPM_IMG img);
 void save_data_csv(const char *planning, const char *process, const char *type, double time, double TotalTime);
 void get_custom_schedule(const char *schedule_str, const char* chunk_str, omp_sched_t *out_schedule_type, int *out_chunk_size);
 
+void async_writer_start(size_t capacity);
+double async_writer_submit(PPM_IMG img, const char * path, int keep);
+double async_writer_submit_packed(PPM_PACKED_IMG img, const char * path, int keep);
+double async_writer_finish();
+double async_writer_overlapped();
+double async_writer_exposed();
+
 
 int main(int argc, char *argv[]){
     PGM_IMG img_ibuf_g;
     PPM_IMG img_ibuf_c;
+    PPM_PACKED_IMG img_packed_c;
+    MAPPED_IMG map_g;   // Proyección de in.pgm cuando se lee con mmap
+    MAPPED_IMG map_c;   // Proyección de in.ppm con C_PACKED y C_MMAP_READ
+
+    // C_MMAP_READ=1: leer las imágenes de entrada mediante mmap
+    const char *mmap_str = getenv("C_MMAP_READ");
+    int use_mmap = (mmap_str != NULL) ? atoi(mmap_str) : 0;
+
+    // C_STREAM=1: procesar por bandas leídas del disco sin cargar la imagen completa,
+    // usando como máximo C_STREAM_MEM_MB megabytes para los buffers de cada banda
+    const char *stream_str = getenv("C_STREAM");
+    int use_stream = (stream_str != NULL) ? atoi(stream_str) : 0;
+    const char *budget_str = getenv("C_STREAM_MEM_MB");
+    size_t mem_budget = (size_t)((budget_str != NULL) ? atoi(budget_str) : 256) << 20;
+
+    // C_PACKED=1: procesar la imagen en color con los canales intercalados, sin separarlos
+    // al leer ni volver a intercalarlos al escribir
+    const char *packed_str = getenv("C_PACKED");
+    int use_packed = (packed_str != NULL) ? atoi(packed_str) : 0;
+
+    // C_INPLACE=1: ecualizar sobre la propia imagen de entrada, sin reservar imagen de
+    // salida (la ecualización YUV de color, que es la última en leer la entrada)
+    const char *inplace_str = getenv("C_INPLACE");
+    int use_inplace = (inplace_str != NULL) ? atoi(inplace_str) : 0;
+
+    // C_PIPELINE=1: procesar la imagen en color (lectura, HSL, YUV y escritura) dentro de
+    // una sola región paralela en la que cada hilo conserva su rango de filas
+    const char *pipeline_str = getenv("C_PIPELINE");
+    int use_pipeline = (pipeline_str != NULL) ? atoi(pipeline_str) : 0;
+
+    // C_TASKS=1: HSL y YUV de la imagen en color como dos cadenas de tareas concurrentes
+    const char *tasks_str = getenv("C_TASKS");
+    int use_tasks = (tasks_str != NULL) ? atoi(tasks_str) : 0;
+
+    // C_TILED=1: HSL y YUV seguidos sobre cada tesela de filas del tamaño de L2
+    const char *tiled_str = getenv("C_TILED");
+    int use_tiled = (tiled_str != NULL) ? atoi(tiled_str) : 0;
+
+    // C_ASYNC_WRITE=1: las imágenes en color se escriben en un hilo de E/S mientras se
+    // calcula la siguiente
+    const char *async_str = getenv("C_ASYNC_WRITE");
+    int use_async_write = (async_str != NULL) ? atoi(async_str) : 0;
 
     // Inicializar MPI para medir el tiempo total y otros aspectos paralelos
     MPI_Init(&argc, &argv);
@@ -40,34 +115,88 @@ int main(int argc, char *argv[]){
     int cores = omp_get_num_procs();
     printf("Number of cores: %d\n", cores);
 
-    // Procesar imágenes en escala de grises
-    printf("Running contrast enhancement for gray-scale images.\n");
-    double tstart_read_pgm = MPI_Wtime(); // Tiempo de inicio de lectura PGM
-    img_ibuf_g = read_pgm("in.pgm"); // Leer archivo PGM
-    double tend_read_pgm = MPI_Wtime(); // Tiempo al finalizar lectura
-
-    // Ejecutar la mejora de contraste en imágenes en escala de grises
-    timeGray t_gray = run_cpu_gray_test(img_ibuf_g);
+    double tstart_read_pgm, tend_read_pgm, tstart_read_ppm, tend_read_ppm;
+    timeGray t_gray;
+    timeColor time_c;
 
-    // Liberar memoria de la imagen en escala de grises
-    free_pgm(img_ibuf_g);
-    
-    // Procesar imágenes a color
-    printf("Running contrast enhancement for color images.\n");
-    double tstart_read_ppm = MPI_Wtime(); // Tiempo de inicio de lectura PPM
-    img_ibuf_c = read_ppm("in.ppm"); // Leer archivo PPM
-    double tend_read_ppm = MPI_Wtime(); // Tiempo al finalizar lectura
+    if (use_stream) {
+        // La lectura se hace banda a banda dentro del procesamiento
+        printf("Running contrast enhancement for gray-scale images.\n");
+        tstart_read_pgm = tend_read_pgm = MPI_Wtime();
+        t_gray = run_cpu_gray_test_stream(mem_budget);
 
-    // Ejecutar la mejora de contraste en imágenes a color
-    timeColor time_c = run_cpu_color_test(img_ibuf_c);
+        printf("Running contrast enhancement for color images.\n");
+        tstart_read_ppm = tend_read_ppm = MPI_Wtime();
+        time_c = run_cpu_color_test_stream(mem_budget);
+    } else {
+        // Procesar imágenes en escala de grises
+        printf("Running contrast enhancement for gray-scale images.\n");
+        tstart_read_pgm = MPI_Wtime(); // Tiempo de inicio de lectura PGM
+        if (use_mmap) {
+            map_g = map_pnm("in.pgm");
+            img_ibuf_g = pgm_view(map_g); // Sin copia
+        } else {
+            img_ibuf_g = read_pgm("in.pgm"); // Leer archivo PGM
+        }
+        tend_read_pgm = MPI_Wtime(); // Tiempo al finalizar lectura
+
+        // Ejecutar la mejora de contraste en imágenes en escala de grises
+        t_gray = run_cpu_gray_test(img_ibuf_g, use_inplace);
+
+        // Liberar memoria de la imagen en escala de grises
+        if (use_mmap) {
+            unmap_pnm(map_g);
+        } else {
+            free_pgm(img_ibuf_g);
+        }
+
+        // Procesar imágenes a color
+        printf("Running contrast enhancement for color images.\n");
+        if (use_pipeline) {
+            // La lectura se hace dentro del pipeline, repartida entre los hilos
+            double time_read;
+            time_c = run_cpu_color_test_pipeline(&time_read);
+            tstart_read_ppm = 0;
+            tend_read_ppm = time_read;
+        } else if (use_packed) {
+            tstart_read_ppm = MPI_Wtime(); // Tiempo de inicio de lectura PPM
+            if (use_mmap) {
+                map_c = map_pnm("in.ppm");
+                img_packed_c = ppm_packed_view(map_c); // Sin copia
+            } else {
+                img_packed_c = read_ppm_packed("in.ppm");
+            }
+            tend_read_ppm = MPI_Wtime(); // Tiempo al finalizar lectura
+
+            time_c = run_cpu_color_test_packed(img_packed_c, use_inplace, use_tasks, use_tiled, use_async_write);
+
+            if (use_mmap) {
+                unmap_pnm(map_c);
+            } else {
+                free_ppm_packed(img_packed_c);
+            }
+        } else {
+            tstart_read_ppm = MPI_Wtime(); // Tiempo de inicio de lectura PPM
+            img_ibuf_c = use_mmap ? read_ppm_mmap("in.ppm") : read_ppm("in.ppm"); // Leer archivo PPM
+            tend_read_ppm = MPI_Wtime(); // Tiempo al finalizar lectura
+
+            // Ejecutar la mejora de contraste en imágenes a color
+            time_c = run_cpu_color_test(img_ibuf_c, use_inplace, use_tasks, use_tiled, use_async_write);
+
+            // Liberar memoria de la imagen a color
+            free_ppm(img_ibuf_c);
+        }
+    }
 
-    // Liberar memoria de la imagen a color
-    free_ppm(img_ibuf_c);
-    
     // Tomar el tiempo al finalizar todo el proceso
     double tfinish = MPI_Wtime();
     double TotalTime = tfinish - tstart;
     printf("Total time: %f\n", TotalTime);
+    printf("Kernel ISA: %s\n", isa_name());
+    pool_report(stdout);
+    if (steal_backend())
+        ws_report();
+    pool_trim();
 
     // Finalizar MPI
     MPI_Finalize();
@@ -82,6 +211,10 @@ int main(int argc, char *argv[]){
     save_data_csv("OpenMP", "color", "write-HSL", time_c.time_write_hsl, TotalTime);
     save_data_csv("OpenMP", "color", "YUV", time_c.time_yuv, TotalTime);
     save_data_csv("OpenMP", "color", "write-YUV", time_c.time_write_yuv, TotalTime);
+    if (use_async_write) {
+        save_data_csv("OpenMP", "color", "write-overlapped", time_c.time_write_overlapped, TotalTime);
+        save_data_csv("OpenMP", "color", "write-exposed", time_c.time_write_exposed, TotalTime);
+    }
 
     return 0;
 }
@@ -128,6 +261,14 @@ void save_data_csv(const char *planning, const char *process, const char *type,
     int chunk_size;
     omp_get_schedule(&schedule_type, &chunk_size);
     const char *schedule_name = obtain_schedule_string(schedule_type);
+    if (steal_backend()) {
+        schedule_name = "steal";
+        chunk_size = 0;
+    } else if (autotune_active()) {
+        // Cada bucle lleva su propia planificación, guardada en la caché de autoajuste
+        schedule_name = "autotune";
+        chunk_size = 0;
+    }
 
     // Crear la línea de datos y escribirla en el archivo
     sprintf(line, "%d,%s,%d,%f,%f\n", omp_get_max_threads(), schedule_name, chunk_size, time, TotalTime);
@@ -153,9 +294,20 @@ const char *obtain_schedule_string(omp_sched_t schedule_type) {
     }
 }
 
-timeColor run_cpu_color_test(PPM_IMG img_in) {
+timeColor run_cpu_color_test(PPM_IMG img_in, int inplace, int tasks, int tiled, int async_write) {
     PPM_IMG img_obuf_hsl, img_obuf_yuv;
     timeColor times;
+
+    if (tasks)
+        return run_cpu_color_test_tasks(&img_in, NULL, inplace);
+    if (tiled)
+        return run_cpu_color_test_tiled(&img_in, NULL, inplace);
+
+    // Las imágenes se escriben en un hilo de E/S mientras se calcula la siguiente
+    if (async_write) {
+        const char *queue_str = getenv("C_ASYNC_WRITE_QUEUE");
+        async_writer_start((queue_str != NULL) ? atoi(queue_str) : 2);
+    }
     
     printf("Starting CPU processing...\n");
     
@@ -165,35 +317,302 @@ timeColor run_cpu_color_test(PPM_IMG img_in) {
     double tfinish = MPI_Wtime();
     printf("HSL processing time: %f (s)\n", tfinish - tstart);
     times.time_hsl = tfinish - tstart;
+    if (numa_mode()) {
+        numa_report_ppm("in.ppm", img_in);
+        numa_report_ppm("out_hsl.ppm", img_obuf_hsl);
+    }
+
+    // Guardar imagen procesada en HSL
+    tstart = MPI_Wtime();
+    if (async_write) {
+        async_writer_submit(img_obuf_hsl, "out_hsl.ppm", 0);
+    } else {
+        write_ppm(img_obuf_hsl, "out_hsl.ppm");
+    }
+    tfinish = MPI_Wtime();
+    times.time_write_hsl = tfinish - tstart;
+
+    // Procesar imagen en espacio de color YUV
+    tstart = MPI_Wtime();
+    if (inplace) {
+        // La entrada ya no se vuelve a leer: el resultado YUV la sobrescribe
+        contrast_enhancement_c_yuv_inplace(img_in);
+        img_obuf_yuv = img_in;
+    } else {
+        img_obuf_yuv = contrast_enhancement_c_yuv(img_in);
+    }
+    tfinish = MPI_Wtime();
+    printf("YUV processing time: %f (s)\n", tfinish - tstart);
+    times.time_yuv = tfinish - tstart;
+    if (numa_mode() && !inplace)
+        numa_report_ppm("out_yuv.ppm", img_obuf_yuv);
+
+    // Guardar imagen procesada en YUV
+    tstart = MPI_Wtime();
+    if (async_write) {
+        // Se espera también a que se vacíe la cola: es E/S que ya no se puede solapar.
+        // El resultado en el sitio es la entrada, que la libera quien la leyó
+        async_writer_submit(img_obuf_yuv, "out_yuv.ppm", inplace);
+        async_writer_finish();
+    } else {
+        write_ppm(img_obuf_yuv, "out_yuv.ppm");
+    }
+    tfinish = MPI_Wtime();
+    times.time_write_yuv = tfinish - tstart;
+
+    if (async_write) {
+        times.time_write_overlapped = async_writer_overlapped();
+        times.time_write_exposed = async_writer_exposed();
+        printf("Write-behind I/O: overlapped %f (s), exposed %f (s)\n", times.time_write_overlapped, times.time_write_exposed);
+    } else {
+        // Liberar memoria de las imágenes procesadas (en modo asíncrono lo hace el hilo de E/S)
+        free_ppm(img_obuf_hsl);
+        if (!inplace)
+            free_ppm(img_obuf_yuv);
+        times.time_write_overlapped = 0;
+        times.time_write_exposed = times.time_write_hsl + times.time_write_yuv;
+    }
+
+    return times;
+}
+
+// Igual que run_cpu_color_test pero con la imagen intercalada de principio a fin
+timeColor run_cpu_color_test_packed(PPM_PACKED_IMG img_in, int inplace, int tasks, int tiled, int async_write) {
+    PPM_PACKED_IMG img_obuf_hsl, img_obuf_yuv;
+    timeColor times;
+
+    if (tasks)
+        return run_cpu_color_test_tasks(NULL, &img_in, inplace);
+    if (tiled)
+        return run_cpu_color_test_tiled(NULL, &img_in, inplace);
+
+    // Las imágenes se escriben en un hilo de E/S mientras se calcula la siguiente
+    if (async_write) {
+        const char *queue_str = getenv("C_ASYNC_WRITE_QUEUE");
+        async_writer_start((queue_str != NULL) ? atoi(queue_str) : 2);
+    }
+    
+    printf("Starting CPU processing...\n");
+    
+    // Procesar imagen en espacio de color HSL
+    double tstart = MPI_Wtime();
+    img_obuf_hsl = contrast_enhancement_c_hsl_packed(img_in);
+    double tfinish = MPI_Wtime();
+    printf("HSL processing time: %f (s)\n", tfinish - tstart);
+    times.time_hsl = tfinish - tstart;
+    if (numa_mode()) {
+        numa_report("in.ppm", img_in.img, 3 * (size_t)img_in.w * img_in.h);
+        numa_report("out_hsl.ppm", img_obuf_hsl.img, 3 * (size_t)img_obuf_hsl.w * img_obuf_hsl.h);
+    }
 
     // Guardar imagen procesada en HSL
     tstart = MPI_Wtime();
-    write_ppm(img_obuf_hsl, "out_hsl.ppm");
+    if (async_write) {
+        async_writer_submit_packed(img_obuf_hsl, "out_hsl.ppm", 0);
+    } else {
+        write_ppm_packed(img_obuf_hsl, "out_hsl.ppm");
+    }
     tfinish = MPI_Wtime();
     times.time_write_hsl = tfinish - tstart;
 
     // Procesar imagen en espacio de color YUV
     tstart = MPI_Wtime();
-    img_obuf_yuv = contrast_enhancement_c_yuv(img_in);
+    if (inplace) {
+        // La entrada ya no se vuelve a leer: el resultado YUV la sobrescribe
+        contrast_enhancement_c_yuv_packed_inplace(img_in);
+        img_obuf_yuv = img_in;
+    } else {
+        img_obuf_yuv = contrast_enhancement_c_yuv_packed(img_in);
+    }
     tfinish = MPI_Wtime();
     printf("YUV processing time: %f (s)\n", tfinish - tstart);
     times.time_yuv = tfinish - tstart;
+    if (numa_mode() && !inplace)
+        numa_report("out_yuv.ppm", img_obuf_yuv.img, 3 * (size_t)img_obuf_yuv.w * img_obuf_yuv.h);
 
     // Guardar imagen procesada en YUV
     tstart = MPI_Wtime();
-    write_ppm(img_obuf_yuv, "out_yuv.ppm");
+    if (async_write) {
+        // Se espera también a que se vacíe la cola: es E/S que ya no se puede solapar.
+        // El resultado en el sitio es la entrada, que la libera quien la leyó
+        async_writer_submit_packed(img_obuf_yuv, "out_yuv.ppm", inplace);
+        async_writer_finish();
+    } else {
+        write_ppm_packed(img_obuf_yuv, "out_yuv.ppm");
+    }
     tfinish = MPI_Wtime();
     times.time_write_yuv = tfinish - tstart;
 
-    // Liberar memoria de las imágenes procesadas
-    free_ppm(img_obuf_hsl);
-    free_ppm(img_obuf_yuv);
+    if (async_write) {
+        times.time_write_overlapped = async_writer_overlapped();
+        times.time_write_exposed = async_writer_exposed();
+        printf("Write-behind I/O: overlapped %f (s), exposed %f (s)\n", times.time_write_overlapped, times.time_write_exposed);
+    } else {
+        // Liberar memoria de las imágenes procesadas (en modo asíncrono lo hace el hilo de E/S)
+        free_ppm_packed(img_obuf_hsl);
+        if (!inplace)
+            free_ppm_packed(img_obuf_yuv);
+        times.time_write_overlapped = 0;
+        times.time_write_exposed = times.time_write_hsl + times.time_write_yuv;
+    }
+
+    return times;
+}
+
+
+// Modo streaming: lectura, proceso y escritura se hacen banda a banda,
+// por lo que todo el tiempo se contabiliza como tiempo de procesamiento
+timeColor run_cpu_color_test_stream(size_t mem_budget) {
+    timeColor times;
+
+    printf("Starting CPU processing...\n");
+
+    // Procesar imagen en espacio de color HSL
+    double tstart = MPI_Wtime();
+    contrast_enhancement_c_hsl_stream("in.ppm", "out_hsl.ppm", mem_budget);
+    double tfinish = MPI_Wtime();
+    printf("HSL processing time: %f (s)\n", tfinish - tstart);
+    times.time_hsl = tfinish - tstart;
+
+    // Procesar imagen en espacio de color YUV
+    tstart = MPI_Wtime();
+    contrast_enhancement_c_yuv_stream("in.ppm", "out_yuv.ppm", mem_budget);
+    tfinish = MPI_Wtime();
+    printf("YUV processing time: %f (s)\n", tfinish - tstart);
+    times.time_yuv = tfinish - tstart;
+
+    times.time_write_hsl = 0;
+    times.time_write_yuv = 0;
+    times.time_write_overlapped = 0;
+    times.time_write_exposed = 0;
+
+    return times;
+}
+
+// Modo pipeline: las dos salidas se escriben desde dentro de la región paralela, así que
+// el tiempo de escritura es el de la etapa más lenta entre los hilos
+timeColor run_cpu_color_test_pipeline(double * time_read) {
+    timeColor times;
+    PIPELINE_TIMES stages;
+
+    printf("Starting CPU processing...\n");
+
+    double tstart = MPI_Wtime();
+    contrast_enhancement_c_pipeline("in.ppm", "out_hsl.ppm", "out_yuv.ppm", &stages);
+    double tfinish = MPI_Wtime();
+    printf("Pipeline time: %f (s)\n", tfinish - tstart);
+    printf("Pipeline stages (slowest thread): read %f, histograms %f, barrier %f, HSL %f, write HSL %f, YUV %f, write YUV %f (s)\n",
+           stages.read, stages.histogram, stages.barrier, stages.hsl, stages.write_hsl, stages.yuv, stages.write_yuv);
+
+    // Los histogramas de L e Y se calculan juntos y se cuentan en HSL, la primera etapa
+    *time_read = stages.read;
+    times.time_hsl = stages.histogram + stages.barrier + stages.hsl;
+    times.time_yuv = stages.yuv;
+    times.time_write_hsl = stages.write_hsl;
+    times.time_write_yuv = stages.write_yuv;
+    times.time_write_overlapped = 0;
+    times.time_write_exposed = stages.write_hsl + stages.write_yuv;
+
+    return times;
+}
+
+// Modo grafo de tareas: las escrituras son tareas del grafo y se solapan con la otra
+// cadena, así que los tiempos de HSL y YUV se miden desde el inicio del grafo hasta que
+// termina su ecualización y no se suman entre sí
+timeColor run_cpu_color_test_tasks(PPM_IMG * planar, PPM_PACKED_IMG * packed, int inplace) {
+    timeColor times;
+    TASK_GRAPH_TIMES graph;
+
+    printf("Starting CPU processing...\n");
+
+    contrast_enhancement_c_tasks(planar, packed, inplace, "out_hsl.ppm", "out_yuv.ppm", &graph);
+    printf("HSL processing time: %f (s)\n", graph.hsl);
+    printf("YUV processing time: %f (s)\n", graph.yuv);
+    printf("Task graph: %d tasks, wall %f (s), critical path %f (s), work %f (s)\n",
+           graph.tasks, graph.wall, graph.critical_path, graph.work);
+
+    times.time_hsl = graph.hsl;
+    times.time_yuv = graph.yuv;
+    times.time_write_hsl = graph.write_hsl;
+    times.time_write_yuv = graph.write_yuv;
+    times.time_write_overlapped = 0;
+    times.time_write_exposed = graph.write_hsl + graph.write_yuv;
 
     return times;
 }
 
+// Modo por teselas: las dos salidas se calculan juntas y después se escriben. El segundo
+// recorrido se reparte entre HSL y YUV según lo que ocupó cada motor, y los histogramas
+// se cuentan en HSL. La escritura asíncrona no se aplica: no hay cálculo con el que solaparla
+timeColor run_cpu_color_test_tiled(PPM_IMG * planar, PPM_PACKED_IMG * packed, int inplace) {
+    timeColor times;
+    TILED_TIMES tiled;
+    PPM_IMG hsl_planar, yuv_planar;
+    PPM_PACKED_IMG hsl_packed, yuv_packed;
+
+    printf("Starting CPU processing...\n");
+
+    if (packed != NULL) {
+        hsl_packed.w = packed->w;
+        hsl_packed.h = packed->h;
+        hsl_packed.img = (unsigned char *)alloc_pixels((size_t)packed->w * packed->h, 3 * sizeof(unsigned char));
+        if (inplace) {
+            yuv_packed = *packed;
+        } else {
+            yuv_packed = hsl_packed;
+            yuv_packed.img = (unsigned char *)alloc_pixels((size_t)packed->w * packed->h, 3 * sizeof(unsigned char));
+        }
+        contrast_enhancement_c_tiled_packed(*packed, hsl_packed, yuv_packed, &tiled);
+    } else {
+        hsl_planar = alloc_ppm(planar->w, planar->h);
+        yuv_planar = inplace ? *planar : alloc_ppm(planar->w, planar->h);
+        contrast_enhancement_c_tiled(*planar, hsl_planar, yuv_planar, &tiled);
+    }
+
+    times.time_hsl = tiled.histogram + tiled.hsl;
+    times.time_yuv = tiled.yuv;
+    printf("HSL processing time: %f (s)\n", times.time_hsl);
+    printf("YUV processing time: %f (s)\n", times.time_yuv);
+    printf("Tiles: %d rows (%zu KB per tile, L2 %zu KB), histograms %f (s)\n",
+           tiled.tile_rows, tile_bytes() >> 10, l2_cache_size() >> 10, tiled.histogram);
+    if (numa_mode() && packed == NULL) {
+        numa_report_ppm("out_hsl.ppm", hsl_planar);
+        if (!inplace)
+            numa_report_ppm("out_yuv.ppm", yuv_planar);
+    }
+
+    double tstart = MPI_Wtime();
+    if (packed != NULL)
+        write_ppm_packed(hsl_packed, "out_hsl.ppm");
+    else
+        write_ppm(hsl_planar, "out_hsl.ppm");
+    double tfinish = MPI_Wtime();
+    times.time_write_hsl = tfinish - tstart;
+
+    tstart = MPI_Wtime();
+    if (packed != NULL)
+        write_ppm_packed(yuv_packed, "out_yuv.ppm");
+    else
+        write_ppm(yuv_planar, "out_yuv.ppm");
+    tfinish = MPI_Wtime();
+    times.time_write_yuv = tfinish - tstart;
+
+    if (packed != NULL) {
+        free_ppm_packed(hsl_packed);
+        if (!inplace)
+            free_ppm_packed(yuv_packed);
+    } else {
+        free_ppm(hsl_planar);
+        if (!inplace)
+            free_ppm(yuv_planar);
+    }
+    times.time_write_overlapped = 0;
+    times.time_write_exposed = times.time_write_hsl + times.time_write_yuv;
+
+    return times;
+}
 
-void set_schedule_openmp(int size) {
+void set_schedule_openmp(size_t size) {
     // Configurar la planificación de OpenMP basada en variables de entorno
     omp_sched_t schedule_type;
     int chunk_size;
@@ -234,24 +653,364 @@ void set_schedule_openmp(int size) {
 
     get_custom_schedule(schedule_str, chunk_str, &schedule_type, &chunk_size);
     omp_set_schedule(schedule_type, chunk_size);
+
+    // En modo NUMA los bucles de cálculo deben repartir los bloques igual que el primer
+    // contacto, así que se fuerza la planificación estática sin tamaño de bloque
+    if (numa_mode()) {
+        omp_set_schedule(omp_sched_static, 0);
+        printf("NUMA first-touch: static schedule\n");
+        if (omp_get_proc_bind() == omp_proc_bind_false)
+            printf("NUMA first-touch: threads are not bound, set OMP_PROC_BIND and OMP_PLACES\n");
+    }
+
+    // C_BACKEND=steal: los bucles por bloques van al pool de robo de trabajo, que no usa
+    // ninguna planificación
+    if (steal_backend()) {
+        ws_start(omp_get_max_threads());
+        printf("Backend: work stealing, %d threads\n", ws_threads());
+        return;
+    }
+
+    // C_OMP_AUTOTUNE=1: planificación propia para cada bucle, medida o leída de la caché
+    autotune_loop_schedules(size);
+}
+
+/*
+ * Autoajuste de la planificación por bucle. Cada bucle de TunedLoop se mide sobre una banda
+ * de muestra con cada planificación candidata y se queda con la más rápida. El resultado se
+ * guarda en una caché de la máquina con una línea por clave (modelo de CPU, hilos, nivel ISA
+ * y clase de tamaño, log2 de los píxeles de la imagen), así que las siguientes ejecuciones
+ * con la misma clave empiezan ya ajustadas. C_OMP_AUTOTUNE=2 vuelve a medir aunque la clave
+ * esté en la caché y C_OMP_TUNE_CACHE indica otro fichero.
+ */
+typedef struct{
+    omp_sched_t kind;
+    int chunk;
+} LOOP_SCHEDULE;
+
+static const char * TUNED_LOOP_NAMES[TUNED_LOOPS] = {
+    "hsl_hist", "hsl_equalize", "yuv_hist", "yuv_equalize",
+    "gray_hist", "apply_lut", "deinterleave", "interleave"
+};
+
+// El tamaño de bloque cuenta iteraciones, y cada iteración de los bucles ajustados es un
+// bloque de PIXEL_BLOCK píxeles (HIST_BLOCK en el histograma gris)
+static const LOOP_SCHEDULE TUNE_CANDIDATES[] = {
+    {omp_sched_static, 0}, {omp_sched_static, 1}, {omp_sched_static, 4}, {omp_sched_static, 16},
+    {omp_sched_dynamic, 1}, {omp_sched_dynamic, 4}, {omp_sched_dynamic, 16}, {omp_sched_dynamic, 64},
+    {omp_sched_guided, 1}, {omp_sched_guided, 4}, {omp_sched_guided, 16}
+};
+#define TUNE_CANDIDATE_COUNT (int)(sizeof(TUNE_CANDIDATES) / sizeof(TUNE_CANDIDATES[0]))
+// Píxeles máximos de la banda de muestra y medidas de cada candidata (se toma la mejor)
+#define TUNE_SAMPLE_PIXELS ((size_t)1 << 22)
+#define TUNE_REPS 3
+
+static int tuned_active = 0;
+static LOOP_SCHEDULE tuned[TUNED_LOOPS];
+
+static int autotune_active()
+{
+    return tuned_active;
+}
+
+void loop_schedule(int loop)
+{
+    if (tuned_active)
+        omp_set_schedule(tuned[loop].kind, tuned[loop].chunk);
+}
+
+int steal_backend()
+{
+    static const char *backend_str = getenv("C_BACKEND");
+    static const int steal = (backend_str != NULL && strcmp(backend_str, "steal") == 0);
+    return steal;
+}
+
+void parallel_blocks(int loop, size_t n, size_t block, const std::function<void(size_t, size_t)> & body)
+{
+    size_t i;
+
+    if (steal_backend()) {
+        ws_parallel_for(n, block, body);
+        return;
+    }
+
+    loop_schedule(loop);
+    #pragma omp parallel for schedule(runtime)
+    for (i = 0; i < n; i += block)
+        body(i, (n - i < block) ? n - i : block);
+}
+
+void parallel_histogram_blocks(int loop, int64_t * hist, size_t n, size_t block,
+                               const std::function<void(int64_t *, size_t, size_t)> & body)
+{
+    size_t i;
+
+    if (steal_backend()) {
+        // Una copia por hilo del pool, indexada con ws_worker_id
+        int threads = ws_threads();
+        int64_t * parts = (int64_t *)pool_alloc((size_t)threads * 256 * sizeof(int64_t));
+        memset(parts, 0, (size_t)threads * 256 * sizeof(int64_t));
+        ws_parallel_for(n, block, [&](size_t first, size_t len) {
+            body(parts + (size_t)ws_worker_id() * 256, first, len);
+        });
+        for (int t = 0; t < threads; t++)
+            for (int v = 0; v < 256; v++)
+                hist[v] += parts[(size_t)t * 256 + v];
+        pool_free(parts);
+        return;
+    }
+
+    // Dentro del bucle hist es la copia privada de cada hilo
+    loop_schedule(loop);
+    #pragma omp parallel for reduction(+:hist[:256]) schedule(runtime)
+    for (i = 0; i < n; i += block)
+        body(hist, i, (n - i < block) ? n - i : block);
+}
+
+static std::string cpu_model()
+{
+    char line[512];
+    std::string model = "unknown";
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (f == NULL)
+        return model;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *p = strchr(line, ':');
+        if (strncmp(line, "model name", 10) == 0 && p != NULL) {
+            for (p++; *p == ' '; p++)
+                ;
+            p[strcspn(p, "\t\n")] = '\0';
+            model = p;
+            break;
+        }
+    }
+    fclose(f);
+    return model;
+}
+
+static std::string tune_cache_path()
+{
+    const char *path_str = getenv("C_OMP_TUNE_CACHE");
+    if (path_str != NULL)
+        return path_str;
+
+    // El directorio personal suele ser compartido entre nodos: el nombre incluye la máquina
+    char host[256] = "localhost";
+    gethostname(host, sizeof(host) - 1);
+    const char *home = getenv("HOME");
+    return std::string((home != NULL) ? home : ".") + "/.contrast-omp-tuning." + host;
+}
+
+// Lee la línea de key: "<key>\t<bucle>=<planificación>,<bloque>\t..." con todos los bucles
+static int load_tuning(const std::string & path, const std::string & key)
+{
+    char line[1024];
+    int found = 0;
+    FILE *f = fopen(path.c_str(), "r");
+    if (f == NULL)
+        return 0;
+    while (!found && fgets(line, sizeof(line), f) != NULL) {
+        if (strncmp(line, key.c_str(), key.size()) != 0 || line[key.size()] != '\t')
+            continue;
+        int loaded = 0;
+        for (char *field = strtok(line + key.size(), "\t\n"); field != NULL; field = strtok(NULL, "\t\n")) {
+            char *eq = strchr(field, '=');
+            char *comma = (eq != NULL) ? strchr(eq, ',') : NULL;
+            if (comma == NULL)
+                continue;
+            *eq = *comma = '\0';
+            for (int loop = 0; loop < TUNED_LOOPS; loop++) {
+                if (strcmp(field, TUNED_LOOP_NAMES[loop]) == 0) {
+                    get_custom_schedule(eq + 1, comma + 1, &tuned[loop].kind, &tuned[loop].chunk);
+                    loaded |= 1 << loop;
+                }
+            }
+        }
+        found = (loaded == (1 << TUNED_LOOPS) - 1);
+    }
+    fclose(f);
+    return found;
+}
+
+// Reescribe la caché sustituyendo la línea de key; el fichero nuevo se renombra al final
+// para que otra ejecución nunca lea uno a medias
+static void save_tuning(const std::string & path, const std::string & key)
+{
+    char line[1024];
+    std::string tmp = path + ".tmp." + std::to_string((long)getpid());
+    FILE *out = fopen(tmp.c_str(), "w");
+    if (out == NULL) {
+        printf("Autotune: cannot write %s\n", tmp.c_str());
+        return;
+    }
+    FILE *in = fopen(path.c_str(), "r");
+    if (in != NULL) {
+        while (fgets(line, sizeof(line), in) != NULL) {
+            if (strncmp(line, key.c_str(), key.size()) != 0 || line[key.size()] != '\t')
+                fputs(line, out);
+        }
+        fclose(in);
+    }
+    fputs(key.c_str(), out);
+    for (int loop = 0; loop < TUNED_LOOPS; loop++)
+        fprintf(out, "\t%s=%s,%d", TUNED_LOOP_NAMES[loop], obtain_schedule_string(tuned[loop].kind), tuned[loop].chunk);
+    fputs("\n", out);
+    fclose(out);
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        printf("Autotune: cannot write %s\n", path.c_str());
+        remove(tmp.c_str());
+        return;
+    }
+    printf("Autotune: saved to %s\n", path.c_str());
+}
+
+// Ejecuta una vez el bucle loop sobre la banda de muestra con la planificación de tuned[loop]
+static double time_tuned_loop(int loop, PPM_IMG in, PPM_IMG out, unsigned char * rgb, unsigned char * lut)
+{
+    int64_t hist[256];
+    size_t n = (size_t)in.w * in.h;
+    RGB_VIEW view_in = planar_view(in.img_r, in.img_g, in.img_b);
+    RGB_VIEW view_out = planar_view(out.img_r, out.img_g, out.img_b);
+
+    double tstart = omp_get_wtime();
+    switch (loop) {
+        case LOOP_HSL_HIST:
+            histogram_hsl_l_pixels(hist, view_in, n);
+            break;
+        case LOOP_HSL_EQUALIZE:
+            hsl_equalize_pixels(lut, view_in, view_out, n);
+            break;
+        case LOOP_YUV_HIST:
+            histogram_yuv_y_pixels(hist, view_in, n);
+            break;
+        case LOOP_YUV_EQUALIZE:
+            yuv_equalize_blocks(lut, view_in, view_out, n, yuv_mode() != YUV_DOUBLE);
+            break;
+        case LOOP_GRAY_HIST:
+            histogram(hist, in.img_r, n, 256);
+            break;
+        case LOOP_APPLY_LUT:
+            apply_lut(out.img_r, in.img_r, lut, n);
+            break;
+        case LOOP_DEINTERLEAVE:
+            deinterleave_image(rgb, out);
+            break;
+        default:
+            interleave_image(in, rgb);
+            break;
+    }
+    return omp_get_wtime() - tstart;
+}
+
+// Mide todas las candidatas de cada bucle sobre una banda de muestra de hasta
+// TUNE_SAMPLE_PIXELS píxeles pseudoaleatorios
+static void tune_loops(size_t size)
+{
+    size_t sample = (size < TUNE_SAMPLE_PIXELS) ? size : TUNE_SAMPLE_PIXELS;
+    int w = PIXEL_BLOCK;
+    int h = (int)((sample + PIXEL_BLOCK - 1) / PIXEL_BLOCK);
+    PPM_IMG in = alloc_ppm(w, h);
+    PPM_IMG out = alloc_ppm(w, h);
+    unsigned char lut[256];
+    uint32_t seed = 12345;
+
+    unsigned char * rgb = (unsigned char *)pool_alloc(3 * (size_t)in.w * in.h * sizeof(unsigned char));
+    for (size_t i = 0; i < (size_t)in.w * in.h; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        in.img_r[i] = (unsigned char)(seed >> 24);
+        in.img_g[i] = (unsigned char)(seed >> 16);
+        in.img_b[i] = (unsigned char)(seed >> 8);
+    }
+    for (int v = 0; v < 256; v++)
+        lut[v] = (unsigned char)(255 - v);
+    interleave_image(in, rgb);
+
+    for (int loop = 0; loop < TUNED_LOOPS; loop++) {
+        double best = -1;
+        LOOP_SCHEDULE choice = TUNE_CANDIDATES[0];
+        tuned[loop] = choice;
+        time_tuned_loop(loop, in, out, rgb, lut);   // Calentamiento: caché y páginas de la salida
+        for (int c = 0; c < TUNE_CANDIDATE_COUNT; c++) {
+            tuned[loop] = TUNE_CANDIDATES[c];
+            for (int rep = 0; rep < TUNE_REPS; rep++) {
+                double t = time_tuned_loop(loop, in, out, rgb, lut);
+                if (best < 0 || t < best) {
+                    best = t;
+                    choice = TUNE_CANDIDATES[c];
+                }
+            }
+        }
+        tuned[loop] = choice;
+    }
+
+    pool_free(rgb);
+    free_ppm(in);
+    free_ppm(out);
+}
+
+static void autotune_loop_schedules(size_t size)
+{
+    const char *autotune_str = getenv("C_OMP_AUTOTUNE");
+    int mode = (autotune_str != NULL) ? atoi(autotune_str) : 0;
+    if (mode == 0)
+        return;
+    if (numa_mode()) {
+        printf("Autotune: disabled, NUMA first-touch needs the static schedule\n");
+        return;
+    }
+
+    // Sin tamaño conocido (streaming) se ajusta para la banda de muestra completa
+    if (size == 0)
+        size = TUNE_SAMPLE_PIXELS;
+    int size_class = 0;
+    while ((size >> (size_class + 1)) != 0)
+        size_class++;
+
+    std::string path = tune_cache_path();
+    std::string key = cpu_model() + "\t" + std::to_string(omp_get_max_threads()) + "\t" +
+                      isa_name() + "\t" + std::to_string(size_class);
+
+    // Durante la medida loop_schedule ya aplica la candidata de cada bucle
+    tuned_active = 1;
+    if (mode != 2 && load_tuning(path, key)) {
+        printf("Autotune: loaded from %s\n", path.c_str());
+    } else {
+        double tstart = omp_get_wtime();
+        tune_loops(size);
+        printf("Autotune: tuned in %f (s)\n", omp_get_wtime() - tstart);
+        save_tuning(path, key);
+    }
+    for (int loop = 0; loop < TUNED_LOOPS; loop++)
+        printf("Autotune: %s %s,%d\n", TUNED_LOOP_NAMES[loop], obtain_schedule_string(tuned[loop].kind), tuned[loop].chunk);
 }
 
-timeGray run_cpu_gray_test(PGM_IMG img_in) {
+timeGray run_cpu_gray_test(PGM_IMG img_in, int inplace) {
     PGM_IMG img_obuf;  
     timeGray t_gray;
 
     // Configurar planificación para OpenMP basada en la imagen
-    set_schedule_openmp(img_in.w * img_in.h);
+    set_schedule_openmp((size_t)img_in.w * img_in.h);
 
     printf("Starting CPU processing...\n");
     
     // Procesar imagen en escala de grises
     double tstart = MPI_Wtime();
-    img_obuf = contrast_enhancement_g(img_in);
+    if (inplace) {
+        contrast_enhancement_g_inplace(img_in);
+        img_obuf = img_in;
+    } else {
+        img_obuf = contrast_enhancement_g(img_in);
+    }
     double tfinish = MPI_Wtime();
     t_gray.time_test = tfinish - tstart;
 
     printf("Processing time: %f (s)\n", t_gray.time_test);
+    if (numa_mode()) {
+        numa_report("in.pgm", img_in.img, (size_t)img_in.w * img_in.h);
+        if (!inplace)
+            numa_report("out.pgm", img_obuf.img, (size_t)img_obuf.w * img_obuf.h);
+    }
 
     // Guardar imagen procesada
     tstart = MPI_Wtime();
@@ -259,56 +1018,69 @@ timeGray run_cpu_gray_test(PGM_IMG img_in) {
     tfinish = MPI_Wtime();
     t_gray.time_write = tfinish - tstart;
 
-    free_pgm(img_obuf); // Liberar memoria de la imagen procesada
+    if (!inplace)
+        free_pgm(img_obuf); // Liberar memoria de la imagen procesada
 
     return t_gray;
 }
 
 
 
+timeGray run_cpu_gray_test_stream(size_t mem_budget) {
+    timeGray t_gray;
+
+    // El tamaño de la imagen no se conoce hasta abrir el fichero
+    set_schedule_openmp(0);
+
+    printf("Starting CPU processing...\n");
+
+    // Procesar imagen en escala de grises
+    double tstart = MPI_Wtime();
+    contrast_enhancement_g_stream("in.pgm", "out.pgm", mem_budget);
+    double tfinish = MPI_Wtime();
+    t_gray.time_test = tfinish - tstart;
+    t_gray.time_write = 0;
+
+    printf("Processing time: %f (s)\n", t_gray.time_test);
+
+    return t_gray;
+}
+
 PPM_IMG read_ppm(const char * path){
     // Aplicamos paralelización mediante omp en la lectura en imágenes de color
     FILE * in_file;
-    char sbuf[256];
     
     char *ibuf;
     PPM_IMG result;
-    int v_max, i;
     in_file = fopen(path, "r");
     if (in_file == NULL){
         printf("Input file not found!\n");
         exit(1);
     }
-    /*Skip the magic number*/
-    fscanf(in_file, "%s", sbuf);
-
-
-    //result = malloc(sizeof(PPM_IMG));
-    fscanf(in_file, "%d",&result.w);
-    fscanf(in_file, "%d",&result.h);
-    fscanf(in_file, "%d\n",&v_max);
-    printf("Image size: %d x %d\n", result.w, result.h);
+    PNM_HEADER hdr = read_pnm_header(in_file);
+    printf("Image size: %d x %d\n", hdr.w, hdr.h);
     
 
-    result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    ibuf         = (char *)malloc(3 * result.w * result.h * sizeof(char));
+    if (numa_mode()) {
+        // Cada hilo lee y separa sus propios bloques: la lectura es el primer contacto
+        result = alloc_ppm_planes(hdr.w, hdr.h, 0);
+        read_ppm_numa(in_file, result);
+        fclose(in_file);
+        return result;
+    }
+
+    result = alloc_ppm(hdr.w, hdr.h);
+    ibuf         = (char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(char));
 
     // Leemos todos los datos de la imagen desde el archivo.
     // Los datos están organizados como una secuencia de valores RGB intercalados.
-    fread(ibuf,sizeof(unsigned char), 3 * result.w*result.h, in_file);
+    fread(ibuf,sizeof(unsigned char), 3 * (size_t)result.w * result.h, in_file);
 
     // Paralelizamos la separación de los canales R, G y B utilizando OpenMP.
-    #pragma omp parallel for schedule(runtime)
-    for(i = 0; i < result.w*result.h; i ++){
-        result.img_r[i] = ibuf[3*i + 0]; //Extraemos el componente rojo
-        result.img_g[i] = ibuf[3*i + 1]; //Extraemos el componente verde
-        result.img_b[i] = ibuf[3*i + 2]; //Extraemos el componente azul
-    }
+    deinterleave_image((const unsigned char *)ibuf, result);
     
     fclose(in_file);
-    free(ibuf);
+    pool_free(ibuf);
     
     return result;
 }
@@ -316,56 +1088,261 @@ PPM_IMG read_ppm(const char * path){
 void write_ppm(PPM_IMG img, const char * path){
     // Se paraleliza la organización de los datos de los canales R, G y B en un solo buffer intercalado.
     FILE * out_file;
-    int i;
     
-    char * obuf = (char *)malloc(3 * img.w * img.h * sizeof(char));
+    char * obuf = (char *)pool_alloc(3 * (size_t)img.w * img.h * sizeof(char));
 
      // Paralelizamos la construcción del buffer intercalado utilizando OpenMP.
-    #pragma omp parallel for schedule(runtime)
-    for(i = 0; i < img.w*img.h; i ++){
-        obuf[3*i + 0] = img.img_r[i]; // Canal rojo
-        obuf[3*i + 1] = img.img_g[i]; // Canal verde
-        obuf[3*i + 2] = img.img_b[i]; // Canal azul
-    }
+    interleave_image(img, (unsigned char *)obuf);
     out_file = fopen(path, "wb");
     fprintf(out_file, "P6\n");
     fprintf(out_file, "%d %d\n255\n",img.w, img.h);
-    fwrite(obuf,sizeof(unsigned char), 3*img.w*img.h, out_file);
+    fwrite(obuf,sizeof(unsigned char), 3*(size_t)img.w * img.h, out_file);
     fclose(out_file);
-    free(obuf);
+    pool_free(obuf);
+}
+
+void deinterleave_image(const unsigned char * rgb, PPM_IMG img)
+{
+    parallel_blocks(LOOP_DEINTERLEAVE, (size_t)img.w * img.h, PIXEL_BLOCK, [&](size_t i, size_t len) {
+        deinterleave_rgb(rgb + 3*i, img.img_r + i, img.img_g + i, img.img_b + i, len);
+    });
+}
+
+void interleave_image(PPM_IMG img, unsigned char * rgb)
+{
+    parallel_blocks(LOOP_INTERLEAVE, (size_t)img.w * img.h, PIXEL_BLOCK, [&](size_t i, size_t len) {
+        interleave_rgb(img.img_r + i, img.img_g + i, img.img_b + i, rgb + 3*i, len);
+    });
 }
 
 void free_ppm(PPM_IMG img)
 {
-    free(img.img_r);
-    free(img.img_g);
-    free(img.img_b);
+    pool_free(img.img_r);
+}
+
+int numa_mode()
+{
+    static const char *numa_str = getenv("C_NUMA");
+    static const int mode = (numa_str != NULL) ? atoi(numa_str) : 0;
+    return mode;
+}
+
+// Bloque para los planos de una imagen: en modo NUMA no se reutiliza ninguno guardado,
+// porque sus páginas ya estarían colocadas según el reparto de otra imagen o etapa
+static unsigned char * alloc_block(size_t bytes)
+{
+    return (unsigned char *)(numa_mode() ? pool_alloc_fresh(bytes) : pool_alloc(bytes));
+}
+
+// Primer contacto de n píxeles de bytes_per_pixel bytes: cada hilo escribe los bloques de
+// PIXEL_BLOCK píxeles que le da schedule(static), el mismo reparto que siguen los bucles
+// de cálculo con schedule(runtime) cuando el modo NUMA fija la planificación estática
+static void first_touch(unsigned char * p, size_t n, size_t bytes_per_pixel)
+{
+    size_t i;
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        memset(p + i * bytes_per_pixel, 0, len * bytes_per_pixel);
+    }
+}
+
+void * alloc_pixels(size_t n, size_t bytes_per_pixel)
+{
+    unsigned char * p = alloc_block(n * bytes_per_pixel);
+    if (numa_mode())
+        first_touch(p, n, bytes_per_pixel);
+    return p;
+}
+
+// Los tres planos de una imagen salen de un único bloque de la reserva de buffers,
+// cada uno alineado a POOL_ALIGN; el bloque empieza en el primer plano. Con touch == 0
+// no se hace el primer contacto, porque lo hará quien la rellene con el mismo reparto
+static PPM_IMG alloc_ppm_planes(int w, int h, int touch)
+{
+    PPM_IMG img;
+    size_t stride = pool_plane_stride((size_t)w * h);
+    unsigned char * block = alloc_block(3 * stride);
+
+    img.w = w;
+    img.h = h;
+    img.img_r = block;
+    img.img_g = block + stride;
+    img.img_b = block + 2 * stride;
+    if (touch) {
+        first_touch(img.img_r, (size_t)w * h, 1);
+        first_touch(img.img_g, (size_t)w * h, 1);
+        first_touch(img.img_b, (size_t)w * h, 1);
+    }
+    return img;
+}
+
+PPM_IMG alloc_ppm(int w, int h)
+{
+    return alloc_ppm_planes(w, h, numa_mode());
+}
+
+// Lee bytes bytes desde offset aunque pread devuelva menos de una vez. Si el fichero
+// está truncado el resto queda sin leer, igual que con fread
+static void pread_full(int fd, unsigned char * buf, size_t bytes, off_t offset)
+{
+    while (bytes > 0) {
+        ssize_t got = pread(fd, buf, bytes, offset);
+        if (got <= 0)
+            break;
+        buf += got;
+        bytes -= got;
+        offset += got;
+    }
+}
+
+// Lectura en modo NUMA de n píxeles de channels bytes a partir de la posición actual de
+// in_file: cada hilo lee con pread sus bloques del reparto estático, así que es la propia
+// lectura la que hace el primer contacto de cada página
+static void read_pixels_numa(FILE * in_file, unsigned char * img, size_t n, int channels)
+{
+    int fd = fileno(in_file);
+    off_t offset = ftell(in_file);
+    size_t i;
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        pread_full(fd, img + i * channels, len * channels, offset + (off_t)(i * channels));
+    }
+}
+
+// Igual que read_pixels_numa, separando los canales de cada bloque en los tres planos
+static void read_ppm_numa(FILE * in_file, PPM_IMG img)
+{
+    int fd = fileno(in_file);
+    off_t offset = ftell(in_file);
+    size_t n = (size_t)img.w * img.h;
+    size_t i;
+
+    #pragma omp parallel for schedule(static)
+    for (i = 0; i < n; i += PIXEL_BLOCK) {
+        unsigned char rgb[3 * PIXEL_BLOCK];
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        pread_full(fd, rgb, 3 * len, offset + (off_t)(3 * i));
+        deinterleave_rgb(rgb, img.img_r + i, img.img_g + i, img.img_b + i, len);
+    }
+}
+
+// Páginas consultadas en cada llamada a move_pages
+#define NUMA_QUERY_PAGES 1024
+#define NUMA_MAX_NODES 64
+
+void numa_report(const char * name, const void * p, size_t bytes)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t addr = (uintptr_t)p & ~(uintptr_t)(page - 1);
+    uintptr_t end = (uintptr_t)p + bytes;
+    void * pages[NUMA_QUERY_PAGES];
+    int status[NUMA_QUERY_PAGES];
+    long count[NUMA_MAX_NODES] = {0};
+    long total = 0, missing = 0;
+
+    while (addr < end) {
+        int k = 0;
+        for (; k < NUMA_QUERY_PAGES && addr < end; k++, addr += page)
+            pages[k] = (void *)addr;
+        // Sin nodos de destino move_pages no mueve nada: devuelve en status el nodo de cada página
+        if (syscall(SYS_move_pages, 0, (unsigned long)k, pages, NULL, status, 0) != 0) {
+            printf("NUMA pages %s: move_pages failed\n", name);
+            return;
+        }
+        for (int j = 0; j < k; j++) {
+            if (status[j] >= 0 && status[j] < NUMA_MAX_NODES)
+                count[status[j]]++;
+            else
+                missing++;
+        }
+        total += k;
+    }
+
+    printf("NUMA pages %s:", name);
+    for (int node = 0; node < NUMA_MAX_NODES; node++) {
+        if (count[node] > 0)
+            printf(" node%d %ld (%.1f%%)", node, count[node], 100.0 * count[node] / total);
+    }
+    if (missing > 0)
+        printf(" not present %ld", missing);
+    printf("\n");
+}
+
+// Los tres planos salen del mismo bloque (alloc_ppm), que se consulta entero
+static void numa_report_ppm(const char * name, PPM_IMG img)
+{
+    numa_report(name, img.img_r, 3 * pool_plane_stride((size_t)img.w * img.h));
+}
+
+// Lectura y escritura sin separar canales: los píxeles se copian tal como están en el fichero
+PPM_PACKED_IMG read_ppm_packed(const char * path){
+    FILE * in_file;
+    PPM_PACKED_IMG result;
+
+    in_file = fopen(path, "r");
+    if (in_file == NULL){
+        printf("Input file not found!\n");
+        exit(1);
+    }
+    PNM_HEADER hdr = read_pnm_header(in_file);
+    result.w = hdr.w;
+    result.h = hdr.h;
+    printf("Image size: %d x %d\n", result.w, result.h);
+
+    if (numa_mode()) {
+        result.img = alloc_block(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+        read_pixels_numa(in_file, result.img, (size_t)result.w * result.h, 3);
+    } else {
+        result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+        fread(result.img, sizeof(unsigned char), 3 * (size_t)result.w * result.h, in_file);
+    }
+
+    fclose(in_file);
+    return result;
+}
+
+void write_ppm_packed(PPM_PACKED_IMG img, const char * path){
+    FILE * out_file = fopen(path, "wb");
+
+    fprintf(out_file, "P6\n");
+    fprintf(out_file, "%d %d\n255\n",img.w, img.h);
+    fwrite(img.img, sizeof(unsigned char), 3*(size_t)img.w * img.h, out_file);
+    fclose(out_file);
+}
+
+void free_ppm_packed(PPM_PACKED_IMG img)
+{
+    pool_free(img.img);
 }
 
 PGM_IMG read_pgm(const char * path){
     FILE * in_file;
-    char sbuf[256];
     
     
     PGM_IMG result;
-    int v_max;//, i;
     in_file = fopen(path, "r");
     if (in_file == NULL){
         printf("Input file not found!\n");
         exit(1);
     }
     
-    fscanf(in_file, "%s", sbuf); /*Skip the magic number*/
-    fscanf(in_file, "%d",&result.w);
-    fscanf(in_file, "%d",&result.h);
-    fscanf(in_file, "%d\n",&v_max);
+    PNM_HEADER hdr = read_pnm_header(in_file);
+    result.w = hdr.w;
+    result.h = hdr.h;
     printf("Image size: %d x %d\n", result.w, result.h);
     
 
-    result.img = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-
-
-    fread(result.img,sizeof(unsigned char), result.w*result.h, in_file);    
+    if (numa_mode()) {
+        result.img = alloc_block((size_t)result.w * result.h * sizeof(unsigned char));
+        read_pixels_numa(in_file, result.img, (size_t)result.w * result.h, 1);
+    } else {
+        result.img = (unsigned char *)pool_alloc((size_t)result.w * result.h * sizeof(unsigned char));
+        fread(result.img,sizeof(unsigned char), (size_t)result.w * result.h, in_file);    
+    }
     fclose(in_file);
     
     return result;
@@ -376,12 +1353,309 @@ void write_pgm(PGM_IMG img, const char * path){
     out_file = fopen(path, "wb");
     fprintf(out_file, "P5\n");
     fprintf(out_file, "%d %d\n255\n",img.w, img.h);
-    fwrite(img.img,sizeof(unsigned char), img.w*img.h, out_file);
+    fwrite(img.img,sizeof(unsigned char), (size_t)img.w * img.h, out_file);
     fclose(out_file);
 }
 
 void free_pgm(PGM_IMG img)
 {
-    free(img.img);
+    pool_free(img.img);
+}
+
+MAPPED_IMG map_pnm(const char * path){
+    MAPPED_IMG result;
+    struct stat st;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0){
+        printf("Input file not found!\n");
+        exit(1);
+    }
+    result.map_size = st.st_size;
+
+    // El fichero se recorre una sola vez de principio a fin
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    // Escribible y privada (copia en escritura): el modo C_INPLACE ecualiza sobre la
+    // propia proyección sin modificar el fichero
+    result.map = mmap(NULL, result.map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // La proyección sigue siendo válida tras cerrar el descriptor
+    if (result.map == MAP_FAILED){
+        printf("Input file could not be mapped!\n");
+        exit(1);
+    }
+    madvise(result.map, result.map_size, MADV_SEQUENTIAL);
+    madvise(result.map, result.map_size, MADV_WILLNEED);
+
+    // La cabecera se interpreta sobre la propia proyección con el mismo lector que la
+    // lectura con stdio, así que ambos modos aceptan exactamente los mismos ficheros
+    FILE * header_file = fmemopen(result.map, result.map_size, "rb");
+    PNM_HEADER hdr = read_pnm_header(header_file);
+    fclose(header_file);
+    result.w = hdr.w;
+    result.h = hdr.h;
+    result.channels = hdr.channels;
+
+    const unsigned char * p = (const unsigned char *)result.map + hdr.offset;
+    const unsigned char * end = (const unsigned char *)result.map + result.map_size;
+
+    result.data = (unsigned char *)p;
+    if (p > end || (size_t)(end - p) < (size_t)result.channels * (size_t)result.w * result.h){
+        printf("Input file is truncated!\n");
+        exit(1);
+    }
+
+    return result;
+}
+
+void unmap_pnm(MAPPED_IMG img){
+    munmap(img.map, img.map_size);
+}
+
+PGM_IMG pgm_view(MAPPED_IMG img){
+    // Vista sin copia: los píxeles se leen directamente de la proyección.
+    // No se debe llamar a free_pgm sobre ella, sino a unmap_pnm.
+    PGM_IMG result;
+    result.w = img.w;
+    result.h = img.h;
+    result.img = img.data;
+    return result;
+}
+
+PPM_PACKED_IMG ppm_packed_view(MAPPED_IMG img){
+    // Vista sin copia de una imagen en color: se libera con unmap_pnm, no con free_ppm_packed
+    PPM_PACKED_IMG result;
+    result.w = img.w;
+    result.h = img.h;
+    result.img = img.data;
+    return result;
+}
+
+PPM_IMG read_ppm_mmap(const char * path){
+    // Separamos los canales leyendo directamente de la proyección, sin buffer intermedio
+    MAPPED_IMG mapped = map_pnm(path);
+    PPM_IMG result = alloc_ppm(mapped.w, mapped.h);
+
+    deinterleave_image(mapped.data, result);
+
+    unmap_pnm(mapped);
+
+    return result;
+}
+
+// Escritura en segundo plano (write-behind): un hilo de E/S vacía una cola acotada
+// de imágenes terminadas mientras el hilo principal calcula la siguiente.
+struct WriteJob {
+    PPM_IMG img;
+    PPM_PACKED_IMG packed_img; // Imagen intercalada cuando packed != 0
+    int packed;
+    int keep;                  // La imagen sigue siendo del llamador: no se libera al escribirla
+    std::string path;
+};
+
+struct AsyncWriter {
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::deque<WriteJob> queue;
+    size_t capacity;     // Número máximo de imágenes pendientes de escribir
+    bool closing;
+    double busy_time;    // Tiempo total que el hilo de E/S pasa escribiendo
+    double exposed_time; // Tiempo que el hilo principal espera por la E/S
+};
+
+AsyncWriter writer;
+
+static void async_writer_loop() {
+    // El entrelazado de write_ppm se hace con un solo hilo para no quitar
+    // núcleos a la etapa de cálculo que se está solapando
+    omp_set_num_threads(1);
+
+    for (;;) {
+        WriteJob job;
+        {
+            std::unique_lock<std::mutex> lock(writer.mutex);
+            writer.not_empty.wait(lock, [] { return !writer.queue.empty() || writer.closing; });
+            if (writer.queue.empty()) {
+                return; // Cola vacía y cerrada: no queda nada por escribir
+            }
+            job = writer.queue.front();
+            writer.queue.pop_front();
+        }
+        writer.not_full.notify_one();
+
+        double tstart = omp_get_wtime();
+        // El hilo de E/S es el propietario de la imagen
+        if (job.packed) {
+            write_ppm_packed(job.packed_img, job.path.c_str());
+            if (!job.keep)
+                free_ppm_packed(job.packed_img);
+        } else {
+            write_ppm(job.img, job.path.c_str());
+            if (!job.keep)
+                free_ppm(job.img);
+        }
+        double elapsed = omp_get_wtime() - tstart;
+
+        std::lock_guard<std::mutex> lock(writer.mutex);
+        writer.busy_time += elapsed;
+    }
+}
+
+void async_writer_start(size_t capacity) {
+    writer.capacity = (capacity > 0) ? capacity : 1;
+    writer.closing = false;
+    writer.busy_time = 0;
+    writer.exposed_time = 0;
+    writer.worker = std::thread(async_writer_loop);
+}
+
+// Encola la imagen para escribirla; solo bloquea si la cola está llena.
+// La imagen pasa a ser propiedad del hilo de E/S, que la libera tras escribirla salvo con keep,
+// en cuyo caso el llamador no debe tocarla ni liberarla hasta async_writer_finish.
+static double async_writer_push(const WriteJob & job) {
+    double tstart = omp_get_wtime();
+    {
+        std::unique_lock<std::mutex> lock(writer.mutex);
+        writer.not_full.wait(lock, [] { return writer.queue.size() < writer.capacity; });
+        writer.queue.push_back(job);
+    }
+    writer.not_empty.notify_one();
+    double waited = omp_get_wtime() - tstart;
+    writer.exposed_time += waited;
+    return waited;
+}
+
+double async_writer_submit(PPM_IMG img, const char * path, int keep) {
+    WriteJob job;
+    job.img = img;
+    job.packed = 0;
+    job.keep = keep;
+    job.path = path;
+    return async_writer_push(job);
+}
+
+double async_writer_submit_packed(PPM_PACKED_IMG img, const char * path, int keep) {
+    WriteJob job;
+    job.packed_img = img;
+    job.packed = 1;
+    job.keep = keep;
+    job.path = path;
+    return async_writer_push(job);
+}
+
+// Espera a que terminen las escrituras pendientes y detiene el hilo de E/S
+double async_writer_finish() {
+    double tstart = omp_get_wtime();
+    {
+        std::lock_guard<std::mutex> lock(writer.mutex);
+        writer.closing = true;
+    }
+    writer.not_empty.notify_one();
+    writer.worker.join();
+    double waited = omp_get_wtime() - tstart;
+    writer.exposed_time += waited;
+    return waited;
+}
+
+// Tiempo de E/S oculto tras el cálculo: lo que el hilo de E/S escribió sin que el principal esperase
+double async_writer_overlapped() {
+    double overlapped = writer.busy_time - writer.exposed_time;
+    return (overlapped > 0) ? overlapped : 0;
+}
+
+double async_writer_exposed() {
+    return writer.exposed_time;
+}
+
+PNM_STREAM open_pnm_stream(const char * path){
+    PNM_STREAM s;
+
+    s.file = fopen(path, "rb");
+    if (s.file == NULL){
+        printf("Input file not found!\n");
+        exit(1);
+    }
+    PNM_HEADER hdr = read_pnm_header(s.file);
+    s.w = hdr.w;
+    s.h = hdr.h;
+    s.channels = hdr.channels;
+    s.offset = hdr.offset;
+    printf("Image size: %d x %d\n", s.w, s.h);
+
+    return s;
+}
+
+PNM_STREAM create_pnm_stream(const char * path, int w, int h, int channels){
+    PNM_STREAM s;
+
+    s.file = fopen(path, "wb");
+    if (s.file == NULL){
+        printf("Output file could not be created!\n");
+        exit(1);
+    }
+    fprintf(s.file, (channels == 3) ? "P6\n" : "P5\n");
+    fprintf(s.file, "%d %d\n255\n", w, h);
+    fflush(s.file); // La cabecera llega al fichero antes que cualquier write_pnm_pixels
+    s.w = w;
+    s.h = h;
+    s.channels = channels;
+    s.offset = ftell(s.file);
+
+    return s;
+}
+
+void close_pnm_stream(PNM_STREAM s){
+    fclose(s.file);
+}
+
+// Lee o escribe rows filas a partir de first_row; los píxeles de cada fila son contiguos en el fichero
+static void read_rows(PNM_STREAM s, int first_row, int rows, unsigned char * buf){
+    fseek(s.file, s.offset + (long)s.channels * s.w * first_row, SEEK_SET);
+    if (fread(buf, sizeof(unsigned char), (size_t)s.channels * (size_t)s.w * rows, s.file) != (size_t)s.channels * (size_t)s.w * rows){
+        printf("Input file is truncated!\n");
+        exit(1);
+    }
 }
 
+static void write_rows(PNM_STREAM s, int first_row, int rows, const unsigned char * buf){
+    fseek(s.file, s.offset + (long)s.channels * s.w * first_row, SEEK_SET);
+    fwrite(buf, sizeof(unsigned char), (size_t)s.channels * (size_t)s.w * rows, s.file);
+}
+
+void read_pnm_pixels(PNM_STREAM s, size_t first, size_t n, unsigned char * buf){
+    pread_full(fileno(s.file), buf, (size_t)s.channels * n, s.offset + (off_t)(s.channels * first));
+}
+
+void write_pnm_pixels(PNM_STREAM s, size_t first, size_t n, const unsigned char * buf){
+    size_t bytes = (size_t)s.channels * n;
+    off_t offset = s.offset + (off_t)(s.channels * first);
+
+    while (bytes > 0) {
+        ssize_t put = pwrite(fileno(s.file), buf, bytes, offset);
+        if (put <= 0) {
+            printf("Output file could not be written!\n");
+            exit(1);
+        }
+        buf += put;
+        bytes -= put;
+        offset += put;
+    }
+}
+
+void read_pgm_rows(PNM_STREAM s, int first_row, PGM_IMG band){
+    read_rows(s, first_row, band.h, band.img);
+}
+
+void write_pgm_rows(PNM_STREAM s, int first_row, PGM_IMG band){
+    write_rows(s, first_row, band.h, band.img);
+}
+
+void read_ppm_packed_rows(PNM_STREAM s, int first_row, PPM_PACKED_IMG band){
+    read_rows(s, first_row, band.h, band.img);
+}
+
+void write_ppm_packed_rows(PNM_STREAM s, int first_row, PPM_PACKED_IMG band){
+    write_rows(s, first_row, band.h, band.img);
+}
@@ -1,6 +1,12 @@
 #ifndef HIST_EQU_COLOR_H
 #define HIST_EQU_COLOR_H
 
+#include <stddef.h>
+#include <stdio.h>
+#include <functional>
+#include "pixel-kernels.h"
+#include "image-pool.h"
+
 typedef struct{
     int w;
     int h;
@@ -15,43 +21,132 @@ typedef struct{
     unsigned char * img_b;
 } PPM_IMG;
 
+//Imagen en color con los canales intercalados (r0 g0 b0 r1 g1 b1 ...), en el mismo
+//orden que en el fichero: se lee y se escribe sin separar ni intercalar canales
 typedef struct{
     int w;
     int h;
-    unsigned char * img_y;
-    unsigned char * img_u;
-    unsigned char * img_v;
-} YUV_IMG;
-
-
-typedef struct
-{
-    int width;
-    int height;
-    float * h;
-    float * s;
-    unsigned char * l;
-} HSL_IMG;
+    unsigned char * img;
+} PPM_PACKED_IMG;
 
-    
 
 PPM_IMG read_ppm(const char * path);
 void write_ppm(PPM_IMG img, const char * path);
 void free_ppm(PPM_IMG img);
 
+//Reserva de imágenes: los planos salen de un único bloque alineado de la reserva de
+//buffers (image-pool.h), que se reutiliza entre etapas e imágenes; se liberan con free_*
+PPM_IMG alloc_ppm(int w, int h);
+
+//Modo NUMA (C_NUMA=1): las imágenes se piden sin reutilizar bloques de la reserva y cada
+//hilo toca primero (first touch) los bloques de PIXEL_BLOCK píxeles que le asigna el reparto
+//estático, el mismo que siguen los bucles de cálculo, para que sus páginas queden en su nodo.
+//Las imágenes de entrada se leen en paralelo con ese mismo reparto
+int numa_mode();
+//n píxeles de bytes_per_pixel bytes (planos sueltos, imágenes intercaladas), con su primer
+//contacto ya hecho en modo NUMA. Se liberan con pool_free
+void * alloc_pixels(size_t n, size_t bytes_per_pixel);
+//Imprime cuántas páginas de [p, p + bytes) hay en cada nodo NUMA
+void numa_report(const char * name, const void * p, size_t bytes);
+
+//Bucles paralelos que el autoajuste (C_OMP_AUTOTUNE=1) planifica por separado
+enum TunedLoop {
+    LOOP_HSL_HIST,       // rgb2hsl: histograma de L
+    LOOP_HSL_EQUALIZE,   // rgb2hsl + LUT + hsl2rgb
+    LOOP_YUV_HIST,       // rgb2yuv: histograma de Y
+    LOOP_YUV_EQUALIZE,   // rgb2yuv + LUT + yuv2rgb
+    LOOP_GRAY_HIST,
+    LOOP_APPLY_LUT,
+    LOOP_DEINTERLEAVE,
+    LOOP_INTERLEAVE,
+    TUNED_LOOPS
+};
+//Fija la planificación de schedule(runtime) para el siguiente bucle. Sin autoajuste no
+//hace nada y todos los bucles siguen con C_OMP_SCHEDULE y C_OMP_CHUNK_SIZE
+void loop_schedule(int loop);
+//Motor de los bucles por bloques, elegido en tiempo de ejecución: OpenMP por defecto o,
+//con C_BACKEND=steal, el pool de hilos con robo de trabajo (work-stealing.h)
+int steal_backend();
+//body(first, len) sobre bloques de block elementos de [0, n) con el motor elegido. Con
+//OpenMP es un parallel for schedule(runtime) con la planificación de loop
+void parallel_blocks(int loop, size_t n, size_t block, const std::function<void(size_t, size_t)> & body);
+//Igual, sumando a hist (256 contadores): body recibe la copia privada del hilo
+void parallel_histogram_blocks(int loop, int64_t * hist, size_t n, size_t block,
+                               const std::function<void(int64_t *, size_t, size_t)> & body);
+//Separa o intercala en paralelo los canales de una imagen completa
+void deinterleave_image(const unsigned char * rgb, PPM_IMG img);
+void interleave_image(PPM_IMG img, unsigned char * rgb);
+
+PPM_PACKED_IMG read_ppm_packed(const char * path);
+void write_ppm_packed(PPM_PACKED_IMG img, const char * path);
+void free_ppm_packed(PPM_PACKED_IMG img);
+
 PGM_IMG read_pgm(const char * path);
 void write_pgm(PGM_IMG img, const char * path);
 void free_pgm(PGM_IMG img);
 
-HSL_IMG rgb2hsl(PPM_IMG img_in);
-PPM_IMG hsl2rgb(HSL_IMG img_in);
+//Lectura mediante mmap: vista sin copia sobre los píxeles del fichero
+typedef struct{
+    int w;
+    int h;
+    int channels;          // 1 para PGM, 3 para PPM (intercalado)
+    unsigned char * data;  // Primer píxel dentro de la proyección
+    void * map;
+    size_t map_size;
+} MAPPED_IMG;
+
+MAPPED_IMG map_pnm(const char * path);
+void unmap_pnm(MAPPED_IMG img);
+PGM_IMG pgm_view(MAPPED_IMG img);
+PPM_IMG read_ppm_mmap(const char * path);
+PPM_PACKED_IMG ppm_packed_view(MAPPED_IMG img);
+
+//Lectura y escritura por bandas de filas, para imágenes que no caben en memoria
+typedef struct{
+    FILE * file;
+    int w;
+    int h;
+    int channels;          // 1 para PGM, 3 para PPM
+    long offset;           // Posición del primer píxel dentro del fichero
+} PNM_STREAM;
+
+PNM_STREAM open_pnm_stream(const char * path);
+PNM_STREAM create_pnm_stream(const char * path, int w, int h, int channels);
+void close_pnm_stream(PNM_STREAM s);
+void read_pgm_rows(PNM_STREAM s, int first_row, PGM_IMG band);
+void write_pgm_rows(PNM_STREAM s, int first_row, PGM_IMG band);
+void read_ppm_packed_rows(PNM_STREAM s, int first_row, PPM_PACKED_IMG band);
+void write_ppm_packed_rows(PNM_STREAM s, int first_row, PPM_PACKED_IMG band);
+//Lectura y escritura posicionales (pread/pwrite) de n píxeles a partir del píxel first:
+//varios hilos pueden usarlas a la vez sobre el mismo fichero
+void read_pnm_pixels(PNM_STREAM s, size_t first, size_t n, unsigned char * buf);
+void write_pnm_pixels(PNM_STREAM s, size_t first, size_t n, const unsigned char * buf);
 
-YUV_IMG rgb2yuv(PPM_IMG img_in);
-PPM_IMG yuv2rgb(YUV_IMG img_in);    
+// Motor HSL fusionado: histograma de L directamente desde RGB y vuelta a RGB con L
+// ecualizada por lut, recalculando H y S por bloques. Las versiones _pixels trabajan
+// sobre n píxeles de una vista planar o intercalada
+void histogram_hsl_l(int64_t * hist_out, PPM_IMG img_in);
+PPM_IMG hsl_equalize_rgb(PPM_IMG img_in, unsigned char * lut);
+void histogram_hsl_l_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n);
+void hsl_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n);
 
-void histogram(int * hist_out, unsigned char * img_in, int img_size, int nbr_bin);
+// Motor YUV fusionado: histograma de Y leyendo solo RGB y vuelta a RGB desde
+// (lut[Y], U, V) recalculando U y V en cada píxel
+void histogram_yuv_y(int64_t * hist_out, PPM_IMG img_in);
+PPM_IMG yuv_equalize_rgb(PPM_IMG img_in, unsigned char * lut);
+void histogram_yuv_y_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n);
+void yuv_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n);
+//Como yuv_equalize_pixels, pero en C_YUV_VERIFY devuelve los píxeles distintos sin imprimirlos
+long yuv_equalize_count(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n);
+//Solo el bucle de ecualización de yuv_equalize_pixels, sin la comprobación de C_YUV_VERIFY
+void yuv_equalize_blocks(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n, int fixed);
+
+void histogram(int64_t * hist_out, unsigned char * img_in, size_t img_size, int nbr_bin);
 void histogram_equalization(unsigned char * img_out, unsigned char * img_in, 
-                            int * hist_in, int img_size, int nbr_bin);
+                            int64_t * hist_in, size_t img_size, int nbr_bin);
+void histogram_equalization_inplace(unsigned char * img, int64_t * hist_in, size_t img_size, int nbr_bin);
+void histogram_lut(unsigned char * lut, int64_t * hist_in, size_t img_size, int nbr_bin);
+void apply_lut(unsigned char * img_out, unsigned char * img_in, unsigned char * lut, size_t img_size);
 
 //Contrast enhancement for gray-scale images
 PGM_IMG contrast_enhancement_g(PGM_IMG img_in);
@@ -61,5 +156,74 @@ PPM_IMG contrast_enhancement_c_rgb(PPM_IMG img_in);
 PPM_IMG contrast_enhancement_c_yuv(PPM_IMG img_in);
 PPM_IMG contrast_enhancement_c_hsl(PPM_IMG img_in);
 
+//Contrast enhancement sobre imágenes intercaladas, sin separar los canales
+PPM_PACKED_IMG contrast_enhancement_c_yuv_packed(PPM_PACKED_IMG img_in);
+PPM_PACKED_IMG contrast_enhancement_c_hsl_packed(PPM_PACKED_IMG img_in);
+
+//Contrast enhancement en el sitio: el resultado sobrescribe la imagen de entrada y no
+//se reserva imagen de salida
+void contrast_enhancement_g_inplace(PGM_IMG img);
+void contrast_enhancement_c_yuv_inplace(PPM_IMG img);
+void contrast_enhancement_c_hsl_inplace(PPM_IMG img);
+void contrast_enhancement_c_yuv_packed_inplace(PPM_PACKED_IMG img);
+void contrast_enhancement_c_hsl_packed_inplace(PPM_PACKED_IMG img);
+
+//Ecualización en dos recorridos sobre el fichero, por bandas de filas que caben en
+//mem_budget bytes: el primero calcula el histograma y el segundo aplica la LUT
+void contrast_enhancement_g_stream(const char * in_path, const char * out_path, size_t mem_budget);
+void contrast_enhancement_c_yuv_stream(const char * in_path, const char * out_path, size_t mem_budget);
+void contrast_enhancement_c_hsl_stream(const char * in_path, const char * out_path, size_t mem_budget);
+
+//Tiempos de cada etapa del pipeline de color: el máximo entre los hilos
+typedef struct{
+    double read;        // Lectura del rango de filas de cada hilo
+    double histogram;   // Histogramas de L e Y en un mismo recorrido
+    double barrier;     // Espera a que todos los hilos terminen sus histogramas
+    double hsl;
+    double write_hsl;
+    double yuv;
+    double write_yuv;
+} PIPELINE_TIMES;
+
+//Pipeline de color completo (lectura, HSL, YUV y escritura de las dos salidas) dentro de
+//una sola región paralela: cada hilo trabaja sobre el mismo rango de filas en todas las
+//etapas y solo hay una barrera, la que necesita el histograma global
+void contrast_enhancement_c_pipeline(const char * in_path, const char * hsl_path,
+                                     const char * yuv_path, PIPELINE_TIMES * times);
+
+//Tiempos del ejecutor por teselas
+typedef struct{
+    int tile_rows;      // Filas por tesela
+    double histogram;   // Primer recorrido: histogramas de L e Y
+    double hsl;         // Parte del segundo recorrido que ocupó la ecualización HSL
+    double yuv;         // Parte que ocupó la ecualización YUV
+} TILED_TIMES;
+
+//Ejecutor por teselas de filas del tamaño de L2 (tile_rows): un recorrido calcula los
+//histogramas de L e Y y, tras el histograma global, otro ecualiza cada tesela en HSL y en
+//YUV seguidas mientras sigue en caché. yuv_out puede ser la propia entrada (en el sitio)
+void contrast_enhancement_c_tiled(PPM_IMG img_in, PPM_IMG hsl_out, PPM_IMG yuv_out, TILED_TIMES * times);
+void contrast_enhancement_c_tiled_packed(PPM_PACKED_IMG img_in, PPM_PACKED_IMG hsl_out,
+                                         PPM_PACKED_IMG yuv_out, TILED_TIMES * times);
+
+//Tiempos del grafo de tareas, medidos desde que se crea la primera tarea
+typedef struct{
+    double wall;           // Hasta que termina la última tarea
+    double critical_path;  // Camino más largo del grafo con la duración medida de cada tarea
+    double work;           // Suma de las duraciones de todas las tareas
+    double hsl;            // Hasta que termina la ecualización HSL
+    double yuv;            // Hasta que termina la ecualización YUV
+    double write_hsl;      // Duración de la escritura de cada salida
+    double write_yuv;
+    int tasks;
+} TASK_GRAPH_TIMES;
+
+//HSL y YUV como dos cadenas de tareas OpenMP (histograma por trozos, LUT, ecualización
+//por trozos y escritura) enlazadas con depend, que el runtime intercala. La imagen va en
+//planar o en packed (la otra es NULL); con inplace el resultado YUV sobrescribe la
+//entrada, y cada trozo espera a que HSL haya leído el suyo
+void contrast_enhancement_c_tasks(PPM_IMG * planar, PPM_PACKED_IMG * packed, int inplace,
+                                  const char * hsl_path, const char * yuv_path, TASK_GRAPH_TIMES * times);
+
 
 #endif
@@ -2,27 +2,148 @@
 #include <string.h>
 #include <stdlib.h>
 #include "hist-equ.h"
+#include "pixel-kernels.h"
 #include <omp.h>
 
 
-void histogram(int * hist_out, unsigned char * img_in, int img_size, int nbr_bin){
-    int i;
-    for ( i = 0; i < nbr_bin; i ++){
-        hist_out[i] = 0;
+// Estrategias para calcular el histograma en paralelo
+enum HistMethod { HIST_SERIAL, HIST_REDUCTION, HIST_PRIVATE, HIST_ATOMIC };
+
+// Por debajo de este número de píxeles no compensa abrir una región paralela
+#define HIST_MIN_PARALLEL 65536
+// Con más hilos que este valor la mezcla por bins de las copias privadas escala mejor
+// que la reducción de arrays del runtime, que combina las copias hilo a hilo
+#define HIST_MAX_REDUCTION_THREADS 8
+// Píxeles que cada hilo pasa de una vez al núcleo por bancos (histogram_banked)
+#define HIST_BLOCK 16384
+
+// Elige la estrategia según el número de hilos y el tamaño de la imagen.
+// C_OMP_HIST=serial|reduction|private|atomic fuerza una estrategia concreta.
+static HistMethod histogram_method(size_t img_size, int nbr_bin){
+    const char *method_str = getenv("C_OMP_HIST");
+    if (method_str != NULL) {
+        if (strcmp(method_str, "serial") == 0) return HIST_SERIAL;
+        if (strcmp(method_str, "reduction") == 0) return HIST_REDUCTION;
+        if (strcmp(method_str, "private") == 0) return HIST_PRIVATE;
+        if (strcmp(method_str, "atomic") == 0) return HIST_ATOMIC;
+    }
+
+    int threads = omp_get_max_threads();
+    if (threads == 1 || img_size < HIST_MIN_PARALLEL) {
+        return HIST_SERIAL;
+    }
+    // Si cada hilo tiene pocos píxeles por bin, mezclar las copias cuesta más que las atómicas
+    if (img_size / threads < (size_t)4 * nbr_bin) {
+        return HIST_ATOMIC;
+    }
+    if (threads <= HIST_MAX_REDUCTION_THREADS) {
+        return HIST_REDUCTION;
+    }
+    return HIST_PRIVATE;
+}
+
+// Cada hilo acumula en su propia copia del histograma y el runtime las suma al final
+static void histogram_reduction(int64_t * hist_out, unsigned char * img_in, size_t img_size, int nbr_bin){
+    size_t i;
+    #pragma omp parallel for schedule(runtime) reduction(+:hist_out[:nbr_bin])
+    for ( i = 0; i < img_size; i += HIST_BLOCK){
+        size_t len = (img_size - i < HIST_BLOCK) ? img_size - i : HIST_BLOCK;
+        histogram_banked(hist_out, img_in + i, len);
     }
+}
+
+// Copias privadas separadas al menos una línea de caché (64 bytes) para evitar falso
+// compartido; la mezcla se reparte por bins, de modo que cada hilo suma una parte del array
+static void histogram_private(int64_t * hist_out, unsigned char * img_in, size_t img_size, int nbr_bin){
+    int threads = omp_get_max_threads();
+    int stride = (nbr_bin + 7) & ~7;
+    size_t bytes = (size_t)threads * stride * sizeof(int64_t);
+    int64_t * hist_priv = (int64_t *)aligned_alloc(64, bytes);
+    if (hist_priv == NULL) {
+        printf("Out of memory allocating %zu bytes\n", bytes);
+        exit(1);
+    }
+
+    #pragma omp parallel num_threads(threads)
+    {
+        // El equipo puede tener menos hilos de los pedidos (OMP_DYNAMIC, OMP_THREAD_LIMIT):
+        // solo existen, y se suman, las copias de los hilos que lo forman
+        int team = omp_get_num_threads();
+        int i;
+        size_t p;
+        int64_t * hist_local = hist_priv + (size_t)omp_get_thread_num() * stride;
+        for ( i = 0; i < nbr_bin; i ++){
+            hist_local[i] = 0;
+        }
+
+        #pragma omp for schedule(runtime)
+        for ( p = 0; p < img_size; p += HIST_BLOCK){
+            size_t len = (img_size - p < HIST_BLOCK) ? img_size - p : HIST_BLOCK;
+            histogram_banked(hist_local, img_in + p, len);
+        }
+
+        #pragma omp for schedule(static)
+        for ( i = 0; i < nbr_bin; i ++){
+            int t;
+            int64_t sum = 0;
+            for ( t = 0; t < team; t ++){
+                sum += hist_priv[(size_t)t * stride + i];
+            }
+            hist_out[i] = sum;
+        }
+    }
+
+    free(hist_priv);
+}
 
+// Un único histograma compartido actualizado con operaciones atómicas
+static void histogram_atomic(int64_t * hist_out, unsigned char * img_in, size_t img_size){
+    size_t i;
+    #pragma omp parallel for schedule(runtime)
     for ( i = 0; i < img_size; i ++){
+        #pragma omp atomic update
         hist_out[img_in[i]] ++;
     }
 }
 
-void histogram_equalization(unsigned char * img_out, unsigned char * img_in, 
-                            int * hist_in, int img_size, int nbr_bin){
-    // Reservamos memoria para la tabla de búsqueda (LUT - Look-Up Table)
-    int *lut = (int *)malloc(sizeof(int) * nbr_bin);
+void histogram(int64_t * hist_out, unsigned char * img_in, size_t img_size, int nbr_bin){
+    int i;
+    for ( i = 0; i < nbr_bin; i ++){
+        hist_out[i] = 0;
+    }
+
+    HistMethod method = histogram_method(img_size, nbr_bin);
+
+    // Con el pool de robo de trabajo (C_BACKEND=steal) cada hilo acumula en su copia y
+    // se suman al final, como en HIST_PRIVATE
+    if (steal_backend() && method != HIST_SERIAL) {
+        parallel_histogram_blocks(LOOP_GRAY_HIST, hist_out, img_size, HIST_BLOCK, [&](int64_t * hist, size_t p, size_t len) {
+            histogram_banked(hist, img_in + p, len);
+        });
+        return;
+    }
+
+    loop_schedule(LOOP_GRAY_HIST);
+    switch (method) {
+        case HIST_REDUCTION:
+            histogram_reduction(hist_out, img_in, img_size, nbr_bin);
+            break;
+        case HIST_PRIVATE:
+            histogram_private(hist_out, img_in, img_size, nbr_bin);
+            break;
+        case HIST_ATOMIC:
+            histogram_atomic(hist_out, img_in, img_size);
+            break;
+        default:
+            histogram_banked(hist_out, img_in, img_size);
+            break;
+    }
+}
 
+void histogram_lut(unsigned char * lut, int64_t * hist_in, size_t img_size, int nbr_bin){
     // Variables auxiliares
-    int i, cdf, min, d;
+    int i, v;
+    int64_t cdf, min, d; // En 64 bits: una imagen puede tener más de 2^31 píxeles
 
     /* Construir la LUT calculando la CDF (Función de Distribución Acumulada) */
 
@@ -44,29 +165,38 @@ void histogram_equalization(unsigned char * img_out, unsigned char * img_in,
         cdf += hist_in[i]; // Acumulamos el valor del histograma actual
 
         // Aplicamos la fórmula de ecualización de histograma a cada valor
-        lut[i] = (int)(((float)cdf - min) * 255 / d + 0.5); 
+        v = (int)(((float)cdf - min) * 255 / d + 0.5); 
 
-        // Aseguramos que los valores de la LUT sean válidos (no negativos)
-        if(lut[i] < 0) {
-            lut[i] = 0;
+        // La LUT se guarda ya recortada al rango [0, 255] de un byte
+        if(v < 0) {
+            v = 0;
         } 
+        if(v > 255) {
+            v = 255;
+        }
+        lut[i] = (unsigned char)v;
     }
+}
 
+void apply_lut(unsigned char * img_out, unsigned char * img_in, unsigned char * lut, size_t img_size){
     /* Generamos la imagen de salida usando la LUT */
 
-    // Paralelizamos este bucle para mejorar el rendimiento usando OpenMP
-    #pragma omp parallel for schedule(runtime)
-    for(i = 0; i < img_size; i++) {
-        // Si el valor en la LUT excede 255, limitamos a 255
-        if(lut[img_in[i]] > 255) {
-            img_out[i] = 255;
-        } 
-        // De lo contrario, asignamos el valor de la LUT al píxel de salida
-        else {
-            img_out[i] = (unsigned char)lut[img_in[i]];
-        }
-    }
+    // Cada hilo aplica el núcleo vectorial sobre bloques de píxeles
+    parallel_blocks(LOOP_APPLY_LUT, img_size, PIXEL_BLOCK, [&](size_t i, size_t len) {
+        apply_lut_u8(lut, img_in + i, img_out + i, len);
+    });
+}
+
+void histogram_equalization(unsigned char * img_out, unsigned char * img_in, 
+                            int64_t * hist_in, size_t img_size, int nbr_bin){
+    // Tabla de búsqueda (LUT - Look-Up Table)
+    unsigned char lut[256]; // nbr_bin es siempre 256: la tabla va en la pila, sin reservas por llamada
+
+    histogram_lut(lut, hist_in, img_size, nbr_bin);
+    apply_lut(img_out, img_in, lut, img_size);
+}
 
-    // Liberamos la memoria asignada a la LUT
-    free(lut);
+// Ecualización en el sitio: img se sobrescribe con el resultado
+void histogram_equalization_inplace(unsigned char * img, int64_t * hist_in, size_t img_size, int nbr_bin){
+    histogram_equalization(img, img, hist_in, img_size, nbr_bin);
 }
@@ -0,0 +1,396 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "hist-equ.h"
+#include "pixel-kernels.h"
+
+PGM_IMG contrast_enhancement_g(PGM_IMG img_in)
+{
+    PGM_IMG result;
+    int64_t hist[256];
+    
+    result.w = img_in.w;
+    result.h = img_in.h;
+    result.img = (unsigned char *)pool_alloc((size_t)result.w * result.h * sizeof(unsigned char));
+    
+    histogram(hist, img_in.img, (size_t)img_in.h * img_in.w, 256);
+    histogram_equalization(result.img,img_in.img,hist,(size_t)result.w * result.h, 256);
+    return result;
+}
+
+PPM_IMG contrast_enhancement_c_rgb(PPM_IMG img_in)
+{
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+    int64_t hist[256];
+    
+    histogram(hist, img_in.img_r, (size_t)img_in.h * img_in.w, 256);
+    histogram_equalization(result.img_r,img_in.img_r,hist,(size_t)result.w * result.h, 256);
+    histogram(hist, img_in.img_g, (size_t)img_in.h * img_in.w, 256);
+    histogram_equalization(result.img_g,img_in.img_g,hist,(size_t)result.w * result.h, 256);
+    histogram(hist, img_in.img_b, (size_t)img_in.h * img_in.w, 256);
+    histogram_equalization(result.img_b,img_in.img_b,hist,(size_t)result.w * result.h, 256);
+
+    return result;
+}
+
+
+PPM_IMG contrast_enhancement_c_yuv(PPM_IMG img_in)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+
+    histogram_yuv_y(hist, img_in);
+    histogram_lut(lut, hist, (size_t)img_in.w * img_in.h, 256);
+    return yuv_equalize_rgb(img_in, lut);
+}
+
+PPM_IMG contrast_enhancement_c_hsl(PPM_IMG img_in)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+
+    histogram_hsl_l(hist, img_in);
+    histogram_lut(lut, hist, (size_t)img_in.w * img_in.h, 256);
+    return hsl_equalize_rgb(img_in, lut);
+}
+
+
+// Las versiones intercaladas usan los mismos motores sobre una vista con stride 3
+PPM_PACKED_IMG contrast_enhancement_c_yuv_packed(PPM_PACKED_IMG img_in)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+    PPM_PACKED_IMG result;
+
+    histogram_yuv_y_pixels(hist, packed_view(img_in.img), (size_t)img_in.w * img_in.h);
+    histogram_lut(lut, hist, (size_t)img_in.w * img_in.h, 256);
+
+    result.w = img_in.w;
+    result.h = img_in.h;
+    result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+    yuv_equalize_pixels(lut, packed_view(img_in.img), packed_view(result.img), (size_t)img_in.w * img_in.h);
+    return result;
+}
+
+PPM_PACKED_IMG contrast_enhancement_c_hsl_packed(PPM_PACKED_IMG img_in)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+    PPM_PACKED_IMG result;
+
+    histogram_hsl_l_pixels(hist, packed_view(img_in.img), (size_t)img_in.w * img_in.h);
+    histogram_lut(lut, hist, (size_t)img_in.w * img_in.h, 256);
+
+    result.w = img_in.w;
+    result.h = img_in.h;
+    result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+    hsl_equalize_pixels(lut, packed_view(img_in.img), packed_view(result.img), (size_t)img_in.w * img_in.h);
+    return result;
+}
+
+// Variantes en el sitio: el resultado sobrescribe la imagen de entrada y no se reserva
+// ninguna imagen de salida, para cuando el llamador ya no necesita la entrada
+void contrast_enhancement_g_inplace(PGM_IMG img)
+{
+    int64_t hist[256];
+
+    histogram(hist, img.img, (size_t)img.h * img.w, 256);
+    histogram_equalization_inplace(img.img, hist, (size_t)img.w * img.h, 256);
+}
+
+void contrast_enhancement_c_yuv_inplace(PPM_IMG img)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+    RGB_VIEW view = planar_view(img.img_r, img.img_g, img.img_b);
+
+    histogram_yuv_y_pixels(hist, view, (size_t)img.w * img.h);
+    histogram_lut(lut, hist, (size_t)img.w * img.h, 256);
+    yuv_equalize_pixels(lut, view, view, (size_t)img.w * img.h);
+}
+
+void contrast_enhancement_c_hsl_inplace(PPM_IMG img)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+    RGB_VIEW view = planar_view(img.img_r, img.img_g, img.img_b);
+
+    histogram_hsl_l_pixels(hist, view, (size_t)img.w * img.h);
+    histogram_lut(lut, hist, (size_t)img.w * img.h, 256);
+    hsl_equalize_pixels(lut, view, view, (size_t)img.w * img.h);
+}
+
+void contrast_enhancement_c_yuv_packed_inplace(PPM_PACKED_IMG img)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+
+    histogram_yuv_y_pixels(hist, packed_view(img.img), (size_t)img.w * img.h);
+    histogram_lut(lut, hist, (size_t)img.w * img.h, 256);
+    yuv_equalize_pixels(lut, packed_view(img.img), packed_view(img.img), (size_t)img.w * img.h);
+}
+
+void contrast_enhancement_c_hsl_packed_inplace(PPM_PACKED_IMG img)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+
+    histogram_hsl_l_pixels(hist, packed_view(img.img), (size_t)img.w * img.h);
+    histogram_lut(lut, hist, (size_t)img.w * img.h, 256);
+    hsl_equalize_pixels(lut, packed_view(img.img), packed_view(img.img), (size_t)img.w * img.h);
+}
+
+// Bytes por píxel que ocupan a la vez los buffers de una banda en cada modo de streaming
+// (cada banda se ecualiza en el sitio, así que no hay buffer de salida)
+#define STREAM_BYTES_G   1   // banda de entrada, sobrescrita con el resultado
+#define STREAM_BYTES_YUV 3   // RGB intercalado de la banda (Y, U y V no se guardan)
+#define STREAM_BYTES_HSL 3   // RGB intercalado de la banda (H, S y L van por bloques)
+
+// Número de filas por banda para no superar mem_budget bytes (al menos una fila)
+static int stream_band_rows(int w, int h, int bytes_per_pixel, size_t mem_budget)
+{
+    size_t rows = mem_budget / ((size_t)w * bytes_per_pixel);
+    if (rows < 1)
+        rows = 1;
+    if (rows > (size_t)h)
+        rows = h;
+    printf("Streaming %d rows per band\n", (int)rows);
+    return (int)rows;
+}
+
+// Suma el histograma de img_size píxeles al acumulado en hist
+static void histogram_add(int64_t * hist, unsigned char * img_in, size_t img_size)
+{
+    int64_t hist_band[256];
+    histogram(hist_band, img_in, img_size, 256);
+    for (int i = 0; i < 256; i++)
+        hist[i] += hist_band[i];
+}
+
+void contrast_enhancement_g_stream(const char * in_path, const char * out_path, size_t mem_budget)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PGM_IMG band;
+    int64_t hist[256] = {0};
+    unsigned char lut[256];
+    int rows = stream_band_rows(in.w, in.h, STREAM_BYTES_G, mem_budget);
+    int row;
+
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc((size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la imagen completa
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_pgm_rows(in, row, band);
+        histogram_add(hist, band.img, (size_t)band.w * band.h);
+    }
+    histogram_lut(lut, hist, (size_t)in.w * in.h, 256);
+
+    // Segundo recorrido: ecualizar cada banda y escribirla en su sitio
+    out = create_pnm_stream(out_path, in.w, in.h, 1);
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_pgm_rows(in, row, band);
+        apply_lut(band.img, band.img, lut, (size_t)band.w * band.h);
+        write_pgm_rows(out, row, band);
+    }
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    pool_free(band.img);
+}
+
+// Modo C_YUV_VERIFY: píxeles que cambian respecto a la conversión en double
+static void report_fixed_diffs(const char * name, long diffs, size_t n)
+{
+    printf("%s fixed-point: %ld of %zu pixels differ from double precision\n", name, diffs, n);
+}
+
+void contrast_enhancement_c_yuv_stream(const char * in_path, const char * out_path, size_t mem_budget)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PPM_PACKED_IMG band;
+    int64_t hist[256] = {0};
+    int64_t band_hist[256];
+    unsigned char lut[256];
+    int rows = stream_band_rows(in.w, in.h, STREAM_BYTES_YUV, mem_budget);
+    int row;
+    long diffs = 0;
+
+    // Las bandas se procesan intercaladas, tal como están en el fichero, y en el sitio
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la luminancia Y, calculada directamente desde RGB
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        histogram_yuv_y_pixels(band_hist, packed_view(band.img), (size_t)band.w * band.h);
+        for (int i = 0; i < 256; i++)
+            hist[i] += band_hist[i];
+    }
+    histogram_lut(lut, hist, (size_t)in.w * in.h, 256);
+
+    // Segundo recorrido: ecualizar Y y volver a RGB banda a banda en un solo paso por píxel
+    out = create_pnm_stream(out_path, in.w, in.h, 3);
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        diffs += yuv_equalize_count(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+        write_ppm_packed_rows(out, row, band);
+    }
+
+    // En C_YUV_VERIFY se informa una vez por imagen, sumando todas las bandas
+    if (yuv_mode() == YUV_VERIFY)
+        report_fixed_diffs("yuv equalization", diffs, (size_t)in.w * in.h);
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    free_ppm_packed(band);
+}
+
+void contrast_enhancement_c_hsl_stream(const char * in_path, const char * out_path, size_t mem_budget)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PPM_PACKED_IMG band;
+    int64_t hist[256] = {0};
+    int64_t band_hist[256];
+    unsigned char lut[256];
+    int rows = stream_band_rows(in.w, in.h, STREAM_BYTES_HSL, mem_budget);
+    int row;
+
+    // Las bandas se procesan intercaladas, tal como están en el fichero, y en el sitio
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la luminosidad L, calculada directamente desde RGB
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        histogram_hsl_l_pixels(band_hist, packed_view(band.img), (size_t)band.w * band.h);
+        for (int i = 0; i < 256; i++)
+            hist[i] += band_hist[i];
+    }
+    histogram_lut(lut, hist, (size_t)in.w * in.h, 256);
+
+    // Segundo recorrido: recalcular HSL, ecualizar L y volver a RGB banda a banda
+    out = create_pnm_stream(out_path, in.w, in.h, 3);
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        hsl_equalize_pixels(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+        write_ppm_packed_rows(out, row, band);
+    }
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    free_ppm_packed(band);
+}
+
+
+// Motor HSL fusionado: el histograma de L se calcula desde RGB con solo el máximo y el
+// mínimo, y hsl_equalize_rgb recalcula H y S por bloques al volver a RGB, así que nunca
+// se reservan los planos H, S y L de toda la imagen
+void histogram_hsl_l_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n)
+{
+    memset(hist_out, 0, 256 * sizeof(int64_t));
+    parallel_histogram_blocks(hist_out, n, HIST_BLOCK, [&](int64_t * hist, size_t first, size_t count) {
+        unsigned char l[PIXEL_BLOCK];
+        for (size_t i = first; i < first + count; i += PIXEL_BLOCK) {
+            size_t len = (first + count - i < PIXEL_BLOCK) ? first + count - i : PIXEL_BLOCK;
+            rgb2hsl_lightness_view(view_offset(img_in, i), l, len);
+            histogram_banked(hist, l, len);
+        }
+    });
+}
+
+void histogram_hsl_l(int64_t * hist_out, PPM_IMG img_in)
+{
+    histogram_hsl_l_pixels(hist_out, planar_view(img_in.img_r, img_in.img_g, img_in.img_b), (size_t)img_in.w * img_in.h);
+}
+
+void hsl_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    parallel_blocks(n, PIXEL_BLOCK, [&](size_t i, size_t len) {
+        hsl_equalize_view(lut, view_offset(img_in, i), view_offset(img_out, i), len);
+    });
+}
+
+PPM_IMG hsl_equalize_rgb(PPM_IMG img_in, unsigned char * lut)
+{
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+
+    hsl_equalize_pixels(lut, planar_view(img_in.img_r, img_in.img_g, img_in.img_b),
+                        planar_view(result.img_r, result.img_g, result.img_b), (size_t)img_in.w * img_in.h);
+    return result;
+}
+
+// Motor YUV fusionado: el histograma de Y se calcula en un recorrido de solo lectura sobre
+// RGB y yuv_equalize_rgb produce la salida a partir de (LUT[Y], U, V) recalculando U y V
+// en cada píxel, así que nunca se guardan los planos YUV de la imagen
+void histogram_yuv_y_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n)
+{
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+
+    memset(hist_out, 0, 256 * sizeof(int64_t));
+    parallel_histogram_blocks(hist_out, n, HIST_BLOCK, [&](int64_t * hist, size_t first, size_t count) {
+        unsigned char y[PIXEL_BLOCK];
+        for (size_t i = first; i < first + count; i += PIXEL_BLOCK) {
+            size_t len = (first + count - i < PIXEL_BLOCK) ? first + count - i : PIXEL_BLOCK;
+            rgb2yuv_luma_view(view_offset(img_in, i), y, len, fixed);
+            histogram_banked(hist, y, len);
+        }
+    });
+}
+
+void histogram_yuv_y(int64_t * hist_out, PPM_IMG img_in)
+{
+    histogram_yuv_y_pixels(hist_out, planar_view(img_in.img_r, img_in.img_g, img_in.img_b), (size_t)img_in.w * img_in.h);
+}
+
+long yuv_equalize_count(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+    unsigned char * ref = NULL;
+    long diffs = 0;
+
+    // En C_YUV_VERIFY se compara la salida con la del motor en double usando la misma LUT.
+    // La referencia se calcula antes porque img_out puede ser la propia img_in (en el sitio)
+    if (yuv_mode() == YUV_VERIFY) {
+        ref = (unsigned char *)pool_alloc(3 * n * sizeof(unsigned char));
+        parallel_blocks(n, PIXEL_BLOCK, [&](size_t i, size_t len) {
+            yuv_equalize_view(lut, view_offset(img_in, i), packed_view(ref + 3 * i), len, 0);
+        });
+    }
+
+    parallel_blocks(n, PIXEL_BLOCK, [&](size_t i, size_t len) {
+        yuv_equalize_view(lut, view_offset(img_in, i), view_offset(img_out, i), len, fixed);
+    });
+
+    if (ref != NULL) {
+        diffs = count_view_diffs(img_out, packed_view(ref), n);
+        pool_free(ref);
+    }
+    return diffs;
+}
+
+void yuv_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    long diffs = yuv_equalize_count(lut, img_in, img_out, n);
+
+    if (yuv_mode() == YUV_VERIFY)
+        report_fixed_diffs("yuv equalization", diffs, n);
+}
+
+PPM_IMG yuv_equalize_rgb(PPM_IMG img_in, unsigned char * lut)
+{
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+
+    yuv_equalize_pixels(lut, planar_view(img_in.img_r, img_in.img_g, img_in.img_b),
+                        planar_view(result.img_r, result.img_g, result.img_b), (size_t)img_in.w * img_in.h);
+    return result;
+}
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "hist-equ.h"
+#include "pixel-kernels.h"
+
+
+void histogram(int64_t * hist_out, unsigned char * img_in, size_t img_size, int nbr_bin){
+    int i;
+    for ( i = 0; i < nbr_bin; i ++){
+        hist_out[i] = 0;
+    }
+
+    parallel_histogram_blocks(hist_out, img_size, HIST_BLOCK, [&](int64_t * hist, size_t i, size_t len) {
+        histogram_banked(hist, img_in + i, len);
+    });
+}
+
+void histogram_lut(unsigned char * lut, int64_t * hist_in, size_t img_size, int nbr_bin){
+    int i, v;
+    int64_t cdf, min, d; // En 64 bits: una imagen puede tener más de 2^31 píxeles
+    /* Construct the LUT by calculating the CDF */
+    cdf = 0;
+    min = 0;
+    i = 0;
+    while(min == 0){
+        min = hist_in[i++];
+    }
+    d = img_size - min;
+    for(i = 0; i < nbr_bin; i ++){
+        cdf += hist_in[i];
+        //lut[i] = (cdf - min)*(nbr_bin - 1)/d;
+        v = (int)(((float)cdf - min)*255/d + 0.5);
+        /* The table is stored already clamped to [0, 255] */
+        if(v < 0){
+            v = 0;
+        }
+        if(v > 255){
+            v = 255;
+        }
+        lut[i] = (unsigned char)v;
+        
+        
+    }
+}
+
+void apply_lut(unsigned char * img_out, unsigned char * img_in, unsigned char * lut, size_t img_size){
+    /* Get the result image */
+    parallel_blocks(img_size, PIXEL_BLOCK, [&](size_t i, size_t len) {
+        apply_lut_u8(lut, img_in + i, img_out + i, len);
+    });
+}
+
+void histogram_equalization(unsigned char * img_out, unsigned char * img_in, 
+                            int64_t * hist_in, size_t img_size, int nbr_bin){
+    unsigned char lut[256]; // nbr_bin es siempre 256: la tabla va en la pila, sin reservas por llamada
+    histogram_lut(lut, hist_in, img_size, nbr_bin);
+    apply_lut(img_out, img_in, lut, img_size);
+}
+
+// Ecualización en el sitio: img se sobrescribe con el resultado
+void histogram_equalization_inplace(unsigned char * img, int64_t * hist_in, size_t img_size, int nbr_bin){
+    histogram_equalization(img, img, hist_in, img_size, nbr_bin);
+}
@@ -2,38 +2,33 @@
 #include <string.h>
 #include <stdlib.h>
 #include "hist-equ.h"
+#include "pixel-kernels.h"
 
 PGM_IMG contrast_enhancement_g(PGM_IMG img_in)
 {
     PGM_IMG result;
-    int hist[256];
+    int64_t hist[256];
     
     result.w = img_in.w;
     result.h = img_in.h;
-    result.img = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
+    result.img = (unsigned char *)pool_alloc((size_t)result.w * result.h * sizeof(unsigned char));
     
-    histogram(hist, img_in.img, img_in.h * img_in.w, 256);
-    histogram_equalization(result.img,img_in.img,hist,result.w*result.h, 256);
+    histogram(hist, img_in.img, (size_t)img_in.h * img_in.w, 256);
+    histogram_equalization(result.img,img_in.img,hist,(size_t)result.w * result.h, 256);
     return result;
 }
 
 PPM_IMG contrast_enhancement_c_rgb(PPM_IMG img_in)
 {
-    PPM_IMG result;
-    int hist[256];
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+    int64_t hist[256];
     
-    result.w = img_in.w;
-    result.h = img_in.h;
-    result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    
-    histogram(hist, img_in.img_r, img_in.h * img_in.w, 256);
-    histogram_equalization(result.img_r,img_in.img_r,hist,result.w*result.h, 256);
-    histogram(hist, img_in.img_g, img_in.h * img_in.w, 256);
-    histogram_equalization(result.img_g,img_in.img_g,hist,result.w*result.h, 256);
-    histogram(hist, img_in.img_b, img_in.h * img_in.w, 256);
-    histogram_equalization(result.img_b,img_in.img_b,hist,result.w*result.h, 256);
+    histogram(hist, img_in.img_r, (size_t)img_in.h * img_in.w, 256);
+    histogram_equalization(result.img_r,img_in.img_r,hist,(size_t)result.w * result.h, 256);
+    histogram(hist, img_in.img_g, (size_t)img_in.h * img_in.w, 256);
+    histogram_equalization(result.img_g,img_in.img_g,hist,(size_t)result.w * result.h, 256);
+    histogram(hist, img_in.img_b, (size_t)img_in.h * img_in.w, 256);
+    histogram_equalization(result.img_b,img_in.img_b,hist,(size_t)result.w * result.h, 256);
 
     return result;
 }
@@ -41,248 +36,354 @@ PPM_IMG contrast_enhancement_c_rgb(PPM_IMG img_in)
 
 PPM_IMG contrast_enhancement_c_yuv(PPM_IMG img_in)
 {
-    YUV_IMG yuv_med;
-    PPM_IMG result;
-    
-    unsigned char * y_equ;
-    int hist[256];
-    
-    yuv_med = rgb2yuv(img_in);
-    y_equ = (unsigned char *)malloc(yuv_med.h*yuv_med.w*sizeof(unsigned char));
-    
-    histogram(hist, yuv_med.img_y, yuv_med.h * yuv_med.w, 256);
-    histogram_equalization(y_equ,yuv_med.img_y,hist,yuv_med.h * yuv_med.w, 256);
+    int64_t hist[256];
+    unsigned char lut[256];
 
-    free(yuv_med.img_y);
-    yuv_med.img_y = y_equ;
-    
-    result = yuv2rgb(yuv_med);
-    free(yuv_med.img_y);
-    free(yuv_med.img_u);
-    free(yuv_med.img_v);
-    
-    return result;
+    histogram_yuv_y(hist, img_in);
+    histogram_lut(lut, hist, (size_t)img_in.w * img_in.h, 256);
+    return yuv_equalize_rgb(img_in, lut);
 }
 
 PPM_IMG contrast_enhancement_c_hsl(PPM_IMG img_in)
 {
-    HSL_IMG hsl_med;
-    PPM_IMG result;
-    
-    unsigned char * l_equ;
-    int hist[256];
+    int64_t hist[256];
+    unsigned char lut[256];
 
-    hsl_med = rgb2hsl(img_in);
-    l_equ = (unsigned char *)malloc(hsl_med.height*hsl_med.width*sizeof(unsigned char));
+    histogram_hsl_l(hist, img_in);
+    histogram_lut(lut, hist, (size_t)img_in.w * img_in.h, 256);
+    return hsl_equalize_rgb(img_in, lut);
+}
 
-    histogram(hist, hsl_med.l, hsl_med.height * hsl_med.width, 256);
-    histogram_equalization(l_equ, hsl_med.l,hist,hsl_med.width*hsl_med.height, 256);
-    
-    free(hsl_med.l);
-    hsl_med.l = l_equ;
 
-    result = hsl2rgb(hsl_med);
-    free(hsl_med.h);
-    free(hsl_med.s);
-    free(hsl_med.l);
+// Las versiones intercaladas usan los mismos motores sobre una vista con stride 3
+PPM_PACKED_IMG contrast_enhancement_c_yuv_packed(PPM_PACKED_IMG img_in)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+    PPM_PACKED_IMG result;
+
+    histogram_yuv_y_pixels(hist, packed_view(img_in.img), (size_t)img_in.w * img_in.h);
+    histogram_lut(lut, hist, (size_t)img_in.w * img_in.h, 256);
+
+    result.w = img_in.w;
+    result.h = img_in.h;
+    result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+    yuv_equalize_pixels(lut, packed_view(img_in.img), packed_view(result.img), (size_t)img_in.w * img_in.h);
     return result;
 }
 
+PPM_PACKED_IMG contrast_enhancement_c_hsl_packed(PPM_PACKED_IMG img_in)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+    PPM_PACKED_IMG result;
+
+    histogram_hsl_l_pixels(hist, packed_view(img_in.img), (size_t)img_in.w * img_in.h);
+    histogram_lut(lut, hist, (size_t)img_in.w * img_in.h, 256);
+
+    result.w = img_in.w;
+    result.h = img_in.h;
+    result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+    hsl_equalize_pixels(lut, packed_view(img_in.img), packed_view(result.img), (size_t)img_in.w * img_in.h);
+    return result;
+}
 
-//Convert RGB to HSL, assume R,G,B in [0, 255]
-//Output H, S in [0.0, 1.0] and L in [0, 255]
-HSL_IMG rgb2hsl(PPM_IMG img_in)
+// Variantes en el sitio: el resultado sobrescribe la imagen de entrada y no se reserva
+// ninguna imagen de salida, para cuando el llamador ya no necesita la entrada
+void contrast_enhancement_g_inplace(PGM_IMG img)
 {
-    int i;
-    float H, S, L;
-    HSL_IMG img_out;// = (HSL_IMG *)malloc(sizeof(HSL_IMG));
-    img_out.width  = img_in.w;
-    img_out.height = img_in.h;
-    img_out.h = (float *)malloc(img_in.w * img_in.h * sizeof(float));
-    img_out.s = (float *)malloc(img_in.w * img_in.h * sizeof(float));
-    img_out.l = (unsigned char *)malloc(img_in.w * img_in.h * sizeof(unsigned char));
-    
-    for(i = 0; i < img_in.w*img_in.h; i ++){
-        
-        float var_r = ( (float)img_in.img_r[i]/255 );//Convert RGB to [0,1]
-        float var_g = ( (float)img_in.img_g[i]/255 );
-        float var_b = ( (float)img_in.img_b[i]/255 );
-        float var_min = (var_r < var_g) ? var_r : var_g;
-        var_min = (var_min < var_b) ? var_min : var_b;   //min. value of RGB
-        float var_max = (var_r > var_g) ? var_r : var_g;
-        var_max = (var_max > var_b) ? var_max : var_b;   //max. value of RGB
-        float del_max = var_max - var_min;               //Delta RGB value
-        
-        L = ( var_max + var_min ) / 2;
-        if ( del_max == 0 )//This is a gray, no chroma...
-        {
-            H = 0;         
-            S = 0;    
-        }
-        else                                    //Chromatic data...
-        {
-            if ( L < 0.5 )
-                S = del_max/(var_max+var_min);
-            else
-                S = del_max/(2-var_max-var_min );
-
-            float del_r = (((var_max-var_r)/6)+(del_max/2))/del_max;
-            float del_g = (((var_max-var_g)/6)+(del_max/2))/del_max;
-            float del_b = (((var_max-var_b)/6)+(del_max/2))/del_max;
-            if( var_r == var_max ){
-                H = del_b - del_g;
-            }
-            else{       
-                if( var_g == var_max ){
-                    H = (1.0/3.0) + del_r - del_b;
-                }
-                else{
-                        H = (2.0/3.0) + del_g - del_r;
-                }   
-            }
-            
-        }
-        
-        if ( H < 0 )
-            H += 1;
-        if ( H > 1 )
-            H -= 1;
-
-        img_out.h[i] = H;
-        img_out.s[i] = S;
-        img_out.l[i] = (unsigned char)(L*255);
+    int64_t hist[256];
+
+    histogram(hist, img.img, (size_t)img.h * img.w, 256);
+    histogram_equalization_inplace(img.img, hist, (size_t)img.w * img.h, 256);
+}
+
+void contrast_enhancement_c_yuv_inplace(PPM_IMG img)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+    RGB_VIEW view = planar_view(img.img_r, img.img_g, img.img_b);
+
+    histogram_yuv_y_pixels(hist, view, (size_t)img.w * img.h);
+    histogram_lut(lut, hist, (size_t)img.w * img.h, 256);
+    yuv_equalize_pixels(lut, view, view, (size_t)img.w * img.h);
+}
+
+void contrast_enhancement_c_hsl_inplace(PPM_IMG img)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+    RGB_VIEW view = planar_view(img.img_r, img.img_g, img.img_b);
+
+    histogram_hsl_l_pixels(hist, view, (size_t)img.w * img.h);
+    histogram_lut(lut, hist, (size_t)img.w * img.h, 256);
+    hsl_equalize_pixels(lut, view, view, (size_t)img.w * img.h);
+}
+
+void contrast_enhancement_c_yuv_packed_inplace(PPM_PACKED_IMG img)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+
+    histogram_yuv_y_pixels(hist, packed_view(img.img), (size_t)img.w * img.h);
+    histogram_lut(lut, hist, (size_t)img.w * img.h, 256);
+    yuv_equalize_pixels(lut, packed_view(img.img), packed_view(img.img), (size_t)img.w * img.h);
+}
+
+void contrast_enhancement_c_hsl_packed_inplace(PPM_PACKED_IMG img)
+{
+    int64_t hist[256];
+    unsigned char lut[256];
+
+    histogram_hsl_l_pixels(hist, packed_view(img.img), (size_t)img.w * img.h);
+    histogram_lut(lut, hist, (size_t)img.w * img.h, 256);
+    hsl_equalize_pixels(lut, packed_view(img.img), packed_view(img.img), (size_t)img.w * img.h);
+}
+
+// Bytes por píxel que ocupan a la vez los buffers de una banda en cada modo de streaming
+// (cada banda se ecualiza en el sitio, así que no hay buffer de salida)
+#define STREAM_BYTES_G   1   // banda de entrada, sobrescrita con el resultado
+#define STREAM_BYTES_YUV 3   // RGB intercalado de la banda (Y, U y V no se guardan)
+#define STREAM_BYTES_HSL 3   // RGB intercalado de la banda (H, S y L van por bloques)
+
+// Número de filas por banda para no superar mem_budget bytes (al menos una fila)
+static int stream_band_rows(int w, int h, int bytes_per_pixel, size_t mem_budget)
+{
+    size_t rows = mem_budget / ((size_t)w * bytes_per_pixel);
+    if (rows < 1)
+        rows = 1;
+    if (rows > (size_t)h)
+        rows = h;
+    printf("Streaming %d rows per band\n", (int)rows);
+    return (int)rows;
+}
+
+// Suma el histograma de img_size píxeles al acumulado en hist
+static void histogram_add(int64_t * hist, unsigned char * img_in, size_t img_size)
+{
+    int64_t hist_band[256];
+    histogram(hist_band, img_in, img_size, 256);
+    for (int i = 0; i < 256; i++)
+        hist[i] += hist_band[i];
+}
+
+void contrast_enhancement_g_stream(const char * in_path, const char * out_path, size_t mem_budget)
+{
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PGM_IMG band;
+    int64_t hist[256] = {0};
+    unsigned char lut[256];
+    int rows = stream_band_rows(in.w, in.h, STREAM_BYTES_G, mem_budget);
+    int row;
+
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc((size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la imagen completa
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_pgm_rows(in, row, band);
+        histogram_add(hist, band.img, (size_t)band.w * band.h);
     }
-    
-    return img_out;
+    histogram_lut(lut, hist, (size_t)in.w * in.h, 256);
+
+    // Segundo recorrido: ecualizar cada banda y escribirla en su sitio
+    out = create_pnm_stream(out_path, in.w, in.h, 1);
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_pgm_rows(in, row, band);
+        apply_lut(band.img, band.img, lut, (size_t)band.w * band.h);
+        write_pgm_rows(out, row, band);
+    }
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    pool_free(band.img);
 }
 
-float Hue_2_RGB( float v1, float v2, float vH )             //Function Hue_2_RGB
+// Modo C_YUV_VERIFY: píxeles que cambian respecto a la conversión en double
+static void report_fixed_diffs(const char * name, long diffs, size_t n)
 {
-    if ( vH < 0 ) vH += 1;
-    if ( vH > 1 ) vH -= 1;
-    if ( ( 6 * vH ) < 1 ) return ( v1 + ( v2 - v1 ) * 6 * vH );
-    if ( ( 2 * vH ) < 1 ) return ( v2 );
-    if ( ( 3 * vH ) < 2 ) return ( v1 + ( v2 - v1 ) * ( ( 2.0f/3.0f ) - vH ) * 6 );
-    return ( v1 );
+    printf("%s fixed-point: %ld of %zu pixels differ from double precision\n", name, diffs, n);
 }
 
-//Convert HSL to RGB, assume H, S in [0.0, 1.0] and L in [0, 255]
-//Output R,G,B in [0, 255]
-PPM_IMG hsl2rgb(HSL_IMG img_in)
+void contrast_enhancement_c_yuv_stream(const char * in_path, const char * out_path, size_t mem_budget)
 {
-    int i;
-    PPM_IMG result;
-    
-    result.w = img_in.width;
-    result.h = img_in.height;
-    result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    
-    for(i = 0; i < img_in.width*img_in.height; i ++){
-        float H = img_in.h[i];
-        float S = img_in.s[i];
-        float L = img_in.l[i]/255.0f;
-        float var_1, var_2;
-        
-        unsigned char r,g,b;
-        
-        if ( S == 0 )
-        {
-            r = L * 255;
-            g = L * 255;
-            b = L * 255;
-        }
-        else
-        {
-            
-            if ( L < 0.5 )
-                var_2 = L * ( 1 + S );
-            else
-                var_2 = ( L + S ) - ( S * L );
-
-            var_1 = 2 * L - var_2;
-            r = 255 * Hue_2_RGB( var_1, var_2, H + (1.0f/3.0f) );
-            g = 255 * Hue_2_RGB( var_1, var_2, H );
-            b = 255 * Hue_2_RGB( var_1, var_2, H - (1.0f/3.0f) );
-        }
-        result.img_r[i] = r;
-        result.img_g[i] = g;
-        result.img_b[i] = b;
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PPM_PACKED_IMG band;
+    int64_t hist[256] = {0};
+    int64_t band_hist[256];
+    unsigned char lut[256];
+    int rows = stream_band_rows(in.w, in.h, STREAM_BYTES_YUV, mem_budget);
+    int row;
+    long diffs = 0;
+
+    // Las bandas se procesan intercaladas, tal como están en el fichero, y en el sitio
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la luminancia Y, calculada directamente desde RGB
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        histogram_yuv_y_pixels(band_hist, packed_view(band.img), (size_t)band.w * band.h);
+        for (int i = 0; i < 256; i++)
+            hist[i] += band_hist[i];
     }
+    histogram_lut(lut, hist, (size_t)in.w * in.h, 256);
 
-    return result;
+    // Segundo recorrido: ecualizar Y y volver a RGB banda a banda en un solo paso por píxel
+    out = create_pnm_stream(out_path, in.w, in.h, 3);
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        diffs += yuv_equalize_count(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+        write_ppm_packed_rows(out, row, band);
+    }
+
+    // En C_YUV_VERIFY se informa una vez por imagen, sumando todas las bandas
+    if (yuv_mode() == YUV_VERIFY)
+        report_fixed_diffs("yuv equalization", diffs, (size_t)in.w * in.h);
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    free_ppm_packed(band);
 }
 
-//Convert RGB to YUV, all components in [0, 255]
-YUV_IMG rgb2yuv(PPM_IMG img_in)
+void contrast_enhancement_c_hsl_stream(const char * in_path, const char * out_path, size_t mem_budget)
 {
-    YUV_IMG img_out;
-    int i;//, j;
-    unsigned char r, g, b;
-    unsigned char y, cb, cr;
-    
-    img_out.w = img_in.w;
-    img_out.h = img_in.h;
-    img_out.img_y = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_u = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_v = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-
-    for(i = 0; i < img_out.w*img_out.h; i ++){
-        r = img_in.img_r[i];
-        g = img_in.img_g[i];
-        b = img_in.img_b[i];
-        
-        y  = (unsigned char)( 0.299*r + 0.587*g +  0.114*b);
-        cb = (unsigned char)(-0.169*r - 0.331*g +  0.499*b + 128);
-        cr = (unsigned char)( 0.499*r - 0.418*g - 0.0813*b + 128);
-        
-        img_out.img_y[i] = y;
-        img_out.img_u[i] = cb;
-        img_out.img_v[i] = cr;
+    PNM_STREAM in = open_pnm_stream(in_path);
+    PNM_STREAM out;
+    PPM_PACKED_IMG band;
+    int64_t hist[256] = {0};
+    int64_t band_hist[256];
+    unsigned char lut[256];
+    int rows = stream_band_rows(in.w, in.h, STREAM_BYTES_HSL, mem_budget);
+    int row;
+
+    // Las bandas se procesan intercaladas, tal como están en el fichero, y en el sitio
+    band.w = in.w;
+    band.img = (unsigned char *)pool_alloc(3 * (size_t)band.w * rows * sizeof(unsigned char));
+
+    // Primer recorrido: histograma de la luminosidad L, calculada directamente desde RGB
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        histogram_hsl_l_pixels(band_hist, packed_view(band.img), (size_t)band.w * band.h);
+        for (int i = 0; i < 256; i++)
+            hist[i] += band_hist[i];
     }
-    
-    return img_out;
+    histogram_lut(lut, hist, (size_t)in.w * in.h, 256);
+
+    // Segundo recorrido: recalcular HSL, ecualizar L y volver a RGB banda a banda
+    out = create_pnm_stream(out_path, in.w, in.h, 3);
+    for (row = 0; row < in.h; row += rows) {
+        band.h = (in.h - row < rows) ? in.h - row : rows;
+        read_ppm_packed_rows(in, row, band);
+        hsl_equalize_pixels(lut, packed_view(band.img), packed_view(band.img), (size_t)band.w * band.h);
+        write_ppm_packed_rows(out, row, band);
+    }
+
+    close_pnm_stream(in);
+    close_pnm_stream(out);
+    free_ppm_packed(band);
 }
 
-unsigned char clip_rgb(int x)
+
+// Motor HSL fusionado: el histograma de L se calcula desde RGB con solo el máximo y el
+// mínimo, y hsl_equalize_rgb recalcula H y S por bloques al volver a RGB, así que nunca
+// se reservan los planos H, S y L de toda la imagen
+void histogram_hsl_l_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n)
 {
-    if(x > 255)
-        return 255;
-    if(x < 0)
-        return 0;
+    unsigned char l[PIXEL_BLOCK];
+    size_t i;
 
-    return (unsigned char)x;
+    memset(hist_out, 0, 256 * sizeof(int64_t));
+    for (i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        rgb2hsl_lightness_view(view_offset(img_in, i), l, len);
+        histogram_banked(hist_out, l, len);
+    }
 }
 
-//Convert YUV to RGB, all components in [0, 255]
-PPM_IMG yuv2rgb(YUV_IMG img_in)
+void histogram_hsl_l(int64_t * hist_out, PPM_IMG img_in)
 {
-    PPM_IMG img_out;
-    int i;
-    int  rt,gt,bt;
-    int y, cb, cr;
-    
-    
-    img_out.w = img_in.w;
-    img_out.h = img_in.h;
-    img_out.img_r = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_g = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-    img_out.img_b = (unsigned char *)malloc(sizeof(unsigned char)*img_out.w*img_out.h);
-
-    for(i = 0; i < img_out.w*img_out.h; i ++){
-        y  = (int)img_in.img_y[i];
-        cb = (int)img_in.img_u[i] - 128;
-        cr = (int)img_in.img_v[i] - 128;
-        
-        rt  = (int)( y + 1.402*cr);
-        gt  = (int)( y - 0.344*cb - 0.714*cr);
-        bt  = (int)( y + 1.772*cb);
-
-        img_out.img_r[i] = clip_rgb(rt);
-        img_out.img_g[i] = clip_rgb(gt);
-        img_out.img_b[i] = clip_rgb(bt);
+    histogram_hsl_l_pixels(hist_out, planar_view(img_in.img_r, img_in.img_g, img_in.img_b), (size_t)img_in.w * img_in.h);
+}
+
+void hsl_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    hsl_equalize_view(lut, img_in, img_out, n);
+}
+
+PPM_IMG hsl_equalize_rgb(PPM_IMG img_in, unsigned char * lut)
+{
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+
+    hsl_equalize_pixels(lut, planar_view(img_in.img_r, img_in.img_g, img_in.img_b),
+                        planar_view(result.img_r, result.img_g, result.img_b), (size_t)img_in.w * img_in.h);
+    return result;
+}
+
+// Motor YUV fusionado: el histograma de Y se calcula en un recorrido de solo lectura sobre
+// RGB y yuv_equalize_rgb produce la salida a partir de (LUT[Y], U, V) recalculando U y V
+// en cada píxel, así que nunca se guardan los planos YUV de la imagen
+void histogram_yuv_y_pixels(int64_t * hist_out, RGB_VIEW img_in, size_t n)
+{
+    unsigned char y[PIXEL_BLOCK];
+    size_t i;
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+
+    memset(hist_out, 0, 256 * sizeof(int64_t));
+    for (i = 0; i < n; i += PIXEL_BLOCK) {
+        size_t len = (n - i < PIXEL_BLOCK) ? n - i : PIXEL_BLOCK;
+        rgb2yuv_luma_view(view_offset(img_in, i), y, len, fixed);
+        histogram_banked(hist_out, y, len);
     }
-    
-    return img_out;
+}
+
+void histogram_yuv_y(int64_t * hist_out, PPM_IMG img_in)
+{
+    histogram_yuv_y_pixels(hist_out, planar_view(img_in.img_r, img_in.img_g, img_in.img_b), (size_t)img_in.w * img_in.h);
+}
+
+long yuv_equalize_count(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    int fixed = (yuv_mode() != YUV_DOUBLE);
+    unsigned char * ref = NULL;
+    long diffs = 0;
+
+    // En C_YUV_VERIFY se compara la salida con la del motor en double usando la misma LUT.
+    // La referencia se calcula antes porque img_out puede ser la propia img_in (en el sitio)
+    if (yuv_mode() == YUV_VERIFY) {
+        ref = (unsigned char *)pool_alloc(3 * n * sizeof(unsigned char));
+        yuv_equalize_view(lut, img_in, packed_view(ref), n, 0);
+    }
+
+    yuv_equalize_view(lut, img_in, img_out, n, fixed);
+
+    if (ref != NULL) {
+        diffs = count_view_diffs(img_out, packed_view(ref), n);
+        pool_free(ref);
+    }
+    return diffs;
+}
+
+void yuv_equalize_pixels(unsigned char * lut, RGB_VIEW img_in, RGB_VIEW img_out, size_t n)
+{
+    long diffs = yuv_equalize_count(lut, img_in, img_out, n);
+
+    if (yuv_mode() == YUV_VERIFY)
+        report_fixed_diffs("yuv equalization", diffs, n);
+}
+
+PPM_IMG yuv_equalize_rgb(PPM_IMG img_in, unsigned char * lut)
+{
+    PPM_IMG result = alloc_ppm(img_in.w, img_in.h);
+
+    yuv_equalize_pixels(lut, planar_view(img_in.img_r, img_in.img_g, img_in.img_b),
+                        planar_view(result.img_r, result.img_g, result.img_b), (size_t)img_in.w * img_in.h);
+    return result;
 }
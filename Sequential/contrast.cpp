@@ -1,7 +1,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "hist-equ.h"
+#include "pixel-kernels.h"
+#include "pnm-header.h"
 #include <mpi.h>
 #include <omp.h>
 
@@ -17,8 +23,11 @@ typedef struct {
     double time_write_yuv;
 } timeColor;
 
-timeColor run_cpu_color_test(PPM_IMG img_in);
-timeGray run_cpu_gray_test(PGM_IMG img_in);
+timeColor run_cpu_color_test(PPM_IMG img_in, int inplace);
+timeColor run_cpu_color_test_packed(PPM_PACKED_IMG img_in, int inplace);
+timeGray run_cpu_gray_test(PGM_IMG img_in, int inplace);
+timeColor run_cpu_color_test_stream(size_t mem_budget);
+timeGray run_cpu_gray_test_stream(size_t mem_budget);
 
 void save_data_csv(const char *planning, const char *process, const char *type, double time, double TotalTime);
 
@@ -26,32 +35,106 @@ void save_data_csv(const char *planning, const char *process, const char *type,
 int main(int argc, char *argv[]){
     PGM_IMG img_ibuf_g;
     PPM_IMG img_ibuf_c;
+    PPM_PACKED_IMG img_packed_c;
+    MAPPED_IMG map_g;   // Proyección de in.pgm cuando se lee con mmap
+    MAPPED_IMG map_c;   // Proyección de in.ppm con C_PACKED y C_MMAP_READ
+
+    // C_MMAP_READ=1: leer las imágenes de entrada mediante mmap
+    const char *mmap_str = getenv("C_MMAP_READ");
+    int use_mmap = (mmap_str != NULL) ? atoi(mmap_str) : 0;
+
+    // C_STREAM=1: procesar por bandas leídas del disco sin cargar la imagen completa,
+    // usando como máximo C_STREAM_MEM_MB megabytes para los buffers de cada banda
+    const char *stream_str = getenv("C_STREAM");
+    int use_stream = (stream_str != NULL) ? atoi(stream_str) : 0;
+    const char *budget_str = getenv("C_STREAM_MEM_MB");
+    size_t mem_budget = (size_t)((budget_str != NULL) ? atoi(budget_str) : 256) << 20;
+
+    // C_PACKED=1: procesar la imagen en color con los canales intercalados, sin separarlos
+    // al leer ni volver a intercalarlos al escribir
+    const char *packed_str = getenv("C_PACKED");
+    int use_packed = (packed_str != NULL) ? atoi(packed_str) : 0;
+
+    // C_INPLACE=1: ecualizar sobre la propia imagen de entrada, sin reservar imagen de
+    // salida (la ecualización YUV de color, que es la última en leer la entrada)
+    const char *inplace_str = getenv("C_INPLACE");
+    int use_inplace = (inplace_str != NULL) ? atoi(inplace_str) : 0;
 
     //Initialize MPI
     MPI_Init(&argc, &argv);
 
+    // C_HIST_BENCH=<píxeles>: medir el núcleo de histograma antes de procesar las imágenes
+    const char *bench_str = getenv("C_HIST_BENCH");
+    if (bench_str != NULL && atoll(bench_str) > 0) {
+        histogram_bench((size_t)atoll(bench_str));
+    }
+
     double tstart = MPI_Wtime();
 
     printf("Running contrast enhancement for gray-scale images.\n");
-    double tstart_read_pgm = MPI_Wtime();
-    img_ibuf_g = read_pgm("in.pgm");
-    double tend_read_pgm = MPI_Wtime();
+    double tstart_read_pgm, tend_read_pgm, tstart_read_ppm, tend_read_ppm;
+    timeGray t_gray;
+    timeColor time_c;
 
-    timeGray t_gray = run_cpu_gray_test(img_ibuf_g);
+    if (use_stream) {
+        // La lectura se hace banda a banda dentro del procesamiento
+        tstart_read_pgm = tend_read_pgm = MPI_Wtime();
+        t_gray = run_cpu_gray_test_stream(mem_budget);
 
-    free_pgm(img_ibuf_g);
+        printf("Running contrast enhancement for color images.\n");
+        tstart_read_ppm = tend_read_ppm = MPI_Wtime();
+        time_c = run_cpu_color_test_stream(mem_budget);
+    } else {
+        tstart_read_pgm = MPI_Wtime();
+        if (use_mmap) {
+            map_g = map_pnm("in.pgm");
+            img_ibuf_g = pgm_view(map_g); // Sin copia
+        } else {
+            img_ibuf_g = read_pgm("in.pgm");
+        }
+        tend_read_pgm = MPI_Wtime();
+
+        t_gray = run_cpu_gray_test(img_ibuf_g, use_inplace);
+
+        if (use_mmap) {
+            unmap_pnm(map_g);
+        } else {
+            free_pgm(img_ibuf_g);
+        }
     
-    printf("Running contrast enhancement for color images.\n");
-    double tstart_read_ppm = MPI_Wtime();
-    img_ibuf_c = read_ppm("in.ppm");
-    double tend_read_ppm = MPI_Wtime();
-
-    timeColor time_c = run_cpu_color_test(img_ibuf_c);
-    free_ppm(img_ibuf_c);
+        printf("Running contrast enhancement for color images.\n");
+        if (use_packed) {
+            tstart_read_ppm = MPI_Wtime();
+            if (use_mmap) {
+                map_c = map_pnm("in.ppm");
+                img_packed_c = ppm_packed_view(map_c); // Sin copia
+            } else {
+                img_packed_c = read_ppm_packed("in.ppm");
+            }
+            tend_read_ppm = MPI_Wtime();
+
+            time_c = run_cpu_color_test_packed(img_packed_c, use_inplace);
+            if (use_mmap) {
+                unmap_pnm(map_c);
+            } else {
+                free_ppm_packed(img_packed_c);
+            }
+        } else {
+            tstart_read_ppm = MPI_Wtime();
+            img_ibuf_c = use_mmap ? read_ppm_mmap("in.ppm") : read_ppm("in.ppm");
+            tend_read_ppm = MPI_Wtime();
+
+            time_c = run_cpu_color_test(img_ibuf_c, use_inplace);
+            free_ppm(img_ibuf_c);
+        }
+    }
     
     double tfinish = MPI_Wtime();
     double TotalTime = tfinish - tstart;
     printf("Total time: %f\n", TotalTime);
+    printf("Kernel ISA: %s\n", isa_name());
+    pool_report(stdout);
+    pool_trim();
 
     //Finalize MPI
     MPI_Finalize();
@@ -97,7 +180,7 @@ void save_data_csv(const char *planning, const char *process, const char *type,
     fclose(f_csv);
 }
 
-timeColor run_cpu_color_test(PPM_IMG img_in)
+timeColor run_cpu_color_test(PPM_IMG img_in, int inplace)
 {
     PPM_IMG img_obuf_hsl, img_obuf_yuv;
     timeColor times;
@@ -116,7 +199,13 @@ timeColor run_cpu_color_test(PPM_IMG img_in)
     times.time_write_hsl = tfinish - tstart;
 
     tstart = MPI_Wtime();
-    img_obuf_yuv = contrast_enhancement_c_yuv(img_in);
+    if (inplace) {
+        // La entrada ya no se vuelve a leer: el resultado YUV la sobrescribe
+        contrast_enhancement_c_yuv_inplace(img_in);
+        img_obuf_yuv = img_in;
+    } else {
+        img_obuf_yuv = contrast_enhancement_c_yuv(img_in);
+    }
     tfinish = MPI_Wtime();
     printf("YUV processing time: %f (s)\n", tfinish - tstart);
     times.time_yuv = tfinish - tstart;
@@ -127,15 +216,58 @@ timeColor run_cpu_color_test(PPM_IMG img_in)
     times.time_write_yuv = tfinish - tstart;
     
     free_ppm(img_obuf_hsl);
-    free_ppm(img_obuf_yuv);
+    if (!inplace)
+        free_ppm(img_obuf_yuv);
 
     return times;
 }
 
+timeColor run_cpu_color_test_packed(PPM_PACKED_IMG img_in, int inplace)
+{
+    PPM_PACKED_IMG img_obuf_hsl, img_obuf_yuv;
+    timeColor times;
+    
+    printf("Starting CPU processing...\n");
+    
+    double tstart = MPI_Wtime();
+    img_obuf_hsl = contrast_enhancement_c_hsl_packed(img_in);
+    double tfinish = MPI_Wtime();
+    printf("HSL processing time: %f (s)\n", tfinish - tstart);
+    times.time_hsl = tfinish - tstart;
+    
+    tstart = MPI_Wtime();
+    write_ppm_packed(img_obuf_hsl, "out_hsl.ppm");
+    tfinish = MPI_Wtime();
+    times.time_write_hsl = tfinish - tstart;
 
+    tstart = MPI_Wtime();
+    if (inplace) {
+        // La entrada ya no se vuelve a leer: el resultado YUV la sobrescribe
+        contrast_enhancement_c_yuv_packed_inplace(img_in);
+        img_obuf_yuv = img_in;
+    } else {
+        img_obuf_yuv = contrast_enhancement_c_yuv_packed(img_in);
+    }
+    tfinish = MPI_Wtime();
+    printf("YUV processing time: %f (s)\n", tfinish - tstart);
+    times.time_yuv = tfinish - tstart;
+    
+    tstart = MPI_Wtime();
+    write_ppm_packed(img_obuf_yuv, "out_yuv.ppm");
+    tfinish = MPI_Wtime();
+    times.time_write_yuv = tfinish - tstart;
+    
+    free_ppm_packed(img_obuf_hsl);
+    if (!inplace)
+        free_ppm_packed(img_obuf_yuv);
+
+    return times;
+}
 
 
-timeGray run_cpu_gray_test(PGM_IMG img_in)
+
+
+timeGray run_cpu_gray_test(PGM_IMG img_in, int inplace)
 {
     PGM_IMG img_obuf;  
     timeGray t_gray;
@@ -143,7 +275,12 @@ timeGray run_cpu_gray_test(PGM_IMG img_in)
     printf("Starting CPU processing...\n");
     
     double tstart = MPI_Wtime();
-    img_obuf = contrast_enhancement_g(img_in);
+    if (inplace) {
+        contrast_enhancement_g_inplace(img_in);
+        img_obuf = img_in;
+    } else {
+        img_obuf = contrast_enhancement_g(img_in);
+    }
     double tfinish = MPI_Wtime();
     t_gray.time_test = tfinish - tstart;
 
@@ -153,106 +290,176 @@ timeGray run_cpu_gray_test(PGM_IMG img_in)
     write_pgm(img_obuf, "out.pgm");
     tfinish = MPI_Wtime();
     t_gray.time_write = tfinish - tstart;
-    free_pgm(img_obuf);
+    if (!inplace)
+        free_pgm(img_obuf);
 
     return t_gray;
 }
 
 
+// Modo streaming: lectura, proceso y escritura se hacen banda a banda,
+// por lo que todo el tiempo se contabiliza como tiempo de procesamiento
+timeColor run_cpu_color_test_stream(size_t mem_budget)
+{
+    timeColor times;
+
+    printf("Starting CPU processing...\n");
+
+    double tstart = MPI_Wtime();
+    contrast_enhancement_c_hsl_stream("in.ppm", "out_hsl.ppm", mem_budget);
+    double tfinish = MPI_Wtime();
+    printf("HSL processing time: %f (s)\n", tfinish - tstart);
+    times.time_hsl = tfinish - tstart;
+    times.time_write_hsl = 0;
+
+    tstart = MPI_Wtime();
+    contrast_enhancement_c_yuv_stream("in.ppm", "out_yuv.ppm", mem_budget);
+    tfinish = MPI_Wtime();
+    printf("YUV processing time: %f (s)\n", tfinish - tstart);
+    times.time_yuv = tfinish - tstart;
+    times.time_write_yuv = 0;
+
+    return times;
+}
+
+timeGray run_cpu_gray_test_stream(size_t mem_budget)
+{
+    timeGray t_gray;
+
+    printf("Starting CPU processing...\n");
+
+    double tstart = MPI_Wtime();
+    contrast_enhancement_g_stream("in.pgm", "out.pgm", mem_budget);
+    double tfinish = MPI_Wtime();
+    t_gray.time_test = tfinish - tstart;
+    t_gray.time_write = 0;
+
+    printf("Processing time: %f (s)\n", t_gray.time_test);
+
+    return t_gray;
+}
+
 
 PPM_IMG read_ppm(const char * path){
     FILE * in_file;
-    char sbuf[256];
     
     char *ibuf;
     PPM_IMG result;
-    int v_max, i;
     in_file = fopen(path, "r");
     if (in_file == NULL){
         printf("Input file not found!\n");
         exit(1);
     }
-    /*Skip the magic number*/
-    fscanf(in_file, "%s", sbuf);
-
-
-    //result = malloc(sizeof(PPM_IMG));
-    fscanf(in_file, "%d",&result.w);
-    fscanf(in_file, "%d",&result.h);
-    fscanf(in_file, "%d\n",&v_max);
-    printf("Image size: %d x %d\n", result.w, result.h);
+    PNM_HEADER hdr = read_pnm_header(in_file);
+    printf("Image size: %d x %d\n", hdr.w, hdr.h);
     
 
-    result.img_r = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_g = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    result.img_b = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
-    ibuf         = (char *)malloc(3 * result.w * result.h * sizeof(char));
+    result = alloc_ppm(hdr.w, hdr.h);
+    ibuf         = (char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(char));
 
     
-    fread(ibuf,sizeof(unsigned char), 3 * result.w*result.h, in_file);
+    fread(ibuf,sizeof(unsigned char), 3 * (size_t)result.w * result.h, in_file);
 
-    for(i = 0; i < result.w*result.h; i ++){
-        result.img_r[i] = ibuf[3*i + 0];
-        result.img_g[i] = ibuf[3*i + 1];
-        result.img_b[i] = ibuf[3*i + 2];
-    }
+    deinterleave_rgb((const unsigned char *)ibuf, result.img_r, result.img_g, result.img_b, (size_t)result.w * result.h);
     
     fclose(in_file);
-    free(ibuf);
+    pool_free(ibuf);
     
     return result;
 }
 
 void write_ppm(PPM_IMG img, const char * path){
     FILE * out_file;
-    int i;
     
-    char * obuf = (char *)malloc(3 * img.w * img.h * sizeof(char));
+    char * obuf = (char *)pool_alloc(3 * (size_t)img.w * img.h * sizeof(char));
 
-    for(i = 0; i < img.w*img.h; i ++){
-        obuf[3*i + 0] = img.img_r[i];
-        obuf[3*i + 1] = img.img_g[i];
-        obuf[3*i + 2] = img.img_b[i];
-    }
+    interleave_rgb(img.img_r, img.img_g, img.img_b, (unsigned char *)obuf, (size_t)img.w * img.h);
     out_file = fopen(path, "wb");
     fprintf(out_file, "P6\n");
     fprintf(out_file, "%d %d\n255\n",img.w, img.h);
-    fwrite(obuf,sizeof(unsigned char), 3*img.w*img.h, out_file);
+    fwrite(obuf,sizeof(unsigned char), 3*(size_t)img.w * img.h, out_file);
     fclose(out_file);
-    free(obuf);
+    pool_free(obuf);
 }
 
 void free_ppm(PPM_IMG img)
 {
-    free(img.img_r);
-    free(img.img_g);
-    free(img.img_b);
+    pool_free(img.img_r);
+}
+
+// Los tres planos de una imagen salen de un único bloque de la reserva de buffers,
+// cada uno alineado a POOL_ALIGN; el bloque empieza en el primer plano
+PPM_IMG alloc_ppm(int w, int h)
+{
+    PPM_IMG img;
+    size_t stride = pool_plane_stride((size_t)w * h);
+    unsigned char * block = (unsigned char *)pool_alloc(3 * stride);
+
+    img.w = w;
+    img.h = h;
+    img.img_r = block;
+    img.img_g = block + stride;
+    img.img_b = block + 2 * stride;
+    return img;
+}
+
+// Lectura y escritura sin separar canales: los píxeles se copian tal como están en el fichero
+PPM_PACKED_IMG read_ppm_packed(const char * path){
+    FILE * in_file;
+    PPM_PACKED_IMG result;
+
+    in_file = fopen(path, "r");
+    if (in_file == NULL){
+        printf("Input file not found!\n");
+        exit(1);
+    }
+    PNM_HEADER hdr = read_pnm_header(in_file);
+    result.w = hdr.w;
+    result.h = hdr.h;
+    printf("Image size: %d x %d\n", result.w, result.h);
+
+    result.img = (unsigned char *)pool_alloc(3 * (size_t)result.w * result.h * sizeof(unsigned char));
+    fread(result.img, sizeof(unsigned char), 3 * (size_t)result.w * result.h, in_file);
+
+    fclose(in_file);
+    return result;
+}
+
+void write_ppm_packed(PPM_PACKED_IMG img, const char * path){
+    FILE * out_file = fopen(path, "wb");
+
+    fprintf(out_file, "P6\n");
+    fprintf(out_file, "%d %d\n255\n",img.w, img.h);
+    fwrite(img.img, sizeof(unsigned char), 3*(size_t)img.w * img.h, out_file);
+    fclose(out_file);
+}
+
+void free_ppm_packed(PPM_PACKED_IMG img)
+{
+    pool_free(img.img);
 }
 
 PGM_IMG read_pgm(const char * path){
     FILE * in_file;
-    char sbuf[256];
     
     
     PGM_IMG result;
-    int v_max;//, i;
     in_file = fopen(path, "r");
     if (in_file == NULL){
         printf("Input file not found!\n");
         exit(1);
     }
     
-    fscanf(in_file, "%s", sbuf); /*Skip the magic number*/
-    fscanf(in_file, "%d",&result.w);
-    fscanf(in_file, "%d",&result.h);
-    fscanf(in_file, "%d\n",&v_max);
+    PNM_HEADER hdr = read_pnm_header(in_file);
+    result.w = hdr.w;
+    result.h = hdr.h;
     printf("Image size: %d x %d\n", result.w, result.h);
     
 
-    result.img = (unsigned char *)malloc(result.w * result.h * sizeof(unsigned char));
+    result.img = (unsigned char *)pool_alloc((size_t)result.w * result.h * sizeof(unsigned char));
 
         
-    fread(result.img,sizeof(unsigned char), result.w*result.h, in_file);    
+    fread(result.img,sizeof(unsigned char), (size_t)result.w * result.h, in_file);    
     fclose(in_file);
     
     return result;
@@ -263,12 +470,163 @@ void write_pgm(PGM_IMG img, const char * path){
     out_file = fopen(path, "wb");
     fprintf(out_file, "P5\n");
     fprintf(out_file, "%d %d\n255\n",img.w, img.h);
-    fwrite(img.img,sizeof(unsigned char), img.w*img.h, out_file);
+    fwrite(img.img,sizeof(unsigned char), (size_t)img.w * img.h, out_file);
     fclose(out_file);
 }
 
 void free_pgm(PGM_IMG img)
 {
-    free(img.img);
+    pool_free(img.img);
 }
 
+MAPPED_IMG map_pnm(const char * path){
+    MAPPED_IMG result;
+    struct stat st;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0){
+        printf("Input file not found!\n");
+        exit(1);
+    }
+    result.map_size = st.st_size;
+
+    // El fichero se recorre una sola vez de principio a fin
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    // Escribible y privada (copia en escritura): el modo C_INPLACE ecualiza sobre la
+    // propia proyección sin modificar el fichero
+    result.map = mmap(NULL, result.map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // La proyección sigue siendo válida tras cerrar el descriptor
+    if (result.map == MAP_FAILED){
+        printf("Input file could not be mapped!\n");
+        exit(1);
+    }
+    madvise(result.map, result.map_size, MADV_SEQUENTIAL);
+    madvise(result.map, result.map_size, MADV_WILLNEED);
+
+    // La cabecera se interpreta sobre la propia proyección con el mismo lector que la
+    // lectura con stdio, así que ambos modos aceptan exactamente los mismos ficheros
+    FILE * header_file = fmemopen(result.map, result.map_size, "rb");
+    PNM_HEADER hdr = read_pnm_header(header_file);
+    fclose(header_file);
+    result.w = hdr.w;
+    result.h = hdr.h;
+    result.channels = hdr.channels;
+
+    const unsigned char * p = (const unsigned char *)result.map + hdr.offset;
+    const unsigned char * end = (const unsigned char *)result.map + result.map_size;
+
+    result.data = (unsigned char *)p;
+    if (p > end || (size_t)(end - p) < (size_t)result.channels * (size_t)result.w * result.h){
+        printf("Input file is truncated!\n");
+        exit(1);
+    }
+
+    return result;
+}
+
+void unmap_pnm(MAPPED_IMG img){
+    munmap(img.map, img.map_size);
+}
+
+PGM_IMG pgm_view(MAPPED_IMG img){
+    // Vista sin copia: los píxeles se leen directamente de la proyección.
+    // No se debe llamar a free_pgm sobre ella, sino a unmap_pnm.
+    PGM_IMG result;
+    result.w = img.w;
+    result.h = img.h;
+    result.img = img.data;
+    return result;
+}
+
+PPM_PACKED_IMG ppm_packed_view(MAPPED_IMG img){
+    // Vista sin copia de una imagen en color: se libera con unmap_pnm, no con free_ppm_packed
+    PPM_PACKED_IMG result;
+    result.w = img.w;
+    result.h = img.h;
+    result.img = img.data;
+    return result;
+}
+
+PPM_IMG read_ppm_mmap(const char * path){
+    // Separamos los canales leyendo directamente de la proyección, sin buffer intermedio
+    MAPPED_IMG mapped = map_pnm(path);
+    PPM_IMG result = alloc_ppm(mapped.w, mapped.h);
+
+    const unsigned char * ibuf = mapped.data;
+    deinterleave_rgb(ibuf, result.img_r, result.img_g, result.img_b, (size_t)result.w * result.h);
+
+    unmap_pnm(mapped);
+
+    return result;
+}
+
+PNM_STREAM open_pnm_stream(const char * path){
+    PNM_STREAM s;
+
+    s.file = fopen(path, "rb");
+    if (s.file == NULL){
+        printf("Input file not found!\n");
+        exit(1);
+    }
+    PNM_HEADER hdr = read_pnm_header(s.file);
+    s.w = hdr.w;
+    s.h = hdr.h;
+    s.channels = hdr.channels;
+    s.offset = hdr.offset;
+    printf("Image size: %d x %d\n", s.w, s.h);
+
+    return s;
+}
+
+PNM_STREAM create_pnm_stream(const char * path, int w, int h, int channels){
+    PNM_STREAM s;
+
+    s.file = fopen(path, "wb");
+    if (s.file == NULL){
+        printf("Output file could not be created!\n");
+        exit(1);
+    }
+    fprintf(s.file, (channels == 3) ? "P6\n" : "P5\n");
+    fprintf(s.file, "%d %d\n255\n", w, h);
+    s.w = w;
+    s.h = h;
+    s.channels = channels;
+    s.offset = ftell(s.file);
+
+    return s;
+}
+
+void close_pnm_stream(PNM_STREAM s){
+    fclose(s.file);
+}
+
+// Lee o escribe rows filas a partir de first_row; los píxeles de cada fila son contiguos en el fichero
+static void read_rows(PNM_STREAM s, int first_row, int rows, unsigned char * buf){
+    fseek(s.file, s.offset + (long)s.channels * s.w * first_row, SEEK_SET);
+    if (fread(buf, sizeof(unsigned char), (size_t)s.channels * (size_t)s.w * rows, s.file) != (size_t)s.channels * (size_t)s.w * rows){
+        printf("Input file is truncated!\n");
+        exit(1);
+    }
+}
+
+static void write_rows(PNM_STREAM s, int first_row, int rows, const unsigned char * buf){
+    fseek(s.file, s.offset + (long)s.channels * s.w * first_row, SEEK_SET);
+    fwrite(buf, sizeof(unsigned char), (size_t)s.channels * (size_t)s.w * rows, s.file);
+}
+
+void read_pgm_rows(PNM_STREAM s, int first_row, PGM_IMG band){
+    read_rows(s, first_row, band.h, band.img);
+}
+
+void write_pgm_rows(PNM_STREAM s, int first_row, PGM_IMG band){
+    write_rows(s, first_row, band.h, band.img);
+}
+
+void read_ppm_packed_rows(PNM_STREAM s, int first_row, PPM_PACKED_IMG band){
+    read_rows(s, first_row, band.h, band.img);
+}
+
+void write_ppm_packed_rows(PNM_STREAM s, int first_row, PPM_PACKED_IMG band){
+    write_rows(s, first_row, band.h, band.img);
+}
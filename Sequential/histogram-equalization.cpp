@@ -2,23 +2,21 @@
 #include <string.h>
 #include <stdlib.h>
 #include "hist-equ.h"
+#include "pixel-kernels.h"
 
 
-void histogram(int * hist_out, unsigned char * img_in, int img_size, int nbr_bin){
+void histogram(int64_t * hist_out, unsigned char * img_in, size_t img_size, int nbr_bin){
     int i;
     for ( i = 0; i < nbr_bin; i ++){
         hist_out[i] = 0;
     }
 
-    for ( i = 0; i < img_size; i ++){
-        hist_out[img_in[i]] ++;
-    }
+    histogram_banked(hist_out, img_in, img_size);
 }
 
-void histogram_equalization(unsigned char * img_out, unsigned char * img_in, 
-                            int * hist_in, int img_size, int nbr_bin){
-    int *lut = (int *)malloc(sizeof(int)*nbr_bin);
-    int i, cdf, min, d;
+void histogram_lut(unsigned char * lut, int64_t * hist_in, size_t img_size, int nbr_bin){
+    int i, v;
+    int64_t cdf, min, d; // En 64 bits: una imagen puede tener más de 2^31 píxeles
     /* Construct the LUT by calculating the CDF */
     cdf = 0;
     min = 0;
@@ -30,25 +28,33 @@ void histogram_equalization(unsigned char * img_out, unsigned char * img_in,
     for(i = 0; i < nbr_bin; i ++){
         cdf += hist_in[i];
         //lut[i] = (cdf - min)*(nbr_bin - 1)/d;
-        lut[i] = (int)(((float)cdf - min)*255/d + 0.5);
-        if(lut[i] < 0){
-            lut[i] = 0;
-        }
-        
-        
-    }
-    
-    /* Get the result image */
-    for(i = 0; i < img_size; i ++){
-        if(lut[img_in[i]] > 255){
-            img_out[i] = 255;
+        v = (int)(((float)cdf - min)*255/d + 0.5);
+        /* The table is stored already clamped to [0, 255] */
+        if(v < 0){
+            v = 0;
         }
-        else{
-            img_out[i] = (unsigned char)lut[img_in[i]];
+        if(v > 255){
+            v = 255;
         }
+        lut[i] = (unsigned char)v;
+        
         
     }
 }
 
+void apply_lut(unsigned char * img_out, unsigned char * img_in, unsigned char * lut, size_t img_size){
+    /* Get the result image */
+    apply_lut_u8(lut, img_in, img_out, img_size);
+}
 
+void histogram_equalization(unsigned char * img_out, unsigned char * img_in, 
+                            int64_t * hist_in, size_t img_size, int nbr_bin){
+    unsigned char lut[256]; // nbr_bin es siempre 256: la tabla va en la pila, sin reservas por llamada
+    histogram_lut(lut, hist_in, img_size, nbr_bin);
+    apply_lut(img_out, img_in, lut, img_size);
+}
 
+// Ecualización en el sitio: img se sobrescribe con el resultado
+void histogram_equalization_inplace(unsigned char * img, int64_t * hist_in, size_t img_size, int nbr_bin){
+    histogram_equalization(img, img, hist_in, img_size, nbr_bin);
+}
@@ -4,22 +4,38 @@
 make
 
 # Se obtienen los datos de OpenMP
-schedule="static guided dynamic"
-chunk_size="16 32 64 128 256 512 1024 2048 4096"
+# La planificación y el tamaño de bloque de cada bucle los elige el autoajuste: la primera
+# ejecución de cada número de hilos los mide y las siguientes los leen de la caché del nodo
+export C_OMP_AUTOTUNE=1
 num_threads="1 2 4 8 16"
 
 for n in $num_threads; do
     export OMP_NUM_THREADS=$n
-    for sche in $schedule; do
-        export C_OMP_SCHEDULE="$sche"
-        for chunk in $chunk_size; do
-            export C_OMP_CHUNK_SIZE=$chunk
-            for i in $(seq 1 5); do
-                srun -p gpus -N 1 -n 1 ./contrast_omp
-            done
-        done
+    for i in $(seq 1 5); do
+        srun -p gpus -N 1 -n 1 ./contrast_omp
+    done
+done
+unset C_OMP_AUTOTUNE
+
+# El mismo binario con el pool de robo de trabajo en lugar de las planificaciones de OpenMP
+export C_BACKEND=steal
+for n in $num_threads; do
+    export OMP_NUM_THREADS=$n
+    for i in $(seq 1 5); do
+        srun -p gpus -N 1 -n 1 ./contrast_omp
+    done
+done
+unset C_BACKEND
+
+# Se obtienen los datos de la versión con algoritmos paralelos de C++17 (sin OpenMP)
+mkdir -p data/ParallelSTL/gray data/ParallelSTL/color
+for n in $num_threads; do
+    export C_PSTL_THREADS=$n
+    for i in $(seq 1 5); do
+        srun -p gpus -N 1 -n 1 ./contrast_pstl
     done
 done
+unset C_PSTL_THREADS
 
 
 # Se obtienen los datos de MPI
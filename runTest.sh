@@ -12,7 +12,7 @@ if [ ! -f "./in.pgm" ] || [ ! -f "./in.ppm" ]; then
     exit 1
 fi
 
-versions=("OpenMP" "MPI" "MPI+OpenMP")
+versions=("OpenMP" "MPI" "MPI+OpenMP" "ParallelSTL")
 
 echo "=================================================================="
 # Print parameter
@@ -61,6 +61,12 @@ run_mpi_openmp() {
     check_output_difference 2
 }
 
+# Execute C++17 parallel algorithms version, and save the output
+run_pstl() {
+    mpirun -np 1 ./ParallelSTL/build/contrast
+    check_output_difference 3
+}
+
 # check the difference between the sequential and parallel versions
 check_output_difference() {
     echo "=================================================================="
@@ -81,18 +87,20 @@ check_output_difference() {
     echo "=================================================================="
 }
 
-passed_versions=("0" "0" "0")
+passed_versions=("0" "0" "0" "0")
 
 if [ -z "$1" ]; then
     run_openmp
     run_mpi
     run_mpi_openmp
+    run_pstl
 else
     case $1 in
         0) run_openmp ;;
         1) run_mpi ;;
         2) run_mpi_openmp ;;
-        *) echo "Invalid parameter. Use 0 for OpenMP, 1 for MPI, or 2 for MPI+OpenMP." ;;
+        3) run_pstl ;;
+        *) echo "Invalid parameter. Use 0 for OpenMP, 1 for MPI, 2 for MPI+OpenMP, or 3 for ParallelSTL." ;;
     esac
 fi
 